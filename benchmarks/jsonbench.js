@@ -0,0 +1,123 @@
+/**
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/* jsonbench.js
+ * Measures setMulti throughput for JSON documents of increasing size,
+ * comparing the native encoder against the value being passed through
+ * JSON.stringify first (which is what the binding used to do internally).
+ *
+ * To run from command line:
+ *   node jsonbench [host] [bucket] [batches]
+ */
+var couchbase = require('../lib/couchbase.js');
+
+var config = {
+  host: process.argv[2] || 'localhost:8091',
+  bucket: process.argv[3] || 'default',
+  batches: parseInt(process.argv[4], 10) || 200,
+  batchSize: 100,
+  docSizes: [200, 1024, 4096, 16384, 65536]
+};
+
+// Builds a document of roughly `size` bytes of JSON, shaped like a typical
+// application document: a few scalar fields plus a list of sub-objects.
+function makeDoc(size) {
+  var doc = {
+    type: 'benchmark',
+    id: 12345,
+    ratio: 0.75,
+    active: true,
+    tags: ['alpha', 'beta', 'gamma'],
+    items: []
+  };
+  var ii = 0;
+  while (JSON.stringify(doc).length < size) {
+    doc.items.push({ name: 'item-' + ii, qty: ii, price: ii * 1.25,
+      note: 'line "' + ii + '"\n' });
+    ii++;
+  }
+  return doc;
+}
+
+function makeBatch(doc, prefix, stringify) {
+  var kv = {};
+  for (var ii = 0; ii < config.batchSize; ii++) {
+    if (stringify) {
+      kv[prefix + ii] = { value: JSON.stringify(doc), format: 'utf8',
+        flags: couchbase.format.json };
+    } else {
+      kv[prefix + ii] = { value: doc };
+    }
+  }
+  return kv;
+}
+
+function runOne(client, size, stringify, callback) {
+  var doc = makeDoc(size);
+  var prefix = 'jsonbench-' + size + '-';
+  var remaining = config.batches;
+  var start = process.hrtime();
+
+  function next() {
+    if (remaining-- === 0) {
+      var diff = process.hrtime(start);
+      var secs = diff[0] + diff[1] / 1e9;
+      var ops = config.batches * config.batchSize;
+      callback({
+        size: size,
+        mode: stringify ? 'stringify' : 'native',
+        opsPerSec: (ops / secs).toFixed(0),
+        mbPerSec: (ops * size / secs / (1024 * 1024)).toFixed(2)
+      });
+      return;
+    }
+    client.setMulti(makeBatch(doc, prefix, stringify), null, function(err) {
+      if (err) {
+        console.log('ERR: ', err);
+        process.exit(1);
+      }
+      next();
+    });
+  }
+  next();
+}
+
+var client = new couchbase.Connection(
+  { host: config.host, bucket: config.bucket }, function(err) {
+    if (err) {
+      console.log('ERR: Unable to connect to Server');
+      process.exit(1);
+    }
+
+    var runs = [];
+    config.docSizes.forEach(function(size) {
+      runs.push([size, true]);
+      runs.push([size, false]);
+    });
+
+    (function nextRun() {
+      var run = runs.shift();
+      if (!run) {
+        client.shutdown();
+        return;
+      }
+      runOne(client, run[0], run[1], function(res) {
+        console.log(res.mode + '\t' + res.size + ' B\t' +
+          res.opsPerSec + ' ops/s\t' + res.mbPerSec + ' MB/s');
+        nextRun();
+      });
+    })();
+  });
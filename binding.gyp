@@ -93,13 +93,20 @@
       'src/constants.cc',
       'src/namemap.cc',
       'src/cookie.cc',
+      'src/cookiepool.cc',
+      'src/callbackbatch.cc',
+      'src/bufferpool.cc',
+      'src/keycache.cc',
       'src/commandbase.cc',
       'src/commands.cc',
       'src/exception.cc',
       'src/options.cc',
       'src/cas.cc',
       'src/uv-plugin-all.c',
-      'src/valueformat.cc'
+      'src/valueformat.cc',
+      'src/jsonencoder.cc',
+      'src/jsondecoder.cc',
+      'src/viewrows.cc'
     ],
     'include_dirs': [
       '<!(node -e "require(\'nan\')")',
@@ -170,6 +170,21 @@ typedef struct lcb_CMDBASE {
     lcb_KEYBUF hashkey; \
     lcb_CMDOPTIONS options
 
+/**
+ * @brief Flag indicating that the vBucket of the key has already been computed
+ *
+ * If set in `cmdflags`, the lower 16 bits of `cmdflags` hold the vBucket ID
+ * for the key, and the key is not hashed again. This may be used by callers
+ * which cache the result of lcbvb_k2vb() for frequently used keys. The flag
+ * is ignored if there is a `hashkey`, if the bucket is not a vBucket bucket,
+ * or if the ID is out of range for the current configuration.
+ * @volatile
+ */
+#define LCB_CMD_F_VBID 0x10000
+
+/** @brief Mask for the vBucket ID when LCB_CMD_F_VBID is set */
+#define LCB_CMD_VBID_MASK 0xffff
+
 typedef lcb_CMDBASE lcb_CMDTOUCH;
 typedef lcb_CMDBASE lcb_CMDSTATS;
 typedef lcb_CMDBASE lcb_CMDFLUSH;
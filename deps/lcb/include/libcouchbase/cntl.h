@@ -347,7 +347,8 @@ typedef enum {
  * @brief Polling grace interval for lcb_durability_poll()
  *
  * This is the time the client will wait between repeated probes to
- * a given server.
+ * a given server. Requests which do not specify an interval poll sooner
+ * when keys are expected to be ready earlier, but never wait longer than this.
  *
  * Modes    | Arg
  * ---------| ----------------
@@ -1108,8 +1109,271 @@ struct lcb_cntl_rdballocfactory {
  */
 #define LCB_CNTL_REINIT_DSN 0x2B
 
+/**
+ * @uncommitted
+ *
+ * Record the latency of each operation in a histogram per server and per
+ * opcode. The histograms may be retrieved using lcb_get_latencies()
+ *
+ * Mode|Arg
+ * ----|---
+ * Set, Get | `int*`
+ */
+#define LCB_CNTL_OPLATENCY 0x2C
+
+/**
+ * Policy deciding which outgoing values are compressed, when compression is
+ * enabled using @ref LCB_CNTL_COMPRESSION_OPTS
+ */
+typedef struct {
+    /** Values smaller than this many bytes are never compressed */
+    lcb_U32 min_size;
+
+    /**
+     * Minimum ratio of the original size to the compressed size. Values which
+     * do not compress at least this well are sent uncompressed.
+     */
+    float min_ratio;
+
+    /**
+     * When consecutive values sharing a key prefix (the part of the key
+     * before the first `:`, `_`, `-`, `|`, `/` or `.`) fail to compress, only
+     * every Nth value of that prefix is tried, doubling N for each further
+     * failure up to this limit. A successful compression resets the prefix.
+     * Set to 1 to try every value.
+     */
+    lcb_U32 max_sample_interval;
+} lcb_COMPRESSPOLICY;
+
+/**
+ * @uncommitted
+ *
+ * @brief Get or set the policy for compressing outgoing values
+ *
+ * Mode|Arg
+ * ----|---
+ * Set, Get | `lcb_COMPRESSPOLICY *`
+ */
+#define LCB_CNTL_COMPRESSION_POLICY 0x2D
+
+/** Counters for outgoing value compression */
+typedef struct {
+    lcb_U64 nvalues; /**< Values considered for compression */
+    lcb_U64 ncompressed; /**< Values sent compressed */
+    lcb_U64 nsmall; /**< Values skipped for being below the minimum size */
+    lcb_U64 nbackoff; /**< Values skipped because their key prefix did not compress */
+    lcb_U64 nrejected; /**< Values sent uncompressed for failing the ratio */
+    lcb_U64 bytes_raw; /**< Original size of the values sent compressed */
+    lcb_U64 bytes_compressed; /**< Compressed size of the values sent compressed */
+    lcb_U64 compress_ns; /**< Time spent compressing values, in nanoseconds */
+} lcb_COMPRESSSTATS;
+
+/**
+ * @uncommitted
+ *
+ * @brief Get the compression counters for outgoing values
+ *
+ * Mode|Arg
+ * ----|---
+ * Get | `lcb_COMPRESSSTATS *`
+ */
+#define LCB_CNTL_COMPRESSION_STATS 0x2E
+
+/** Sizing of the memcached connection pool */
+typedef struct {
+    /**
+     * Number of idle connections to keep open to each server. These are
+     * connected in the background, so that a replacement is ready if a
+     * connection fails, and are not closed when idle.
+     */
+    lcb_U32 min_idle;
+    lcb_U32 max_idle; /**< Maximum number of idle connections per server */
+    lcb_U32 max_total; /**< Maximum number of connections per server. 0 for no limit */
+    lcb_U32 idle_timeout; /**< Microseconds before an idle connection is closed */
+} lcb_POOLOPTS;
+
+/**
+ * @uncommitted
+ *
+ * @brief Get or set the sizing of the memcached connection pool
+ *
+ * Setting this immediately starts any connections required to satisfy
+ * lcb_POOLOPTS::min_idle.
+ *
+ * Mode|Arg
+ * ----|---
+ * Set, Get | `lcb_POOLOPTS *`
+ */
+#define LCB_CNTL_MEMDPOOL_OPTS 0x2F
+
+/** Statistics for the connections to a single host */
+typedef struct {
+    const char *host; /**< The host, as `host:port` */
+    lcb_U32 waiters; /**< Requests waiting for a connection */
+    lcb_U32 idle; /**< Connections ready for use */
+    lcb_U32 pending; /**< Connections being established */
+    lcb_U32 leased; /**< Connections in use */
+    lcb_U32 total; /**< All connections, including pending ones */
+    lcb_U64 connects; /**< Connections successfully established */
+    lcb_U64 connect_errors; /**< Connections which failed */
+    lcb_U64 connect_time; /**< Total microseconds taken to establish connections */
+    lcb_U32 connect_time_max; /**< Longest time taken to establish a connection */
+} lcb_POOLHOSTSTATS;
+
+typedef void (*lcb_POOLSTATS_CALLBACK)(lcb_t instance, const void *cookie,
+                                       const lcb_POOLHOSTSTATS *stats);
+
+/** Argument for @ref LCB_CNTL_MEMDPOOL_STATS */
+typedef struct {
+    lcb_POOLSTATS_CALLBACK callback; /**< Invoked once per host */
+    const void *cookie; /**< Passed to the callback */
+} lcb_POOLSTATSREQ;
+
+/**
+ * @uncommitted
+ *
+ * @brief Get the statistics of the memcached connection pool, per host
+ *
+ * Mode|Arg
+ * ----|---
+ * Get | `lcb_POOLSTATSREQ *`
+ */
+#define LCB_CNTL_MEMDPOOL_STATS 0x30
+
+/** Connections used for key-value operations on each data node */
+typedef struct {
+    /**
+     * Number of connections to open to each data node. Operations are placed
+     * on the connection with the fewest bytes awaiting a response.
+     */
+    lcb_U32 nconns;
+    /**
+     * Values of this size or larger are sent over a connection of their own
+     * (one of the `nconns`), so they do not delay smaller operations. 0
+     * to disable. Only used if `nconns` is greater than 1.
+     */
+    lcb_U32 large_value;
+} lcb_KVCONNOPTS;
+
+/**
+ * @uncommitted
+ *
+ * @brief Get or set the number of connections used for each data node
+ *
+ * Changes apply immediately. Operations pending on connections removed by
+ * lowering the count are retried as if their server had left the cluster.
+ * Note that lcb_POOLOPTS::max_total, if set, must allow for the number of
+ * connections requested here.
+ *
+ * Mode|Arg
+ * ----|---
+ * Set, Get | `lcb_KVCONNOPTS *`
+ */
+#define LCB_CNTL_KVCONNS 0x31
+
+/** Totals of the writes made to the data nodes */
+typedef struct {
+    lcb_U64 nwrites; /**< Number of write (`send()`/`writev()`) calls */
+    lcb_U64 nbytes; /**< Number of bytes passed to those calls */
+    lcb_U64 nbufs; /**< Number of buffers passed to those calls */
+    /**
+     * Number of bytes copied so that runs of small buffers could be written
+     * as a single one
+     */
+    lcb_U64 ncoalesced;
+} lcb_FLUSHSTATS;
+
+/**
+ * @uncommitted
+ *
+ * @brief Get the number of writes made to the data nodes and their sizes
+ *
+ * The counters cover all the connections used for key-value operations
+ * since the instance was created (or the nodes were added to the cluster).
+ * `nbytes / nwrites` is the average number of bytes per write.
+ *
+ * Mode|Arg
+ * ----|---
+ * Get | `lcb_FLUSHSTATS *`
+ */
+#define LCB_CNTL_FLUSHSTATS 0x32
+
+/** Latency statistics for a single N1QL query node */
+typedef struct {
+    const char *host; /**< The host, as `host:port` */
+    /**
+     * Moving average of the time taken for a response to start arriving, in
+     * microseconds. 0 if no query has been sent to the node yet
+     */
+    lcb_U32 latency;
+    lcb_U32 inflight; /**< Queries awaiting a response */
+    int failed; /**< Whether the last query sent to the node failed */
+} lcb_N1QLHOSTSTATS;
+
+typedef void (*lcb_N1QLSTATS_CALLBACK)(lcb_t instance, const void *cookie,
+                                       const lcb_N1QLHOSTSTATS *stats);
+
+/** Argument for @ref LCB_CNTL_N1QL_HOSTS in get mode */
+typedef struct {
+    lcb_N1QLSTATS_CALLBACK callback; /**< Invoked once per query node */
+    const void *cookie; /**< Passed to the callback */
+} lcb_N1QLSTATSREQ;
+
+/**
+ * @volatile
+ *
+ * @brief Set the N1QL query nodes, or get their latency statistics
+ *
+ * The cluster configuration does not list the query nodes, so they must be
+ * set before executing @ref LCB_HTTP_TYPE_N1QL requests. They are set as a
+ * semicolon-separated list of `host:port`, in which the port defaults to
+ * 8093. Statistics of nodes which are in both the old and new lists are
+ * kept.
+ *
+ * Mode|Arg
+ * ----|---
+ * Set | `const char *`
+ * Get | `lcb_N1QLSTATSREQ *`
+ */
+#define LCB_CNTL_N1QL_HOSTS 0x33
+
+/** Totals of the work done to apply new cluster maps */
+typedef struct {
+    lcb_U64 napplied; /**< Number of cluster maps applied */
+    /**
+     * Queued packets checked for a change in their vBucket's master. A
+     * packet relocated to a node whose queue is checked afterwards is
+     * counted again
+     */
+    lcb_U64 nexamined;
+    lcb_U64 nrelocated; /**< Packets moved to the queue of another node */
+    /**
+     * Packets not checked, as they were queued for a node which kept all of
+     * its vBuckets
+     */
+    lcb_U64 nskipped;
+    /** Time spent replacing the nodes and relocating packets, in nanoseconds */
+    lcb_U64 ns_total;
+    lcb_U64 ns_last; /**< The same, for the last map applied */
+} lcb_CONFIGSTATS;
+
+/**
+ * @uncommitted
+ *
+ * @brief Get the number of packets relocated when applying new cluster maps
+ *
+ * When the cluster map changes, only the packets queued for nodes which were
+ * the master of a vBucket that moved are checked, and of those only the ones
+ * for the moved vBuckets are relocated.
+ *
+ * Mode|Arg
+ * ----|---
+ * Get | `lcb_CONFIGSTATS *`
+ */
+#define LCB_CNTL_CONFIGSTATS 0x34
+
 /** This is not a command, but rather an indicator of the last item */
-#define LCB_CNTL__MAX                    0x2C
+#define LCB_CNTL__MAX                    0x35
 /**@}*/
 
 #ifdef __cplusplus
@@ -841,6 +841,12 @@ typedef struct {
     lcb_uint32_t flags; /**< Server side flags stored with the item */
     lcb_cas_t cas; /**< CAS representing current mutation state of the item */
     lcb_U8 datatype; /**< Currently unused */
+    /**
+     * If not NULL, the buffer backing `bytes`. This may be passed to
+     * lcb_backbuf_ref() to keep `bytes` valid after the callback returns, in
+     * which case lcb_backbuf_unref() must be called once it is no longer needed.
+     */
+    void *bufh;
 } lcb_GETRESPv0;
 
 /**
@@ -1812,7 +1818,8 @@ lcb_error_t lcb_touch(lcb_t instance,
  *
  * The lcb_DURABILITYOPTSv0::interval field specifies how long to wait between
  * each attempt at verifying the completion of the durability requirements.
- * If not specified, this will be @ref LCB_CNTL_DURABILITY_INTERVAL
+ * If not specified, the wait adapts to the time keys have recently taken to
+ * meet their requirements, up to @ref LCB_CNTL_DURABILITY_INTERVAL
  *
  * The lcb_DURABILITYOPTSv0::persist_to field specifies how many nodes must
  * contain the item on their disk in order for the command to succeed.
@@ -2472,7 +2479,17 @@ typedef enum {
      * Execute an arbitrary request against a host and port
      */
     LCB_HTTP_TYPE_RAW = 2,
-    LCB_HTTP_TYPE_MAX = 3
+
+    /**
+     * @volatile
+     *
+     * Execute a N1QL query against one of the query nodes set with
+     * @ref LCB_CNTL_N1QL_HOSTS. The node is chosen according to the latency
+     * of its recent responses, and the connection is kept open and reused
+     * for later queries.
+     */
+    LCB_HTTP_TYPE_N1QL = 3,
+    LCB_HTTP_TYPE_MAX = 4
 } lcb_http_type_t;
 
 /**
@@ -2636,6 +2653,12 @@ lcb_set_http_data_callback(lcb_t, lcb_http_data_callback);
  *   buckets, rebalance etc. The result will be passed to management
  *   callbacks (data/complete).
  *
+ * - LCB_HTTP_TYPE_N1QL
+ *
+ *   The query is passed as the body of a `POST` request, usually to the
+ *   `/query` path. As with views, the data callback may be used to receive
+ *   the results as they arrive.
+ *
  * Fetch first 10 docs from `_design/test/_view/all` view
  * @code{.c}
  *   lcb_http_request_t req;
@@ -2718,6 +2741,33 @@ lcb_error_t lcb_make_http_request(lcb_t instance,
 LIBCOUCHBASE_API
 void lcb_cancel_http_request(lcb_t instance,
                              lcb_http_request_t request);
+
+/**
+ * @brief Stop reading the response of an ongoing HTTP request
+ *
+ * This allows a consumer of a lcb_HTTPCMDv0::chunked request to apply
+ * backpressure when it cannot keep up with the data callback. Data which was
+ * already read from the socket is still delivered, after which no further
+ * callbacks are invoked for the request until lcb_resume_http_request() is
+ * called. The request does not time out while it is paused.
+ *
+ * @param instance The handle to lcb
+ * @param request The request handle
+ * @volatile
+ */
+LIBCOUCHBASE_API
+void lcb_pause_http_request(lcb_t instance, lcb_http_request_t request);
+
+/**
+ * @brief Resume reading the response of a request paused with
+ * lcb_pause_http_request()
+ *
+ * @param instance The handle to lcb
+ * @param request The request handle
+ * @volatile
+ */
+LIBCOUCHBASE_API
+void lcb_resume_http_request(lcb_t instance, lcb_http_request_t request);
 /**@}*/
 
 /**
@@ -3065,6 +3115,77 @@ LIBCOUCHBASE_API
 lcb_error_t lcb_get_timings(lcb_t instance,
                             const void *cookie,
                             lcb_timings_callback callback);
+
+/**
+ * @uncommitted
+ * @brief Latency histogram for a single opcode on a single server.
+ *
+ * Unlike the instance-wide timings above, these histograms are kept per
+ * server and per opcode, with buckets whose width grows with the latency
+ * so that percentiles are accurate to about 3% over the whole range.
+ * Recording is enabled with @ref LCB_CNTL_OPLATENCY
+ */
+typedef struct lcb_LATENCYHIST_st lcb_LATENCYHIST;
+
+/**
+ * @uncommitted
+ * Called for each server and opcode for which latencies have been recorded
+ *
+ * @param instance the handle to lcb
+ * @param cookie the cookie passed to lcb_get_latencies()
+ * @param server the server, as `host:port`
+ * @param opcode the memcached opcode of the operations
+ * @param hist the histogram. This is only valid within the callback
+ */
+typedef void (*lcb_latency_callback)(lcb_t instance,
+                                     const void *cookie,
+                                     const char *server,
+                                     lcb_U8 opcode,
+                                     const lcb_LATENCYHIST *hist);
+
+/**
+ * @uncommitted
+ * Get the per-server, per-opcode latency histograms
+ *
+ * @param instance the handle to lcb
+ * @param cookie a cookie that will be present in all of the callbacks
+ * @param callback Callback to invoke for each non-empty histogram
+ * @param reset if nonzero, each histogram is cleared after its callback
+ * has been invoked, so that the next call only reports new samples
+ * @return Status of the operation.
+ */
+LIBCOUCHBASE_API
+lcb_error_t lcb_get_latencies(lcb_t instance,
+                              const void *cookie,
+                              lcb_latency_callback callback,
+                              int reset);
+
+/** @uncommitted @brief Get the number of samples in the histogram */
+LIBCOUCHBASE_API
+lcb_U64 lcb_lathist_count(const lcb_LATENCYHIST *hist);
+
+/** @uncommitted @brief Get the lowest recorded latency, in microseconds */
+LIBCOUCHBASE_API
+lcb_U32 lcb_lathist_min(const lcb_LATENCYHIST *hist);
+
+/** @uncommitted @brief Get the highest recorded latency, in microseconds */
+LIBCOUCHBASE_API
+lcb_U32 lcb_lathist_max(const lcb_LATENCYHIST *hist);
+
+/** @uncommitted @brief Get the mean latency, in microseconds */
+LIBCOUCHBASE_API
+double lcb_lathist_mean(const lcb_LATENCYHIST *hist);
+
+/**
+ * @uncommitted
+ * Get the latency below which the given percentage of samples fall
+ *
+ * @param hist the histogram
+ * @param percentile the percentile, e.g. `99.9`
+ * @return the latency in microseconds, or 0 if the histogram is empty
+ */
+LIBCOUCHBASE_API
+lcb_U32 lcb_lathist_percentile(const lcb_LATENCYHIST *hist, double percentile);
 /**@}*/
 
 /**
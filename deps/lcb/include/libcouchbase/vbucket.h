@@ -105,6 +105,8 @@ typedef struct {
     lcbvb_VBUCKET *vbuckets; /* vbucket map */
     lcbvb_VBUCKET *ffvbuckets; /* fast-forward map */
     lcbvb_CONTINUUM *continuum; /* ketama continuums */
+    unsigned *ketama_radix; /* continuum index for each high-bits prefix */
+    unsigned ketama_shift; /* shift to derive the prefix from a hash */
 } lcbvb_CONFIG;
 
 
@@ -255,6 +257,23 @@ LIBCOUCHBASE_API
 int
 lcbvb_k2vb(lcbvb_CONFIG *cfg, const void *key, lcb_SIZE n);
 
+/**
+ * @uncommitted
+ *
+ * Maps several keys to their vBucket IDs in a single call. This is
+ * equivalent to calling lcbvb_k2vb() for each key.
+ * @param cfg The configuration
+ * @param keys Array of keys
+ * @param sizes Array of key sizes, parallel to `keys`
+ * @param nkeys The number of keys
+ * @param[out] vbids Array of at least `nkeys` elements which will contain
+ * the vBucket for each key
+ */
+LIBCOUCHBASE_API
+void
+lcbvb_k2vb_many(lcbvb_CONFIG *cfg, const void * const *keys,
+    const lcb_SIZE *sizes, lcb_SIZE nkeys, int *vbids);
+
 /**@committed
  * @brief Get the number of servers in the bucket. Note that not all servers
  * may actually be available.
@@ -347,6 +366,13 @@ typedef struct {
     int n_vb_changes;
     /** Whether the ordering of the nodes has changed as well */
     int sequence_changed;
+    /**
+     * One flag per vBucket, set if the vBucket's master is a different node
+     * in the new configuration. Nodes are compared by address, so a change in
+     * the ordering of the nodes alone does not mark any vBucket. NULL if the
+     * number of vBuckets differs, or if it could not be allocated.
+     */
+    char *vbs_moved;
 } lcbvb_CONFIGDIFF, VBUCKET_CONFIG_DIFF;
 
 /** @brief Convenience enum to determine the mode of change */
@@ -238,7 +238,9 @@
         'src/getconfig.c',
         'src/http/http.c',
         'src/http/http_io.c',
+        'src/http/qnodes.c',
         'src/instance.c',
+        'src/lathist.c',
         'src/mcserver/negotiate.c',
         'src/mcserver/mcserver.c',
         'src/newconfig.c',
@@ -249,6 +251,7 @@
         'src/settings.c',
         'src/synchandler.c',
         'src/timer.c',
+        'src/timewheel.c',
         'src/timings.c',
         'src/utilities.c',
         'src/wait.c',
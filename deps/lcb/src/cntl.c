@@ -637,6 +637,206 @@ console_log_handler(int mode, lcb_t instance, int cmd, void *arg)
     return LCB_SUCCESS;
 }
 
+static lcb_error_t
+oplatency_handler(int mode, lcb_t instance, int cmd, void *arg)
+{
+    int newval = 0;
+    if (mode == CNTL__MODE_SETSTRING) {
+        newval = boolean_from_string(arg);
+        mode = LCB_CNTL_SET;
+    } else if (mode == LCB_CNTL_SET) {
+        newval = *(int *)arg;
+    } else {
+        *(int *)arg = LCBT_SETTING(instance, oplatency);
+        return LCB_SUCCESS;
+    }
+
+    if (mode == LCB_CNTL_SET) {
+        LCBT_SETTING(instance, oplatency) = newval;
+    }
+    (void)cmd;
+    return LCB_SUCCESS;
+}
+
+static lcb_error_t
+comppolicy_handler(int mode, lcb_t instance, int cmd, void *arg)
+{
+    lcb_COMPRESSPOLICY *policy = arg;
+    if (mode == LCB_CNTL_SET) {
+        if (policy->min_ratio < 0 || policy->max_sample_interval < 1) {
+            return LCB_ECTL_BADARG;
+        }
+        instance->compress.policy = *policy;
+    } else if (mode == LCB_CNTL_GET) {
+        *policy = instance->compress.policy;
+    } else {
+        return LCB_ECTL_UNSUPPMODE;
+    }
+    (void)cmd;
+    return LCB_SUCCESS;
+}
+
+static lcb_error_t
+compstats_handler(int mode, lcb_t instance, int cmd, void *arg)
+{
+    if (mode != LCB_CNTL_GET) {
+        return LCB_ECTL_UNSUPPMODE;
+    }
+    *(lcb_COMPRESSSTATS *)arg = instance->compress.stats;
+    (void)cmd;
+    return LCB_SUCCESS;
+}
+
+static lcb_error_t
+memdpool_opts_handler(int mode, lcb_t instance, int cmd, void *arg)
+{
+    lcbio_MGR *mgr = instance->memd_sockpool;
+    lcb_POOLOPTS *opts = arg;
+
+    if (mode == LCB_CNTL_SET) {
+        if (opts->max_total && opts->max_total < opts->min_idle) {
+            return LCB_ECTL_BADARG;
+        }
+        mgr->minidle = opts->min_idle;
+        mgr->maxidle = opts->max_idle;
+        mgr->maxtotal = opts->max_total;
+        mgr->tmoidle = opts->idle_timeout;
+        lcbio_mgr_warmup(mgr, NULL);
+    } else if (mode == LCB_CNTL_GET) {
+        opts->min_idle = mgr->minidle;
+        opts->max_idle = mgr->maxidle;
+        opts->max_total = mgr->maxtotal;
+        opts->idle_timeout = mgr->tmoidle;
+    } else {
+        return LCB_ECTL_UNSUPPMODE;
+    }
+    (void)cmd;
+    return LCB_SUCCESS;
+}
+
+typedef struct {
+    lcb_t instance;
+    const lcb_POOLSTATSREQ *req;
+} POOLSTATS_CTX;
+
+static void
+memdpool_stats_cb(const lcb_POOLHOSTSTATS *stats, void *arg)
+{
+    POOLSTATS_CTX *ctx = arg;
+    ctx->req->callback(ctx->instance, ctx->req->cookie, stats);
+}
+
+static lcb_error_t
+memdpool_stats_handler(int mode, lcb_t instance, int cmd, void *arg)
+{
+    POOLSTATS_CTX ctx;
+    if (mode != LCB_CNTL_GET) {
+        return LCB_ECTL_UNSUPPMODE;
+    }
+    ctx.instance = instance;
+    ctx.req = arg;
+    lcbio_mgr_stats(instance->memd_sockpool, memdpool_stats_cb, &ctx);
+    (void)cmd;
+    return LCB_SUCCESS;
+}
+
+static lcb_error_t
+kvconns_handler(int mode, lcb_t instance, int cmd, void *arg)
+{
+    lcb_KVCONNOPTS *opts = arg;
+    mc_CMDQUEUE *cq = &instance->cmdq;
+
+    if (mode == LCB_CNTL_SET) {
+        unsigned ii;
+        if (opts->nconns < 1) {
+            return LCB_ECTL_BADARG;
+        }
+        LCBT_SETTING(instance, memd_nconns) = opts->nconns;
+        cq->lane_threshold = opts->large_value;
+        for (ii = 0; ii < cq->npipelines; ii++) {
+            mcserver_set_lanes((mc_SERVER *)cq->pipelines[ii], opts->nconns);
+        }
+    } else if (mode == LCB_CNTL_GET) {
+        opts->nconns = LCBT_SETTING(instance, memd_nconns);
+        opts->large_value = cq->lane_threshold;
+    } else {
+        return LCB_ECTL_UNSUPPMODE;
+    }
+    (void)cmd;
+    return LCB_SUCCESS;
+}
+
+static void
+add_flushstats(lcb_FLUSHSTATS *stats, const mc_SERVER *server)
+{
+    stats->nwrites += server->iobatch.nwrites;
+    stats->nbytes += server->iobatch.nbytes;
+    stats->nbufs += server->iobatch.nbufs;
+    stats->ncoalesced += server->iobatch.ncoalesced;
+}
+
+static lcb_error_t
+flushstats_handler(int mode, lcb_t instance, int cmd, void *arg)
+{
+    lcb_FLUSHSTATS *stats = arg;
+    unsigned ii, jj;
+
+    if (mode != LCB_CNTL_GET) {
+        return LCB_ECTL_UNSUPPMODE;
+    }
+    memset(stats, 0, sizeof(*stats));
+    for (ii = 0; ii < LCBT_NSERVERS(instance); ii++) {
+        mc_SERVER *server = LCBT_GET_SERVER(instance, ii);
+        add_flushstats(stats, server);
+        for (jj = 0; jj < server->pipeline.nlanes; jj++) {
+            add_flushstats(stats, (mc_SERVER *)server->pipeline.lanes[jj]);
+        }
+    }
+    (void)cmd;
+    return LCB_SUCCESS;
+}
+
+static lcb_error_t
+n1ql_hosts_handler(int mode, lcb_t instance, int cmd, void *arg)
+{
+    lcb_QNODES *qn = instance->n1ql_nodes;
+
+    if (mode == LCB_CNTL_SET || mode == CNTL__MODE_SETSTRING) {
+        if (!arg) {
+            return LCB_ECTL_BADARG;
+        }
+        return lcb_qnodes_set(qn, arg);
+
+    } else if (mode == LCB_CNTL_GET) {
+        lcb_N1QLSTATSREQ *req = arg;
+        unsigned ii;
+        for (ii = 0; ii < qn->nnodes; ii++) {
+            lcb_N1QLHOSTSTATS stats;
+            const lcb_QNODE *node = qn->nodes + ii;
+            stats.host = node->hoststr;
+            stats.latency = (lcb_U32)(node->latency / 1000);
+            stats.inflight = node->inflight;
+            stats.failed = node->failed;
+            req->callback(instance, req->cookie, &stats);
+        }
+    } else {
+        return LCB_ECTL_UNSUPPMODE;
+    }
+    (void)cmd;
+    return LCB_SUCCESS;
+}
+
+static lcb_error_t
+configstats_handler(int mode, lcb_t instance, int cmd, void *arg)
+{
+    if (mode != LCB_CNTL_GET) {
+        return LCB_ECTL_UNSUPPMODE;
+    }
+    *(lcb_CONFIGSTATS *)arg = instance->configstats;
+    (void)cmd;
+    return LCB_SUCCESS;
+}
+
 static lcb_error_t
 detailed_errcode_handler(int mode, lcb_t instance, int cmd, void *arg)
 {
@@ -711,7 +911,16 @@ static ctl_handler handlers[] = {
     syncdtor_handler, /* LCB_CNTL_SYNCDESTROY */
     console_log_handler, /* LCB_CNTL_CONLOGGER_LEVEL */
     detailed_errcode_handler, /* LCB_CNTL_DETAILED_ERRCODES */
-    reinit_dsn_handler /* LCB_CNTL_REINIT_DSN */
+    reinit_dsn_handler, /* LCB_CNTL_REINIT_DSN */
+    oplatency_handler, /* LCB_CNTL_OPLATENCY */
+    comppolicy_handler, /* LCB_CNTL_COMPRESSION_POLICY */
+    compstats_handler, /* LCB_CNTL_COMPRESSION_STATS */
+    memdpool_opts_handler, /* LCB_CNTL_MEMDPOOL_OPTS */
+    memdpool_stats_handler, /* LCB_CNTL_MEMDPOOL_STATS */
+    kvconns_handler, /* LCB_CNTL_KVCONNS */
+    flushstats_handler, /* LCB_CNTL_FLUSHSTATS */
+    n1ql_hosts_handler, /* LCB_CNTL_N1QL_HOSTS */
+    configstats_handler /* LCB_CNTL_CONFIGSTATS */
 };
 
 typedef struct {
@@ -735,7 +944,10 @@ static cntl_OPCODESTRS stropcode_map[] = {
         {"console_log_level", LCB_CNTL_CONLOGGER_LEVEL},
         {"config_cache", LCB_CNTL_CONFIGCACHE },
         {"detailed_errcodes", LCB_CNTL_DETAILED_ERRCODES},
-        {"_reinit_dsn", LCB_CNTL_REINIT_DSN }
+        {"_reinit_dsn", LCB_CNTL_REINIT_DSN },
+        {"oplatency", LCB_CNTL_OPLATENCY },
+        {"n1ql_hosts", LCB_CNTL_N1QL_HOSTS },
+        {NULL, -1}
 };
 
 #define CNTL_NUM_HANDLERS (sizeof(handlers) / sizeof(handlers[0]))
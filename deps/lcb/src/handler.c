@@ -119,9 +119,9 @@ if (! (req->flags & MCREQ_F_INVOKED)) { \
  * @param resp The response received
  * @param[out] bytes pointer to the final payload
  * @param[out] nbytes pointer to the size of the final payload
- * @param[out] freeptr pointer to free. This should be initialized to `NULL`.
- * If temporary dynamic storage is required this will be set to the allocated
- * pointer upon return. Otherwise it will be set to NULL. In any case it must
+ * @param[out] freeptr pointer to release. This should be initialized to `NULL`.
+ * If temporary storage is required this will be set to the buffer upon
+ * return. In any case it must be passed to mcreq_inflate_release()
  */
 static void
 maybe_decompress(lcb_t o,
@@ -139,9 +139,14 @@ maybe_decompress(lcb_t o,
     if (PACKET_DATATYPE(respkt) & PROTOCOL_BINARY_DATATYPE_COMPRESSED) {
         if (LCBT_SETTING(o, compressopts) & LCB_COMPRESS_IN) {
             /* if we inflate, we don't set the flag */
-            mcreq_inflate_value(
-                PACKET_VALUE(respkt), PACKET_NVALUE(respkt),
-                &rescmd->v.v0.bytes, &rescmd->v.v0.nbytes, freeptr);
+            if (mcreq_inflate_pooled(&o->compress,
+                    PACKET_VALUE(respkt), PACKET_NVALUE(respkt),
+                    &rescmd->v.v0.bytes, &rescmd->v.v0.nbytes, freeptr) == 0) {
+                /* the value no longer lives in the network buffer */
+                rescmd->v.v0.bufh = NULL;
+            } else {
+                dtype |= LCB_VALUE_F_SNAPPYCOMP;
+            }
 
         } else {
             /* user doesn't want inflation. signal it's compressed */
@@ -174,18 +179,20 @@ H_get(mc_PIPELINE *pipeline, mc_PACKET *request, packet_info *response,
         resp.v.v0.flags = ntohl(getq->message.body.flags);
         resp.v.v0.bytes = PACKET_VALUE(response);
         resp.v.v0.nbytes = PACKET_NVALUE(response);
+        resp.v.v0.bufh = response->bufh;
         rc = LCB_SUCCESS;
     } else {
         resp.v.v0.cas = 0;
         resp.v.v0.nbytes = 0;
         resp.v.v0.bytes = NULL;
         resp.v.v0.flags = 0;
+        resp.v.v0.bufh = NULL;
     }
 
     maybe_decompress(o, response, &resp, &freeptr);
     INVOKE_CALLBACK(request, o->callbacks.get,
                     (o, MCREQ_PKT_COOKIE(request), rc, &resp));
-    free(freeptr);
+    mcreq_inflate_release(&o->compress, freeptr);
 }
 
 static void
@@ -208,10 +215,13 @@ H_getreplica(mc_PIPELINE *pipeline, mc_PACKET *request, packet_info *response,
         resp.v.v0.flags = ntohl(get->message.body.flags);
         resp.v.v0.bytes = PACKET_VALUE(response);
         resp.v.v0.nbytes = PACKET_NVALUE(response);
+        resp.v.v0.bufh = response->bufh;
+    } else {
+        resp.v.v0.bufh = NULL;
     }
     maybe_decompress(instance, response, &resp, &freeptr);
     request->u_rdata.exdata->callback(pipeline, request, rc, &resp);
-    free(freeptr);
+    mcreq_inflate_release(&instance->compress, freeptr);
 }
 
 static void
@@ -478,11 +488,26 @@ H_config(mc_PIPELINE *pipeline, mc_PACKET *request, packet_info *response,
 static void
 record_metrics(mc_PIPELINE *pipeline, mc_PACKET *req, packet_info *res)
 {
-    lcb_t instance = pipeline->parent->instance;
+    mc_CMDQUEUE *cq = pipeline->parent;
+    lcb_t instance = cq->instance;
+    /* Latencies of a lane are recorded against the server owning it */
+    mc_PIPELINE *srvpl = pipeline->primary ? pipeline->primary : pipeline;
+    int oplatency = LCBT_SETTING(instance, oplatency) &&
+            /* Not a temporary pipeline used to fail a packet */
+            (unsigned)srvpl->index < cq->npipelines &&
+            cq->pipelines[srvpl->index] == srvpl;
+    hrtime_t delta;
+
+    if (!instance->histogram && !oplatency) {
+        return;
+    }
+
+    delta = gethrtime() - MCREQ_PKT_RDATA(req)->start;
     if (instance->histogram) {
-        lcb_record_metrics(
-                instance, gethrtime() - MCREQ_PKT_RDATA(req)->start,
-                PACKET_OPCODE(res));
+        lcb_record_metrics(instance, delta, PACKET_OPCODE(res));
+    }
+    if (oplatency) {
+        lcb_record_oplatency((mc_SERVER *)srvpl, delta, PACKET_OPCODE(res));
     }
 }
 
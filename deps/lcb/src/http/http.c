@@ -83,6 +83,52 @@ static lcb_error_t add_header(lcb_http_request_t req, const char *key, const cha
     return LCB_SUCCESS;
 }
 
+static void pooled_close_cb(lcbio_SOCKET *sock, int reusable, void *arg)
+{
+    int *keepalive = arg;
+    lcbio_ref(sock);
+    if (reusable && *keepalive) {
+        lcbio_mgr_put(sock);
+    } else {
+        lcbio_mgr_discard(sock);
+    }
+}
+
+static void close_io(lcb_http_request_t req)
+{
+    if (!req->ioctx) {
+        return;
+    }
+    if (req->pooled) {
+        /* Only a connection whose response was read in full can be reused */
+        int keepalive = req->parser && lcbht_can_keepalive(req->parser);
+        lcbio_ctx_close(req->ioctx, pooled_close_cb, &keepalive);
+    } else {
+        lcbio_ctx_close(req->ioctx, NULL, NULL);
+    }
+    req->ioctx = NULL;
+}
+
+static void release_qnode(lcb_http_request_t req)
+{
+    if (req->qnodes) {
+        lcb_qnodes_release(req->qnodes, req->qnode_ix, req->qnode_gen);
+        req->qnodes = NULL;
+    }
+}
+
+void lcb_http_request_sample(lcb_http_request_t req)
+{
+    hrtime_t now;
+    if (!req->qnodes || req->qnode_sampled) {
+        return;
+    }
+    now = gethrtime();
+    lcb_qnodes_sample(req->qnodes, req->qnode_ix, req->qnode_gen,
+                      now - req->start, now);
+    req->qnode_sampled = 1;
+}
+
 void lcb_http_request_decref(lcb_http_request_t req)
 {
     lcb_list_t *ii, *nn;
@@ -91,11 +137,9 @@ void lcb_http_request_decref(lcb_http_request_t req)
         return;
     }
 
-    if (req->ioctx) {
-        lcbio_ctx_close(req->ioctx, NULL, NULL);
-        req->ioctx = NULL;
-    }
+    close_io(req);
     lcbio_connreq_cancel(&req->creq);
+    release_qnode(req);
 
     free(req->path);
     free(req->url);
@@ -171,6 +215,13 @@ void lcb_http_request_finish(lcb_t instance,
 
     maybe_refresh_config(instance, req, error);
 
+    if (error != LCB_SUCCESS && req->qnodes && !req->qnode_sampled) {
+        hrtime_t now = gethrtime();
+        lcb_qnodes_fail(req->qnodes, req->qnode_ix, req->qnode_gen,
+                        now - req->start, now);
+        req->qnode_sampled = 1;
+    }
+
     if ((req->status & LCB_HTREQ_S_CBINVOKED) == 0 && req->on_complete) {
         lcb_http_resp_t resp;
         lcbht_RESPONSE *htres = lcbht_get_response(req->parser);
@@ -217,10 +268,7 @@ lcb_error_t lcb_http_request_exec(lcb_http_request_t req)
     lcb_string *out = &req->outbuf;
 
     request_free_headers(req);
-    if (req->ioctx) {
-        lcbio_ctx_close(req->ioctx, NULL, NULL);
-        req->ioctx = NULL;
-    }
+    close_io(req);
 
     lcbio_connreq_cancel(&req->creq);
     if (req->nhost > sizeof(reqhost.host)) {
@@ -259,6 +307,7 @@ lcb_error_t lcb_http_request_exec(lcb_http_request_t req)
 
     lcb_aspend_add(&instance->pendops, LCB_PENDTYPE_HTTP, req);
 
+    req->start = gethrtime();
     rc = lcb_http_request_connect(req);
     if (rc != LCB_SUCCESS) {
         /** Mark as having the callback invoked */
@@ -324,7 +373,8 @@ static lcb_error_t setup_headers(lcb_http_request_t req,
     if (rc != LCB_SUCCESS) {
         return rc;
     }
-    rc = add_header(req, "Connection", "close");
+    rc = add_header(req, "Connection",
+                    req->reqtype == LCB_HTTP_TYPE_N1QL ? "keep-alive" : "close");
     if (rc != LCB_SUCCESS) {
         return rc;
     }
@@ -381,7 +431,7 @@ lcb_error_t lcb_make_http_request(lcb_t instance,
     char *password = NULL, *base = NULL;
     lcb_size_t nbase, nbody, npath;
     lcb_http_method_t method;
-    int chunked;
+    int chunked, qnode_ix = -1;
     lcb_error_t rc;
     lcb_settings *settings = instance->settings;
 
@@ -407,7 +457,8 @@ lcb_error_t lcb_make_http_request(lcb_t instance,
         nbody = cmd->v.v0.nbody;
         body = cmd->v.v0.body;
         content_type = cmd->v.v0.content_type;
-        if (type != LCB_HTTP_TYPE_VIEW && type != LCB_HTTP_TYPE_MANAGEMENT) {
+        if (type != LCB_HTTP_TYPE_VIEW && type != LCB_HTTP_TYPE_MANAGEMENT &&
+                type != LCB_HTTP_TYPE_N1QL) {
             return LCB_EINVAL;
         }
         if (type == LCB_HTTP_TYPE_VIEW && instance->type != LCB_TYPE_BUCKET) {
@@ -478,6 +529,21 @@ lcb_error_t lcb_make_http_request(lcb_t instance,
         }
         break;
     }
+    case LCB_HTTP_TYPE_N1QL:
+        if (instance->type != LCB_TYPE_BUCKET) {
+            return LCB_EINVAL;
+        }
+        qnode_ix = lcb_qnodes_pick(instance->n1ql_nodes);
+        if (qnode_ix < 0) {
+            return LCB_NOT_SUPPORTED;
+        }
+        base = instance->n1ql_nodes->nodes[qnode_ix].hoststr;
+        nbase = strlen(base);
+        username = settings->username;
+        if (settings->password && *settings->password) {
+            password = strdup(settings->password);
+        }
+        break;
     case LCB_HTTP_TYPE_RAW:
         base = (char *)cmd->v.v1.host;
         nbase = strlen(base);
@@ -495,6 +561,11 @@ lcb_error_t lcb_make_http_request(lcb_t instance,
 
     req = calloc(1, sizeof(struct lcb_http_request_st));
     if (!req) {
+        if (qnode_ix >= 0) {
+            lcb_qnodes_release(instance->n1ql_nodes, qnode_ix,
+                               instance->n1ql_nodes->generation);
+        }
+        free(password);
         return LCB_CLIENT_ENOMEM;
     }
     if (request) {
@@ -509,6 +580,11 @@ lcb_error_t lcb_make_http_request(lcb_t instance,
     req->on_complete = instance->callbacks.http_complete;
     req->on_data = instance->callbacks.http_data;
     req->reqtype = type;
+    if (qnode_ix >= 0) {
+        req->qnodes = instance->n1ql_nodes;
+        req->qnode_ix = qnode_ix;
+        req->qnode_gen = instance->n1ql_nodes->generation;
+    }
     lcb_list_init(&req->headers_out.list);
     req->nbody = nbody;
     if (req->nbody) {
@@ -561,6 +637,7 @@ void lcb_cancel_http_request(lcb_t instance, lcb_http_request_t request)
         lcb_aspend_del(&instance->pendops, LCB_PENDTYPE_HTTP, request);
     }
     request->instance = NULL;
+    release_qnode(request);
 
     if (request->io_timer) {
         lcb_timer_destroy(NULL, request->io_timer);
@@ -569,3 +646,39 @@ void lcb_cancel_http_request(lcb_t instance, lcb_http_request_t request)
 
     lcb_maybe_breakout(instance);
 }
+
+LIBCOUCHBASE_API
+void lcb_pause_http_request(lcb_t instance, lcb_http_request_t request)
+{
+    if (request->paused || request->status != LCB_HTREQ_S_ONGOING) {
+        return;
+    }
+
+    /* The read in progress, if any, is not rescheduled once it completes */
+    request->paused = 1;
+    if (request->io_timer) {
+        lcb_timer_disarm(request->io_timer);
+    }
+    (void)instance;
+}
+
+LIBCOUCHBASE_API
+void lcb_resume_http_request(lcb_t instance, lcb_http_request_t request)
+{
+    if (!request->paused) {
+        return;
+    }
+
+    request->paused = 0;
+    if (request->status != LCB_HTREQ_S_ONGOING) {
+        return;
+    }
+    if (request->io_timer) {
+        lcb_timer_rearm(request->io_timer, request->timeout);
+    }
+    if (request->ioctx) {
+        lcbio_ctx_rwant(request->ioctx, 1);
+        lcbio_ctx_schedule(request->ioctx);
+    }
+    (void)instance;
+}
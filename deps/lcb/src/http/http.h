@@ -8,6 +8,7 @@
 #include "contrib/http_parser/http_parser.h"
 #include "list.h"
 #include "simplestring.h"
+#include "qnodes.h"
 
 typedef struct {
     lcb_list_t list;
@@ -47,6 +48,8 @@ struct lcb_http_request_st {
 
     /** Non-zero if caller would like to receive response in chunks */
     int chunked;
+    /** Non-zero while the caller has paused reading of the response */
+    int paused;
     /** This callback will be executed when the whole response will be
      * transferred */
     lcb_http_complete_callback on_complete;
@@ -78,6 +81,17 @@ struct lcb_http_request_st {
     lcbht_pPARSER parser;
     /** IO Timeout */
     lcb_uint32_t timeout;
+
+    /** Non-zero if the connection comes from lcb_st::http_sockpool */
+    int pooled;
+    /** When the request was last sent */
+    hrtime_t start;
+    /** Query nodes from which the target of a N1QL request was picked */
+    lcb_QNODES *qnodes;
+    int qnode_ix;
+    unsigned qnode_gen;
+    /** Whether the latency of the N1QL request has been recorded */
+    int qnode_sampled;
 };
 
 void
@@ -96,6 +110,10 @@ lcb_http_request_exec(lcb_http_request_t req);
 lcb_error_t
 lcb_http_request_connect(lcb_http_request_t req);
 
+/** Record the latency of a N1QL request, once its response has started */
+void
+lcb_http_request_sample(lcb_http_request_t req);
+
 void
 lcb_setup_lcb_http_resp_t(lcb_http_resp_t *resp,
     lcb_http_status_t status, const char *path, lcb_size_t npath,
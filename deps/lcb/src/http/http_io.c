@@ -30,6 +30,7 @@ handle_headers(lcb_http_request_t req)
 {
     lcbht_RESPONSE *res = lcbht_get_response(req->parser);
     req->headers = lcbht_make_resphdrlist(res);
+    lcb_http_request_sample(req);
 
     if (res->status >= 300 && res->status <= 400) {
         const char *redirto = lcbht_get_resphdr(res, "Location");
@@ -156,7 +157,7 @@ io_read(lcbio_CTX *ctx, unsigned nr)
         lcb_http_request_finish(instance, req, err);
     } else if (rv == 1) {
         lcb_http_request_finish(instance, req, LCB_SUCCESS);
-    } else {
+    } else if (!req->paused) {
         lcbio_ctx_rwant(ctx, 1);
         lcbio_ctx_schedule(ctx);
     }
@@ -203,9 +204,11 @@ on_connected(lcbio_SOCKET *sock, void *arg, lcb_error_t err, lcbio_OSERR syserr)
     procs.cb_err = io_error;
     procs.cb_read = io_read;
     req->ioctx = lcbio_ctx_new(sock, arg, &procs);
-    req->ioctx->subsys = "mgmt/capi";
+    req->ioctx->subsys = req->pooled ? "n1ql" : "mgmt/capi";
     lcbio_ctx_put(req->ioctx, req->outbuf.base, req->outbuf.nused);
-    lcbio_ctx_rwant(req->ioctx, 1);
+    if (!req->paused) {
+        lcbio_ctx_rwant(req->ioctx, 1);
+    }
     lcbio_ctx_schedule(req->ioctx);
     (void)syserr;
 }
@@ -214,7 +217,6 @@ lcb_error_t
 lcb_http_request_connect(lcb_http_request_t req)
 {
     lcb_host_t dest;
-    lcbio_pCONNSTART cs;
     lcb_settings *settings = req->instance->settings;
 
     memcpy(dest.host, req->host, req->nhost);
@@ -222,15 +224,25 @@ lcb_http_request_connect(lcb_http_request_t req)
     memcpy(dest.port, req->port, req->nport);
     dest.port[req->nport] = '\0';
 
-    req->timeout = req->reqtype == LCB_HTTP_TYPE_VIEW ?
+    req->timeout = req->reqtype == LCB_HTTP_TYPE_VIEW ||
+            req->reqtype == LCB_HTTP_TYPE_N1QL ?
             settings->views_timeout : settings->http_timeout;
 
-    cs = lcbio_connect(req->io, settings, &dest, req->timeout, on_connected, req);
-    if (!cs) {
-        return LCB_CONNECT_ERROR;
+    if (req->reqtype == LCB_HTTP_TYPE_N1QL) {
+        /* Queries reuse the connections left open by earlier queries */
+        lcbio_pMGRREQ mr = lcbio_mgr_get(req->instance->http_sockpool, &dest,
+                                         req->timeout, on_connected, req);
+        LCBIO_CONNREQ_MKPOOLED(&req->creq, mr);
+        req->pooled = 1;
+    } else {
+        lcbio_pCONNSTART cs = lcbio_connect(req->io, settings, &dest,
+                                            req->timeout, on_connected, req);
+        if (!cs) {
+            return LCB_CONNECT_ERROR;
+        }
+        req->creq.type = LCBIO_CONNREQ_RAW;
+        req->creq.u.cs = cs;
     }
-    req->creq.type = LCBIO_CONNREQ_RAW;
-    req->creq.u.cs = cs;
 
     if (!req->io_timer) {
         req->io_timer = lcb_timer_create_simple(req->io,
@@ -0,0 +1,224 @@
+/* -*- Mode: C; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+#include "qnodes.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Weight of a new sample in the moving average is 1/EWMA_DIV */
+#define EWMA_DIV 4
+
+#define GET_NODE(qn, ix, gen) \
+    ((gen) == (qn)->generation && (ix) >= 0 && (unsigned)(ix) < (qn)->nnodes \
+        ? (qn)->nodes + (ix) : NULL)
+
+lcb_QNODES *
+lcb_qnodes_new(void)
+{
+    return calloc(1, sizeof(lcb_QNODES));
+}
+
+static void
+free_nodes(lcb_QNODE *nodes, unsigned nnodes)
+{
+    unsigned ii;
+    for (ii = 0; ii < nnodes; ii++) {
+        free(nodes[ii].hoststr);
+    }
+    free(nodes);
+}
+
+void
+lcb_qnodes_destroy(lcb_QNODES *qn)
+{
+    if (!qn) {
+        return;
+    }
+    free_nodes(qn->nodes, qn->nnodes);
+    free(qn);
+}
+
+lcb_error_t
+lcb_qnodes_set(lcb_QNODES *qn, const char *spec)
+{
+    hostlist_t hl;
+    lcb_QNODE *nodes = NULL;
+    lcb_error_t err;
+    unsigned ii, jj, nnodes;
+
+    if ((hl = hostlist_create()) == NULL) {
+        return LCB_CLIENT_ENOMEM;
+    }
+    err = hostlist_add_stringz(hl, spec, LCB_QNODES_DEFAULT_PORT);
+    if (err != LCB_SUCCESS) {
+        hostlist_destroy(hl);
+        return err;
+    }
+
+    nnodes = hl->nentries;
+    if (nnodes && (nodes = calloc(nnodes, sizeof(*nodes))) == NULL) {
+        hostlist_destroy(hl);
+        return LCB_CLIENT_ENOMEM;
+    }
+
+    for (ii = 0; ii < nnodes; ii++) {
+        lcb_QNODE *node = nodes + ii;
+        size_t nstr;
+
+        node->host = hl->entries[ii];
+        nstr = strlen(node->host.host) + strlen(node->host.port) + 2;
+        if ((node->hoststr = malloc(nstr)) == NULL) {
+            free_nodes(nodes, nnodes);
+            hostlist_destroy(hl);
+            return LCB_CLIENT_ENOMEM;
+        }
+        sprintf(node->hoststr, "%s:%s", node->host.host, node->host.port);
+
+        /* Queries in flight are not carried over; see 'generation' */
+        for (jj = 0; jj < qn->nnodes; jj++) {
+            lcb_QNODE *old = qn->nodes + jj;
+            if (lcb_host_equals(&old->host, &node->host)) {
+                node->latency = old->latency;
+                node->sampled = old->sampled;
+                node->failed = old->failed;
+                break;
+            }
+        }
+    }
+
+    hostlist_destroy(hl);
+    free_nodes(qn->nodes, qn->nnodes);
+    qn->nodes = nodes;
+    qn->nnodes = nnodes;
+    qn->generation++;
+    return LCB_SUCCESS;
+}
+
+int
+lcb_qnodes_pick(lcb_QNODES *qn)
+{
+    unsigned ii, start, nmeasured = 0;
+    hrtime_t avg = 0, bestscore = 0;
+    int best = -1;
+
+    if (!qn->nnodes) {
+        return -1;
+    }
+
+    /* Start from a different node each time, so that ties are spread */
+    start = qn->npicks++ % qn->nnodes;
+
+    if (qn->nnodes > 1 && qn->npicks % LCB_QNODES_PROBE_INTERVAL == 0) {
+        best = start;
+        for (ii = 0; ii < qn->nnodes; ii++) {
+            if (qn->nodes[ii].sampled < qn->nodes[best].sampled) {
+                best = ii;
+            }
+        }
+        goto GT_DONE;
+    }
+
+    for (ii = 0; ii < qn->nnodes; ii++) {
+        if (qn->nodes[ii].latency) {
+            avg += qn->nodes[ii].latency;
+            nmeasured++;
+        }
+    }
+    avg = nmeasured ? avg / nmeasured : 1;
+
+    for (ii = 0; ii < qn->nnodes; ii++) {
+        unsigned ix = (start + ii) % qn->nnodes;
+        lcb_QNODE *node = qn->nodes + ix;
+        hrtime_t score;
+
+        if (node->latency) {
+            score = node->latency * (node->inflight + 1);
+        } else if (node->inflight) {
+            /* Assume an unmeasured node is as fast as the others */
+            score = avg * (node->inflight + 1);
+        } else {
+            score = 0;
+        }
+
+        if (best == -1 || score < bestscore) {
+            best = ix;
+            bestscore = score;
+        }
+    }
+
+    GT_DONE:
+    qn->nodes[best].inflight++;
+    return best;
+}
+
+void
+lcb_qnodes_sample(lcb_QNODES *qn, int ix, unsigned generation,
+                  hrtime_t latency, hrtime_t now)
+{
+    lcb_QNODE *node = GET_NODE(qn, ix, generation);
+    if (!node) {
+        return;
+    }
+    if (!latency) {
+        latency = 1;
+    }
+
+    /* The first success after a failure replaces the penalty outright */
+    if (!node->latency || node->failed) {
+        node->latency = latency;
+    } else {
+        node->latency = (node->latency * (EWMA_DIV - 1) + latency) / EWMA_DIV;
+        if (!node->latency) {
+            node->latency = 1;
+        }
+    }
+    node->failed = 0;
+    node->sampled = now;
+}
+
+void
+lcb_qnodes_fail(lcb_QNODES *qn, int ix, unsigned generation,
+                hrtime_t elapsed, hrtime_t now)
+{
+    lcb_QNODE *node = GET_NODE(qn, ix, generation);
+    hrtime_t penalty;
+    if (!node) {
+        return;
+    }
+
+    penalty = node->latency * 2;
+    if (penalty < elapsed) {
+        penalty = elapsed;
+    }
+    if (penalty < LCB_QNODES_FAIL_PENALTY) {
+        penalty = LCB_QNODES_FAIL_PENALTY;
+    }
+    node->latency = penalty;
+    node->failed = 1;
+    node->sampled = now;
+}
+
+void
+lcb_qnodes_release(lcb_QNODES *qn, int ix, unsigned generation)
+{
+    lcb_QNODE *node = GET_NODE(qn, ix, generation);
+    if (node && node->inflight) {
+        node->inflight--;
+    }
+}
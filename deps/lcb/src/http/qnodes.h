@@ -0,0 +1,132 @@
+/* -*- Mode: C; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LCB_QNODES_H
+#define LCB_QNODES_H
+#include <libcouchbase/couchbase.h>
+#include "hostlist.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file
+ * @brief Query node selection
+ *
+ * @defgroup LCB_QNODES Query Nodes
+ *
+ * @details
+ * Keeps the list of N1QL query nodes and picks the one to send each query
+ * to. Each node has a moving average of the time taken for the response
+ * headers to arrive, and the node with the lowest expected wait (that
+ * latency scaled by the number of queries already in flight to the node) is
+ * chosen. Nodes which have not been measured yet are tried first, and every
+ * LCB_QNODES_PROBE_INTERVAL picks the node with the oldest measurement is
+ * chosen instead so that a node which was slow, or failed, is measured
+ * again.
+ *
+ * @addtogroup LCB_QNODES
+ * @{
+ */
+
+/** Default port of the query service */
+#define LCB_QNODES_DEFAULT_PORT 8093
+
+/** One in this many picks goes to the node measured the longest time ago */
+#define LCB_QNODES_PROBE_INTERVAL 16
+
+/** Smallest latency recorded for a query which failed, in nanoseconds */
+#define LCB_QNODES_FAIL_PENALTY 1000000000
+
+typedef struct {
+    lcb_host_t host;
+    char *hoststr; /**< The host, as `host:port` */
+    hrtime_t latency; /**< Moving average, in nanoseconds. 0 if not measured */
+    hrtime_t sampled; /**< When the latency was last updated */
+    unsigned inflight; /**< Queries sent to this node and not yet completed */
+    int failed; /**< Whether the last query sent to this node failed */
+} lcb_QNODE;
+
+typedef struct {
+    lcb_QNODE *nodes;
+    unsigned nnodes;
+    /**
+     * Incremented whenever the list is replaced, so that queries sent to the
+     * nodes of a previous list are not counted against the current one
+     */
+    unsigned generation;
+    unsigned npicks;
+} lcb_QNODES;
+
+lcb_QNODES *
+lcb_qnodes_new(void);
+
+void
+lcb_qnodes_destroy(lcb_QNODES *qn);
+
+/**
+ * Replace the list of nodes
+ * @param qn the node list
+ * @param spec nodes as `host:port` separated by semicolons. The port
+ * defaults to LCB_QNODES_DEFAULT_PORT
+ * @return LCB_EINVAL if the list cannot be parsed, in which case the current
+ * list is kept.
+ *
+ * The measurements of nodes which are also in the new list are kept.
+ */
+lcb_error_t
+lcb_qnodes_set(lcb_QNODES *qn, const char *spec);
+
+/**
+ * Choose the node for a new query, and count the query as in flight to it
+ * @return the index of the node, or -1 if there are no nodes
+ */
+int
+lcb_qnodes_pick(lcb_QNODES *qn);
+
+/**
+ * Record the latency of a query sent to a node
+ * @param qn the node list
+ * @param ix index returned by lcb_qnodes_pick()
+ * @param generation the list generation at the time of the pick
+ * @param latency the time taken, in nanoseconds
+ * @param now the current time
+ */
+void
+lcb_qnodes_sample(lcb_QNODES *qn, int ix, unsigned generation,
+                  hrtime_t latency, hrtime_t now);
+
+/**
+ * Record a query which failed before a response was received. This at least
+ * doubles the latency of the node, so that it is avoided until it is probed
+ * again successfully.
+ */
+void
+lcb_qnodes_fail(lcb_QNODES *qn, int ix, unsigned generation,
+                hrtime_t elapsed, hrtime_t now);
+
+/** Count a query as no longer in flight */
+void
+lcb_qnodes_release(lcb_QNODES *qn, int ix, unsigned generation);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -472,10 +472,18 @@ lcb_error_t lcb_create(lcb_t *instance,
     obj->memd_sockpool = lcbio_mgr_create(settings, obj->iotable);
     obj->memd_sockpool->maxidle = 1;
     obj->memd_sockpool->tmoidle = 10000000;
+    obj->http_sockpool = lcbio_mgr_create(settings, obj->iotable);
+    obj->http_sockpool->maxidle = 4;
+    /* Kept short, since the server may close an idle connection at any time */
+    obj->http_sockpool->tmoidle = 4000000;
+    obj->n1ql_nodes = lcb_qnodes_new();
     obj->confmon = lcb_confmon_create(settings, obj->iotable);
     obj->ht_nodes = hostlist_create();
     obj->mc_nodes = hostlist_create();
-    obj->retryq = lcb_retryq_new(&obj->cmdq, obj->iotable, obj->settings);
+    /* 1ms slots; one rotation covers the default operation timeout */
+    obj->timewheel = lcb_timewheel_new(obj->iotable, 4096, LCB_US2NS(1000));
+    obj->retryq = lcb_retryq_new(&obj->cmdq, obj->timewheel, obj->settings);
+    mcreq_compress_init(&obj->compress);
     lcb_initialize_packet_handlers(obj);
     lcb_aspend_init(&obj->pendops);
 
@@ -570,6 +578,7 @@ void lcb_destroy(lcb_t instance)
             free(dset_list);
         }
     }
+    DESTROY(lcb_durability_coord_destroy, durcoord);
 
     for (ii = 0; ii < LCBT_NSERVERS(instance); ++ii) {
         lcb_server_t *server = LCBT_GET_SERVER(instance, ii);
@@ -593,9 +602,13 @@ void lcb_destroy(lcb_t instance)
         }
     }
     DESTROY(lcb_retryq_destroy, retryq);
+    DESTROY(lcb_timewheel_destroy, timewheel);
     DESTROY(lcb_confmon_destroy, confmon);
     DESTROY(lcbio_mgr_destroy, memd_sockpool);
+    DESTROY(lcbio_mgr_destroy, http_sockpool);
+    DESTROY(lcb_qnodes_destroy, n1ql_nodes);
     mcreq_queue_cleanup(&instance->cmdq);
+    mcreq_compress_cleanup(&instance->compress);
     lcb_aspend_cleanup(po);
 
     if (instance->iotable && instance->iotable->refcount > 1 &&
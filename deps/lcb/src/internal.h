@@ -40,10 +40,13 @@
 #include <strcodecs/strcodecs.h>
 #include "mcserver/mcserver.h"
 #include "mc/mcreq.h"
+#include "mc/compress.h"
 #include "settings.h"
 #include "genhash.h"
 
 /* lcb_t-specific includes */
+#include "timewheel.h"
+#include "http/qnodes.h"
 #include "retryq.h"
 #include "aspend.h"
 
@@ -114,12 +117,22 @@ extern "C" {
 
         /** Socket pool for memcached connections */
         lcbio_MGR *memd_sockpool;
+        /** Socket pool for keep-alive HTTP connections (N1QL queries) */
+        lcbio_MGR *http_sockpool;
+        /** N1QL query nodes and their latencies */
+        lcb_QNODES *n1ql_nodes;
+        /** Packets relocated by cluster map changes */
+        lcb_CONFIGSTATS configstats;
+        /** Polls durability requests. Created with the first one */
+        struct lcb_durability_coord_st *durcoord;
 
         lcb_error_t last_error;
 
         lcb_settings *settings;
         lcbio_pTABLE iotable;
+        lcb_TIMEWHEEL *timewheel;
         lcb_RETRYQ *retryq;
+        mc_COMPRESSCTX compress;
         char *scratch; /* storage for random strings, lcb_get_host, etc */
         lcbio_pTIMER dtor_timer;
 
@@ -144,6 +157,7 @@ extern "C" {
      */
     void lcb_initialize_packet_handlers(lcb_t instance);
     void lcb_record_metrics(lcb_t instance, hrtime_t delta,lcb_uint8_t opcode);
+    void lcb_record_oplatency(mc_SERVER *server, hrtime_t delta, lcb_U8 opcode);
 
     LCB_INTERNAL_API
     void lcb_maybe_breakout(lcb_t instance);
@@ -158,6 +172,8 @@ extern "C" {
 
     struct lcb_durability_set_st;
     void lcb_durability_dset_destroy(struct lcb_durability_set_st *dset);
+    struct lcb_durability_coord_st;
+    void lcb_durability_coord_destroy(struct lcb_durability_coord_st *coord);
 
     lcb_error_t lcb_iops_cntl_handler(int mode,
                                       lcb_t instance, int cmd, void *arg);
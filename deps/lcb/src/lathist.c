@@ -0,0 +1,158 @@
+/* -*- Mode: C; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include <string.h>
+#include "lathist.h"
+
+/* Index of the most significant bit. `v` must be nonzero */
+static unsigned
+msb32(lcb_U32 v)
+{
+    unsigned ret = 0;
+    if (v & 0xffff0000) {
+        v >>= 16;
+        ret += 16;
+    }
+    if (v & 0xff00) {
+        v >>= 8;
+        ret += 8;
+    }
+    if (v & 0xf0) {
+        v >>= 4;
+        ret += 4;
+    }
+    if (v & 0xc) {
+        v >>= 2;
+        ret += 2;
+    }
+    if (v & 0x2) {
+        ret += 1;
+    }
+    return ret;
+}
+
+unsigned
+lcb_lathist_bucket(lcb_U32 usec)
+{
+    unsigned shift;
+    if (usec < LCB_LATHIST_SUBCOUNT) {
+        return usec;
+    }
+    shift = msb32(usec) - LCB_LATHIST_SUBBITS;
+    return ((shift + 1) << LCB_LATHIST_SUBBITS) +
+            ((usec >> shift) - LCB_LATHIST_SUBCOUNT);
+}
+
+/* Highest value which maps to the given bucket */
+static lcb_U32
+bucket_upper(unsigned ix)
+{
+    unsigned shift;
+    lcb_U32 lower;
+    if (ix < LCB_LATHIST_SUBCOUNT) {
+        return ix;
+    }
+    shift = (ix >> LCB_LATHIST_SUBBITS) - 1;
+    lower = (lcb_U32)(LCB_LATHIST_SUBCOUNT + (ix & (LCB_LATHIST_SUBCOUNT - 1))) << shift;
+    return lower + ((1u << shift) - 1);
+}
+
+void
+lcb_lathist_record(lcb_LATENCYHIST *hist, lcb_U32 usec)
+{
+    if (!hist->count || usec < hist->min) {
+        hist->min = usec;
+    }
+    if (usec > hist->max) {
+        hist->max = usec;
+    }
+    hist->count++;
+    hist->sum += usec;
+    hist->buckets[lcb_lathist_bucket(usec)]++;
+}
+
+void
+lcb_lathist_reset(lcb_LATENCYHIST *hist)
+{
+    memset(hist, 0, sizeof(*hist));
+}
+
+LIBCOUCHBASE_API
+lcb_U64
+lcb_lathist_count(const lcb_LATENCYHIST *hist)
+{
+    return hist->count;
+}
+
+LIBCOUCHBASE_API
+lcb_U32
+lcb_lathist_min(const lcb_LATENCYHIST *hist)
+{
+    return hist->min;
+}
+
+LIBCOUCHBASE_API
+lcb_U32
+lcb_lathist_max(const lcb_LATENCYHIST *hist)
+{
+    return hist->max;
+}
+
+LIBCOUCHBASE_API
+double
+lcb_lathist_mean(const lcb_LATENCYHIST *hist)
+{
+    if (!hist->count) {
+        return 0;
+    }
+    return (double)hist->sum / (double)hist->count;
+}
+
+LIBCOUCHBASE_API
+lcb_U32
+lcb_lathist_percentile(const lcb_LATENCYHIST *hist, double percentile)
+{
+    lcb_U64 rank, seen = 0;
+    double exact;
+    unsigned ii;
+
+    if (!hist->count) {
+        return 0;
+    }
+    if (percentile >= 100) {
+        return hist->max;
+    }
+
+    /* Nearest rank. The epsilon keeps e.g. 99.9% of 1000 from rounding up */
+    exact = percentile / 100.0 * (double)hist->count - 1e-9;
+    rank = (lcb_U64)exact;
+    if ((double)rank < exact) {
+        rank++;
+    }
+    if (rank < 1) {
+        rank = 1;
+    }
+
+    for (ii = 0; ii < LCB_LATHIST_NBUCKETS; ii++) {
+        seen += hist->buckets[ii];
+        if (seen >= rank) {
+            lcb_U32 upper = bucket_upper(ii);
+            return upper < hist->max ? upper : hist->max;
+        }
+    }
+    return hist->max;
+}
@@ -0,0 +1,67 @@
+/* -*- Mode: C; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LCB_LATHIST_H
+#define LCB_LATHIST_H
+#include <libcouchbase/couchbase.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file
+ * @brief Log-linear latency histograms
+ *
+ * Latencies are recorded in microseconds. Values below 2^LCB_LATHIST_SUBBITS
+ * each have their own bucket; above that every power of two is divided into
+ * 2^LCB_LATHIST_SUBBITS equally sized buckets, so that the reported value of
+ * any sample is within about 3% of the recorded one.
+ */
+
+#define LCB_LATHIST_SUBBITS 5
+#define LCB_LATHIST_SUBCOUNT (1 << LCB_LATHIST_SUBBITS)
+#define LCB_LATHIST_NBUCKETS ((32 - LCB_LATHIST_SUBBITS + 1) * LCB_LATHIST_SUBCOUNT)
+
+struct lcb_LATENCYHIST_st {
+    lcb_U64 count;
+    lcb_U64 sum;
+    lcb_U32 min;
+    lcb_U32 max;
+    lcb_U32 buckets[LCB_LATHIST_NBUCKETS];
+};
+
+/**
+ * Record a single sample
+ * @param hist the histogram
+ * @param usec the latency, in microseconds
+ */
+void
+lcb_lathist_record(lcb_LATENCYHIST *hist, lcb_U32 usec);
+
+/** Clear all samples from the histogram */
+void
+lcb_lathist_reset(lcb_LATENCYHIST *hist);
+
+/** Get the bucket for the given value. Exposed for testing */
+unsigned
+lcb_lathist_bucket(lcb_U32 usec);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -228,6 +228,18 @@ lcbht_get_resphdr(const lcbht_RESPONSE *resp, const char *key)
     return NULL;
 }
 
+int
+lcbht_can_keepalive(lcbht_pPARSER parser)
+{
+    if ((parser->resp.state & LCBHT_S_DONE) == 0) {
+        return 0;
+    }
+    if (parser->resp.state & LCBHT_S_ERROR) {
+        return 0;
+    }
+    return _lcb_http_should_keep_alive(&parser->parser);
+}
+
 char **
 lcbht_make_resphdrlist(lcbht_RESPONSE *response)
 {
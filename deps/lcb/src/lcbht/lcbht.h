@@ -149,6 +149,17 @@ lcbht_clear_response(lcbht_RESPONSE *resp);
 const char *
 lcbht_get_resphdr(const lcbht_RESPONSE *response, const char *key);
 
+/**
+ * Check whether the connection may be used for another request once the
+ * current response has been read. This is the case if the response is
+ * complete and neither its HTTP version nor its `Connection` header require
+ * the connection to be closed.
+ * @param parser the parser
+ * @return true if the connection may be reused
+ */
+int
+lcbht_can_keepalive(lcbht_pPARSER parser);
+
 /**
  * Return a list of headers
  * @param response The response
@@ -29,6 +29,10 @@ typedef struct lcbio_MGRHOST {
     unsigned n_leased; /* number of connections currently used */
     unsigned n_total; /* number of total connections */
     unsigned refcount;
+    lcb_U64 n_connects; /* connections established */
+    lcb_U64 n_connect_errors; /* connections which failed */
+    hrtime_t connect_time; /* total time taken by established connections */
+    hrtime_t connect_time_max;
 } mgr_HOST;
 
 typedef struct mgr_CINFO_st {
@@ -38,6 +42,7 @@ typedef struct mgr_CINFO_st {
     lcbio_SOCKET *sock;
     struct lcbio_CONNSTART *cs;
     lcbio_pTIMER idle_timer;
+    hrtime_t started;
     int state;
 } mgr_CINFO;
 
@@ -55,6 +60,8 @@ typedef struct lcbio_MGRREQ {
 #define HE_NPEND(he) LCB_CLIST_SIZE(&(he)->ll_pending)
 #define HE_NIDLE(he) LCB_CLIST_SIZE(&(he)->ll_idle)
 #define HE_NREQS(he) LCB_CLIST_SIZE(&(he)->requests)
+#define HE_CAN_CONNECT(he) \
+    (!(he)->parent->maxtotal || (he)->n_total < (he)->parent->maxtotal)
 
 static void on_idle_timeout(void *cookie);
 static void he_available_notify(void *cookie);
@@ -84,12 +91,22 @@ cinfo_from_sock(lcbio_SOCKET *sock)
 static void
 destroy_cinfo(mgr_CINFO *info)
 {
-    info->parent->n_total--;
+    mgr_HOST *he = info->parent;
+    he->n_total--;
     if (info->state == CS_IDLE) {
-        lcb_clist_delete(&info->parent->ll_idle, &info->llnode);
+        lcb_clist_delete(&he->ll_idle, &info->llnode);
 
     } else if (info->state == CS_PENDING && info->cs) {
         lcbio_connect_cancel(info->cs);
+    } else if (info->state == CS_LEASED) {
+        he->n_leased--;
+    }
+
+    /* A slot has been freed up for waiting requests, or for the minimum
+     * number of idle connections. Failed connections aren't retried here,
+     * so that a down host isn't connected to in a loop. */
+    if (info->state != CS_PENDING && he->async) {
+        lcbio_async_signal(he->async);
     }
 
     if (info->sock) {
@@ -255,6 +272,17 @@ on_connected(lcbio_SOCKET *sock, void *arg, lcb_error_t err, lcbio_OSERR oserr)
     lcb_log(LOGARGS(he->parent, DEBUG), HE_LOGFMT "Received result for I=%p,C=%p; E=0x%x", HE_LOGID(he), (void*)info, (void*)sock, err);
     lcb_clist_delete(&he->ll_pending, &info->llnode);
 
+    if (err != LCB_SUCCESS) {
+        he->n_connect_errors++;
+    } else {
+        hrtime_t elapsed = gethrtime() - info->started;
+        he->n_connects++;
+        he->connect_time += elapsed;
+        if (elapsed > he->connect_time_max) {
+            he->connect_time_max = elapsed;
+        }
+    }
+
     if (err != LCB_SUCCESS) {
         /** If the connection failed, fail out all remaining requests */
         lcb_list_t *cur, *next;
@@ -300,6 +328,8 @@ start_new_connection(mgr_HOST *he, uint32_t tmo)
     lcb_assert(err == LCB_SUCCESS);
     lcb_log(LOGARGS(he->parent, DEBUG), HE_LOGFMT "Starting connection on I=%p", HE_LOGID(he), (void*)info);
 
+    info->started = gethrtime();
+
     info->cs = lcbio_connect(he->parent->io, he->parent->settings, &tmphost,
                              tmo, on_connected, info);
 
@@ -308,6 +338,26 @@ start_new_connection(mgr_HOST *he, uint32_t tmo)
     he_ref(he);
 }
 
+/**
+ * Start connections for requests which don't have one pending, and for
+ * any idle connections missing from the minimum
+ */
+static void
+he_maintain(mgr_HOST *he)
+{
+    lcbio_MGR *mgr = he->parent;
+    uint32_t tmo = mgr->settings->operation_timeout;
+
+    connection_available(he);
+    while (HE_NREQS(he) > HE_NPEND(he) && HE_CAN_CONNECT(he)) {
+        start_new_connection(he, tmo);
+    }
+    while (HE_NIDLE(he) + HE_NPEND(he) < mgr->minidle && HE_CAN_CONNECT(he)) {
+        lcb_log(LOGARGS(mgr, DEBUG), HE_LOGFMT "Warming up connection. Idle=%d, Pending=%d", HE_LOGID(he), (int)HE_NIDLE(he), (int)HE_NPEND(he));
+        start_new_connection(he, tmo);
+    }
+}
+
 static void
 on_request_timeout(void *cookie)
 {
@@ -327,20 +377,13 @@ async_invoke_request(void *cookie)
     invoke_request(req);
 }
 
-mgr_REQ *
-lcbio_mgr_get(lcbio_MGR *pool, lcb_host_t *dest, uint32_t timeout,
-              lcbio_CONNDONE_cb handler, void *arg)
+static mgr_HOST *
+get_host(lcbio_MGR *pool, const lcb_host_t *dest)
 {
     mgr_HOST *he;
-    lcb_list_t *cur;
-    mgr_REQ *req = calloc(1, sizeof(*req));
     mgr_KEY key = { 0 };
 
     sprintf(key, "%s:%s", dest->host, dest->port);
-
-    req->callback = handler;
-    req->arg = arg;
-
     he = genhash_find(pool->ht, key, strlen(key));
     if (!he) {
         he = calloc(1, sizeof(*he));
@@ -357,7 +400,19 @@ lcbio_mgr_get(lcbio_MGR *pool, lcb_host_t *dest, uint32_t timeout,
         he_ref(he);
         mgr_ref(pool);
     }
+    return he;
+}
 
+mgr_REQ *
+lcbio_mgr_get(lcbio_MGR *pool, lcb_host_t *dest, uint32_t timeout,
+              lcbio_CONNDONE_cb handler, void *arg)
+{
+    mgr_HOST *he = get_host(pool, dest);
+    lcb_list_t *cur;
+    mgr_REQ *req = calloc(1, sizeof(*req));
+
+    req->callback = handler;
+    req->arg = arg;
     req->host = he;
     cur = lcb_clist_pop(&he->ll_idle);
 
@@ -372,6 +427,9 @@ lcbio_mgr_get(lcbio_MGR *pool, lcb_host_t *dest, uint32_t timeout,
         he->n_leased++;
         lcbio_async_signal(req->timer);
         lcb_log(LOGARGS(pool, INFO), HE_LOGFMT "Found ready connection in pool. Reusing socket and not creating new connection", HE_LOGID(he));
+        if (HE_NIDLE(he) + HE_NPEND(he) < pool->minidle) {
+            lcbio_async_signal(he->async);
+        }
 
     } else {
         req->state = RS_PENDING;
@@ -379,10 +437,13 @@ lcbio_mgr_get(lcbio_MGR *pool, lcb_host_t *dest, uint32_t timeout,
         lcbio_timer_rearm(req->timer, timeout);
 
         lcb_clist_append(&he->requests, &req->llnode);
-        if (HE_NPEND(he) < HE_NREQS(he)) {
+        if (HE_NPEND(he) < HE_NREQS(he) && HE_CAN_CONNECT(he)) {
             lcb_log(LOGARGS(pool, DEBUG), HE_LOGFMT "Creating new connection because none are available in the pool", HE_LOGID(he));
             start_new_connection(he, timeout);
 
+        } else if (HE_NPEND(he) < HE_NREQS(he)) {
+            lcb_log(LOGARGS(pool, DEBUG), HE_LOGFMT "Not creating a new connection. Pool is at its limit of %u", HE_LOGID(he), pool->maxtotal);
+
         } else {
             lcb_log(LOGARGS(pool, DEBUG), HE_LOGFMT "Not creating a new connection. There are still pending ones", HE_LOGID(he));
         }
@@ -398,7 +459,7 @@ lcbio_mgr_get(lcbio_MGR *pool, lcb_host_t *dest, uint32_t timeout,
 static void
 he_available_notify(void *cookie)
 {
-    connection_available((mgr_HOST *)cookie);
+    he_maintain((mgr_HOST *)cookie);
 }
 
 void
@@ -428,6 +489,11 @@ on_idle_timeout(void *cookie)
 {
     mgr_CINFO *info = cookie;
 
+    if (HE_NIDLE(info->parent) <= info->parent->parent->minidle) {
+        lcbio_timer_rearm(info->idle_timer, info->parent->parent->tmoidle);
+        return;
+    }
+
     lcb_log(LOGARGS(info->parent->parent, DEBUG), HE_LOGFMT "Idle connection expired", HE_LOGID(info->parent));
 
     lcbio_unref(info->sock);
@@ -449,8 +515,8 @@ lcbio_mgr_put(lcbio_SOCKET *sock)
     he = info->parent;
     mgr = he->parent;
 
-    if (HE_NIDLE(he) >= mgr->maxidle &&
-            HE_NREQS(he) <= (he->n_leased - he->n_leased)) {
+    if (HE_NIDLE(he) >= mgr->maxidle && HE_NIDLE(he) >= mgr->minidle &&
+            HE_NREQS(he) == 0) {
 
         lcb_log(LOGARGS(mgr, INFO), HE_LOGFMT "Closing idle connection. Too many in quota", HE_LOGID(he));
         lcbio_unref(info->sock);
@@ -463,6 +529,10 @@ lcbio_mgr_put(lcbio_SOCKET *sock)
     lcbio_timer_rearm(info->idle_timer, mgr->tmoidle);
     lcb_clist_append(&he->ll_idle, &info->llnode);
     info->state = CS_IDLE;
+    if (HE_NREQS(he)) {
+        /* Requests may be waiting because of maxtotal */
+        lcbio_async_signal(he->async);
+    }
 }
 
 void
@@ -478,6 +548,60 @@ lcbio_mgr_detach(lcbio_SOCKET *sock)
 }
 
 
+static void
+warmup_iterfunc(const void *k, lcb_size_t nk, const void *v, lcb_size_t nv,
+                void *arg)
+{
+    he_maintain((mgr_HOST *)v);
+    (void)k; (void)nk; (void)nv; (void)arg;
+}
+
+void
+lcbio_mgr_warmup(lcbio_MGR *mgr, lcb_host_t *dest)
+{
+    if (dest) {
+        he_maintain(get_host(mgr, dest));
+    } else {
+        genhash_iter(mgr->ht, warmup_iterfunc, NULL);
+    }
+}
+
+typedef struct {
+    lcbio_MGRSTATS_cb callback;
+    void *arg;
+} mgr_STATSCTX;
+
+static void
+stats_iterfunc(const void *k, lcb_size_t nk, const void *v, lcb_size_t nv,
+               void *arg)
+{
+    mgr_STATSCTX *ctx = arg;
+    const mgr_HOST *he = v;
+    lcb_POOLHOSTSTATS stats;
+
+    stats.host = he->key;
+    stats.waiters = (lcb_U32)HE_NREQS(he);
+    stats.idle = (lcb_U32)HE_NIDLE(he);
+    stats.pending = (lcb_U32)HE_NPEND(he);
+    stats.leased = he->n_leased;
+    stats.total = he->n_total;
+    stats.connects = he->n_connects;
+    stats.connect_errors = he->n_connect_errors;
+    stats.connect_time = LCB_NS2US(he->connect_time);
+    stats.connect_time_max = (lcb_U32)LCB_NS2US(he->connect_time_max);
+    ctx->callback(&stats, ctx->arg);
+    (void)k; (void)nk; (void)nv;
+}
+
+void
+lcbio_mgr_stats(lcbio_MGR *mgr, lcbio_MGRSTATS_cb callback, void *arg)
+{
+    mgr_STATSCTX ctx;
+    ctx.callback = callback;
+    ctx.arg = arg;
+    genhash_iter(mgr->ht, stats_iterfunc, &ctx);
+}
+
 #define CONN_INDENT "    "
 
 static void
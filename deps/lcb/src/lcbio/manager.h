@@ -43,8 +43,17 @@ typedef struct lcbio_MGR {
      * before being closed
      */
     uint32_t tmoidle;
+
+    /** Maximum number of open connections, per host. 0 for no limit */
     unsigned maxtotal;
     unsigned maxidle; /**< Maximum number of idle connections, per host */
+
+    /**
+     * Number of idle connections to keep open per host. These are connected
+     * in the background, ahead of being requested, and are not closed when
+     * idle.
+     */
+    unsigned minidle;
     unsigned refcount;
 } lcbio_MGR;
 
@@ -126,6 +135,32 @@ void lcbio_mgr_discard(lcbio_SOCKET *sock);
 LCB_INTERNAL_API
 void lcbio_mgr_detach(lcbio_SOCKET *sock);
 
+/**
+ * Open connections in the background so that at least lcbio_MGR::minidle
+ * are idle, up to lcbio_MGR::maxtotal. This should also be called after
+ * changing either limit.
+ *
+ * @param mgr the pool
+ * @param dest the host to connect to. If NULL, all hosts the pool has
+ * previously connected to are topped up.
+ */
+LCB_INTERNAL_API
+void
+lcbio_mgr_warmup(lcbio_MGR *mgr, lcb_host_t *dest);
+
+typedef void (*lcbio_MGRSTATS_cb)(const lcb_POOLHOSTSTATS *stats, void *arg);
+
+/**
+ * Get the statistics for each host in the pool
+ * @param mgr the pool
+ * @param callback invoked once per host. The `host` field is only valid within
+ * the callback
+ * @param arg passed to the callback
+ */
+LCB_INTERNAL_API
+void
+lcbio_mgr_stats(lcbio_MGR *mgr, lcbio_MGRSTATS_cb callback, void *arg);
+
 /**
  * Dumps the connection manager state to stderr
  */
@@ -5,16 +5,90 @@
 #include <contrib/snappy/snappy-c.h>
 #endif
 
+void
+mcreq_compress_init(mc_COMPRESSCTX *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->policy.min_size = MCREQ_COMPRESS_DEFAULT_MINSIZE;
+    ctx->policy.min_ratio = MCREQ_COMPRESS_DEFAULT_MINRATIO;
+    ctx->policy.max_sample_interval = MCREQ_COMPRESS_DEFAULT_MAXSAMPLE;
+}
+
+void
+mcreq_compress_cleanup(mc_COMPRESSCTX *ctx)
+{
+    free(ctx->inflatebuf);
+    ctx->inflatebuf = NULL;
+    ctx->ninflatebuf = 0;
+}
+
+#ifndef LCB_NO_SNAPPY
+/* Hash the key up to the first separator (at most 16 bytes) into a slot */
+static unsigned
+prefix_slot(const void *key, lcb_SIZE nkey)
+{
+    const unsigned char *p = key;
+    lcb_U32 hv = 2166136261u;
+    lcb_SIZE ii;
+
+    for (ii = 0; ii < nkey && ii < 16; ii++) {
+        if (p[ii] == ':' || p[ii] == '_' || p[ii] == '-' || p[ii] == '|' ||
+                p[ii] == '/' || p[ii] == '.') {
+            break;
+        }
+        hv = (hv ^ p[ii]) * 16777619u;
+    }
+    return (hv ^ (hv >> 16)) % MCREQ_COMPRESS_NPREFIXES;
+}
+
+/* Each further failure doubles the number of values skipped for the prefix */
+static void
+prefix_failed(mc_COMPRESSCTX *ctx, unsigned slot)
+{
+    unsigned interval, nfailed = ++ctx->prefixes[slot].nfailed;
+    if (nfailed < 2) {
+        return;
+    }
+    interval = nfailed - 1 < 16 ? 1u << (nfailed - 1) : 1u << 16;
+    if (interval > ctx->policy.max_sample_interval) {
+        interval = ctx->policy.max_sample_interval;
+    }
+    ctx->prefixes[slot].nskip = interval - 1;
+}
+#endif
+
 int
-mcreq_compress_value(mc_PIPELINE *pl, mc_PACKET *pkt, const lcb_CONTIGBUF *vbuf)
+mcreq_compress_value(mc_PIPELINE *pl, mc_PACKET *pkt, const lcb_CONTIGBUF *vbuf,
+    mc_COMPRESSCTX *ctx, const void *key, lcb_SIZE nkey)
 {
 #ifdef LCB_NO_SNAPPY
-    (void)pl;(void)pkt;(void)vbuf;return -1;
+    (void)pl;(void)pkt;(void)vbuf;(void)ctx;(void)key;(void)nkey;return -1;
 #else
     /* get the desired size */
     size_t maxsize, compsize;
     snappy_status status;
     nb_SPAN *outspan;
+    unsigned slot = 0;
+    hrtime_t begin = 0;
+
+    if (ctx) {
+        ctx->stats.nvalues++;
+        if (vbuf->nbytes < ctx->policy.min_size) {
+            ctx->stats.nsmall++;
+            return 1;
+        }
+        slot = prefix_slot(key, nkey);
+        if (ctx->prefixes[slot].nskip >= ctx->policy.max_sample_interval) {
+            /* The interval has since been lowered */
+            ctx->prefixes[slot].nskip = ctx->policy.max_sample_interval - 1;
+        }
+        if (ctx->prefixes[slot].nskip) {
+            ctx->prefixes[slot].nskip--;
+            ctx->stats.nbackoff++;
+            return 1;
+        }
+        begin = gethrtime();
+    }
 
     compsize = maxsize = snappy_max_compressed_length(vbuf->nbytes);
     if (mcreq_reserve_value2(pl, pkt, maxsize) != LCB_SUCCESS) {
@@ -29,6 +103,24 @@ mcreq_compress_value(mc_PIPELINE *pl, mc_PACKET *pkt, const lcb_CONTIGBUF *vbuf)
         return -1;
     }
 
+    if (ctx) {
+        ctx->stats.compress_ns += gethrtime() - begin;
+        if ((double)vbuf->nbytes <
+                (double)compsize * (double)ctx->policy.min_ratio) {
+            /* Not worth it. Give back the whole reservation */
+            netbuf_mblock_release(&pl->nbmgr, outspan);
+            outspan->size = 0;
+            pkt->flags &= ~MCREQ_F_HASVALUE;
+            ctx->stats.nrejected++;
+            prefix_failed(ctx, slot);
+            return 1;
+        }
+        ctx->prefixes[slot].nfailed = 0;
+        ctx->stats.ncompressed++;
+        ctx->stats.bytes_raw += vbuf->nbytes;
+        ctx->stats.bytes_compressed += compsize;
+    }
+
     if (compsize < maxsize) {
         /* chop off some bytes? */
         nb_SPAN trailspan = *outspan;
@@ -42,32 +134,116 @@ mcreq_compress_value(mc_PIPELINE *pl, mc_PACKET *pkt, const lcb_CONTIGBUF *vbuf)
 }
 
 int
-mcreq_inflate_value(const void *compressed, lcb_SIZE ncompressed,
-    const void **bytes, lcb_SIZE *nbytes, void **freeptr)
+mcreq_inflate_size(const void *compressed, lcb_SIZE ncompressed,
+    lcb_SIZE *nbytes)
 {
 #ifdef LCB_NO_SNAPPY
-    (void)compressed;(void)ncompressed;(void)bytes;(void)nbytes;(void)freeptr;
+    (void)compressed;(void)ncompressed;(void)nbytes;
     return -1;
 #else
-    lcb_SIZE cursize, compsize;
-    snappy_status status;
-    cursize = ncompressed;
-    do {
-        cursize *= 2;
-        *freeptr = realloc(*freeptr, cursize);
-        compsize = cursize;
-        status = snappy_uncompress(compressed, ncompressed, *freeptr, &compsize);
-    } while (status == SNAPPY_BUFFER_TOO_SMALL);
+    size_t result;
+    if (snappy_uncompressed_length(compressed, ncompressed, &result) != SNAPPY_OK) {
+        return -1;
+    }
+    *nbytes = result;
+    return 0;
+#endif
+}
 
-    if (status != SNAPPY_OK) {
-        /* TODO: return an error here */
+int
+mcreq_inflate_into(const void *compressed, lcb_SIZE ncompressed,
+    void *dst, lcb_SIZE ndst)
+{
+#ifdef LCB_NO_SNAPPY
+    (void)compressed;(void)ncompressed;(void)dst;(void)ndst;
+    return -1;
+#else
+    size_t outsize = ndst;
+    if (snappy_uncompress(compressed, ncompressed, dst, &outsize) != SNAPPY_OK) {
+        return -1;
+    }
+    return 0;
+#endif
+}
+
+int
+mcreq_inflate_value(const void *compressed, lcb_SIZE ncompressed,
+    const void **bytes, lcb_SIZE *nbytes, void **freeptr)
+{
+    lcb_SIZE n_inflated;
+
+    if (mcreq_inflate_size(compressed, ncompressed, &n_inflated) != 0) {
+        return -1;
+    }
+    /* Always allocate at least one byte, so that freeptr is non-NULL */
+    *freeptr = realloc(*freeptr, n_inflated ? n_inflated : 1);
+    if (*freeptr == NULL) {
+        return -1;
+    }
+    if (mcreq_inflate_into(compressed, ncompressed, *freeptr, n_inflated) != 0) {
         free(*freeptr);
         *freeptr = NULL;
         return -1;
     }
 
     *bytes = *freeptr;
-    *nbytes = compsize;
+    *nbytes = n_inflated;
     return 0;
-#endif
+}
+
+int
+mcreq_inflate_pooled(mc_COMPRESSCTX *ctx,
+    const void *compressed, lcb_SIZE ncompressed,
+    const void **bytes, lcb_SIZE *nbytes, void **freeptr)
+{
+    lcb_SIZE n_inflated;
+    void *dst;
+
+    *freeptr = NULL;
+    if (mcreq_inflate_size(compressed, ncompressed, &n_inflated) != 0) {
+        return -1;
+    }
+
+    if (n_inflated > MCREQ_INFLATE_POOLMAX || ctx->inflatebuf_used) {
+        dst = malloc(n_inflated ? n_inflated : 1);
+    } else {
+        if (ctx->ninflatebuf < n_inflated || ctx->inflatebuf == NULL) {
+            /* The old contents are not needed, so don't realloc() */
+            free(ctx->inflatebuf);
+            ctx->ninflatebuf = n_inflated ? n_inflated : 1;
+            ctx->inflatebuf = malloc(ctx->ninflatebuf);
+            if (ctx->inflatebuf == NULL) {
+                ctx->ninflatebuf = 0;
+                return -1;
+            }
+        }
+        ctx->inflatebuf_used = 1;
+        dst = ctx->inflatebuf;
+    }
+    if (dst == NULL) {
+        return -1;
+    }
+
+    *freeptr = dst;
+    if (mcreq_inflate_into(compressed, ncompressed, dst, n_inflated) != 0) {
+        mcreq_inflate_release(ctx, dst);
+        *freeptr = NULL;
+        return -1;
+    }
+    *bytes = dst;
+    *nbytes = n_inflated;
+    return 0;
+}
+
+void
+mcreq_inflate_release(mc_COMPRESSCTX *ctx, void *freeptr)
+{
+    if (freeptr == NULL) {
+        return;
+    }
+    if (freeptr == ctx->inflatebuf) {
+        ctx->inflatebuf_used = 0;
+    } else {
+        free(freeptr);
+    }
 }
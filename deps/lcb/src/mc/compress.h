@@ -6,15 +6,54 @@
 extern "C" {
 #endif
 
+#define MCREQ_COMPRESS_DEFAULT_MINSIZE 32
+#define MCREQ_COMPRESS_DEFAULT_MINRATIO 1.1f
+#define MCREQ_COMPRESS_DEFAULT_MAXSAMPLE 64
+
+/** Number of slots into which key prefixes are hashed */
+#define MCREQ_COMPRESS_NPREFIXES 256
+
+/**
+ * Adaptive compression state. This decides whether a value is worth
+ * compressing, and remembers key prefixes whose values recently failed to
+ * compress so that only a sample of their values is tried.
+ */
+typedef struct {
+    lcb_COMPRESSPOLICY policy;
+    lcb_COMPRESSSTATS stats;
+    struct {
+        unsigned nfailed; /**< Consecutive values which did not compress */
+        unsigned nskip; /**< Values to skip before trying again */
+    } prefixes[MCREQ_COMPRESS_NPREFIXES];
+
+    void *inflatebuf; /**< Buffer reused for inflating values */
+    lcb_SIZE ninflatebuf;
+    int inflatebuf_used;
+} mc_COMPRESSCTX;
+
+/** Initialize the context with the default policy */
+void
+mcreq_compress_init(mc_COMPRESSCTX *ctx);
+
+/** Release any resources held by the context */
+void
+mcreq_compress_cleanup(mc_COMPRESSCTX *ctx);
+
 /**
  * Stores a compressed payload into a packet
  * @param pl The pipeline which hosts the packet
  * @param pkt The packet which hosts the value
  * @param vbuf The user input to be compressed
- * @return 0 if successful, nonzero on error.
+ * @param ctx The compression policy context. If NULL, the value is always
+ * compressed
+ * @param key The key of the item, used to track its prefix
+ * @param nkey The length of the key
+ * @return 0 if the value was compressed, 1 if the policy decided against
+ * compression (in which case no value has been reserved), or -1 on error
  */
 int
-mcreq_compress_value(mc_PIPELINE *pl, mc_PACKET *pkt, const lcb_CONTIGBUF *vbuf);
+mcreq_compress_value(mc_PIPELINE *pl, mc_PACKET *pkt, const lcb_CONTIGBUF *vbuf,
+    mc_COMPRESSCTX *ctx, const void *key, lcb_SIZE nkey);
 
 
 /**
@@ -32,6 +71,61 @@ int
 mcreq_inflate_value(const void *compressed, lcb_SIZE ncompressed,
     const void **bytes, lcb_SIZE *nbytes, void **freeptr);
 
+/** Largest inflated value for which the context's buffer is retained */
+#define MCREQ_INFLATE_POOLMAX 1048576
+
+/**
+ * Get the size of a compressed value once it has been inflated
+ * @param compressed The value to inflate
+ * @param ncompressed Size of value to inflate
+ * @param[out] nbytes The size of the inflated value
+ * @return 0 if successful, nonzero if the value is not valid
+ */
+int
+mcreq_inflate_size(const void *compressed, lcb_SIZE ncompressed,
+    lcb_SIZE *nbytes);
+
+/**
+ * Inflate a compressed value into a caller supplied buffer
+ * @param compressed The value to inflate
+ * @param ncompressed Size of value to inflate
+ * @param dst The buffer. This must be at least as large as the size returned
+ * by mcreq_inflate_size()
+ * @param ndst The size of the buffer
+ * @return 0 if successful, nonzero on error
+ */
+int
+mcreq_inflate_into(const void *compressed, lcb_SIZE ncompressed,
+    void *dst, lcb_SIZE ndst);
+
+/**
+ * Inflate a value into a buffer owned by the context. The buffer is reused
+ * once it is released using mcreq_inflate_release(). Values larger than
+ * @ref MCREQ_INFLATE_POOLMAX, or inflated while the buffer is still in use,
+ * are inflated into a buffer of their own.
+ *
+ * @param ctx The context
+ * @param compressed The value to inflate
+ * @param ncompressed Size of value to inflate
+ * @param[out] bytes The inflated value
+ * @param[out] nbytes The size of the inflated value
+ * @param[out] freeptr Set to the buffer to be passed to
+ * mcreq_inflate_release() once the value is no longer required
+ * @return 0 if successful, nonzero on error.
+ */
+int
+mcreq_inflate_pooled(mc_COMPRESSCTX *ctx,
+    const void *compressed, lcb_SIZE ncompressed,
+    const void **bytes, lcb_SIZE *nbytes, void **freeptr);
+
+/**
+ * Release a buffer returned by mcreq_inflate_pooled()
+ * @param ctx The context
+ * @param freeptr The buffer. May be NULL
+ */
+void
+mcreq_inflate_release(mc_COMPRESSCTX *ctx, void *freeptr);
+
 #ifndef LCB_NO_SNAPPY
 #define mcreq_compression_supported() 1
 #else
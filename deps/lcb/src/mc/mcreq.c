@@ -126,13 +126,13 @@ mcreq_reserve_value(
 }
 
 static int
-pkt_tmo_compar(sllist_node *a, sllist_node *b)
+pkt_tmo_compar(lcb_list_t *a, lcb_list_t *b)
 {
     mc_PACKET *pa, *pb;
     hrtime_t tmo_a, tmo_b;
 
-    pa = SLLIST_ITEM(a, mc_PACKET, slnode);
-    pb = SLLIST_ITEM(b, mc_PACKET, slnode);
+    pa = LCB_LIST_ITEM(a, mc_PACKET, llnode);
+    pb = LCB_LIST_ITEM(b, mc_PACKET, llnode);
 
     tmo_a = MCREQ_PKT_RDATA(pa)->start;
     tmo_b = MCREQ_PKT_RDATA(pb)->start;
@@ -149,17 +149,165 @@ pkt_tmo_compar(sllist_node *a, sllist_node *b)
 void
 mcreq_reenqueue_packet(mc_PIPELINE *pipeline, mc_PACKET *packet)
 {
-    sllist_root *reqs = &pipeline->requests;
+    lcb_list_t *reqs = &pipeline->requests;
     mcreq_enqueue_packet(pipeline, packet);
-    sllist_remove(reqs, &packet->slnode);
-    sllist_insert_sorted(reqs, &packet->slnode, pkt_tmo_compar);
+    lcb_list_delete(&packet->llnode);
+    lcb_list_add_sorted(reqs, &packet->llnode, pkt_tmo_compar);
 }
 
 void
-mcreq_enqueue_packet(mc_PIPELINE *pipeline, mc_PACKET *packet)
+mcreq_reenqueue_packet_after(mc_PIPELINE *pipeline, mc_PACKET *packet,
+                             mc_PACKET *hint)
+{
+    lcb_list_t *reqs = &pipeline->requests, *ll;
+
+    if (hint == NULL || pkt_tmo_compar(&packet->llnode, &hint->llnode) < 0) {
+        mcreq_reenqueue_packet(pipeline, packet);
+        return;
+    }
+
+    mcreq_enqueue_packet(pipeline, packet);
+    lcb_list_delete(&packet->llnode);
+    for (ll = hint->llnode.next; ll != reqs; ll = ll->next) {
+        if (pkt_tmo_compar(&packet->llnode, ll) < 0) {
+            break;
+        }
+    }
+    /* Appending to a node of the list inserts the packet just before it */
+    lcb_list_append(ll, &packet->llnode);
+}
+
+#define PKT_NBYTES(pkt) mcreq_get_size(pkt)
+
+/* Minimum number of slots in the opaque index */
+#define OPINDEX_MINSIZE 64
+
+#define OPINDEX_SLOT(pl, opaque) ((opaque) & (pl)->opindex_mask)
+#define OPINDEX_NEXT(pl, ix) (((ix) + 1) & (pl)->opindex_mask)
+
+static void
+opindex_insert(mc_PIPELINE *pl, mc_PACKET *pkt)
+{
+    unsigned ix = OPINDEX_SLOT(pl, pkt->opaque);
+    while (pl->opindex[ix]) {
+        ix = OPINDEX_NEXT(pl, ix);
+    }
+    pl->opindex[ix] = pkt;
+}
+
+/** Rehash the index into `nslots` slots. Returns 0 on allocation failure */
+static int
+opindex_resize(mc_PIPELINE *pl, unsigned nslots)
+{
+    mc_PACKET **old = pl->opindex;
+    unsigned ii, nold = old ? pl->opindex_mask + 1 : 0;
+
+    pl->opindex = calloc(nslots, sizeof(*pl->opindex));
+    if (!pl->opindex) {
+        pl->opindex = old;
+        return 0;
+    }
+    pl->opindex_mask = nslots - 1;
+    for (ii = 0; ii < nold; ii++) {
+        if (old[ii]) {
+            opindex_insert(pl, old[ii]);
+        }
+    }
+    free(old);
+    return 1;
+}
+
+static void
+opindex_add(mc_PIPELINE *pl, mc_PACKET *pkt)
+{
+    unsigned nslots = pl->opindex ? pl->opindex_mask + 1 : 0;
+    /* Keep at least half of the slots free, so probe sequences stay short */
+    if ((pl->opindex_count + 1) * 2 > nslots &&
+            !opindex_resize(pl, nslots ? nslots * 2 : OPINDEX_MINSIZE)) {
+        /* Out of memory. Fill the table further, but always leave a free
+         * slot so that probes terminate; past that, spill to the list */
+        if (pl->opindex_count + 1 >= nslots) {
+            pl->opindex_nspill++;
+            return;
+        }
+    }
+    opindex_insert(pl, pkt);
+    pl->opindex_count++;
+}
+
+/** Returns the slot of `pkt`, or of the first packet with `opaque` if NULL */
+static int
+opindex_find(const mc_PIPELINE *pl, const mc_PACKET *pkt, lcb_uint32_t opaque)
+{
+    unsigned ix;
+    mc_PACKET *cur;
+
+    if (!pl->opindex_count) {
+        return -1;
+    }
+    for (ix = OPINDEX_SLOT(pl, opaque); (cur = pl->opindex[ix]);
+            ix = OPINDEX_NEXT(pl, ix)) {
+        if (pkt ? cur == pkt : cur->opaque == opaque) {
+            return ix;
+        }
+    }
+    return -1;
+}
+
+static void
+opindex_del(mc_PIPELINE *pl, unsigned ix)
+{
+    unsigned next;
+    mc_PACKET *cur;
+
+    /* Move back any following packet whose probe sequence passes through
+     * the emptied slot, so that lookups do not stop short of it */
+    pl->opindex[ix] = NULL;
+    for (next = OPINDEX_NEXT(pl, ix); (cur = pl->opindex[next]);
+            next = OPINDEX_NEXT(pl, next)) {
+        unsigned home = OPINDEX_SLOT(pl, cur->opaque);
+        if (((next - home) & pl->opindex_mask) >=
+                ((next - ix) & pl->opindex_mask)) {
+            pl->opindex[ix] = cur;
+            pl->opindex[next] = NULL;
+            ix = next;
+        }
+    }
+
+    pl->opindex_count--;
+    if (pl->opindex_count * 8 < pl->opindex_mask + 1 &&
+            pl->opindex_mask + 1 > OPINDEX_MINSIZE) {
+        opindex_resize(pl, (pl->opindex_mask + 1) / 2);
+    }
+}
+
+/** Remove a packet found at `ix` (-1 if spilled) from the index */
+static void
+opindex_remove(mc_PIPELINE *pl, int ix)
+{
+    if (ix >= 0) {
+        opindex_del(pl, ix);
+    } else {
+        lcb_assert(pl->opindex_nspill);
+        pl->opindex_nspill--;
+    }
+}
+
+/** Remove a packet from the list of requests (and from the index) */
+static void
+pipeline_unlink(mc_PIPELINE *pl, mc_PACKET *pkt)
+{
+    opindex_remove(pl, opindex_find(pl, pkt, pkt->opaque));
+    lcb_list_delete(&pkt->llnode);
+    pl->nbytes_pending -= PKT_NBYTES(pkt);
+}
+
+static void
+pipeline_enqueue(mc_PIPELINE *pipeline, mc_PACKET *packet)
 {
     nb_SPAN *vspan = &packet->u_value.single;
-    sllist_append(&pipeline->requests, &packet->slnode);
+    lcb_list_append(&pipeline->requests, &packet->llnode);
+    opindex_add(pipeline, packet);
     netbuf_enqueue_span(&pipeline->nbmgr, &packet->kh_span);
 
     if (!(packet->flags & MCREQ_F_HASVALUE)) {
@@ -181,6 +329,13 @@ mcreq_enqueue_packet(mc_PIPELINE *pipeline, mc_PACKET *packet)
     netbuf_pdu_enqueue(&pipeline->nbmgr, packet, offsetof(mc_PACKET, sl_flushq));
 }
 
+void
+mcreq_enqueue_packet(mc_PIPELINE *pipeline, mc_PACKET *packet)
+{
+    pipeline->nbytes_pending += PKT_NBYTES(packet);
+    pipeline_enqueue(pipeline, packet);
+}
+
 void
 mcreq_wipe_packet(mc_PIPELINE *pipeline, mc_PACKET *packet)
 {
@@ -269,6 +424,7 @@ mcreq_dup_packet(const mc_PACKET *src)
     dst->alloc_parent = NULL;
     dst->sl_flushq.next = NULL;
     dst->slnode.next = NULL;
+    dst->llnode.next = dst->llnode.prev = NULL;
     dst->retries = src->retries;
 
     if (src->flags & MCREQ_F_HASVALUE) {
@@ -352,11 +508,48 @@ mcreq_extract_hashkey(
     }
 }
 
+mc_PIPELINE *
+mcreq_select_lane(mc_PIPELINE *pipeline, lcb_SIZE nvalue)
+{
+    mc_PIPELINE *best = pipeline;
+    lcb_SIZE threshold = pipeline->parent->lane_threshold;
+    unsigned ii, nlanes = pipeline->nlanes;
+
+    if (!nlanes) {
+        return pipeline;
+    }
+
+    if (threshold) {
+        /* The last lane is reserved for large values */
+        if (nvalue >= threshold) {
+            return pipeline->lanes[nlanes - 1];
+        }
+        nlanes--;
+    }
+
+    for (ii = 0; ii < nlanes && best->nbytes_pending; ii++) {
+        mc_PIPELINE *cur = pipeline->lanes[ii];
+        if (cur->nbytes_pending < best->nbytes_pending) {
+            best = cur;
+        }
+    }
+    return best;
+}
+
 lcb_error_t
 mcreq_basic_packet(
         mc_CMDQUEUE *queue, const lcb_CMDBASE *cmd,
         protocol_binary_request_header *req, lcb_uint8_t extlen,
         mc_PACKET **packet, mc_PIPELINE **pipeline)
+{
+    return mcreq_basic_packet2(queue, cmd, req, extlen, 0, packet, pipeline);
+}
+
+lcb_error_t
+mcreq_basic_packet2(
+        mc_CMDQUEUE *queue, const lcb_CMDBASE *cmd,
+        protocol_binary_request_header *req, lcb_uint8_t extlen,
+        lcb_SIZE nvalue, mc_PACKET **packet, mc_PIPELINE **pipeline)
 {
     const void *hashkey;
     lcb_size_t nhashkey;
@@ -366,15 +559,24 @@ mcreq_basic_packet(
         return LCB_CLIENT_ETMPFAIL;
     }
 
-    mcreq_extract_hashkey(&cmd->key, &cmd->hashkey,
-                          sizeof(*req) + extlen, &hashkey, &nhashkey);
+    vb = (cmd->cmdflags & LCB_CMD_VBID_MASK);
+    if ((cmd->cmdflags & LCB_CMD_F_VBID) && cmd->hashkey.contig.nbytes == 0 &&
+            LCBVB_DISTTYPE(queue->config) == LCBVB_DIST_VBUCKET &&
+            (unsigned)vb < queue->config->nvb) {
+        /* The caller has already hashed the key */
+        srvix = lcbvb_vbmaster(queue->config, vb);
+
+    } else {
+        mcreq_extract_hashkey(&cmd->key, &cmd->hashkey,
+                              sizeof(*req) + extlen, &hashkey, &nhashkey);
+        vbucket_map(queue->config, hashkey, nhashkey, &vb, &srvix);
+    }
 
-    vbucket_map(queue->config, hashkey, nhashkey, &vb, &srvix);
     if (srvix < 0 || (unsigned)srvix >= queue->npipelines) {
         return LCB_NO_MATCHING_SERVER;
     }
 
-    *pipeline = queue->pipelines[srvix];
+    *pipeline = mcreq_select_lane(queue->pipelines[srvix], nvalue);
     *packet = mcreq_allocate_packet(*pipeline);
 
     mcreq_reserve_key(*pipeline, *packet, sizeof(*req) + extlen, &cmd->key);
@@ -410,6 +612,10 @@ mcreq_pipeline_cleanup(mc_PIPELINE *pipeline)
 {
     netbuf_cleanup(&pipeline->nbmgr);
     netbuf_cleanup(&pipeline->reqpool);
+    free(pipeline->opindex);
+    pipeline->opindex = NULL;
+    pipeline->opindex_count = 0;
+    pipeline->opindex_nspill = 0;
 }
 
 int
@@ -418,12 +624,24 @@ mcreq_pipeline_init(mc_PIPELINE *pipeline)
     nb_SETTINGS settings;
     netbuf_default_settings(&settings);
 
-    /** Initialize datapool */
+    /** Initialize datapool. Sized to the values being sent */
+    settings.data_maxalloc = MCREQ_DATA_MAXALLOC;
     netbuf_init(&pipeline->nbmgr, &settings);
 
     /** Initialize request pool */
+    settings.data_maxalloc = 0;
     settings.data_basealloc = sizeof(mc_PACKET) * 32;
     netbuf_init(&pipeline->reqpool, &settings);
+
+    lcb_list_init(&pipeline->requests);
+    pipeline->opindex = NULL;
+    pipeline->opindex_mask = 0;
+    pipeline->opindex_count = 0;
+    pipeline->opindex_nspill = 0;
+    pipeline->lanes = NULL;
+    pipeline->nlanes = 0;
+    pipeline->primary = NULL;
+    pipeline->nbytes_pending = 0;
     return 0;
 }
 
@@ -443,8 +661,13 @@ mcreq_queue_add_pipelines(
     queue->scheds = calloc(npipelines, 1);
 
     for (ii = 0; ii < npipelines; ii++) {
+        unsigned jj;
         pipelines[ii]->parent = queue;
         pipelines[ii]->index = ii;
+        for (jj = 0; jj < pipelines[ii]->nlanes; jj++) {
+            pipelines[ii]->lanes[jj]->parent = queue;
+            pipelines[ii]->lanes[jj]->index = ii;
+        }
     }
 }
 
@@ -466,6 +689,7 @@ mcreq_queue_init(mc_CMDQUEUE *queue)
     queue->scheds = NULL;
     queue->npipelines = 0;
     queue->nremaining = 0;
+    queue->lane_threshold = 0;
     return 0;
 }
 
@@ -483,37 +707,51 @@ mcreq_sched_enter(mc_CMDQUEUE *queue)
     (void)queue;
 }
 
+static void
+pipeline_leave(mc_PIPELINE *pipeline, int success, int flush)
+{
+    sllist_node *ll_next, *ll = pipeline->ctxqueued.first;
+
+    if (!ll) {
+        return;
+    }
+
+    while (ll) {
+        mc_PACKET *pkt = SLLIST_ITEM(ll, mc_PACKET, slnode);
+        ll_next = ll->next;
+
+        if (success) {
+            pipeline_enqueue(pipeline, pkt);
+        } else {
+            pipeline->nbytes_pending -= PKT_NBYTES(pkt);
+            mcreq_wipe_packet(pipeline, pkt);
+            mcreq_release_packet(pipeline, pkt);
+        }
+
+        ll = ll_next;
+    }
+    pipeline->ctxqueued.first = pipeline->ctxqueued.last = NULL;
+    if (flush) {
+        pipeline->flush_start(pipeline);
+    }
+}
+
 static void
 queuectx_leave(mc_CMDQUEUE *queue, int success, int flush)
 {
-    unsigned ii;
+    unsigned ii, jj;
     for (ii = 0; ii < queue->npipelines; ii++) {
         mc_PIPELINE *pipeline;
-        sllist_node *ll_next, *ll;
 
         if (!queue->scheds[ii]) {
             continue;
         }
 
+        /* Lanes share the index (and thus the sched flag) of their primary */
         pipeline = queue->pipelines[ii];
-        ll = pipeline->ctxqueued.first;
-
-        while (ll) {
-            mc_PACKET *pkt = SLLIST_ITEM(ll, mc_PACKET, slnode);
-            ll_next = ll->next;
-
-            if (success) {
-                mcreq_enqueue_packet(pipeline, pkt);
-            } else {
-                mcreq_wipe_packet(pipeline, pkt);
-                mcreq_release_packet(pipeline, pkt);
-            }
-
-            ll = ll_next;
-        }
-        pipeline->ctxqueued.first = pipeline->ctxqueued.last = NULL;
-        if (flush) {
-            pipeline->flush_start(pipeline);
+        pipeline_leave(pipeline, success, flush);
+        for (jj = 0; jj < pipeline->nlanes; jj++) {
+            pipeline_leave(pipeline->lanes[jj], success, flush);
         }
         queue->scheds[ii] = 0;
     }
@@ -538,23 +776,36 @@ mcreq_sched_add(mc_PIPELINE *pipeline, mc_PACKET *pkt)
     if (!cq->scheds[pipeline->index]) {
         cq->scheds[pipeline->index] = 1;
     }
+    pipeline->nbytes_pending += PKT_NBYTES(pkt);
     sllist_append(&pipeline->ctxqueued, &pkt->slnode);
 }
 
 static mc_PACKET *
 pipeline_find(mc_PIPELINE *pipeline, lcb_uint32_t opaque, int do_remove)
 {
-    sllist_iterator iter;
-    SLLIST_ITERFOR(&pipeline->requests, &iter) {
-        mc_PACKET *pkt = SLLIST_ITEM(iter.cur, mc_PACKET, slnode);
-        if (pkt->opaque == opaque) {
-            if (do_remove) {
-                sllist_iter_remove(&pipeline->requests, &iter);
+    mc_PACKET *pkt = NULL;
+    int ix = opindex_find(pipeline, NULL, opaque);
+    if (ix >= 0) {
+        pkt = pipeline->opindex[ix];
+    } else if (pipeline->opindex_nspill) {
+        lcb_list_t *ll;
+        LCB_LIST_FOR(ll, &pipeline->requests) {
+            mc_PACKET *cur = LCB_LIST_ITEM(ll, mc_PACKET, llnode);
+            if (cur->opaque == opaque) {
+                pkt = cur;
+                break;
             }
-            return pkt;
         }
     }
-    return NULL;
+    if (!pkt) {
+        return NULL;
+    }
+    if (do_remove) {
+        opindex_remove(pipeline, ix);
+        lcb_list_delete(&pkt->llnode);
+        pipeline->nbytes_pending -= PKT_NBYTES(pkt);
+    }
+    return pkt;
 }
 
 mc_PACKET *
@@ -605,11 +856,11 @@ mcreq_pipeline_timeout(
         mc_PIPELINE *pl, lcb_error_t err, mcreq_pktfail_fn failcb, void *cbarg,
         hrtime_t oldest_valid, hrtime_t *oldest_start)
 {
-    sllist_iterator iter;
+    lcb_list_t *ll, *ll_next;
     unsigned count = 0;
 
-    SLLIST_ITERFOR(&pl->requests, &iter) {
-        mc_PACKET *pkt = SLLIST_ITEM(iter.cur, mc_PACKET, slnode);
+    LCB_LIST_SAFE_FOR(ll, ll_next, &pl->requests) {
+        mc_PACKET *pkt = LCB_LIST_ITEM(ll, mc_PACKET, llnode);
         mc_REQDATA *rd = MCREQ_PKT_RDATA(pkt);
 
         /**
@@ -624,7 +875,7 @@ mcreq_pipeline_timeout(
             return count;
         }
 
-        sllist_iter_remove(&pl->requests, &iter);
+        pipeline_unlink(pl, pkt);
         failcb(pl, pkt, err, cbarg);
         mcreq_packet_handled(pl, pkt);
         count++;
@@ -643,16 +894,164 @@ void
 mcreq_iterwipe(mc_CMDQUEUE *queue, mc_PIPELINE *src,
                mcreq_iterwipe_fn callback, void *arg)
 {
-    sllist_iterator iter;
+    lcb_list_t *ll, *ll_next;
 
-    SLLIST_ITERFOR(&src->requests, &iter) {
-        int rv;
-        mc_PACKET *orig = SLLIST_ITEM(iter.cur, mc_PACKET, slnode);
+    LCB_LIST_SAFE_FOR(ll, ll_next, &src->requests) {
+        int rv, ix;
+        mc_PACKET *orig = LCB_LIST_ITEM(ll, mc_PACKET, llnode);
+        lcb_list_t *ll_prev = ll->prev;
+        lcb_SIZE nbytes = PKT_NBYTES(orig);
+
+        /* The callback may release the packet if it is removed */
+        ix = opindex_find(src, orig, orig->opaque);
         rv = callback(queue, src, orig, arg);
         if (rv == MCREQ_REMOVE_PACKET) {
-            sllist_iter_remove(&src->requests, &iter);
+            opindex_remove(src, ix);
+            ll_prev->next = ll_next;
+            ll_next->prev = ll_prev;
+            src->nbytes_pending -= nbytes;
+        }
+    }
+}
+
+void
+mcreq_iovbatch_cleanup(mc_IOVBATCH *batch)
+{
+    free(batch->iov);
+    free(batch->scratch);
+    batch->iov = NULL;
+    batch->scratch = NULL;
+    batch->nalloc = 0;
+    batch->nused = 0;
+    batch->nidle = 0;
+}
+
+/* Number of underused batches after which the IOV array is halved */
+#define IOVBATCH_SHRINK_AFTER 64
+
+/**
+ * Resize the IOV array according to how much of it the previous batch used.
+ * This is done before filling the next batch, as the previous one is only
+ * released by its write call.
+ */
+static int
+iovbatch_adapt(mc_IOVBATCH *batch)
+{
+    unsigned nalloc = batch->nalloc;
+    nb_IOV *iov;
+
+    if (!nalloc) {
+        nalloc = MCREQ_IOVBATCH_MIN;
+    } else if (batch->nused == nalloc) {
+        nalloc = nalloc * 2 > MCREQ_IOVBATCH_MAX ? MCREQ_IOVBATCH_MAX : nalloc * 2;
+        batch->nidle = 0;
+    } else if (batch->nused <= nalloc / 4 && nalloc > MCREQ_IOVBATCH_MIN) {
+        if (++batch->nidle == IOVBATCH_SHRINK_AFTER) {
+            nalloc /= 2;
+            batch->nidle = 0;
+        }
+    } else {
+        batch->nidle = 0;
+    }
+
+    if (nalloc != batch->nalloc) {
+        iov = realloc(batch->iov, sizeof(*iov) * nalloc);
+        if (iov) {
+            batch->iov = iov;
+            batch->nalloc = nalloc;
+        }
+    }
+    return batch->iov != NULL;
+}
+
+/**
+ * Copies runs of small spans among the `n` IOVs at `first` into the scratch
+ * buffer, so that each run takes a single IOV. A lone small span is left
+ * alone, as copying it would not save anything.
+ * @return the number of IOVs remaining in place of the `n` IOVs
+ */
+static unsigned
+iovbatch_coalesce(mc_IOVBATCH *batch, unsigned first, unsigned n)
+{
+    nb_IOV *iov = batch->iov;
+    unsigned ii, out = first, end = first + n;
+
+#define FITS(len, extra) \
+    ((len) <= MCREQ_IOVBATCH_SMALLSPAN && \
+            batch->nscratch + (len) + (extra) <= MCREQ_IOVBATCH_SCRATCH)
+
+    if (!batch->scratch) {
+        batch->scratch = malloc(MCREQ_IOVBATCH_SCRATCH);
+        if (!batch->scratch) {
+            return n;
         }
     }
+
+    for (ii = first; ii < end; ii++) {
+        nb_IOV cur = iov[ii];
+        char *tail = batch->scratch + batch->nscratch;
+        nb_IOV *prev = out ? &iov[out - 1] : NULL;
+
+        if (prev && batch->nscratch &&
+                (char *)prev->iov_base + prev->iov_len == tail &&
+                FITS(cur.iov_len, 0)) {
+            /* Append to the run which ends the batch */
+            memcpy(tail, cur.iov_base, cur.iov_len);
+            prev->iov_len += cur.iov_len;
+
+        } else if (ii + 1 < end && FITS(cur.iov_len, 0) &&
+                FITS(iov[ii + 1].iov_len, cur.iov_len)) {
+            /* Start a new run */
+            memcpy(tail, cur.iov_base, cur.iov_len);
+            iov[out].iov_base = tail;
+            iov[out].iov_len = cur.iov_len;
+            out++;
+
+        } else {
+            iov[out++] = cur;
+            continue;
+        }
+        batch->nscratch += cur.iov_len;
+        batch->ncoalesced += cur.iov_len;
+    }
+#undef FITS
+    return out - first;
+}
+
+unsigned
+mcreq_iovbatch_fill(mc_PIPELINE *pipeline, mc_IOVBATCH *batch, int coalesce)
+{
+    unsigned total = 0;
+
+    if (!iovbatch_adapt(batch)) {
+        return 0;
+    }
+
+    batch->nused = 0;
+    batch->nscratch = 0;
+
+    while (batch->nused < batch->nalloc) {
+        int nfilled = 0;
+        unsigned nb = netbuf_start_flush(&pipeline->nbmgr,
+            batch->iov + batch->nused, batch->nalloc - batch->nused, &nfilled);
+        if (!nb) {
+            break;
+        }
+        total += nb;
+        if (!coalesce) {
+            batch->nused += nfilled;
+            break;
+        }
+        /* Coalescing may make room for more */
+        batch->nused += iovbatch_coalesce(batch, batch->nused, nfilled);
+    }
+
+    if (total) {
+        batch->nwrites++;
+        batch->nbytes += total;
+        batch->nbufs += batch->nused;
+    }
+    return total;
 }
 
 void
@@ -696,15 +1095,15 @@ mcreq_dump_packet(const mc_PACKET *packet)
     printf("%sCookie: %p\n", indent, rdata->cookie);
 
     indent = "  ";
-    printf("%sNEXT: %p\n", indent, (void *)packet->slnode.next);
+    printf("%sNEXT: %p\n", indent, (void *)packet->llnode.next);
 }
 
 void
 mcreq_dump_chain(const mc_PIPELINE *pipeline)
 {
-    sllist_node *ll;
-    SLLIST_FOREACH(&pipeline->requests, ll) {
-        const mc_PACKET *pkt = SLLIST_ITEM(ll, mc_PACKET, slnode);
+    lcb_list_t *ll;
+    LCB_LIST_FOR(ll, (lcb_list_t *)&pipeline->requests) {
+        const mc_PACKET *pkt = LCB_LIST_ITEM(ll, mc_PACKET, llnode);
         mcreq_dump_packet(pkt);
     }
 }
@@ -7,6 +7,7 @@
 #include <memcached/protocol_binary.h>
 #include "netbuf/netbuf.h"
 #include "sllist.h"
+#include "list.h"
 #include "config.h"
 #include "packetutils.h"
 
@@ -122,6 +123,12 @@ extern "C" {
 /** @brief Constant defining the size of a memcached header */
 #define MCREQ_PKT_BASESIZE 24
 
+/**
+ * @brief Limit for the block size of a pipeline's data buffers, which adapts
+ * to the sizes of the packets being sent. @see nb_SETTINGS::data_maxalloc
+ */
+#define MCREQ_DATA_MAXALLOC (1 << 21)
+
 /** @brief Embedded user data for a simple request */
 typedef struct {
     const void *cookie; /**< User pointer to place in callbacks */
@@ -248,9 +255,15 @@ union mc_USER {
  * an allocated chunk of 'extended' user data.
  */
 typedef struct mc_packet_st {
-    /** Node in the linked list for logical command ordering */
+    /**
+     * Node in the linked list of packets scheduled within the current
+     * context. @see mcreq_sched_add()
+     */
     sllist_node slnode;
 
+    /** Node in the pipeline's list of requests, for logical command ordering */
+    lcb_list_t llnode;
+
     /**
      * Node in the linked list for actual output ordering.
      * @see netbuf_end_flush2(), netbuf_pdu_enqueue()
@@ -313,7 +326,23 @@ typedef void (*mcreq_flushstart_fn)(struct mc_pipeline_st *pipeline);
  */
 typedef struct mc_pipeline_st {
     /** List of requests. Newer requests are appended at the end */
-    sllist_root requests;
+    lcb_list_t requests;
+
+    /**
+     * The packets in `requests`, indexed by opaque, so that responses can be
+     * matched to their request without walking the list. This is an open
+     * addressed table of `opindex_mask + 1` slots, where a packet's probe
+     * sequence starts at `opaque & opindex_mask`. As opaques are assigned
+     * sequentially, packets rarely share a slot.
+     */
+    struct mc_packet_st **opindex;
+    unsigned opindex_mask;
+    unsigned opindex_count;
+    /**
+     * Packets in `requests` which are not in the index, because it could
+     * not be grown. These are found by walking the list.
+     */
+    unsigned opindex_nspill;
 
     /** Parent command queue */
     struct mc_cmdqueue_st *parent;
@@ -344,6 +373,23 @@ typedef struct mc_pipeline_st {
 
     /** Allocator for packet structures */
     nb_MGR reqpool;
+
+    /**
+     * Additional pipelines (each with its own connection) to the same server.
+     * Packets mapped to this pipeline may be placed on any of these instead.
+     * @see mcreq_select_lane()
+     */
+    struct mc_pipeline_st **lanes;
+
+    /** Number of entries in `lanes` */
+    unsigned nlanes;
+
+    /** If this pipeline is a lane, the pipeline owning it. NULL otherwise */
+    struct mc_pipeline_st *primary;
+
+    /** Bytes of packets scheduled on this pipeline which have not been
+     * responded to yet */
+    lcb_SIZE nbytes_pending;
 } mc_PIPELINE;
 
 typedef struct mc_cmdqueue_st {
@@ -368,6 +414,12 @@ typedef struct mc_cmdqueue_st {
     /** Number of pending items which have not yet been marked as 'done' */
     unsigned nremaining;
 
+    /**
+     * Values of this size or larger are placed on the last lane of a pipeline,
+     * keeping them from delaying smaller packets. 0 to disable.
+     */
+    lcb_SIZE lane_threshold;
+
     lcb_t instance;
 } mc_CMDQUEUE;
 
@@ -476,6 +528,17 @@ mcreq_enqueue_packet(mc_PIPELINE *pipeline, mc_PACKET *packet);
 void
 mcreq_reenqueue_packet(mc_PIPELINE *pipeline, mc_PACKET *packet);
 
+/**
+ * Like mcreq_reenqueue_packet(), but the search for the command's position
+ * starts after `hint`, a command already in the pipeline's queue which is not
+ * newer than this one. Moving a run of commands, oldest first, into a queue
+ * then takes a single pass over the queue rather than one per command.
+ * @param hint the command last moved into this pipeline, or NULL
+ */
+void
+mcreq_reenqueue_packet_after(mc_PIPELINE *pipeline, mc_PACKET *packet,
+                             mc_PACKET *hint);
+
 /**
  * Wipe the packet's internal buffers, releasing them. This should be called
  * when the underlying data buffer fields are no longer needed, usually this
@@ -523,6 +586,30 @@ mcreq_basic_packet(
         protocol_binary_request_header *req, uint8_t extlen,
         mc_PACKET **packet, mc_PIPELINE **pipeline);
 
+/**
+ * Like mcreq_basic_packet(), but also takes the size of the value which will
+ * be placed in the packet, for use with mc_CMDQUEUE::lane_threshold
+ * @param nvalue the size of the value, or 0 if the packet has no value
+ */
+lcb_error_t
+mcreq_basic_packet2(
+        mc_CMDQUEUE *queue, const lcb_CMDBASE *cmd,
+        protocol_binary_request_header *req, uint8_t extlen, lcb_SIZE nvalue,
+        mc_PACKET **packet, mc_PIPELINE **pipeline);
+
+/**
+ * Select the pipeline on which a packet mapped to `pipeline` should be placed.
+ * If the pipeline has no lanes, it is returned as-is. Otherwise, values at or
+ * above mc_CMDQUEUE::lane_threshold go to the last lane and other packets go
+ * to whichever remaining pipeline has the fewest pending bytes.
+ *
+ * @param pipeline the pipeline the packet maps to
+ * @param nvalue the size of the packet's value
+ * @return the pipeline to allocate the packet from
+ */
+mc_PIPELINE *
+mcreq_select_lane(mc_PIPELINE *pipeline, lcb_SIZE nvalue);
+
 /**
  * @brief Get the key from a packet
  * @param[in] packet The packet from which to retrieve the key
@@ -763,6 +850,67 @@ mcreq_pipeline_timeout(
         hrtime_t oldest_valid,
         hrtime_t *oldest_start);
 
+/** @brief Initial (and minimum) number of IOVs in an mc_IOVBATCH */
+#define MCREQ_IOVBATCH_MIN 32
+
+/**
+ * @brief Upper bound for the number of IOVs in an mc_IOVBATCH. This is the
+ * most a single `writev()` call accepts.
+ */
+#if defined(IOV_MAX) && IOV_MAX < 1024
+#define MCREQ_IOVBATCH_MAX IOV_MAX
+#else
+#define MCREQ_IOVBATCH_MAX 1024
+#endif
+
+/**
+ * @brief Spans of this size or smaller may be copied into the batch's
+ * scratch buffer rather than being passed as IOVs of their own
+ */
+#define MCREQ_IOVBATCH_SMALLSPAN 256
+
+/** @brief Size of the scratch buffer into which small spans are copied */
+#define MCREQ_IOVBATCH_SCRATCH 16384
+
+/**
+ * Reusable IOV array for flushing a pipeline in as few write calls as
+ * possible. The array grows (up to MCREQ_IOVBATCH_MAX) while batches fill
+ * it, and shrinks again after a long run of batches using a fraction of it.
+ */
+typedef struct {
+    nb_IOV *iov; /**< IOVs filled by mcreq_iovbatch_fill() */
+    unsigned nalloc; /**< Allocated size of `iov` */
+    unsigned nused; /**< Number of IOVs used by the last batch */
+    unsigned nidle; /**< Consecutive batches using a quarter of `iov` or less */
+    char *scratch; /**< Buffer for coalesced spans; allocated when needed */
+    nb_SIZE nscratch; /**< Bytes of `scratch` used by the current batch */
+
+    /* Totals over all non-empty batches, each passed to one write call */
+    lcb_U64 nwrites; /**< Number of batches */
+    lcb_U64 nbytes; /**< Bytes in all batches */
+    lcb_U64 nbufs; /**< IOVs in all batches */
+    lcb_U64 ncoalesced; /**< Bytes copied into the scratch buffer */
+} mc_IOVBATCH;
+
+/** Releases the memory held by the batch. The counters are retained */
+void
+mcreq_iovbatch_cleanup(mc_IOVBATCH *batch);
+
+/**
+ * Fill the batch with the pipeline's pending data. This replaces
+ * mcreq_flush_iov_fill() and is likewise completed with mcreq_flush_done().
+ *
+ * @param pipeline the pipeline to flush
+ * @param batch the batch. `batch->iov` and `batch->nused` describe the
+ *        data to write
+ * @param coalesce whether runs of small spans may be copied into a single
+ *        IOV. This may only be used if the data is written (or copied)
+ *        before the next call, as the scratch buffer is then reused.
+ * @return the number of bytes in the batch, or 0 if nothing is pending
+ */
+unsigned
+mcreq_iovbatch_fill(mc_PIPELINE *pipeline, mc_IOVBATCH *batch, int coalesce);
+
 void
 mcreq_dump_packet(const mc_PACKET *pkt);
 
@@ -779,8 +927,8 @@ mcreq_dump_chain(const mc_PIPELINE *pipeline);
         memcpy( (hdr)->bytes, SPAN_BUFFER(&(pkt)->kh_span), sizeof((hdr)->bytes) )
 
 #define mcreq_first_packet(pipeline) \
-        SLLIST_IS_EMPTY(&(pipeline)->requests) ? NULL : \
-                SLLIST_ITEM((pipeline)->requests.first, mc_PACKET, slnode)
+        (LCB_LIST_IS_EMPTY(&(pipeline)->requests) ? NULL : \
+                LCB_LIST_ITEM((pipeline)->requests.next, mc_PACKET, llnode))
 
 /**@}*/
 
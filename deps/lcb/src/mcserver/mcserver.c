@@ -23,13 +23,14 @@
 #include "bucketconfig/clconfig.h"
 #include "mc/mcreq-flush-inl.h"
 #include <lcbio/ssl.h>
+#include <lcbio/iotable.h>
 #include "ctx-log-inl.h"
 
 #define LOGARGS(c, lvl) (c)->settings, "server", LCB_LOG_##lvl, __FILE__, __LINE__
 #define LOGFMT "<%s:%s> (SRV=%p,IX=%d) "
 #define LOGID(server) get_ctx_host(server->connctx), get_ctx_port(server->connctx), (void*)server, server->pipeline.index
-#define MCREQ_MAXIOV 32
 #define LCBCONN_UNWANT(conn, flags) (conn)->want &= ~(flags)
+#define TIMER_ARMED(server) lcb_twentry_armed(&(server)->io_timer)
 
 typedef enum {
     /* There are no known errored commands on this server */
@@ -56,21 +57,30 @@ static void finalize_errored_ctx(mc_SERVER *server);
 static void on_error(lcbio_CTX *ctx, lcb_error_t err);
 static void server_socket_failed(mc_SERVER *server, lcb_error_t err);
 
+/** Schedule the server's timeout callback to run in `usec` microseconds */
+static void
+timer_rearm(mc_SERVER *server, uint32_t usec)
+{
+    lcb_timewheel_schedule(server->instance->timewheel, &server->io_timer,
+        gethrtime() + LCB_US2NS(usec));
+}
+
 static void
 on_flush_ready(lcbio_CTX *ctx)
 {
     mc_SERVER *server = lcbio_ctx_data(ctx);
-    nb_IOV iov[MCREQ_MAXIOV];
+    mc_IOVBATCH *batch = &server->iobatch;
+    /* Completion-based plugins may still reference the data after put_ex
+     * returns, so the scratch buffer can only be reused with event I/O */
+    int coalesce = IOT_IS_EVENT(ctx->io);
     int ready;
 
     do {
-        int niov = 0;
-        unsigned nb;
-        nb = mcreq_flush_iov_fill(&server->pipeline, iov, MCREQ_MAXIOV, &niov);
+        unsigned nb = mcreq_iovbatch_fill(&server->pipeline, batch, coalesce);
         if (!nb) {
             return;
         }
-        ready = lcbio_ctx_put_ex(ctx, (lcb_IOV *)iov, niov, nb);
+        ready = lcbio_ctx_put_ex(ctx, (lcb_IOV *)batch->iov, batch->nused, nb);
     } while (ready);
     lcbio_ctx_wwant(ctx);
 }
@@ -94,12 +104,12 @@ mcserver_flush(mc_SERVER *server)
     lcbio_ctx_wwant(server->connctx);
     lcbio_ctx_schedule(server->connctx);
 
-    if (!lcbio_timer_armed(server->io_timer)) {
+    if (!TIMER_ARMED(server)) {
         /**
          * XXX: Maybe use get_next_timeout(), although here we can assume
          * that a command was just scheduled
          */
-        lcbio_timer_rearm(server->io_timer, MCSERVER_TIMEOUT(server));
+        timer_rearm(server, MCSERVER_TIMEOUT(server));
     }
 }
 
@@ -157,10 +167,13 @@ try_read(lcbio_CTX *ctx, mc_SERVER *server, rdb_IOROPE *ior)
     mc_PIPELINE *pl = &server->pipeline;
     unsigned pktsize = 24, is_last = 1;
 
+    info->bufh = NULL;
+
 #define DO_ASSIGN_PAYLOAD() \
     rdb_consumed(ior, sizeof(info->res.bytes)); \
     if (PACKET_NBODY(info)) { \
         info->payload = rdb_get_consolidated(ior, PACKET_NBODY(info)); \
+        info->bufh = RDB_SEG_FIRST(&ior->recvd); \
     } {
 
 #define DO_SWALLOW_PAYLOAD() \
@@ -177,6 +190,12 @@ try_read(lcbio_CTX *ctx, mc_SERVER *server, rdb_IOROPE *ior)
 
     pktsize += PACKET_NBODY(info);
     if (rdb_get_nused(ior) < pktsize) {
+        /* Make room for the rest of a large packet in the first segment, so
+         * that the remainder is read in place rather than consolidated (i.e.
+         * copied) once it has all arrived. */
+        if (pktsize > ior->rdsize) {
+            rdb_consolidate(ior, pktsize);
+        }
         goto GT_NEEDMORE;
     }
 
@@ -264,7 +283,7 @@ on_read(lcbio_CTX *ctx, unsigned nb)
 int
 mcserver_has_pending(mc_SERVER *server)
 {
-    return !SLLIST_IS_EMPTY(&server->pipeline.requests);
+    return !LCB_LIST_IS_EMPTY(&server->pipeline.requests);
 }
 
 static void flush_noop(mc_PIPELINE *pipeline) {
@@ -360,15 +379,20 @@ static void flush_errdrain(mc_PIPELINE *pipeline)
 {
     /* Called when we are draining errors. */
     mc_SERVER *server = (mc_SERVER *)pipeline;
-    if (!lcbio_timer_armed(server->io_timer)) {
-        lcbio_timer_rearm(server->io_timer, MCSERVER_TIMEOUT(server));
+    if (!TIMER_ARMED(server)) {
+        timer_rearm(server, MCSERVER_TIMEOUT(server));
     }
 }
 
 void
 mcserver_fail_chain(mc_SERVER *server, lcb_error_t err)
 {
+    unsigned ii;
     purge_single_server(server, err, 0, NULL, REFRESH_NEVER);
+    for (ii = 0; ii < server->pipeline.nlanes; ii++) {
+        purge_single_server((mc_SERVER *)server->pipeline.lanes[ii],
+            err, 0, NULL, REFRESH_NEVER);
+    }
 }
 
 
@@ -411,7 +435,7 @@ timeout_server(void *arg)
 
     next_us = get_next_timeout(server);
     lcb_log(LOGARGS(server, INFO), LOGFMT "Scheduling next timeout for %u ms", LOGID(server), next_us / 1000);
-    lcbio_timer_rearm(server->io_timer, next_us);
+    timer_rearm(server, next_us);
     lcb_maybe_breakout(server->instance);
 }
 
@@ -456,7 +480,7 @@ on_connected(lcbio_SOCKET *sock, void *data, lcb_error_t err, lcbio_OSERR syserr
 
     tmo = get_next_timeout(server);
     lcb_log(LOGARGS(server, INFO), LOGFMT "Setting initial timeout=%ums", LOGID(server), tmo/1000);
-    lcbio_timer_rearm(server->io_timer, get_next_timeout(server));
+    timer_rearm(server, get_next_timeout(server));
     mcserver_flush(server);
 }
 
@@ -487,11 +511,11 @@ dupstr_or_null(const char *s) {
     return NULL;
 }
 
-mc_SERVER *
-mcserver_alloc2(lcb_t instance, VBUCKET_CONFIG_HANDLE vbc, int ix)
+static mc_SERVER *
+server_alloc(lcb_t instance,
+    const char *datahost, const char *resthost, const char *viewshost)
 {
     mc_SERVER *ret;
-    lcbvb_SVCMODE mode;
     ret = calloc(1, sizeof(*ret));
     if (!ret) {
         return ret;
@@ -500,22 +524,76 @@ mcserver_alloc2(lcb_t instance, VBUCKET_CONFIG_HANDLE vbc, int ix)
     ret->instance = instance;
     ret->settings = instance->settings;
     ret->curhost = calloc(1, sizeof(*ret->curhost));
-    mode = ret->settings->sslopts & LCB_SSL_ENABLED
-            ? LCBVB_SVCMODE_SSL : LCBVB_SVCMODE_PLAIN;
 
-    ret->datahost = dupstr_or_null(VB_MEMDSTR(vbc, ix, mode));
-    ret->resthost = dupstr_or_null(VB_MGMTSTR(vbc, ix, mode));
-    ret->viewshost = dupstr_or_null(VB_CAPIURL(vbc, ix, mode));
+    ret->datahost = dupstr_or_null(datahost);
+    ret->resthost = dupstr_or_null(resthost);
+    ret->viewshost = dupstr_or_null(viewshost);
 
     lcb_settings_ref(ret->settings);
     mcreq_pipeline_init(&ret->pipeline);
     ret->pipeline.flush_start = (mcreq_flushstart_fn)server_connect;
     ret->pipeline.buf_done_callback = buf_done_cb;
     lcb_host_parsez(ret->curhost, ret->datahost, LCB_CONFIG_MCD_PORT);
-    ret->io_timer = lcbio_timer_new(instance->iotable, ret, timeout_server);
+    lcb_twentry_init(&ret->io_timer, timeout_server, ret);
     return ret;
 }
 
+mc_SERVER *
+mcserver_alloc2(lcb_t instance, VBUCKET_CONFIG_HANDLE vbc, int ix)
+{
+    mc_SERVER *ret;
+    lcbvb_SVCMODE mode;
+
+    mode = instance->settings->sslopts & LCB_SSL_ENABLED
+            ? LCBVB_SVCMODE_SSL : LCBVB_SVCMODE_PLAIN;
+    ret = server_alloc(instance, VB_MEMDSTR(vbc, ix, mode),
+        VB_MGMTSTR(vbc, ix, mode), VB_CAPIURL(vbc, ix, mode));
+    if (ret) {
+        mcserver_set_lanes(ret, ret->settings->memd_nconns);
+    }
+    return ret;
+}
+
+void
+mcserver_set_lanes(mc_SERVER *server, unsigned nconns)
+{
+    mc_PIPELINE *pl = &server->pipeline;
+    unsigned nlanes = nconns ? nconns - 1 : 0;
+
+    if (nlanes > pl->nlanes) {
+        mc_PIPELINE **lanes = realloc(pl->lanes, sizeof(*lanes) * nlanes);
+        if (!lanes) {
+            return;
+        }
+        pl->lanes = lanes;
+        while (pl->nlanes < nlanes) {
+            mc_SERVER *lane = server_alloc(server->instance,
+                server->datahost, server->resthost, server->viewshost);
+            if (!lane) {
+                break;
+            }
+            lane->pipeline.primary = pl;
+            lane->pipeline.parent = pl->parent;
+            lane->pipeline.index = pl->index;
+            lanes[pl->nlanes++] = &lane->pipeline;
+        }
+    }
+
+    while (pl->nlanes > nlanes) {
+        mc_SERVER *lane = (mc_SERVER *)pl->lanes[--pl->nlanes];
+        if (pl->parent) {
+            purge_single_server(lane, LCB_MAP_CHANGED, 0, NULL, REFRESH_NEVER);
+        }
+        lane->pipeline.primary = NULL;
+        mcserver_close(lane);
+    }
+
+    if (!pl->nlanes) {
+        free(pl->lanes);
+        pl->lanes = NULL;
+    }
+}
+
 mc_SERVER *
 mcserver_alloc(lcb_t instance, int ix)
 {
@@ -528,9 +606,14 @@ static void
 server_free(mc_SERVER *server)
 {
     mcreq_pipeline_cleanup(&server->pipeline);
+    mcreq_iovbatch_cleanup(&server->iobatch);
 
-    if (server->io_timer) {
-        lcbio_timer_destroy(server->io_timer);
+    if (server->latencies) {
+        unsigned ii;
+        for (ii = 0; ii < 256; ii++) {
+            free(server->latencies[ii]);
+        }
+        free(server->latencies);
     }
 
     free(server->resthost);
@@ -593,8 +676,17 @@ server_socket_failed(mc_SERVER *server, lcb_error_t err)
 void
 mcserver_close(mc_SERVER *server)
 {
+    unsigned ii;
+
     /* Should never be called twice */
     lcb_assert(server->state != S_CLOSED);
+    for (ii = 0; ii < server->pipeline.nlanes; ii++) {
+        server->pipeline.lanes[ii]->primary = NULL;
+        mcserver_close((mc_SERVER *)server->pipeline.lanes[ii]);
+    }
+    free(server->pipeline.lanes);
+    server->pipeline.lanes = NULL;
+    server->pipeline.nlanes = 0;
     start_errored_ctx(server, S_CLOSED);
 }
 
@@ -613,9 +705,8 @@ start_errored_ctx(mc_SERVER *server, mcserver_STATE next_state)
     lcbio_connreq_cancel(&server->connreq);
 
     /* If the server is being destroyed, silence the timer */
-    if (next_state == S_CLOSED && server->io_timer != NULL) {
-        lcbio_timer_destroy(server->io_timer);
-        server->io_timer = NULL;
+    if (next_state == S_CLOSED) {
+        lcb_timewheel_cancel(server->instance->timewheel, &server->io_timer);
     }
 
     if (ctx == NULL) {
@@ -626,9 +717,9 @@ start_errored_ctx(mc_SERVER *server, mcserver_STATE next_state)
             /* Not closed but don't have a current context */
             server->pipeline.flush_start = (mcreq_flushstart_fn)server_connect;
             if (mcserver_has_pending(server)) {
-                if (!lcbio_timer_armed(server->io_timer)) {
+                if (!TIMER_ARMED(server)) {
                     /* TODO: Maybe throttle reconnection attempts? */
-                    lcbio_timer_rearm(server->io_timer, MCSERVER_TIMEOUT(server));
+                    timer_rearm(server, MCSERVER_TIMEOUT(server));
                 }
                 server_connect(server);
             }
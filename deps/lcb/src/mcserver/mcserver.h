@@ -5,6 +5,7 @@
 #include <lcbio/timer-ng.h>
 #include <mc/mcreq.h>
 #include <netbuf/netbuf.h>
+#include "timewheel.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -40,14 +41,20 @@ typedef struct lcb_server_st {
     /** Whether compression is supported */
     int compsupport;
 
-    /** IO/Operation timer */
-    lcbio_pTIMER io_timer;
+    /** IO/Operation timer, scheduled on the instance's timing wheel */
+    lcb_TWENTRY io_timer;
 
     lcbio_CTX *connctx;
     lcbio_CONNREQ connreq;
 
     /** Request for current connection */
     lcb_host_t *curhost;
+
+    /** Latency histograms indexed by opcode. Allocated when first used */
+    lcb_LATENCYHIST **latencies;
+
+    /** IOVs (and write counters) used to flush the pipeline */
+    mc_IOVBATCH iobatch;
 } lcb_server_t, mc_SERVER;
 
 #define MCSERVER_TIMEOUT(c) (c)->settings->operation_timeout
@@ -65,6 +72,17 @@ mcserver_alloc(lcb_t instance, int ix);
 mc_SERVER *
 mcserver_alloc2(lcb_t instance, VBUCKET_CONFIG_HANDLE vbc, int ix);
 
+/**
+ * Set the number of connections used for the server. The server's own
+ * connection is the first of these; the others are allocated (or closed) as
+ * lanes of its pipeline. Commands pending on closed lanes are failed (and
+ * possibly retried) with LCB_MAP_CHANGED.
+ * @param server the server
+ * @param nconns the total number of connections
+ */
+void
+mcserver_set_lanes(mc_SERVER *server, unsigned nconns);
+
 /**
  * Close the server. The resources of the server may still continue to persist
  * internally for a bit until all callbacks have been delivered and all buffers
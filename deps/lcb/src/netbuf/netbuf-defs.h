@@ -38,6 +38,11 @@ typedef unsigned int nb_SIZE;
 #define NB_DATA_CACHEBLOCKS 16
 /** @brief Default data allocation size */
 #define NB_DATA_BASEALLOC 32768
+/**
+ * @brief Default limit for an adaptive data allocation size.
+ * 0 keeps the allocation size fixed. @see nb_SETTINGS::data_maxalloc
+ */
+#define NB_DATA_MAXALLOC 0
 /**@}*/
 
 typedef struct {
@@ -47,6 +52,12 @@ typedef struct {
     nb_SIZE dea_basealloc;
     nb_SIZE data_cacheblocks;
     nb_SIZE data_basealloc;
+    /**
+     * If nonzero, the data allocation size adapts to the sizes of the spans
+     * being reserved, between `data_basealloc` and this value, and an empty
+     * block of the current size is kept for reuse.
+     */
+    nb_SIZE data_maxalloc;
 } nb_SETTINGS;
 
 #ifndef _WIN32
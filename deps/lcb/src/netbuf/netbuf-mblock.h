@@ -174,6 +174,28 @@ typedef struct {
     struct netbuf_mblock_st *parent;
 } nb_MBLOCK;
 
+/** @brief Number of buckets in nb_MBPOOL::sizehist; one per power of two */
+#define NB_MBPOOL_SIZEBUCKETS 32
+
+/**
+ * @brief Allocation counters for an nb_MBPOOL
+ */
+typedef struct {
+    unsigned long blocks_alloc; /**< Block buffers allocated with malloc */
+    unsigned long blocks_freed; /**< Block buffers freed */
+    unsigned long blocks_reused; /**< Empty blocks reused for a new span */
+    unsigned long wraps; /**< Spans placed by wrapping to the start of a block */
+    unsigned long fallbacks; /**< Spans which did not fit the active block */
+    unsigned long oversized; /**< Blocks enlarged beyond `basealloc` for a span */
+    unsigned long deallocs; /**< Out-of-order releases queued */
+    nb_SIZE dealloc_depth; /**< Out-of-order releases currently queued */
+    nb_SIZE dealloc_maxdepth; /**< Largest value of `dealloc_depth` */
+    nb_SIZE bytes_held; /**< Bytes currently allocated for block buffers */
+    nb_SIZE basealloc; /**< Current allocation size */
+    unsigned grows; /**< Times the allocation size was increased */
+    unsigned shrinks; /**< Times the allocation size was decreased */
+} nb_MBSTATS;
+
 /**
  * @brief pool of nb_MBLOCK structures
  */
@@ -187,16 +209,31 @@ typedef struct netbuf_mblock_st {
     /** Allocation size */
     nb_SIZE basealloc;
 
-    /** Maximum number of non-cached blocks */
+    /** Maximum number of empty blocks to keep in `avail` */
     unsigned int maxblocks;
 
-    /** Current number of non-cached blocks */
+    /** Current number of blocks in `avail` */
     unsigned int curblocks;
 
     nb_MBLOCK *cacheblocks;
     nb_SIZE ncacheblocks;
 
     struct netbuf_st *mgr;
+
+    /** Counters. `basealloc` is filled in by netbuf_get_stats() */
+    nb_MBSTATS stats;
+
+    /**
+     * Limit for adapting `basealloc`, or 0 if it is fixed. The lower limit is
+     * the initial `basealloc`
+     */
+    nb_SIZE maxalloc;
+    nb_SIZE minalloc;
+
+    /** Bytes of recently reserved spans, bucketed by power of two */
+    nb_SIZE sizehist[NB_MBPOOL_SIZEBUCKETS];
+    /** Spans recorded in `sizehist` since `basealloc` was last evaluated */
+    unsigned nsamples;
 } nb_MBPOOL;
 
 /**
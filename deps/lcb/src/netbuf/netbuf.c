@@ -39,12 +39,19 @@
 #define BLOCK_HAS_DEALLOCS(block) \
     ((block)->deallocs && SLLIST_IS_EMPTY(&(block)->deallocs->pending))
 
+/** Number of spans between re-evaluations of an adaptive pool's basealloc */
+#define ADAPT_INTERVAL 256
+/** Number of typical spans an adaptive pool's blocks should hold */
+#define ADAPT_SPANS 8
+/** Limit on the weight of a single span in the size histogram */
+#define ADAPT_MAXWEIGHT (1 << 20)
+
 /** Static forward decls */
 static void mblock_release_data(nb_MBPOOL*,nb_MBLOCK*,nb_SIZE,nb_SIZE);
 static void mblock_release_ptr(nb_MBPOOL*,char*,nb_SIZE);
 static void mblock_init(nb_MBPOOL*);
 static void mblock_cleanup(nb_MBPOOL*);
-static void mblock_wipe_block(nb_MBLOCK *block);
+static void mblock_wipe_block(nb_MBPOOL *pool, nb_MBLOCK *block);
 
 /******************************************************************************
  ******************************************************************************
@@ -100,10 +107,17 @@ alloc_new_block(nb_MBPOOL *pool, nb_SIZE capacity)
     if (!ret->root) {
         if (mblock_is_standalone(ret)) {
             free(ret);
+        } else {
+            ret->nalloc = 0;
         }
         return NULL;
     }
 
+    pool->stats.blocks_alloc++;
+    pool->stats.bytes_held += ret->nalloc;
+    if (ret->nalloc > pool->basealloc) {
+        pool->stats.oversized++;
+    }
     return ret;
 }
 
@@ -119,11 +133,8 @@ find_free_block(nb_MBPOOL *pool, nb_SIZE capacity)
         nb_MBLOCK *cur = SLLIST_ITEM(iter.cur, nb_MBLOCK, slnode);
         if (cur->nalloc >= capacity) {
             sllist_iter_remove(&pool->avail, &iter);
-
-            if (mblock_is_standalone(cur)) {
-                pool->curblocks--;
-            }
-
+            pool->curblocks--;
+            pool->stats.blocks_reused++;
             return cur;
         }
     }
@@ -169,7 +180,7 @@ reserve_empty_block(nb_MBPOOL *pool, nb_SPAN *span)
  * and nonzero otherwise.
  */
 static int
-reserve_active_block(nb_MBLOCK *block, nb_SPAN *span)
+reserve_active_block(nb_MBPOOL *pool, nb_MBLOCK *block, nb_SPAN *span)
 {
     if (BLOCK_HAS_DEALLOCS(block)) {
         return -1;
@@ -186,6 +197,7 @@ reserve_active_block(nb_MBLOCK *block, nb_SPAN *span)
             /** Wrap around the wrap */
             span->offset = 0;
             block->cursor = span->size;
+            pool->stats.wraps++;
             return 0;
         } else {
             return -1;
@@ -203,6 +215,60 @@ reserve_active_block(nb_MBLOCK *block, nb_SPAN *span)
     }
 }
 
+/**
+ * Records the size of a span reserved from an adaptive pool. Periodically
+ * sizes `basealloc` so that a block holds ADAPT_SPANS spans of the size
+ * accounting for 90% of the bytes recently reserved.
+ */
+static void
+mblock_adapt(nb_MBPOOL *pool, nb_SIZE size)
+{
+    unsigned ii, bucket = 0;
+    nb_SIZE total = 0, acc = 0, want;
+
+    while (bucket < NB_MBPOOL_SIZEBUCKETS - 1 && ((nb_SIZE)1 << bucket) < size) {
+        bucket++;
+    }
+    pool->sizehist[bucket] += MINIMUM(size, ADAPT_MAXWEIGHT);
+    if (++pool->nsamples < ADAPT_INTERVAL) {
+        return;
+    }
+
+    for (ii = 0; ii < NB_MBPOOL_SIZEBUCKETS; ii++) {
+        total += pool->sizehist[ii];
+    }
+    for (ii = 0; ii < NB_MBPOOL_SIZEBUCKETS - 1; ii++) {
+        acc += pool->sizehist[ii];
+        if (acc >= total - total / 10) {
+            break;
+        }
+    }
+
+    if (((nb_SIZE)1 << ii) > pool->maxalloc / ADAPT_SPANS) {
+        want = pool->maxalloc;
+    } else {
+        want = ((nb_SIZE)1 << ii) * ADAPT_SPANS;
+    }
+    if (want < pool->minalloc) {
+        want = pool->minalloc;
+    }
+
+    if (want > pool->basealloc) {
+        pool->basealloc = want;
+        pool->stats.grows++;
+    } else if (want <= pool->basealloc / 2) {
+        /* Shrink gradually, so that a short lull doesn't undo a burst */
+        pool->basealloc /= 2;
+        pool->stats.shrinks++;
+    }
+
+    /* Older samples count for less */
+    for (ii = 0; ii < NB_MBPOOL_SIZEBUCKETS; ii++) {
+        pool->sizehist[ii] /= 2;
+    }
+    pool->nsamples = 0;
+}
+
 static int
 mblock_reserve_data(nb_MBPOOL *pool, nb_SPAN *span)
 {
@@ -217,14 +283,19 @@ mblock_reserve_data(nb_MBPOOL *pool, nb_SPAN *span)
     return 0;
 #endif
 
+    if (pool->maxalloc) {
+        mblock_adapt(pool, span->size);
+    }
+
     if (SLLIST_IS_EMPTY(&pool->active)) {
         return reserve_empty_block(pool, span);
 
     } else {
         block = SLLIST_ITEM(pool->active.last, nb_MBLOCK, slnode);
-        rv = reserve_active_block(block, span);
+        rv = reserve_active_block(pool, block, span);
 
         if (rv != 0) {
+            pool->stats.fallbacks++;
             return reserve_empty_block(pool, span);
         }
 
@@ -238,12 +309,20 @@ mblock_reserve_data(nb_MBPOOL *pool, nb_SPAN *span)
  ** Out-Of-Order Deallocation Functions                                      **
  ******************************************************************************
  ******************************************************************************/
+/* Position of a span within the used region of a wrapped or unwrapped block.
+ * Spans at the front of a wrapped block come after those at its end */
+#define OOO_POSITION(block, offset) \
+    ((offset) >= (block)->start \
+            ? (offset) - (block)->start \
+            : (offset) + (block)->wrap - (block)->start)
+
 static void
-ooo_queue_dealoc(nb_MGR *mgr, nb_MBLOCK *block, nb_SPAN *span)
+ooo_queue_dealoc(nb_MBPOOL *pool, nb_MBLOCK *block, nb_SPAN *span)
 {
     nb_QDEALLOC *qd;
     nb_DEALLOC_QUEUE *queue;
     nb_SPAN qespan;
+    nb_MGR *mgr = pool->mgr;
 
     if (!block->deallocs) {
         queue = calloc(1, sizeof(*queue));
@@ -266,10 +345,16 @@ ooo_queue_dealoc(nb_MGR *mgr, nb_MBLOCK *block, nb_SPAN *span)
     qd = (nb_QDEALLOC *)(void *)SPAN_MBUFFER_NC(&qespan);
     qd->offset = span->offset;
     qd->size = span->size;
-    if (queue->min_offset > qd->offset) {
+    if (OOO_POSITION(block, queue->min_offset) >
+            OOO_POSITION(block, qd->offset)) {
         queue->min_offset = qd->offset;
     }
     sllist_append(&queue->pending, &qd->slnode);
+
+    pool->stats.deallocs++;
+    if (++pool->stats.dealloc_depth > pool->stats.dealloc_maxdepth) {
+        pool->stats.dealloc_maxdepth = pool->stats.dealloc_depth;
+    }
 }
 
 static INLINE void
@@ -282,21 +367,35 @@ maybe_unwrap_block(nb_MBLOCK *block)
 }
 
 static void
-ooo_apply_dealloc(nb_MBLOCK *block)
+ooo_apply_dealloc(nb_MBPOOL *pool, nb_MBLOCK *block)
 {
     nb_SIZE min_next = -1;
     sllist_iterator iter;
     nb_DEALLOC_QUEUE *queue = block->deallocs;
+    int progress;
+
+    /* Each pass may uncover spans queued before the ones it released */
+    do {
+        progress = 0;
+        SLLIST_ITERFOR(&queue->pending, &iter) {
+            nb_QDEALLOC *cur = SLLIST_ITEM(iter.cur, nb_QDEALLOC, slnode);
+            if (cur->offset == block->start) {
+                block->start += cur->size;
+                maybe_unwrap_block(block);
+
+                sllist_iter_remove(&block->deallocs->pending, &iter);
+                mblock_release_ptr(&queue->qpool, (char *)cur, sizeof(*cur));
+                pool->stats.dealloc_depth--;
+                progress = 1;
+            }
+        }
+    } while (progress && !SLLIST_IS_EMPTY(&queue->pending));
 
     SLLIST_ITERFOR(&queue->pending, &iter) {
         nb_QDEALLOC *cur = SLLIST_ITEM(iter.cur, nb_QDEALLOC, slnode);
-        if (cur->offset == block->start) {
-            block->start += cur->size;
-            maybe_unwrap_block(block);
-
-            sllist_iter_remove(&block->deallocs->pending, &iter);
-            mblock_release_ptr(&queue->qpool, (char *)cur, sizeof(*cur));
-        } else if (cur->offset < min_next) {
+        if (min_next == (nb_SIZE)-1 ||
+                OOO_POSITION(block, cur->offset) <
+                OOO_POSITION(block, min_next)) {
             min_next = cur->offset;
         }
     }
@@ -311,13 +410,12 @@ mblock_release_data(nb_MBPOOL *pool,
     if (offset == block->start) {
         /** Removing from the beginning */
         block->start += size;
+        maybe_unwrap_block(block);
 
         if (block->deallocs && block->deallocs->min_offset == block->start) {
-            ooo_apply_dealloc(block);
+            ooo_apply_dealloc(pool, block);
         }
 
-        maybe_unwrap_block(block);
-
     } else if (offset + size == block->cursor) {
         /** Removing from the end */
         if (block->cursor == block->wrap) {
@@ -339,7 +437,7 @@ mblock_release_data(nb_MBPOOL *pool,
         span.parent = block;
         span.offset = offset;
         span.size = size;
-        ooo_queue_dealoc(pool->mgr, block, &span);
+        ooo_queue_dealoc(pool, block, &span);
         return;
     }
 
@@ -357,12 +455,14 @@ mblock_release_data(nb_MBPOOL *pool,
         }
     }
 
-    if (pool->curblocks < pool->maxblocks) {
+    /* An adaptive pool only keeps blocks of its current size */
+    if (pool->curblocks < pool->maxblocks &&
+            (!pool->maxalloc || block->nalloc == pool->basealloc)) {
         sllist_append(&pool->avail, &block->slnode);
         pool->curblocks++;
 
     } else {
-        mblock_wipe_block(block);
+        mblock_wipe_block(pool, block);
     }
 }
 
@@ -400,7 +500,7 @@ static int
 mblock_get_next_size(const nb_MBPOOL *pool, int allow_wrap)
 {
     nb_MBLOCK *block;
-    if (SLLIST_IS_EMPTY(&pool->avail)) {
+    if (SLLIST_IS_EMPTY(&pool->active)) {
         return 0;
     }
 
@@ -428,10 +528,12 @@ mblock_get_next_size(const nb_MBPOOL *pool, int allow_wrap)
 }
 
 static void
-mblock_wipe_block(nb_MBLOCK *block)
+mblock_wipe_block(nb_MBPOOL *pool, nb_MBLOCK *block)
 {
     if (block->root) {
         free(block->root);
+        pool->stats.blocks_freed++;
+        pool->stats.bytes_held -= block->nalloc;
     }
     if (block->deallocs) {
         sllist_iterator dea_iter;
@@ -441,6 +543,7 @@ mblock_wipe_block(nb_MBLOCK *block)
             nb_QDEALLOC *qd = SLLIST_ITEM(dea_iter.cur, nb_QDEALLOC, slnode);
             sllist_iter_remove(&queue->pending, &dea_iter);
             mblock_release_ptr(&queue->qpool, (char *)qd, sizeof(*qd));
+            pool->stats.dealloc_depth--;
         }
 
         mblock_cleanup(&queue->qpool);
@@ -450,6 +553,10 @@ mblock_wipe_block(nb_MBLOCK *block)
 
     if (mblock_is_standalone(block)) {
         free(block);
+    } else {
+        /* Make the cached structure available again */
+        block->root = NULL;
+        block->nalloc = 0;
     }
 }
 
@@ -460,9 +567,8 @@ free_blocklist(nb_MBPOOL *pool, sllist_root *list)
     SLLIST_ITERFOR(list, &iter) {
         nb_MBLOCK *block = SLLIST_ITEM(iter.cur, nb_MBLOCK, slnode);
         sllist_iter_remove(list, &iter);
-        mblock_wipe_block(block);
+        mblock_wipe_block(pool, block);
     }
-    (void)pool;
 }
 
 
@@ -694,7 +800,10 @@ void
 netbuf_mblock_release(nb_MGR *mgr, nb_SPAN *span)
 {
 #ifdef NETBUF_LIBC_PROXY
-    free(span->parent);
+    /* Each span is its own allocation; releasing only its tail is a no-op */
+    if (span->offset == 0) {
+        free(span->parent);
+    }
     (void)mgr;
 #else
     mblock_release_data(&mgr->datapool, span->parent, span->size, span->offset);
@@ -714,6 +823,7 @@ void netbuf_default_settings(nb_SETTINGS *settings)
     settings->dea_cacheblocks = NB_MBDEALLOC_CACHEBLOCKS;
     settings->sndq_basealloc = NB_SNDQ_BASEALLOC;
     settings->sndq_cacheblocks = NB_SNDQ_CACHEBLOCKS;
+    settings->data_maxalloc = NB_DATA_MAXALLOC;
 }
 
 void
@@ -739,9 +849,21 @@ netbuf_init(nb_MGR *mgr, const nb_SETTINGS *user_settings)
     bufpool->basealloc = mgr->settings.data_basealloc;
     bufpool->ncacheblocks = mgr->settings.data_cacheblocks;
     bufpool->mgr = mgr;
+    if (mgr->settings.data_maxalloc > bufpool->basealloc) {
+        bufpool->minalloc = bufpool->basealloc;
+        bufpool->maxalloc = mgr->settings.data_maxalloc;
+        bufpool->maxblocks = 1;
+    }
     mblock_init(bufpool);
 }
 
+void
+netbuf_get_stats(const nb_MGR *mgr, nb_MBSTATS *stats)
+{
+    *stats = mgr->datapool.stats;
+    stats->basealloc = mgr->datapool.basealloc;
+}
+
 
 void
 netbuf_cleanup(nb_MGR *mgr)
@@ -823,7 +945,15 @@ void
 netbuf_dump_status(nb_MGR *mgr)
 {
     sllist_node *ll;
+    nb_MBSTATS st;
+
+    netbuf_get_stats(mgr, &st);
     printf("Status for MGR=%p\n", (void *)mgr);
+    printf("STATS: BASEALLOC=%u HELD=%uB ALLOC=%lu FREED=%lu REUSED=%lu "
+           "WRAPS=%lu FALLBACKS=%lu OVERSIZED=%lu DEALLOCS=%lu (DEPTH=%u, MAX=%u)\n",
+           st.basealloc, st.bytes_held, st.blocks_alloc, st.blocks_freed,
+           st.blocks_reused, st.wraps, st.fallbacks, st.oversized,
+           st.deallocs, st.dealloc_depth, st.dealloc_maxdepth);
     printf("ACTIVE:\n");
 
     SLLIST_FOREACH(&mgr->datapool.active, ll) {
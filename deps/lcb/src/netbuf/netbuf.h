@@ -340,6 +340,14 @@ netbuf_cleanup(nb_MGR *mgr);
 void
 netbuf_default_settings(nb_SETTINGS *settings);
 
+/**
+ * Get the allocation counters for the manager's data buffers
+ * @param mgr the manager
+ * @param[out] stats filled with the counters
+ */
+void
+netbuf_get_stats(const nb_MGR *mgr, nb_MBSTATS *stats);
+
 /**
  * Dump the internal structure of the manager to the screen. Useful for
  * debugging.
@@ -69,25 +69,47 @@ log_vbdiff(lcb_t instance, VBUCKET_CONFIG_DIFF *diff)
     }
 }
 
+/** The last packet moved into a pipeline, and the lane it was placed in */
+typedef struct {
+    mc_PIPELINE *pl;
+    mc_PACKET *pkt;
+} reloc_HINT;
+
+/** State for relocating packets when a new config is applied */
+typedef struct {
+    /** vBuckets whose master changed, or NULL to check every packet */
+    const char *vbs_moved;
+    unsigned nvb;
+    /**
+     * Indexed by the new server index. Packets are checked oldest first, so
+     * each one moved to a server goes after the previous one
+     */
+    reloc_HINT *hints;
+    lcb_CONFIGSTATS *stats;
+} reloc_CTX;
+
 /**
  * This callback is invoked for packet relocation twice. It tries to relocate
  * commands to their destination server. Some commands may not be relocated
  * either because they have no explicit "Relocation Information" (i.e. no
  * specific vbucket) or because the command is tied to a specific server (i.e.
- * CMD_STAT)
+ * CMD_STAT). Packets for vBuckets which have kept their master are left
+ * where they are.
  */
 static int
 iterwipe_cb(mc_CMDQUEUE *cq, mc_PIPELINE *oldpl, mc_PACKET *oldpkt, void *arg)
 {
     protocol_binary_request_header hdr;
     mc_SERVER *srv = (mc_SERVER *)oldpl;
+    reloc_CTX *ctx = arg;
+    reloc_HINT *hint;
     mc_PIPELINE *newpl;
     mc_PACKET *newpkt;
     int newix;
+    unsigned vb;
     uint8_t op;
 
-    (void)arg;
-
+    ctx->stats->nexamined++;
     memcpy(&hdr, SPAN_BUFFER(&oldpkt->kh_span), sizeof(hdr.bytes));
     op = hdr.request.opcode;
     if (op == PROTOCOL_BINARY_CMD_OBSERVE ||
@@ -96,8 +118,13 @@ iterwipe_cb(mc_CMDQUEUE *cq, mc_PIPELINE *oldpl, mc_PACKET *oldpkt, void *arg)
         return MCREQ_KEEP_PACKET;
     }
 
-    newix = vbucket_get_master(cq->config, ntohs(hdr.request.vbucket));
-    if (newix < 0 || newix > (int)cq->npipelines) {
+    vb = ntohs(hdr.request.vbucket);
+    if (ctx->vbs_moved && (vb >= ctx->nvb || !ctx->vbs_moved[vb])) {
+        return MCREQ_KEEP_PACKET;
+    }
+
+    newix = vbucket_get_master(cq->config, vb);
+    if (newix < 0 || newix >= (int)cq->npipelines) {
         return MCREQ_KEEP_PACKET;
     }
 
@@ -106,9 +133,11 @@ iterwipe_cb(mc_CMDQUEUE *cq, mc_PIPELINE *oldpl, mc_PACKET *oldpkt, void *arg)
     }
 
     newpl = cq->pipelines[newix];
-    if (newpl == oldpl || newpl == NULL) {
+    if (newpl == oldpl || newpl == oldpl->primary || newpl == NULL) {
         return MCREQ_KEEP_PACKET;
     }
+    newpl = mcreq_select_lane(newpl, mcreq_get_bodysize(oldpkt));
+    hint = ctx->hints + newix;
 
     lcb_log(LOGARGS(cq->instance, DEBUG), "Remapped packet %p (SEQ=%u) from "SERVER_FMT " to " SERVER_FMT,
         (void*)oldpkt, oldpkt->opaque, SERVER_ARGS((mc_SERVER*)oldpl), SERVER_ARGS((mc_SERVER*)newpl));
@@ -116,22 +145,50 @@ iterwipe_cb(mc_CMDQUEUE *cq, mc_PIPELINE *oldpl, mc_PACKET *oldpkt, void *arg)
     /** Otherwise, copy over the packet and find the new vBucket to map to */
     newpkt = mcreq_dup_packet(oldpkt);
     newpkt->flags &= ~MCREQ_STATE_FLAGS;
-    mcreq_reenqueue_packet(newpl, newpkt);
+    mcreq_reenqueue_packet_after(newpl, newpkt,
+        hint->pl == newpl ? hint->pkt : NULL);
+    hint->pl = newpl;
+    hint->pkt = newpkt;
     mcreq_packet_handled(oldpl, oldpkt);
+    ctx->stats->nrelocated++;
     return MCREQ_REMOVE_PACKET;
 }
 
+/** Relocate the packets of a pipeline and each of its lanes */
+static void
+iterwipe_lanes(mc_CMDQUEUE *cq, mc_PIPELINE *pl, reloc_CTX *ctx)
+{
+    unsigned ii;
+    size_t nhints = sizeof(*ctx->hints) * cq->npipelines;
+
+    memset(ctx->hints, 0, nhints);
+    mcreq_iterwipe(cq, pl, iterwipe_cb, ctx);
+    for (ii = 0; ii < pl->nlanes; ii++) {
+        memset(ctx->hints, 0, nhints);
+        mcreq_iterwipe(cq, pl->lanes[ii], iterwipe_cb, ctx);
+    }
+}
+
+/** Count the packets of a pipeline which are left without being checked */
+static void
+skip_lanes(mc_PIPELINE *pl, reloc_CTX *ctx)
+{
+    unsigned ii;
+    ctx->stats->nskipped += pl->opindex_count + pl->opindex_nspill;
+    for (ii = 0; ii < pl->nlanes; ii++) {
+        ctx->stats->nskipped +=
+            pl->lanes[ii]->opindex_count + pl->lanes[ii]->opindex_nspill;
+    }
+}
+
 static int
-is_new_config(lcb_t instance, VBUCKET_CONFIG_HANDLE oldc, VBUCKET_CONFIG_HANDLE newc)
+is_new_config(lcb_t instance, VBUCKET_CONFIG_DIFF *diff)
 {
-    VBUCKET_CONFIG_DIFF *diff;
     VBUCKET_CHANGE_STATUS chstatus = VBUCKET_NO_CHANGES;
-    diff = vbucket_compare(oldc, newc);
 
     if (diff) {
         chstatus = vbucket_what_changed(diff);
         log_vbdiff(instance, diff);
-        vbucket_free_diff(diff);
     }
 
     if (diff == NULL || chstatus == VBUCKET_NO_CHANGES) {
@@ -141,18 +198,61 @@ is_new_config(lcb_t instance, VBUCKET_CONFIG_HANDLE oldc, VBUCKET_CONFIG_HANDLE
     return 1;
 }
 
+/**
+ * Mark the old servers which were the master of a vBucket that has moved.
+ * Only the queues of these servers can hold packets to relocate.
+ * @return an array of flags indexed by the old server index, or NULL if every
+ * server must be checked
+ */
+static char *
+get_lost_masters(VBUCKET_CONFIG_HANDLE oldc, VBUCKET_CONFIG_DIFF *diff)
+{
+    unsigned ii;
+    char *lost;
+
+    if (!diff || !diff->vbs_moved) {
+        return NULL;
+    }
+    if ((lost = calloc(VB_NSERVERS(oldc) + 1, 1)) == NULL) {
+        return NULL;
+    }
+    for (ii = 0; ii < oldc->nvb; ii++) {
+        int oldix;
+        if (!diff->vbs_moved[ii]) {
+            continue;
+        }
+        oldix = vbucket_get_master(oldc, ii);
+        if (oldix > -1 && oldix < (int)VB_NSERVERS(oldc)) {
+            lost[oldix] = 1;
+        }
+    }
+    return lost;
+}
+
 static int
-replace_config(lcb_t instance, clconfig_info *next_config)
+replace_config(lcb_t instance, VBUCKET_CONFIG_HANDLE oldc,
+               clconfig_info *next_config, VBUCKET_CONFIG_DIFF *diff)
 {
     VBUCKET_DISTRIBUTION_TYPE dist_t;
     mc_CMDQUEUE *cq = &instance->cmdq;
     mc_PIPELINE **ppold, **ppnew;
+    lcb_CONFIGSTATS *stats = &instance->configstats, prev = *stats;
+    reloc_CTX ctx;
+    char *lost, *check;
+    hrtime_t start = gethrtime();
     unsigned ii, nold, nnew;
 
     dist_t = VB_DISTTYPE(next_config->vbc);
     nnew = VB_NSERVERS(next_config->vbc);
     ppnew = calloc(nnew, sizeof(*ppnew));
+    check = calloc(nnew, 1);
     ppold = mcreq_queue_take_pipelines(cq, &nold);
+    lost = get_lost_masters(oldc, diff);
+
+    ctx.vbs_moved = lost ? diff->vbs_moved : NULL;
+    ctx.nvb = next_config->vbc->nvb;
+    ctx.hints = calloc(nnew, sizeof(*ctx.hints));
+    ctx.stats = stats;
 
     /**
      * Determine which existing servers are still part of the new cluster config
@@ -165,6 +265,7 @@ replace_config(lcb_t instance, clconfig_info *next_config)
             cur->pipeline.index = newix;
             ppnew[newix] = &cur->pipeline;
             ppold[ii] = NULL;
+            check[newix] = lost == NULL || lost[ii];
             lcb_log(LOGARGS(instance, INFO), "Reusing server "SERVER_FMT". OldIndex=%d. NewIndex=%d", SERVER_ARGS(cur), ii, newix);
         }
     }
@@ -173,7 +274,7 @@ replace_config(lcb_t instance, clconfig_info *next_config)
      * Once we've moved the kept servers to the new list, allocate new mc_SERVER
      * structures for slots that don't have an existing mc_SERVER. We must do
      * this before add_pipelines() is called, so that there are no holes inside
-     * ppnew
+     * ppnew. New servers have nothing queued, so they need not be checked.
      */
     for (ii = 0; ii < nnew; ii++) {
         if (!ppnew[ii]) {
@@ -188,30 +289,56 @@ replace_config(lcb_t instance, clconfig_info *next_config)
      */
     mcreq_queue_add_pipelines(cq, ppnew, nnew, next_config->vbc);
     if (dist_t == VBUCKET_DISTRIBUTION_VBUCKET) {
+        /* Count these before any packets are relocated into them */
         for (ii = 0; ii < nnew; ii++) {
-            mcreq_iterwipe(cq, ppnew[ii], iterwipe_cb, NULL);
+            if (!check[ii]) {
+                skip_lanes(ppnew[ii], &ctx);
+            }
+        }
+        for (ii = 0; ii < nnew; ii++) {
+            if (check[ii]) {
+                iterwipe_lanes(cq, ppnew[ii], &ctx);
+            }
         }
     }
 
     /**
      * Go through all the servers that are to be removed and relocate commands
-     * from their queues into the new queues
+     * from their queues into the new queues. All of their packets are checked,
+     * as their vBuckets have all moved.
      */
     for (ii = 0; ii < nold; ii++) {
         if (!ppold[ii]) {
             continue;
         }
         if (dist_t == VBUCKET_DISTRIBUTION_VBUCKET) {
-            mcreq_iterwipe(cq, ppold[ii], iterwipe_cb, NULL);
+            ctx.vbs_moved = NULL;
+            iterwipe_lanes(cq, ppold[ii], &ctx);
         }
         mcserver_fail_chain((mc_SERVER *)ppold[ii], LCB_MAP_CHANGED);
         mcserver_close((mc_SERVER *)ppold[ii]);
     }
 
+    stats->napplied++;
+    stats->ns_last = gethrtime() - start;
+    stats->ns_total += stats->ns_last;
+    lcb_log(LOGARGS(instance, DEBUG), "Relocated %lu of %lu checked packets (%lu not checked) in %lu us",
+        (unsigned long)(stats->nrelocated - prev.nrelocated),
+        (unsigned long)(stats->nexamined - prev.nexamined),
+        (unsigned long)(stats->nskipped - prev.nskipped),
+        (unsigned long)(stats->ns_last / 1000));
+
     for (ii = 0; ii < nnew; ii++) {
+        unsigned jj;
         ppnew[ii]->flush_start(ppnew[ii]);
+        for (jj = 0; jj < ppnew[ii]->nlanes; jj++) {
+            ppnew[ii]->lanes[jj]->flush_start(ppnew[ii]->lanes[jj]);
+        }
     }
 
+    free(ctx.hints);
+    free(check);
+    free(lost);
     free(ppold);
     return LCB_CONFIGURATION_CHANGED;
 }
@@ -232,14 +359,19 @@ void lcb_update_vbconfig(lcb_t instance, clconfig_info *config)
     q->instance = instance;
 
     if (old_config) {
-        if (is_new_config(instance, old_config->vbc, config->vbc)) {
-            change_status = replace_config(instance, config);
+        VBUCKET_CONFIG_DIFF *diff = vbucket_compare(old_config->vbc, config->vbc);
+        if (is_new_config(instance, diff)) {
+            change_status = replace_config(instance, old_config->vbc, config, diff);
+            vbucket_free_diff(diff);
             if (change_status == -1) {
                 LOG(instance, ERR, "Couldn't replace config");
                 return;
             }
             lcb_clconfig_decref(old_config);
         } else {
+            if (diff) {
+                vbucket_free_diff(diff);
+            }
             change_status = LCB_CONFIGURATION_UNCHANGED;
         }
     } else {
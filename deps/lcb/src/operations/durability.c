@@ -32,35 +32,38 @@
  * from ever being met (e.g. CAS mismatch on master)) the entry is marked as
  * done.
  *
- * Entries are polled for all at once. This polling involves sending out a
- * number of observe broadcast primitives to the related nodes (this itself
- * is implemented in observe.c). The client will then asynchronously wait
- * for the responses for all those entries to arrive (asynchronously, of course).
+ * Entries themselves are part of a set which contains state for timeout and
+ * polling infomation. This contains the criteria for all the entries and
+ * is also the resource parent for them.
  *
- * If all entries have been set to a 'done' mode then the operation is complete;
- * otherwise the polling is rescheduled to be performed within a given interval
- * (the exact duration of this interval is adaptive by default, but may be
- * user-specified).
+ * Sets are not polled on their own. Each instance has a single coordinator
+ * which holds all the sets in progress and a single timer. Whenever the timer
+ * fires, every set which is due for a poll is added to a batch, and the keys
+ * of the whole batch are observed at once (this itself is implemented in
+ * observe.c), so that each node receives one OBSERVE packet per tick no
+ * matter how many sets are pending. A key which is pending in several sets
+ * is only observed once; the response is applied to each of its entries.
+ *
+ * Once all the responses for a batch have arrived (indicated by a callback
+ * with the key appearing as NULL), each set which still has entries which are
+ * not done is scheduled for another poll. The interval is the one given by the
+ * user, or if none was given, it adapts to the time keys have recently taken
+ * to meet their criteria: the first poll is made a bit before a key is
+ * expected to be ready, and later ones back off exponentially up to the
+ * durability_interval setting.
  *
  * This cycle repeats until either all entries have been set to the 'done' mode
  * or the operation timeout has been reached (at which point, all non-done
  * entries are set to done and have their error set to LCB_ETIMEDOUT).
  *
- * Entries themselves are part of a set which contains state for timeout and
- * polling infomation. This contains the criteria for all the entries and
- * is also the resource parent for them. Sets are reference-counted and are
- * destroyed when their reference count hits zero.
- *
- * The reference count semantics works as follows.
+ * Sets are reference-counted and are destroyed when their reference count
+ * hits zero. The reference count semantics works as follows.
  *
  * It is incremented once during the creation of the operation (i.e.
  * lcb_durability_poll).
  *
- * It is incremented once for each polling 'sweep', at which this code (i.e.
- * poll_once) sends out observe broadcasts.
- *
- * It is decremented when all the responses for the observe broadcasts have been
- * received (indicated by a callback with the key appearing as NULL).
+ * It is incremented once when the set is added to a batch, and decremented
+ * when all the responses for that batch have been received.
  *
  * Finally, it is decremented when all entries are set to 'done'.
  *
@@ -78,25 +81,20 @@
 #define OPTFLD(opts, opt) (opts)->v.v0.opt
 #define DSET_OPTFLD(ds, opt) OPTFLD(&(ds)->opts, opt)
 
-enum {
-    STATE_OBSPOLL = 1,
-    STATE_TIMEOUT = 2,
+/* Shortest delay between two polls of a set with an adaptive interval, in us */
+#define MIN_INTERVAL LCB_MS2US(1)
 
-    /* spurious events. set after purge */
-    STATE_IGNORE = 3
-};
+/* Sets due for a poll within this long of a tick are polled with it, in us */
+#define TICK_SLACK LCB_MS2US(1)
+
+/* Weight of a new sample in the latency moving average is 1/EWMA_DIV */
+#define EWMA_DIV 8
 
-static void timer_callback(lcb_socket_t sock, short which, void *arg);
-static void timer_schedule(lcb_durability_set_t *dset,
-                           unsigned long delay,
-                           unsigned int state);
-static void poll_once(lcb_durability_set_t *dset);
 static void purge_entries(lcb_durability_set_t *dset, lcb_error_t err);
+static void coord_wakeup(lcb_durability_coord_t *coord, hrtime_t ns_due);
 #define dset_ref(dset) (dset)->refcnt++;
 static void dset_unref(lcb_durability_set_t *dset);
 
-
-
 /**
  * Returns true if the entry is complete, false otherwise. This only assumes
  * successful entries.
@@ -156,7 +154,63 @@ static void ent_set_resdone(lcb_durability_entry_t *ent)
 }
 
 /**
- * Called when the last (primitive) OBSERVE response is received for the entry.
+ * Add a sample of the time taken by a key to meet its criteria to the
+ * coordinator's moving average
+ */
+static void coord_sample(lcb_durability_coord_t *coord, hrtime_t latency)
+{
+    if (!latency) {
+        latency = 1;
+    }
+    if (!coord->latency) {
+        coord->latency = latency;
+    } else {
+        coord->latency = (coord->latency * (EWMA_DIV - 1) + latency) / EWMA_DIV;
+        if (!coord->latency) {
+            coord->latency = 1;
+        }
+    }
+}
+
+/**
+ * Returns how long to wait before polling the set again, in microseconds.
+ *
+ * With an adaptive interval the poll is aimed slightly before the keys are
+ * expected to meet their criteria (so the estimate can come down if the
+ * cluster gets faster). Once that time has passed, the delay doubles with
+ * each poll up to the configured interval.
+ */
+static lcb_uint32_t dset_next_delay(lcb_durability_set_t *dset)
+{
+    lcb_uint32_t us_max = DSET_OPTFLD(dset, interval);
+    lcb_uint32_t us_expected, us_elapsed, delay;
+
+    if (!dset->adaptive) {
+        return us_max;
+    }
+
+    us_expected = (lcb_uint32_t)(dset->instance->durcoord->latency / 1000 * 3 / 4);
+    us_elapsed = (lcb_uint32_t)((gethrtime() - dset->start) / 1000);
+
+    if (us_elapsed < us_expected) {
+        delay = us_expected - us_elapsed;
+    } else {
+        delay = MIN_INTERVAL << (dset->nlate < 16 ? dset->nlate : 16);
+        dset->nlate++;
+    }
+
+    if (delay < MIN_INTERVAL) {
+        delay = MIN_INTERVAL;
+    }
+    if (delay > us_max) {
+        delay = us_max;
+    }
+    return delay;
+}
+
+/**
+ * Called when the last (primitive) OBSERVE response of the set's batch is
+ * received.
  */
 static void dset_done_waiting(lcb_durability_set_t *dset)
 {
@@ -165,7 +219,8 @@ static void dset_done_waiting(lcb_durability_set_t *dset)
     dset->waiting = 0;
 
     if (dset->nremaining > 0) {
-        timer_schedule(dset, DSET_OPTFLD(dset, interval), STATE_OBSPOLL);
+        dset->ns_next = gethrtime() + LCB_US2NS(dset_next_delay(dset));
+        coord_wakeup(dset->instance->durcoord, dset->ns_next);
     }
     dset_unref(dset);
 }
@@ -177,8 +232,7 @@ static void dset_done_waiting(lcb_durability_set_t *dset)
 static void purge_entries(lcb_durability_set_t *dset, lcb_error_t err)
 {
     lcb_size_t ii;
-    dset->us_timeout = 0;
-    dset->next_state = STATE_IGNORE;
+    dset->ns_timeout = 0;
 
     /**
      * Each time we call 'ent_set_resdone' we might cause the refcount to drop
@@ -201,80 +255,148 @@ static void purge_entries(lcb_durability_set_t *dset, lcb_error_t err)
 }
 
 /**
- * Schedules a single sweep of observe requests.
+ * Ensure every pending key of the set can be sent to its master, so that
+ * one set with a bad key does not fail the whole batch.
  */
-static void poll_once(lcb_durability_set_t *dset)
+static lcb_error_t dset_check_servers(lcb_durability_set_t *dset)
 {
-    lcb_size_t ii, oix;
-    lcb_error_t err;
+    mc_CMDQUEUE *cq = &dset->instance->cmdq;
+    lcb_size_t ii;
 
-    /**
-     * We should never be called while an 'iter' operation is still
-     * in progress
-     */
-    lcb_assert(dset->waiting == 0);
-    dset_ref(dset);
+    if (cq->config == NULL) {
+        return LCB_CLIENT_ETMPFAIL;
+    }
 
-    for (ii = 0, oix = 0; ii < dset->nentries; ii++) {
-        struct lcb_durability_entry_st *ent = dset->entries + ii;
+    for (ii = 0; ii < dset->nentries; ii++) {
+        lcb_durability_entry_t *ent = dset->entries + ii;
+        const void *hk;
+        lcb_size_t nhk;
+        int vbid, ix;
 
         if (ent->done) {
             continue;
         }
 
-        /* reset all the per-iteration fields */
-        RESFLD(ent, persisted_master) = 0;
-        RESFLD(ent, exists_master) = 0;
-        RESFLD(ent, npersisted) = 0;
-        RESFLD(ent, nreplicated) = 0;
-        RESFLD(ent, cas) = 0;
-        RESFLD(ent, err) = LCB_SUCCESS;
+        if (REQFLD(ent, nhashkey)) {
+            hk = REQFLD(ent, hashkey);
+            nhk = REQFLD(ent, nhashkey);
+        } else {
+            hk = REQFLD(ent, key);
+            nhk = REQFLD(ent, nkey);
+        }
+
+        vbid = vbucket_get_vbucket_by_key(cq->config, hk, nhk);
+        ix = vbucket_get_master(cq->config, vbid);
+        if (ix < 0 || ix >= (int)cq->npipelines) {
+            return LCB_NO_MATCHING_SERVER;
+        }
+    }
+    return LCB_SUCCESS;
+}
+
+static void batch_destroy(lcb_durability_batch_t *batch)
+{
+    if (batch->ht) {
+        genhash_free(batch->ht);
+    }
+    free(batch->entries);
+    free(batch->dsets);
+    free(batch);
+}
 
-        dset->valid_entries[oix++] = ent;
+/**
+ * Called once all the responses for a batch have arrived (or it could not be
+ * sent at all). Each set is rescheduled or completed.
+ */
+static void batch_done(lcb_durability_batch_t *batch)
+{
+    lcb_size_t ii;
+
+    lcb_list_delete(&batch->ll);
+    for (ii = 0; ii < batch->ndsets; ii++) {
+        dset_done_waiting(batch->dsets[ii]);
     }
+    batch_destroy(batch);
+}
 
-    lcb_assert(oix == dset->nremaining);
+/**
+ * Build the batch for the sets already in it: reset the per-iteration fields
+ * of their pending entries, and index the entries by key.
+ */
+static lcb_error_t batch_prepare(lcb_durability_batch_t *batch)
+{
+    lcb_size_t ii, jj, nkeys = 0;
 
-    err = lcb_observe_ex(dset->instance,
-                         dset,
-                         dset->nremaining,
-                         (const void * const *)dset->valid_entries,
-                         LCB_OBSERVE_TYPE_DURABILITY);
+    for (ii = 0; ii < batch->ndsets; ii++) {
+        nkeys += batch->dsets[ii]->nremaining;
+    }
+
+    batch->ht = lcb_hashtable_nc_new(nkeys);
+    batch->entries = malloc(nkeys * sizeof(*batch->entries));
+    if (batch->ht == NULL || batch->entries == NULL) {
+        return LCB_CLIENT_ENOMEM;
+    }
+
+    for (ii = 0; ii < batch->ndsets; ii++) {
+        lcb_durability_set_t *dset = batch->dsets[ii];
+
+        for (jj = 0; jj < dset->nentries; jj++) {
+            lcb_durability_entry_t *ent = dset->entries + jj, *first;
 
-    if (err != LCB_SUCCESS) {
-        for (ii = 0; ii < dset->nentries; ii++) {
-            lcb_durability_entry_t *ent = dset->entries + ii;
             if (ent->done) {
                 continue;
             }
-            RESFLD(ent, err) = err;
-            ent_set_resdone(ent);
-        }
-
-    } else {
-        dset->waiting = 1;
-        dset_ref(dset);
-    }
-
-    if (dset->waiting && oix) {
-        lcb_uint32_t us_now = (lcb_uint32_t)(gethrtime() / 1000);
-        lcb_uint32_t us_tmo;
 
-        if (dset->us_timeout > us_now) {
-            us_tmo = dset->us_timeout - us_now;
-        } else {
-            us_tmo = 1;
+            /* reset all the per-iteration fields */
+            RESFLD(ent, persisted_master) = 0;
+            RESFLD(ent, exists_master) = 0;
+            RESFLD(ent, npersisted) = 0;
+            RESFLD(ent, nreplicated) = 0;
+            RESFLD(ent, cas) = 0;
+            RESFLD(ent, err) = LCB_SUCCESS;
+            ent->same_key = NULL;
+
+            first = genhash_find(batch->ht, REQFLD(ent, key), REQFLD(ent, nkey));
+            if (first) {
+                ent->same_key = first->same_key;
+                first->same_key = ent;
+            } else {
+                genhash_update(batch->ht, REQFLD(ent, key), REQFLD(ent, nkey),
+                               ent, 0);
+                batch->entries[batch->nentries++] = ent;
+            }
         }
+    }
+    return LCB_SUCCESS;
+}
 
-        timer_schedule(dset,
-                       us_tmo,
-                       STATE_TIMEOUT);
+/**
+ * Sends the observe requests for all the keys of the batch. Should this fail,
+ * all the sets in the batch are failed with the error.
+ */
+static void batch_send(lcb_durability_coord_t *coord,
+                       lcb_durability_batch_t *batch)
+{
+    lcb_error_t err;
+    lcb_size_t ii;
 
-    } else {
-        purge_entries(dset, LCB_ERROR);
+    lcb_list_append(&coord->batches, &batch->ll);
+    err = batch_prepare(batch);
+    if (err == LCB_SUCCESS) {
+        err = lcb_observe_ex(coord->instance,
+                             batch,
+                             batch->nentries,
+                             (const void * const *)batch->entries,
+                             LCB_OBSERVE_TYPE_DURABILITY);
+    }
+    if (err == LCB_SUCCESS) {
+        return;
     }
 
-    dset_unref(dset);
+    for (ii = 0; ii < batch->ndsets; ii++) {
+        purge_entries(batch->dsets[ii], err);
+    }
+    batch_done(batch);
 }
 
 /**
@@ -371,34 +493,13 @@ static void check_negative_durability(lcb_durability_entry_t *ent,
 }
 
 /**
- * Observe callback. Called internally by libcouchbase's observe handlers
+ * Apply an observe response to a single entry
  */
-void lcb_durability_dset_update(lcb_t instance,
-                                lcb_durability_set_t *dset,
-                                lcb_error_t err,
-                                const lcb_observe_resp_t *resp)
+static void ent_update(lcb_durability_entry_t *ent,
+                       lcb_error_t err,
+                       const lcb_observe_resp_t *resp)
 {
-    lcb_durability_entry_t *ent;
-
-    /**
-     * So we have two counters to decrement. One is the global 'done' counter
-     * and the other is the iteration counter.
-     *
-     * The iteration counter is only decremented when we receive a NULL signal
-     * in the callback, whereas the global counter is decremented once, whenever
-     * the entry's criteria have been satisfied
-     */
-
-    if (resp->v.v0.key == NULL) {
-        dset_done_waiting(dset);
-        return;
-    }
-
-    if (dset->nentries == 1) {
-        ent = &dset->single.ent;
-    } else {
-        ent = genhash_find(dset->ht, resp->v.v0.key, resp->v.v0.nkey);
-    }
+    lcb_durability_set_t *dset = ent->parent;
 
     if (ent->done) {
         /* ignore subsequent errors */
@@ -423,21 +524,58 @@ void lcb_durability_dset_update(lcb_t instance,
         }
     }
 
-    if (DSET_OPTFLD(ent->parent, check_delete)) {
+    if (DSET_OPTFLD(dset, check_delete)) {
         check_negative_durability(ent, resp);
 
     } else {
         check_positive_durability(ent, resp);
     }
 
-    if (ent_is_complete(ent)) {
+    if (!ent->done && ent_is_complete(ent)) {
+        /* Only adaptive sets are polled often enough to tell the latency */
+        if (dset->adaptive &&
+                (DSET_OPTFLD(dset, persist_to) || DSET_OPTFLD(dset, replicate_to))) {
+            coord_sample(dset->instance->durcoord, gethrtime() - dset->start);
+        }
+
         /* clear any transient errors */
         RESFLD(ent, err) = LCB_SUCCESS;
         ent_set_resdone(ent);
     }
+}
 
-    (void)instance;
+/**
+ * Observe callback. Called internally by libcouchbase's observe handlers
+ */
+void lcb_durability_batch_update(lcb_t instance,
+                                 lcb_durability_batch_t *batch,
+                                 lcb_error_t err,
+                                 const lcb_observe_resp_t *resp)
+{
+    lcb_durability_entry_t *ent;
+
+    /**
+     * So we have two counters to decrement. One is the global 'done' counter
+     * and the other is the iteration counter.
+     *
+     * The iteration counter is only decremented when we receive a NULL signal
+     * in the callback, whereas the global counter is decremented once, whenever
+     * the entry's criteria have been satisfied
+     */
+
+    if (resp->v.v0.key == NULL) {
+        batch_done(batch);
+        return;
+    }
 
+    ent = genhash_find(batch->ht, resp->v.v0.key, resp->v.v0.nkey);
+    while (ent) {
+        lcb_durability_entry_t *next = ent->same_key;
+        ent_update(ent, err, resp);
+        ent = next;
+    }
+
+    (void)instance;
 }
 
 /**
@@ -508,6 +646,33 @@ static int verify_critera(lcb_t instance, lcb_durability_set_t *dset)
     return 0;
 }
 
+
+static void coord_timer_callback(void *arg)
+{
+    lcb_durability_coord_tick(arg);
+}
+
+/**
+ * Returns the instance's coordinator, creating it if needed
+ */
+static lcb_durability_coord_t *coord_get(lcb_t instance)
+{
+    lcb_durability_coord_t *coord = instance->durcoord;
+    if (coord) {
+        return coord;
+    }
+
+    if ((coord = calloc(1, sizeof(*coord))) == NULL) {
+        return NULL;
+    }
+    coord->instance = instance;
+    lcb_list_init(&coord->dsets);
+    lcb_list_init(&coord->batches);
+    coord->timer = lcbio_timer_new(instance->iotable, coord, coord_timer_callback);
+    instance->durcoord = coord;
+    return coord;
+}
+
 LIBCOUCHBASE_API
 lcb_error_t lcb_durability_poll(lcb_t instance,
                                 const void *cookie,
@@ -516,19 +681,24 @@ lcb_error_t lcb_durability_poll(lcb_t instance,
                                 const lcb_durability_cmd_t *const *cmds)
 {
     hrtime_t now = gethrtime();
+    lcb_durability_coord_t *coord;
     lcb_durability_set_t *dset;
     lcb_size_t ii;
-    lcbio_pTABLE io = instance->iotable;
 
     if (!ncmds) {
         return LCB_EINVAL;
     }
 
+    if ((coord = coord_get(instance)) == NULL) {
+        return LCB_CLIENT_ENOMEM;
+    }
+
     dset = calloc(1, sizeof(*dset));
     if (!dset) {
         return LCB_CLIENT_ENOMEM;
     }
 
+    lcb_list_init(&dset->ll);
     dset->opts = *options;
     dset->instance = instance;
 
@@ -542,27 +712,26 @@ lcb_error_t lcb_durability_poll(lcb_t instance,
     }
 
     /* set our timeouts now */
-    dset->us_timeout = (lcb_uint32_t)(now / 1000) + DSET_OPTFLD(dset, timeout);
-    dset->timer = io->timer.create(io->p);
+    dset->ns_timeout = now + LCB_US2NS(DSET_OPTFLD(dset, timeout));
+    dset->start = now;
     dset->cookie = cookie;
     dset->nentries = ncmds;
     dset->nremaining = ncmds;
 
     /** Get the timings */
     if (!DSET_OPTFLD(dset, interval)) {
-        DSET_OPTFLD(dset, interval) = LCB_DEFAULT_DURABILITY_INTERVAL;
+        DSET_OPTFLD(dset, interval) = LCBT_SETTING(instance, durability_interval);
+        dset->adaptive = 1;
     }
 
     /* list of observe commands to schedule */
     if (dset->nentries == 1) {
         dset->entries = &dset->single.ent;
-        dset->valid_entries = &dset->single.entp;
 
     } else {
         dset->ht = lcb_hashtable_nc_new(dset->nentries);
         dset->entries = calloc(dset->nentries, sizeof(*dset->entries));
-        dset->valid_entries = malloc(dset->nentries * sizeof(*dset->valid_entries));
-        if (dset->entries == NULL || dset->valid_entries == NULL) {
+        if (dset->entries == NULL) {
             lcb_durability_dset_destroy(dset);
             return LCB_CLIENT_ENOMEM;
         }
@@ -593,7 +762,18 @@ lcb_error_t lcb_durability_poll(lcb_t instance,
 
     dset_ref(dset);
     lcb_aspend_add(&instance->pendops, LCB_PENDTYPE_DURABILITY, dset);
-    timer_schedule(dset, 0, STATE_OBSPOLL);
+
+    /**
+     * Unless the keys are not expected to be ready for a while, the first
+     * poll is made on the next tick, together with any other sets created
+     * in the meantime.
+     */
+    dset->ns_next = now;
+    if (dset->adaptive && coord->latency) {
+        dset->ns_next += LCB_US2NS(dset_next_delay(dset));
+    }
+    lcb_list_append(&coord->dsets, &dset->ll);
+    coord_wakeup(coord, dset->ns_next);
     SYNCMODE_INTERCEPT(instance)
 }
 
@@ -617,12 +797,7 @@ void lcb_durability_dset_destroy(lcb_durability_set_t *dset)
     lcb_size_t ii;
     lcb_t instance = dset->instance;
 
-    if (dset->timer) {
-        lcbio_TABLE *io = instance->iotable;
-        io->timer.cancel(io->p, dset->timer);
-        io->timer.destroy(io->p, dset->timer);
-        dset->timer = NULL;
-    }
+    lcb_list_delete(&dset->ll);
 
     for (ii = 0; ii < dset->nentries; ii++) {
         lcb_durability_entry_t *ent = dset->entries + ii;
@@ -635,7 +810,6 @@ void lcb_durability_dset_destroy(lcb_durability_set_t *dset)
             genhash_free(dset->ht);
         }
         free(dset->entries);
-        free(dset->valid_entries);
     }
 
     free(dset);
@@ -643,64 +817,118 @@ void lcb_durability_dset_destroy(lcb_durability_set_t *dset)
 }
 
 /**
- * All-purpose callback dispatcher.
+ * Make sure the coordinator's timer fires no later than the given time
  */
-static void timer_callback(lcb_socket_t sock, short which, void *arg)
+static void coord_wakeup(lcb_durability_coord_t *coord, hrtime_t ns_due)
 {
-    lcb_durability_set_t *dset = arg;
     hrtime_t ns_now = gethrtime();
-    lcb_uint32_t us_now = (lcb_uint32_t)(ns_now / 1000);
 
-    if (us_now >= (dset->us_timeout - 50)) {
-        dset->next_state = STATE_TIMEOUT;
+    if (lcbio_timer_armed(coord->timer) && coord->ns_wakeup <= ns_due) {
+        return;
     }
+    coord->ns_wakeup = ns_due;
+    lcbio_timer_rearm(coord->timer,
+                      ns_due > ns_now ? LCB_NS2US(ns_due - ns_now) : 0);
+}
 
+/**
+ * Arm the timer for the next poll or timeout of any set
+ */
+static void coord_schedule(lcb_durability_coord_t *coord)
+{
+    lcb_list_t *ll;
+    hrtime_t ns_due = 0;
+    int found = 0;
 
-    switch (dset->next_state) {
-    case STATE_OBSPOLL:
-        poll_once(dset);
-        break;
+    LCB_LIST_FOR(ll, &coord->dsets) {
+        lcb_durability_set_t *dset = LCB_LIST_ITEM(ll, lcb_durability_set_t, ll);
+        hrtime_t ns_cur = dset->ns_timeout;
 
-    case STATE_TIMEOUT: {
+        if (!dset->nremaining) {
+            continue;
+        }
+        if (!dset->waiting && dset->ns_next < ns_cur) {
+            ns_cur = dset->ns_next;
+        }
+        if (!found || ns_cur < ns_due) {
+            ns_due = ns_cur;
+            found = 1;
+        }
+    }
+
+    lcbio_timer_disarm(coord->timer);
+    if (found) {
+        coord_wakeup(coord, ns_due);
+    }
+}
 
+void lcb_durability_coord_tick(lcb_durability_coord_t *coord)
+{
+    lcb_list_t *ll, *llnext;
+    lcb_durability_batch_t *batch = NULL;
+    lcb_size_t nalloc = 0;
+    hrtime_t ns_now = gethrtime();
+
+    LCB_LIST_SAFE_FOR(ll, llnext, &coord->dsets) {
+        lcb_durability_set_t *dset = LCB_LIST_ITEM(ll, lcb_durability_set_t, ll);
+        lcb_error_t err;
+
+        if (!dset->nremaining) {
+            continue;
+        }
 
-        if (us_now >= (dset->us_timeout - 50)) {
+        if (ns_now + LCB_US2NS(50) >= dset->ns_timeout) {
             purge_entries(dset, LCB_ETIMEDOUT);
+            continue;
+        }
 
-        } else {
-            timer_schedule(dset,
-                           dset->us_timeout - us_now,
-                           STATE_TIMEOUT);
+        if (dset->waiting || dset->ns_next > ns_now + LCB_US2NS(TICK_SLACK)) {
+            continue;
         }
-        break;
-    }
 
-    case STATE_IGNORE:
-        break;
+        if ((err = dset_check_servers(dset)) != LCB_SUCCESS) {
+            purge_entries(dset, err);
+            continue;
+        }
 
-    default:
-        lcb_assert("unexpected state" && 0);
-        break;
+        if (batch == NULL && (batch = calloc(1, sizeof(*batch))) == NULL) {
+            purge_entries(dset, LCB_CLIENT_ENOMEM);
+            continue;
+        }
+
+        if (batch->ndsets == nalloc) {
+            lcb_size_t nnew = nalloc ? nalloc * 2 : 16;
+            void *dsets = realloc(batch->dsets, nnew * sizeof(*batch->dsets));
+            if (dsets == NULL) {
+                purge_entries(dset, LCB_CLIENT_ENOMEM);
+                continue;
+            }
+            batch->dsets = dsets;
+            nalloc = nnew;
+        }
+
+        /* Released when all the responses for the batch are in */
+        dset->waiting = 1;
+        dset_ref(dset);
+        batch->dsets[batch->ndsets++] = dset;
     }
 
-    (void)sock;
-    (void)which;
+    if (batch && batch->ndsets) {
+        batch_send(coord, batch);
+    } else if (batch) {
+        batch_destroy(batch);
+    }
+    coord_schedule(coord);
 }
 
-/**
- * Schedules us to be notified with the given state within a particular amount
- * of time. This is used both for the timeout and for the interval
- */
-static void timer_schedule(lcb_durability_set_t *dset,
-                           unsigned long delay,
-                           unsigned int state)
+void lcb_durability_coord_destroy(lcb_durability_coord_t *coord)
 {
-    lcbio_TABLE* io = dset->instance->iotable;
-    dset->next_state = state;
-    if (!delay) {
-        delay = 1;
-    }
+    lcb_list_t *ll, *llnext;
 
-    io->timer.cancel(io->p, dset->timer);
-    io->timer.schedule(io->p, dset->timer, delay, dset, timer_callback);
+    /* The sets have been destroyed already; no callbacks are invoked */
+    LCB_LIST_SAFE_FOR(ll, llnext, &coord->batches) {
+        batch_destroy(LCB_LIST_ITEM(ll, lcb_durability_batch_t, ll));
+    }
+    lcbio_timer_destroy(coord->timer);
+    free(coord);
 }
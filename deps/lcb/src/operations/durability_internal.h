@@ -37,6 +37,12 @@ extern "C" {
         /** pointer to the containing durability_set */
         struct lcb_durability_set_st *parent;
 
+        /**
+         * Next entry (of another set) with the same key in the batch being
+         * polled. The key is only observed once for all of them
+         */
+        struct lcb_durability_entry_st *same_key;
+
         /**
          * flag, indicates that we're done and that it should be excluded from
          * further operations
@@ -55,9 +61,6 @@ extern "C" {
         /** array of entries which are to be polled */
         struct lcb_durability_entry_st *entries;
 
-        /** Allocated as well for passing to observe_ex */
-        struct lcb_durability_entry_st **valid_entries;
-
         /** number of entries in the array */
         lcb_size_t nentries;
 
@@ -66,9 +69,11 @@ extern "C" {
              * Tweak for single entry, so we don't have to allocate tiny chunks
              */
             lcb_durability_entry_t ent;
-            lcb_durability_entry_t *entp;
         } single;
 
+        /** Node in the coordinator's list of sets */
+        lcb_list_t ll;
+
         /**
          * How many entries have been thus far completed. The operation is
          * complete when this number hits zero
@@ -76,7 +81,8 @@ extern "C" {
         lcb_size_t nremaining;
 
         /**
-         * How many entries remain for the current iteration
+         * Whether the set is part of a batch whose responses have not all
+         * arrived yet
          */
         unsigned waiting;
 
@@ -85,11 +91,6 @@ extern "C" {
          */
         unsigned refcnt;
 
-        /**
-         * State. This is defined in the source file
-         */
-        unsigned next_state;
-
         /**
          * Hash table. Only used for multiple entries
          */
@@ -103,22 +104,88 @@ extern "C" {
         /**
          * Timestamp for the timeout
          */
-        lcb_uint32_t us_timeout;
+        hrtime_t ns_timeout;
+
+        /** Timestamp for the next poll */
+        hrtime_t ns_next;
+
+        /** When the set was created */
+        hrtime_t start;
+
+        /**
+         * Number of polls made since the keys were expected to meet their
+         * criteria. Used for the backoff
+         */
+        unsigned nlate;
 
-        void *timer;
+        /**
+         * Whether the polling interval adapts to the persistence latency (the
+         * user did not specify one)
+         */
+        int adaptive;
 
         lcb_t instance;
     } lcb_durability_set_t;
 
+    /**
+     * The keys of one or more sets which are polled together. All the keys
+     * to observe on a given node go in a single OBSERVE packet.
+     */
+    typedef struct lcb_durability_batch_st {
+        lcb_list_t ll;
+
+        /** Maps a key to the first entry with that key */
+        genhash_t *ht;
+
+        /** The entries whose keys are observed, one per key */
+        lcb_durability_entry_t **entries;
+        lcb_size_t nentries;
+
+        lcb_durability_set_t **dsets;
+        lcb_size_t ndsets;
+    } lcb_durability_batch_t;
+
+    /**
+     * Polls the pending durability sets of an instance. There is a single
+     * timer for all of them; each time it fires, the sets due for a poll are
+     * merged into one batch.
+     */
+    typedef struct lcb_durability_coord_st {
+        lcb_t instance;
+
+        /** Sets which are still in progress */
+        lcb_list_t dsets;
+
+        /** Batches awaiting responses */
+        lcb_list_t batches;
+
+        lcbio_pTIMER timer;
+
+        /** When the timer is due to fire, if armed */
+        hrtime_t ns_wakeup;
+
+        /**
+         * Moving average of the time taken for keys to meet their criteria,
+         * in nanoseconds. 0 until measured
+         */
+        hrtime_t latency;
+    } lcb_durability_coord_t;
+
     void lcb_durability_update(lcb_t instance,
                                const void *cookie,
                                lcb_error_t err,
                                lcb_observe_resp_t *resp);
 
-    void lcb_durability_dset_update(lcb_t instance,
-                                    lcb_durability_set_t *dset,
-                                    lcb_error_t err,
-                                    const lcb_observe_resp_t *resp);
+    void lcb_durability_batch_update(lcb_t instance,
+                                     lcb_durability_batch_t *batch,
+                                     lcb_error_t err,
+                                     const lcb_observe_resp_t *resp);
+
+    /**
+     * Run the coordinator's timer callback right away. Sets which are due
+     * are polled, and those which have timed out are completed.
+     */
+    void lcb_durability_coord_tick(lcb_durability_coord_t *coord);
 
     typedef enum {
         /** Durability requirement. Poll all servers */
@@ -75,9 +75,9 @@ handle_observe_callback(
 
 
     if (oc->otype & F_DURABILITY) {
-        lcb_durability_dset_update(
+        lcb_durability_batch_update(
                 instance,
-                (lcb_durability_set_t *)MCREQ_PKT_COOKIE(pkt), err, resp);
+                (lcb_durability_batch_t *)MCREQ_PKT_COOKIE(pkt), err, resp);
     } else {
         instance->callbacks.observe(instance, MCREQ_PKT_COOKIE(pkt), err, resp);
     }
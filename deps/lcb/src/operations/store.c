@@ -27,6 +27,21 @@ get_value_size(mc_PACKET *packet)
     }
 }
 
+static lcb_size_t
+get_cmd_value_size(const lcb_VALBUF *vbuf)
+{
+    if (vbuf->vtype == LCB_KV_IOV) {
+        unsigned ii;
+        lcb_size_t ret = 0;
+        for (ii = 0; ii < vbuf->u_buf.multi.niov; ii++) {
+            ret += vbuf->u_buf.multi.iov[ii].iov_len;
+        }
+        return ret;
+    } else {
+        return vbuf->u_buf.contig.nbytes;
+    }
+}
+
 static lcb_error_t
 get_esize_and_opcode(
         lcb_storage_t ucmd, lcb_uint8_t *opcode, lcb_uint8_t *esize)
@@ -102,9 +117,9 @@ lcb_store3(lcb_t instance, const void *cookie, const lcb_CMDSTORE *cmd)
 
     hsize = hdr->request.extlen + sizeof(*hdr);
 
-    err = mcreq_basic_packet(
+    err = mcreq_basic_packet2(
             cq, (const lcb_CMDBASE *)cmd, hdr, hdr->request.extlen,
-            &packet, &pipeline);
+            get_cmd_value_size(&cmd->value), &packet, &pipeline);
 
     if (err != LCB_SUCCESS) {
         return err;
@@ -112,12 +127,16 @@ lcb_store3(lcb_t instance, const void *cookie, const lcb_CMDSTORE *cmd)
 
     should_compress = can_compress(instance, pipeline, cmd);
     if (should_compress) {
-        int rv = mcreq_compress_value(pipeline, packet, &cmd->value.u_buf.contig);
-        if (rv != 0) {
+        int rv = mcreq_compress_value(pipeline, packet,
+            &cmd->value.u_buf.contig, &instance->compress,
+            cmd->key.contig.bytes, cmd->key.contig.nbytes);
+        if (rv < 0) {
             mcreq_release_packet(pipeline, packet);
             return LCB_CLIENT_ENOMEM;
         }
-    } else {
+        should_compress = rv == 0;
+    }
+    if (!should_compress) {
         mcreq_reserve_value(pipeline, packet, &cmd->value);
     }
 
@@ -21,6 +21,9 @@ typedef struct packet_info_st {
     protocol_binary_response_header res;
     /** The payload of the response. This should only be used if there is a body */
     void *payload;
+    /** Segment containing the payload (rdb_ROPESEG), if the payload is read
+     * directly from the network buffers */
+    void *bufh;
 } packet_info;
 
 /**
@@ -202,7 +202,10 @@ rope_consolidate(rdb_ROPEBUF *rope, unsigned nr)
 
     lcb_list_prepend(&rope->segments, &newseg->llnode);
     rope->nused += newseg->nused;
-    assert(rope->nused >= nr);
+
+    /* If less than `nr` bytes have been received, then everything has been
+     * moved into the new segment, which has space for the remainder */
+    assert(nr == 0 || rope->nused == newseg->nused);
 }
 
 void
@@ -8,6 +8,7 @@ extern "C" {
 #include <lcbio/timer-ng.h>
 #include <mc/mcreq.h>
 #include "list.h"
+#include "timewheel.h"
 
 /**
  * @file
@@ -19,19 +20,22 @@ extern "C" {
  * Retry queue for operations. The retry queue accepts commands which have
  * previously failed and aims to retry them within a specified interval.
  *
+ * Each queued operation is scheduled on the instance's timing wheel for the
+ * earlier of its next retry and its timeout, so that adding an operation and
+ * processing the due ones does not depend on how many are queued.
+ *
  * @addtogroup LCB_RETRYQ
  * @{
  */
 
 typedef struct lcb_RETRYQ {
-    /** List of operations in retry ordering. Sorted by 'crtime' */
-    lcb_list_t schedops;
-    /** List of operations in timeout ordering. Ordered by 'start_time' */
-    lcb_list_t tmoops;
+    /** List of all queued operations, in insertion order */
+    lcb_list_t ops;
     /** Parent command queue */
     mc_CMDQUEUE *cq;
     lcb_settings *settings;
-    lcbio_pTIMER timer;
+    /** Timing wheel on which retries and timeouts are scheduled */
+    lcb_TIMEWHEEL *wheel;
 } lcb_RETRYQ;
 
 /**
@@ -40,12 +44,12 @@ typedef struct lcb_RETRYQ {
  * with a certain throttle.
  *
  * @param cq The parent cmdqueue object
- * @param table used to create the timer
+ * @param wheel The timing wheel used to schedule retries and timeouts
  * @param settings Used for logging and interval timeouts
  * @return A new retry queue object
  */
 lcb_RETRYQ *
-lcb_retryq_new(mc_CMDQUEUE *cq, lcbio_pTABLE table, lcb_settings *settings);
+lcb_retryq_new(mc_CMDQUEUE *cq, lcb_TIMEWHEEL *wheel, lcb_settings *settings);
 
 void
 lcb_retryq_destroy(lcb_RETRYQ *rq);
@@ -80,7 +84,7 @@ lcb_retryq_signal(lcb_RETRYQ *rq);
  * @param rq the queue
  * @return nonzero if there are pending operations
  */
-#define lcb_retryq_empty(rq) LCB_LIST_IS_EMPTY(&(rq)->schedops)
+#define lcb_retryq_empty(rq) LCB_LIST_IS_EMPTY(&(rq)->ops)
 
 /**@}*/
 
@@ -61,6 +61,7 @@
 #define LCB_DEFAULT_NMVRETRY LCB_RETRY_CMDS_ALL
 #define LCB_DEFAULT_HTCONFIG_URLTYPE LCB_HTCONFIG_URLTYPE_TRYALL
 #define LCB_DEFAULT_COMPRESSOPTS LCB_COMPRESS_NONE
+#define LCB_DEFAULT_MEMD_NCONNS 1
 
 #include "config.h"
 #include <libcouchbase/couchbase.h>
@@ -103,6 +104,9 @@ typedef struct lcb_settings_st {
      * updates. */
     lcb_U32 bc_http_stream_time;
 
+    /** Number of connections to open to each data node */
+    lcb_U32 memd_nconns;
+
     unsigned bc_http_urltype : 4;
 
     /** Don't guess next vbucket server. Mainly for testing */
@@ -111,6 +115,8 @@ typedef struct lcb_settings_st {
      * loop as much as possible until no outstanding events remain.*/
     unsigned syncdtor : 1;
     unsigned detailed_neterr : 1;
+    /** Whether per-server, per-opcode latencies are recorded */
+    unsigned oplatency : 1;
     unsigned randomize_bootstrap_nodes : 1;
     unsigned conntype : 1;
     unsigned sslopts : 2;
@@ -0,0 +1,206 @@
+/* -*- Mode: C; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "internal.h"
+#include "timewheel.h"
+
+static void
+tw_tick(void *arg)
+{
+    lcb_timewheel_run(arg, gethrtime());
+}
+
+lcb_TIMEWHEEL *
+lcb_timewheel_new(lcbio_pTABLE table, unsigned nslots, hrtime_t resolution)
+{
+    unsigned ii, n = 1;
+    lcb_TIMEWHEEL *tw = calloc(1, sizeof(*tw));
+
+    if (!tw) {
+        return NULL;
+    }
+    while (n < nslots) {
+        n <<= 1;
+    }
+    tw->slots = malloc(n * sizeof(*tw->slots));
+    if (!tw->slots) {
+        free(tw);
+        return NULL;
+    }
+    for (ii = 0; ii < n; ii++) {
+        lcb_list_init(tw->slots + ii);
+    }
+
+    tw->mask = n - 1;
+    tw->resolution = resolution;
+    tw->tick = gethrtime() / resolution;
+    if (table) {
+        tw->timer = lcbio_timer_new(table, tw, tw_tick);
+    }
+    return tw;
+}
+
+void
+lcb_timewheel_destroy(lcb_TIMEWHEEL *tw)
+{
+    unsigned ii;
+    for (ii = 0; ii <= tw->mask; ii++) {
+        while (lcb_list_shift(tw->slots + ii) != NULL) {
+            /* lcb_list_shift() marks the entry as unscheduled */
+        }
+    }
+    if (tw->timer) {
+        lcbio_timer_destroy(tw->timer);
+    }
+    free(tw->slots);
+    free(tw);
+}
+
+void
+lcb_twentry_init(lcb_TWENTRY *ent, lcb_TWCALLBACK callback, void *arg)
+{
+    memset(ent, 0, sizeof(*ent));
+    ent->callback = callback;
+    ent->arg = arg;
+}
+
+static void
+rearm_timer(lcb_TIMEWHEEL *tw, hrtime_t tick, hrtime_t now)
+{
+    hrtime_t when = tick * tw->resolution;
+    uint32_t usec = 0;
+
+    if (when > now) {
+        /* Round up, so the timer never fires before the slot is due */
+        usec = LCB_NS2US(when - now + 999);
+    }
+    tw->wakeup = tick;
+    lcbio_timer_rearm(tw->timer, usec);
+}
+
+/* Arm the timer for the next slot containing any entries */
+static void
+update_timer(lcb_TIMEWHEEL *tw, hrtime_t now)
+{
+    unsigned ii;
+
+    if (!tw->nentries) {
+        tw->wakeup = 0;
+        lcbio_timer_disarm(tw->timer);
+        return;
+    }
+
+    for (ii = 1; ii <= tw->mask + 1; ii++) {
+        hrtime_t tick = tw->tick + ii;
+        if (!LCB_LIST_IS_EMPTY(tw->slots + (tick & tw->mask))) {
+            rearm_timer(tw, tick, now);
+            return;
+        }
+    }
+}
+
+void
+lcb_timewheel_schedule(lcb_TIMEWHEEL *tw, lcb_TWENTRY *ent, hrtime_t expires)
+{
+    hrtime_t tick = (expires + tw->resolution - 1) / tw->resolution;
+
+    if (lcb_twentry_armed(ent)) {
+        lcb_list_delete(&ent->ll);
+    } else {
+        tw->nentries++;
+    }
+
+    ent->expires = expires;
+    ent->tick = tick;
+
+    /* Entries which are already due go into the next slot to be processed */
+    if (tick <= tw->tick) {
+        tick = tw->tick + 1;
+    }
+    lcb_list_append(tw->slots + (tick & tw->mask), &ent->ll);
+
+    if (tw->timer && !tw->running && (!tw->wakeup || tick < tw->wakeup)) {
+        rearm_timer(tw, tick, gethrtime());
+    }
+}
+
+void
+lcb_timewheel_cancel(lcb_TIMEWHEEL *tw, lcb_TWENTRY *ent)
+{
+    if (!lcb_twentry_armed(ent)) {
+        return;
+    }
+    lcb_list_delete(&ent->ll);
+    tw->nentries--;
+}
+
+unsigned
+lcb_timewheel_run(lcb_TIMEWHEEL *tw, hrtime_t now)
+{
+    hrtime_t nowtick = now / tw->resolution, cur;
+    unsigned ninvoked = 0;
+
+    if (nowtick <= tw->tick) {
+        goto GT_DONE;
+    }
+
+    /* If we are more than one rotation behind, visit each slot only once */
+    cur = tw->tick + 1;
+    if (nowtick - tw->tick > tw->mask + 1) {
+        cur = nowtick - tw->mask;
+    }
+
+    tw->running = 1;
+    for (; cur <= nowtick; cur++) {
+        lcb_list_t pending, *slot = tw->slots + (cur & tw->mask);
+
+        /* Entries scheduled by callbacks from here on go after this slot */
+        tw->tick = cur;
+        if (LCB_LIST_IS_EMPTY(slot)) {
+            continue;
+        }
+
+        /* Move the slot's entries to a separate list, so that callbacks may
+         * freely cancel or reschedule any of them */
+        pending.next = slot->next;
+        pending.prev = slot->prev;
+        pending.next->prev = &pending;
+        pending.prev->next = &pending;
+        lcb_list_init(slot);
+
+        while (!LCB_LIST_IS_EMPTY(&pending)) {
+            lcb_list_t *ll = lcb_list_shift(&pending);
+            lcb_TWENTRY *ent = LCB_LIST_ITEM(ll, lcb_TWENTRY, ll);
+
+            if (ent->tick > nowtick) {
+                /* Due in a later rotation */
+                lcb_list_append(slot, ll);
+                continue;
+            }
+            tw->nentries--;
+            ninvoked++;
+            ent->callback(ent->arg);
+        }
+    }
+    tw->running = 0;
+
+    GT_DONE:
+    if (tw->timer) {
+        update_timer(tw, now);
+    }
+    return ninvoked;
+}
@@ -0,0 +1,129 @@
+/* -*- Mode: C; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LCB_TIMEWHEEL_H
+#define LCB_TIMEWHEEL_H
+#include <lcbio/lcbio.h>
+#include <lcbio/timer-ng.h>
+#include "list.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file
+ * @brief Hashed Timing Wheel
+ *
+ * @defgroup LCB_TIMEWHEEL Timing Wheel
+ *
+ * @details
+ * A hashed timing wheel multiplexes many deadlines onto a single I/O timer.
+ * Entries are placed into one of a fixed number of slots according to their
+ * expiry, rounded up to the wheel's resolution, so that scheduling and
+ * cancelling an entry is O(1) regardless of how many entries are pending.
+ * Entries whose expiry lies more than one rotation away share a slot with
+ * nearer entries and are skipped until their expiry is reached.
+ *
+ * The wheel never invokes an entry before its expiry, and invokes it at most
+ * one resolution interval after it.
+ *
+ * @addtogroup LCB_TIMEWHEEL
+ * @{
+ */
+
+typedef void (*lcb_TWCALLBACK)(void *arg);
+
+typedef struct {
+    lcb_list_t ll; /**< Slot membership. NULL if not scheduled */
+    hrtime_t expires; /**< Absolute expiry time */
+    hrtime_t tick; /**< Expiry in units of the wheel resolution */
+    lcb_TWCALLBACK callback;
+    void *arg;
+} lcb_TWENTRY;
+
+typedef struct {
+    lcb_list_t *slots;
+    unsigned mask; /**< Number of slots, minus one */
+    hrtime_t resolution; /**< Length of a slot, in nanoseconds */
+    hrtime_t tick; /**< Last tick which was processed */
+    hrtime_t wakeup; /**< Tick for which the timer is armed, or 0 */
+    unsigned nentries;
+    int running; /**< Whether expired entries are being invoked */
+    lcbio_pTIMER timer;
+} lcb_TIMEWHEEL;
+
+/**
+ * Create a new timing wheel
+ * @param table The table used to create the timer. If NULL, the wheel has no
+ * timer of its own and must be driven using lcb_timewheel_run()
+ * @param nslots The number of slots, rounded up to a power of two
+ * @param resolution the length of each slot, in nanoseconds
+ * @return the new wheel, or NULL on allocation failure
+ */
+lcb_TIMEWHEEL *
+lcb_timewheel_new(lcbio_pTABLE table, unsigned nslots, hrtime_t resolution);
+
+/**
+ * Destroy the wheel. Any scheduled entries are unlinked without being
+ * invoked.
+ */
+void
+lcb_timewheel_destroy(lcb_TIMEWHEEL *tw);
+
+/**
+ * Initialize an entry. This must be called once before the entry is used
+ * @param ent the entry
+ * @param callback invoked with `arg` when the entry expires
+ * @param arg argument for the callback
+ */
+void
+lcb_twentry_init(lcb_TWENTRY *ent, lcb_TWCALLBACK callback, void *arg);
+
+/**
+ * Schedule an entry to expire at the given time. If the entry is already
+ * scheduled, it is moved to the new expiry.
+ * @param tw the wheel
+ * @param ent the entry
+ * @param expires absolute time, as returned by gethrtime()
+ */
+void
+lcb_timewheel_schedule(lcb_TIMEWHEEL *tw, lcb_TWENTRY *ent, hrtime_t expires);
+
+/**
+ * Cancel a scheduled entry. This is a no-op if the entry is not scheduled.
+ */
+void
+lcb_timewheel_cancel(lcb_TIMEWHEEL *tw, lcb_TWENTRY *ent);
+
+/**
+ * Invoke all entries which have expired at `now`. Callbacks may schedule or
+ * cancel any entry, including the one being invoked.
+ * @return the number of entries invoked
+ */
+unsigned
+lcb_timewheel_run(lcb_TIMEWHEEL *tw, hrtime_t now);
+
+/** Check whether an entry is currently scheduled */
+#define lcb_twentry_armed(ent) ((ent)->ll.next != NULL)
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -15,6 +15,7 @@
  *   limitations under the License.
  */
 #include "internal.h"
+#include "lathist.h"
 
 /**
  * Timing data in libcouchbase is stored in a structure to make
@@ -183,3 +184,50 @@ void lcb_record_metrics(lcb_t instance,
     }
     (void)opcode;
 }
+
+void lcb_record_oplatency(mc_SERVER *server, hrtime_t delta, lcb_U8 opcode)
+{
+    lcb_LATENCYHIST *hist;
+    hrtime_t usec = delta / LCB_US2NS(1);
+
+    if (server->latencies == NULL) {
+        server->latencies = calloc(256, sizeof(*server->latencies));
+        if (server->latencies == NULL) {
+            return;
+        }
+    }
+    if ((hist = server->latencies[opcode]) == NULL) {
+        hist = server->latencies[opcode] = calloc(1, sizeof(*hist));
+        if (hist == NULL) {
+            return;
+        }
+    }
+    lcb_lathist_record(hist, usec > 0xffffffff ? 0xffffffff : (lcb_U32)usec);
+}
+
+LIBCOUCHBASE_API
+lcb_error_t lcb_get_latencies(lcb_t instance,
+                              const void *cookie,
+                              lcb_latency_callback callback,
+                              int reset)
+{
+    unsigned ii, jj;
+
+    for (ii = 0; ii < LCBT_NSERVERS(instance); ii++) {
+        mc_SERVER *server = LCBT_GET_SERVER(instance, ii);
+        if (server->latencies == NULL) {
+            continue;
+        }
+        for (jj = 0; jj < 256; jj++) {
+            lcb_LATENCYHIST *hist = server->latencies[jj];
+            if (hist == NULL || hist->count == 0) {
+                continue;
+            }
+            callback(instance, cookie, server->datahost, (lcb_U8)jj, hist);
+            if (reset) {
+                lcb_lathist_reset(hist);
+            }
+        }
+    }
+    return LCB_SUCCESS;
+}
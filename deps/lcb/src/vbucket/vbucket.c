@@ -253,6 +253,40 @@ static int continuum_item_cmp(const void *t1, const void *t2)
     }
 }
 
+/* Builds a table mapping the high bits of a hash to the first continuum
+ * point at or after that prefix. The table has about twice as many entries
+ * as there are points, so a lookup needs to compare against at most a few
+ * points following the indexed one. */
+static int
+build_ketama_radix(lcbvb_CONFIG *cfg)
+{
+    unsigned bits = 8, nbuckets, bb, pp = 0;
+    unsigned *radix;
+
+    while ((1u << bits) < cfg->ncontinuum * 2 && bits < 16) {
+        bits++;
+    }
+    nbuckets = 1u << bits;
+
+    radix = malloc((nbuckets + 1) * sizeof(*radix));
+    if (!radix) {
+        return 0;
+    }
+    for (bb = 0; bb < nbuckets; bb++) {
+        while (pp < cfg->ncontinuum &&
+                (cfg->continuum[pp].point >> (32 - bits)) < bb) {
+            pp++;
+        }
+        radix[bb] = pp;
+    }
+    radix[nbuckets] = cfg->ncontinuum;
+
+    free(cfg->ketama_radix);
+    cfg->ketama_radix = radix;
+    cfg->ketama_shift = 32 - bits;
+    return 1;
+}
+
 static int
 parse_ketama(lcbvb_CONFIG *cfg)
 {
@@ -287,7 +321,7 @@ parse_ketama(lcbvb_CONFIG *cfg)
     cfg->continuum = new_continuum;
     cfg->ncontinuum = pp;
     free(old_continuum);
-    return 1;
+    return build_ketama_radix(cfg);
 }
 
 static int
@@ -646,6 +680,7 @@ lcbvb_destroy(lcbvb_CONFIG *conf)
     }
     free(conf->servers);
     free(conf->continuum);
+    free(conf->ketama_radix);
     free(conf->buuid);
     free(conf->bname);
     free(conf->vbuckets);
@@ -747,48 +782,27 @@ lcbvb_save_json(lcbvb_CONFIG *cfg)
 static int
 map_ketama(lcbvb_CONFIG *cfg, const void *key, size_t nkey)
 {
-    uint32_t digest, mid, prev;
-    lcbvb_CONTINUUM *beginp, *endp, *midp, *highp, *lowp;
+    uint32_t digest, prefix;
+    unsigned ix, end;
     assert(cfg->continuum);
+    assert(cfg->ketama_radix);
     digest = vb__hash_ketama(key, nkey);
-    beginp = lowp = cfg->continuum;
-    endp = highp = cfg->continuum + cfg->ncontinuum;
-
-    /* divide and conquer array search to find server with next biggest
-     * point after what this key hashes to */
-    while (1)
-    {
-        /* pick the middle point */
-        midp = lowp + (highp - lowp) / 2;
-
-        if (midp == endp) {
-            /* if at the end, roll back to zeroth */
-            return beginp->index;
-            break;
-        }
-
-        mid = midp->point;
-        prev = (midp == beginp) ? 0 : (midp-1)->point;
 
-        if (digest <= mid && digest > prev) {
-            /* we found nearest server */
-            return midp->index;
-            break;
-        }
-
-        /* adjust the limits */
-        if (mid < digest) {
-            lowp = midp + 1;
-        } else {
-            highp = midp - 1;
-        }
+    /* find the server with the next biggest point after what this key
+     * hashes to. The radix table narrows this down to the few points
+     * sharing the digest's prefix */
+    prefix = digest >> cfg->ketama_shift;
+    ix = cfg->ketama_radix[prefix];
+    end = cfg->ketama_radix[prefix + 1];
+    while (ix < end && cfg->continuum[ix].point < digest) {
+        ix++;
+    }
 
-        if (lowp > highp) {
-            return beginp->index;
-            break;
-        }
+    if (ix == cfg->ncontinuum) {
+        /* if at the end, roll back to zeroth */
+        ix = 0;
     }
-    return -1;
+    return cfg->continuum[ix].index;
 }
 
 int
@@ -798,6 +812,17 @@ lcbvb_k2vb(lcbvb_CONFIG *cfg, const void *k, lcb_SIZE n)
     return digest % cfg->nvb;
 }
 
+void
+lcbvb_k2vb_many(lcbvb_CONFIG *cfg, const void * const *keys,
+    const lcb_SIZE *sizes, lcb_SIZE nkeys, int *vbids)
+{
+    lcb_SIZE ii;
+    unsigned nvb = cfg->nvb;
+    for (ii = 0; ii < nkeys; ii++) {
+        vbids[ii] = hash_crc32(keys[ii], sizes[ii]) % nvb;
+    }
+}
+
 int
 lcbvb_vbmaster(lcbvb_CONFIG *cfg, int vbid)
 {
@@ -881,11 +906,24 @@ lcbvb_compare(lcbvb_CONFIG *from, lcbvb_CONFIG *to)
     }
 
     if (from->nvb == to->nvb) {
+        /* Left NULL if it cannot be allocated; callers then treat every
+         * vBucket as possibly moved */
+        ret->vbs_moved = calloc(from->nvb ? from->nvb : 1, 1);
         for (ii = 0; ii < from->nvb; ii++) {
             lcbvb_VBUCKET *vba = from->vbuckets + ii, *vbb = to->vbuckets + ii;
-            if (vba->servers[0] != vbb->servers[0]) {
+            int ma = vba->servers[0], mb = vbb->servers[0];
+            if (ma != mb) {
                 ret->n_vb_changes++;
             }
+            if (!ret->vbs_moved) {
+                continue;
+            }
+            if (ma < 0 || mb < 0 || !ret->sequence_changed) {
+                ret->vbs_moved[ii] = ma != mb;
+            } else {
+                ret->vbs_moved[ii] = 0 != strcmp(from->servers[ma].authority,
+                    to->servers[mb].authority);
+            }
         }
     } else {
         ret->n_vb_changes = -1;
@@ -908,6 +946,7 @@ lcbvb_free_diff(lcbvb_CONFIGDIFF *diff) {
     assert(diff);
     free_array_helper(diff->servers_added);
     free_array_helper(diff->servers_removed);
+    free(diff->vbs_moved);
     free(diff);
 }
 
@@ -32,10 +32,16 @@ has_pending(lcb_t instance)
     }
 
     for (ii = 0; ii < LCBT_NSERVERS(instance); ii++) {
+        unsigned jj;
         lcb_server_t *ss = LCBT_GET_SERVER(instance, ii);
         if (mcserver_has_pending(ss)) {
             return 1;
         }
+        for (jj = 0; jj < ss->pipeline.nlanes; jj++) {
+            if (mcserver_has_pending((lcb_server_t *)ss->pipeline.lanes[jj])) {
+                return 1;
+            }
+        }
     }
     return 0;
 }
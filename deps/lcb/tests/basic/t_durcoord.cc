@@ -0,0 +1,224 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "config.h"
+#include <gtest/gtest.h>
+#include "internal.h"
+#include "bucketconfig/clconfig.h"
+#include "operations/durability_internal.h"
+#include <map>
+#include <string>
+#include <vector>
+
+#define NVBUCKETS 64
+#define MS 1000000
+
+typedef std::map<std::string, unsigned> KeyCounts;
+
+extern "C" {
+static void durability_callback(lcb_t, const void *cookie, lcb_error_t,
+                                const lcb_durability_resp_t *resp)
+{
+    KeyCounts *done = (KeyCounts *)cookie;
+    (*done)[std::string((const char *)resp->v.v0.key, resp->v.v0.nkey)]++;
+}
+}
+
+class DurabilityCoord : public ::testing::Test
+{
+protected:
+    virtual void SetUp() {
+        ASSERT_EQ(LCB_SUCCESS, lcb_create(&instance, NULL));
+        lcb_set_durability_callback(instance, durability_callback);
+
+        lcbvb_CONFIG *vbc = lcbvb_create();
+        ASSERT_EQ(0, lcbvb_genconfig(vbc, 4, 1, NVBUCKETS));
+        char *js = lcbvb_save_json(vbc);
+        lcbvb_destroy(vbc);
+        vbc = lcbvb_create();
+        ASSERT_EQ(0, lcbvb_load_json(vbc, js));
+        free(js);
+
+        // Generated configs have the replica on the master itself
+        for (unsigned ii = 0; ii < vbc->nvb; ii++) {
+            lcbvb_VBUCKET *vb = vbc->vbuckets + ii;
+            vb->servers[1] = (vb->servers[0] + 1) % vbc->nsrv;
+        }
+        clconfig_info *info = lcb_clconfig_create(vbc, LCB_CLCONFIG_USER);
+        lcb_update_vbconfig(instance, info);
+        lcb_clconfig_decref(info);
+    }
+
+    virtual void TearDown() {
+        lcb_destroy(instance);
+    }
+
+    void poll(KeyCounts *done, const char *key1, const char *key2 = NULL) {
+        lcb_durability_opts_t opts;
+        lcb_durability_cmd_t cmds[2];
+        const lcb_durability_cmd_t *cmdlist[] = { cmds, cmds + 1 };
+        memset(&opts, 0, sizeof opts);
+        memset(cmds, 0, sizeof cmds);
+        opts.v.v0.persist_to = 1;
+        cmds[0].v.v0.key = key1;
+        cmds[0].v.v0.nkey = strlen(key1);
+        if (key2) {
+            cmds[1].v.v0.key = key2;
+            cmds[1].v.v0.nkey = strlen(key2);
+        }
+        ASSERT_EQ(LCB_SUCCESS,
+                  lcb_durability_poll(instance, done, &opts, key2 ? 2 : 1, cmdlist));
+    }
+
+    // Counts the OBSERVE packets queued for each node, and the keys in them
+    unsigned countKeys(std::vector<unsigned>& npackets) {
+        mc_CMDQUEUE *cq = &instance->cmdq;
+        unsigned nkeys = 0;
+        npackets.assign(cq->npipelines, 0);
+        for (unsigned ii = 0; ii < cq->npipelines; ii++) {
+            lcb_list_t *ll;
+            LCB_LIST_FOR(ll, &cq->pipelines[ii]->requests) {
+                mc_PACKET *pkt = LCB_LIST_ITEM(ll, mc_PACKET, llnode);
+                protocol_binary_request_header hdr;
+                memcpy(&hdr, SPAN_BUFFER(&pkt->kh_span), sizeof hdr.bytes);
+                if (hdr.request.opcode != PROTOCOL_BINARY_CMD_OBSERVE) {
+                    continue;
+                }
+                npackets[ii]++;
+
+                const char *ptr = SPAN_BUFFER(&pkt->u_value.single);
+                const char *end = ptr + pkt->u_value.single.size;
+                while (ptr < end) {
+                    lcb_uint16_t nkey;
+                    memcpy(&nkey, ptr + 2, sizeof nkey);
+                    ptr += 4 + ntohs(nkey);
+                    nkeys++;
+                }
+            }
+        }
+        return nkeys;
+    }
+
+    lcb_durability_batch_t *getBatch() {
+        lcb_list_t *ll = instance->durcoord->batches.next;
+        if (ll == &instance->durcoord->batches) {
+            return NULL;
+        }
+        return LCB_LIST_ITEM(ll, lcb_durability_batch_t, ll);
+    }
+
+    void respond(lcb_durability_batch_t *batch, const char *key) {
+        lcb_observe_resp_t resp;
+        memset(&resp, 0, sizeof resp);
+        if (key) {
+            resp.v.v0.key = key;
+            resp.v.v0.nkey = strlen(key);
+            resp.v.v0.status = LCB_OBSERVE_PERSISTED;
+            resp.v.v0.from_master = 1;
+        }
+        lcb_durability_batch_update(instance, batch, LCB_SUCCESS, &resp);
+    }
+
+    lcb_t instance;
+};
+
+TEST_F(DurabilityCoord, testMergesSets)
+{
+    const unsigned nsets = 40;
+    KeyCounts done;
+    char keys[nsets][32];
+    for (unsigned ii = 0; ii < nsets; ii++) {
+        sprintf(keys[ii], "Key_%u", ii);
+        poll(&done, keys[ii]);
+    }
+    lcb_durability_coord_tick(instance->durcoord);
+
+    // One packet per node, holding the keys of every set
+    std::vector<unsigned> npackets;
+    ASSERT_EQ(nsets * 2, countKeys(npackets));
+    for (unsigned ii = 0; ii < npackets.size(); ii++) {
+        ASSERT_EQ(1, npackets[ii]);
+    }
+
+    lcb_durability_batch_t *batch = getBatch();
+    ASSERT_TRUE(batch != NULL);
+    ASSERT_EQ(nsets, batch->ndsets);
+
+    // Sets are not polled again until the batch completes
+    lcb_durability_coord_tick(instance->durcoord);
+    ASSERT_EQ(nsets * 2, countKeys(npackets));
+    ASSERT_TRUE(done.empty());
+}
+
+TEST_F(DurabilityCoord, testSharedKey)
+{
+    KeyCounts done;
+    poll(&done, "foo");
+    poll(&done, "foo");
+    poll(&done, "foo", "bar");
+    lcb_durability_coord_tick(instance->durcoord);
+
+    std::vector<unsigned> npackets;
+    ASSERT_EQ(4, countKeys(npackets));
+    lcb_durability_batch_t *batch = getBatch();
+    ASSERT_EQ(3, batch->ndsets);
+    ASSERT_EQ(2, batch->nentries);
+
+    // A single response completes the key in all the sets
+    respond(batch, "foo");
+    ASSERT_EQ(3, done["foo"]);
+    ASSERT_EQ(0, done["bar"]);
+    ASSERT_NE(0, instance->durcoord->latency);
+
+    // Only the set still waiting for a key remains, and is polled again later
+    respond(batch, NULL);
+    ASSERT_TRUE(getBatch() == NULL);
+    lcb_list_t *ll = instance->durcoord->dsets.next;
+    ASSERT_EQ(&instance->durcoord->dsets, ll->next);
+    lcb_durability_set_t *dset = LCB_LIST_ITEM(ll, lcb_durability_set_t, ll);
+    ASSERT_EQ(1, dset->nremaining);
+    ASSERT_GT(dset->ns_next, gethrtime());
+}
+
+TEST_F(DurabilityCoord, testWaitsForExpectedLatency)
+{
+    KeyCounts done;
+    poll(&done, "first");
+    lcb_durability_set_t *first = LCB_LIST_ITEM(
+        instance->durcoord->dsets.next, lcb_durability_set_t, ll);
+    instance->durcoord->latency = 40 * MS;
+
+    // The first poll of a new set is aimed just before it is expected to be done
+    poll(&done, "second");
+    hrtime_t now = gethrtime();
+    lcb_durability_set_t *second = LCB_LIST_ITEM(
+        instance->durcoord->dsets.prev, lcb_durability_set_t, ll);
+    ASSERT_GT(second->ns_next, now + 20 * MS);
+    ASSERT_LE(second->ns_next, now + 30 * MS);
+
+    lcb_durability_coord_tick(instance->durcoord);
+    lcb_durability_batch_t *batch = getBatch();
+    ASSERT_EQ(1, batch->ndsets);
+    ASSERT_EQ(first, batch->dsets[0]);
+
+    // Once a set is late, it backs off from the shortest interval
+    first->start -= 100 * MS;
+    respond(batch, NULL);
+    now = gethrtime();
+    ASSERT_EQ(1, first->nlate);
+    ASSERT_LE(first->ns_next, now + 1 * MS);
+    ASSERT_LT(first->ns_next, second->ns_next);
+}
@@ -0,0 +1,74 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "config.h"
+#include <gtest/gtest.h>
+#include <libcouchbase/couchbase.h>
+#include "lathist.h"
+
+class LatencyHistogram : public ::testing::Test
+{
+};
+
+TEST_F(LatencyHistogram, testBuckets)
+{
+    unsigned prev = 0;
+    // Buckets are contiguous and increase with the value
+    for (lcb_U32 ii = 0; ii < 1000000; ii++) {
+        unsigned cur = lcb_lathist_bucket(ii);
+        ASSERT_TRUE(cur == prev || cur == prev + 1);
+        prev = cur;
+    }
+    ASSERT_EQ(LCB_LATHIST_NBUCKETS - 1, lcb_lathist_bucket(0xffffffff));
+    ASSERT_LT(lcb_lathist_bucket(0x80000000), LCB_LATHIST_NBUCKETS);
+}
+
+TEST_F(LatencyHistogram, testPercentiles)
+{
+    lcb_LATENCYHIST hist;
+    lcb_lathist_reset(&hist);
+    ASSERT_EQ(0, lcb_lathist_percentile(&hist, 50));
+
+    for (lcb_U32 ii = 1; ii <= 100000; ii++) {
+        lcb_lathist_record(&hist, ii);
+    }
+    ASSERT_EQ(100000, lcb_lathist_count(&hist));
+    ASSERT_EQ(1, lcb_lathist_min(&hist));
+    ASSERT_EQ(100000, lcb_lathist_max(&hist));
+    ASSERT_DOUBLE_EQ(50000.5, lcb_lathist_mean(&hist));
+
+    // Within the precision of the buckets, and never below the exact value
+    double pcts[] = { 50, 90, 99, 99.9 };
+    for (size_t ii = 0; ii < sizeof(pcts)/sizeof(pcts[0]); ii++) {
+        double exact = pcts[ii] * 1000;
+        lcb_U32 val = lcb_lathist_percentile(&hist, pcts[ii]);
+        ASSERT_GE(val, exact);
+        ASSERT_LE(val, exact * 1.04);
+    }
+    ASSERT_EQ(100000, lcb_lathist_percentile(&hist, 100));
+
+    // Outliers are reported at the tail
+    lcb_lathist_reset(&hist);
+    for (int ii = 0; ii < 999; ii++) {
+        lcb_lathist_record(&hist, 100);
+    }
+    lcb_lathist_record(&hist, 5000000);
+    ASSERT_EQ(lcb_lathist_percentile(&hist, 50),
+        lcb_lathist_percentile(&hist, 99.9));
+    ASSERT_GE(lcb_lathist_percentile(&hist, 50), 100);
+    ASSERT_LE(lcb_lathist_percentile(&hist, 50), 104);
+    ASSERT_EQ(5000000, lcb_lathist_percentile(&hist, 99.99));
+}
@@ -444,3 +444,157 @@ TEST_F(NetbufTest, testOutOfOrder)
 
     clean_check(&mgr);
 }
+
+TEST_F(NetbufTest, testOutOfOrderChain)
+{
+    nb_MGR mgr;
+    nb_SPAN spans[4];
+    int ii;
+
+    netbuf_init(&mgr, NULL);
+    for (ii = 0; ii < 4; ii++) {
+        spans[ii].size = 10;
+        ASSERT_EQ(0, netbuf_mblock_reserve(&mgr, spans + ii));
+    }
+
+    // The third span is queued before the second, so releasing the first
+    // must apply the queued releases more than once
+    netbuf_mblock_release(&mgr, &spans[2]);
+    netbuf_mblock_release(&mgr, &spans[3]);
+    netbuf_mblock_release(&mgr, &spans[1]);
+    netbuf_mblock_release(&mgr, &spans[0]);
+    clean_check(&mgr);
+}
+
+TEST_F(NetbufTest, testOutOfOrderWrapped)
+{
+    nb_MGR mgr;
+    nb_SPAN spans[5];
+    const nb_SIZE sizes[] = { 20000, 5000, 5000, 15000, 1000 };
+    int ii;
+
+    netbuf_init(&mgr, NULL);
+    for (ii = 0; ii < 3; ii++) {
+        spans[ii].size = sizes[ii];
+        ASSERT_EQ(0, netbuf_mblock_reserve(&mgr, spans + ii));
+    }
+    netbuf_mblock_release(&mgr, &spans[0]);
+
+    // These wrap around to the front of the block
+    for (ii = 3; ii < 5; ii++) {
+        spans[ii].size = sizes[ii];
+        ASSERT_EQ(0, netbuf_mblock_reserve(&mgr, spans + ii));
+    }
+    ASSERT_EQ(0, spans[3].offset);
+
+    // The queued span at the end of the block is released before the one at
+    // its front, even though its offset is higher
+    netbuf_mblock_release(&mgr, &spans[3]);
+    netbuf_mblock_release(&mgr, &spans[2]);
+    netbuf_mblock_release(&mgr, &spans[1]);
+    netbuf_mblock_release(&mgr, &spans[4]);
+    clean_check(&mgr);
+}
+
+TEST_F(NetbufTest, testStats)
+{
+    nb_MGR mgr;
+    nb_MBSTATS st;
+    nb_SPAN spans[6];
+
+    netbuf_init(&mgr, NULL);
+    spans[0].size = 20000;
+    spans[1].size = 10000;
+    netbuf_mblock_reserve(&mgr, &spans[0]);
+    netbuf_mblock_reserve(&mgr, &spans[1]);
+    netbuf_get_stats(&mgr, &st);
+    ASSERT_EQ(1, st.blocks_alloc);
+    ASSERT_EQ(NB_DATA_BASEALLOC, st.bytes_held);
+    ASSERT_EQ(NB_DATA_BASEALLOC, st.basealloc);
+
+    // Not enough room at the end, but enough at the start
+    netbuf_mblock_release(&mgr, &spans[0]);
+    spans[2].size = 15000;
+    netbuf_mblock_reserve(&mgr, &spans[2]);
+    netbuf_get_stats(&mgr, &st);
+    ASSERT_EQ(1, st.wraps);
+    ASSERT_EQ(0, st.fallbacks);
+
+    // Too large for the active block
+    spans[3].size = 40000;
+    netbuf_mblock_reserve(&mgr, &spans[3]);
+    netbuf_get_stats(&mgr, &st);
+    ASSERT_EQ(1, st.fallbacks);
+    ASSERT_EQ(1, st.oversized);
+    ASSERT_EQ(2, st.blocks_alloc);
+    ASSERT_EQ(NB_DATA_BASEALLOC * 3, st.bytes_held);
+
+    // Released out of order
+    spans[4].size = 100;
+    spans[5].size = 100;
+    netbuf_mblock_reserve(&mgr, &spans[4]);
+    netbuf_mblock_reserve(&mgr, &spans[5]);
+    netbuf_mblock_release(&mgr, &spans[4]);
+    netbuf_get_stats(&mgr, &st);
+    ASSERT_EQ(1, st.deallocs);
+    ASSERT_EQ(1, st.dealloc_depth);
+
+    netbuf_mblock_release(&mgr, &spans[3]);
+    netbuf_mblock_release(&mgr, &spans[5]);
+    netbuf_mblock_release(&mgr, &spans[1]);
+    netbuf_mblock_release(&mgr, &spans[2]);
+    netbuf_get_stats(&mgr, &st);
+    ASSERT_EQ(0, st.dealloc_depth);
+    ASSERT_EQ(1, st.dealloc_maxdepth);
+    ASSERT_EQ(2, st.blocks_freed);
+    ASSERT_EQ(0, st.bytes_held);
+    clean_check(&mgr);
+}
+
+TEST_F(NetbufTest, testAdaptive)
+{
+    nb_MGR mgr;
+    nb_SETTINGS settings;
+    nb_MBSTATS st;
+    nb_SPAN span;
+    unsigned ii;
+
+    // A fixed size pool allocates a block for each large span
+    netbuf_init(&mgr, NULL);
+    for (ii = 0; ii < 1000; ii++) {
+        span.size = 100000;
+        netbuf_mblock_reserve(&mgr, &span);
+        netbuf_mblock_release(&mgr, &span);
+    }
+    netbuf_get_stats(&mgr, &st);
+    ASSERT_EQ(1000, st.blocks_alloc);
+    clean_check(&mgr);
+
+    netbuf_default_settings(&settings);
+    settings.data_maxalloc = 1 << 21;
+    netbuf_init(&mgr, &settings);
+    for (ii = 0; ii < 1000; ii++) {
+        span.size = 100000;
+        netbuf_mblock_reserve(&mgr, &span);
+        netbuf_mblock_release(&mgr, &span);
+    }
+    netbuf_get_stats(&mgr, &st);
+    ASSERT_EQ(1, st.grows);
+    ASSERT_EQ(131072 * 8, st.basealloc);
+    // Only the spans seen before growing needed their own block
+    ASSERT_LE(st.blocks_alloc, 260);
+    ASSERT_GT(st.blocks_reused, 700);
+    ASSERT_EQ(st.basealloc, st.bytes_held);
+
+    // Falls back to the base size once the large spans stop
+    for (ii = 0; ii < 10000; ii++) {
+        span.size = 100;
+        netbuf_mblock_reserve(&mgr, &span);
+        netbuf_mblock_release(&mgr, &span);
+    }
+    netbuf_get_stats(&mgr, &st);
+    ASSERT_GT(st.shrinks, 0);
+    ASSERT_EQ(NB_DATA_BASEALLOC, st.basealloc);
+    ASSERT_EQ(NB_DATA_BASEALLOC, st.bytes_held);
+    clean_check(&mgr);
+}
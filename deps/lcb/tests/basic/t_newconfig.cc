@@ -0,0 +1,182 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "config.h"
+#include <gtest/gtest.h>
+#include "internal.h"
+#include "bucketconfig/clconfig.h"
+#include <set>
+
+#define NVBUCKETS 1024
+
+class NewConfig : public ::testing::Test
+{
+protected:
+    virtual void SetUp() {
+        ASSERT_EQ(LCB_SUCCESS, lcb_create(&instance, NULL));
+        apply(genConfig(4));
+    }
+
+    virtual void TearDown() {
+        lcb_destroy(instance);
+    }
+
+    // The instance takes ownership of the config
+    void apply(lcbvb_CONFIG *vbc) {
+        clconfig_info *info = lcb_clconfig_create(vbc, LCB_CLCONFIG_USER);
+        lcb_update_vbconfig(instance, info);
+        lcb_clconfig_decref(info);
+    }
+
+    lcbvb_CONFIG *copyConfig(lcbvb_CONFIG *orig) {
+        char *js = lcbvb_save_json(orig);
+        lcbvb_CONFIG *vbc = lcbvb_create();
+        EXPECT_EQ(0, lcbvb_load_json(vbc, js));
+        free(js);
+        return vbc;
+    }
+
+    // Generated configs only have node addresses once loaded from JSON
+    lcbvb_CONFIG *genConfig(unsigned nservers) {
+        lcbvb_CONFIG *vbc = lcbvb_create();
+        EXPECT_EQ(0, lcbvb_genconfig(vbc, nservers, 1, NVBUCKETS));
+        lcbvb_CONFIG *ret = copyConfig(vbc);
+        lcbvb_destroy(vbc);
+        return ret;
+    }
+
+    // A step of a rebalance: some vBuckets move to the next node
+    lcbvb_CONFIG *moveVbuckets(const std::set<int>& vbs) {
+        lcbvb_CONFIG *vbc = copyConfig(LCBT_VBCONFIG(instance));
+        for (std::set<int>::const_iterator it = vbs.begin(); it != vbs.end(); ++it) {
+            lcbvb_VBUCKET *vb = vbc->vbuckets + *it;
+            vb->servers[1] = vb->servers[0];
+            vb->servers[0] = (vb->servers[0] + 1) % vbc->nsrv;
+        }
+        return vbc;
+    }
+
+    void schedule(unsigned nkeys) {
+        lcb_sched_enter(instance);
+        for (unsigned ii = 0; ii < nkeys; ii++) {
+            char key[64];
+            lcb_CMDGET cmd;
+            memset(&cmd, 0, sizeof cmd);
+            size_t nkey = sprintf(key, "Key_%u", ii);
+            LCB_KREQ_SIMPLE(&cmd.key, key, nkey);
+            ASSERT_EQ(LCB_SUCCESS, lcb_get3(instance, NULL, &cmd));
+        }
+        lcb_sched_leave(instance);
+    }
+
+    unsigned countKeys(unsigned nkeys, const std::set<int>& vbs) {
+        unsigned n = 0;
+        for (unsigned ii = 0; ii < nkeys; ii++) {
+            char key[64];
+            size_t nkey = sprintf(key, "Key_%u", ii);
+            int vbid, srvix;
+            lcbvb_map_key(LCBT_VBCONFIG(instance), key, nkey, &vbid, &srvix);
+            n += vbs.count(vbid);
+        }
+        return n;
+    }
+
+    // Checks that every packet is queued for its vBucket's master
+    unsigned checkPlacement() {
+        mc_CMDQUEUE *cq = &instance->cmdq;
+        unsigned npackets = 0;
+        for (unsigned ii = 0; ii < cq->npipelines; ii++) {
+            mc_PIPELINE *pl = cq->pipelines[ii];
+            lcb_list_t *ll;
+            LCB_LIST_FOR(ll, &pl->requests) {
+                mc_PACKET *pkt = LCB_LIST_ITEM(ll, mc_PACKET, llnode);
+                protocol_binary_request_header hdr;
+                memcpy(&hdr, SPAN_BUFFER(&pkt->kh_span), sizeof hdr.bytes);
+                EXPECT_EQ((int)ii, lcbvb_vbmaster(cq->config,
+                                                  ntohs(hdr.request.vbucket)));
+                npackets++;
+            }
+        }
+        return npackets;
+    }
+
+    lcb_CONFIGSTATS getStats() {
+        lcb_CONFIGSTATS stats;
+        EXPECT_EQ(LCB_SUCCESS,
+                  lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_CONFIGSTATS, &stats));
+        return stats;
+    }
+
+    lcb_t instance;
+};
+
+TEST_F(NewConfig, testRelocatesMovedOnly)
+{
+    const unsigned nkeys = 2000;
+    std::set<int> vbs;
+    for (int ii = 0; ii < NVBUCKETS; ii += 100) {
+        vbs.insert(ii);
+    }
+
+    schedule(nkeys);
+    ASSERT_EQ(nkeys, checkPlacement());
+    unsigned nmoved = countKeys(nkeys, vbs);
+    unsigned nfirst = instance->cmdq.pipelines[0]->opindex_count;
+    ASSERT_GT(nmoved, 0);
+
+    // All the moved vBuckets were on the first node
+    apply(moveVbuckets(vbs));
+    lcb_CONFIGSTATS stats = getStats();
+    ASSERT_EQ(1, stats.napplied);
+    ASSERT_EQ(nmoved, stats.nrelocated);
+    ASSERT_EQ(nfirst, stats.nexamined);
+    ASSERT_EQ(nkeys - nfirst, stats.nskipped);
+    ASSERT_EQ(stats.ns_last, stats.ns_total);
+    ASSERT_EQ(nkeys, checkPlacement());
+}
+
+TEST_F(NewConfig, testRemovedServer)
+{
+    const unsigned nkeys = 2000;
+    schedule(nkeys);
+    unsigned nlast = instance->cmdq.pipelines[3]->opindex_count;
+
+    apply(genConfig(3));
+
+    lcb_CONFIGSTATS stats = getStats();
+    ASSERT_EQ(1, stats.napplied);
+    ASSERT_GE(stats.nexamined + stats.nskipped, nkeys);
+    ASSERT_GE(stats.nrelocated, nlast);
+    ASSERT_EQ(nkeys, checkPlacement());
+}
+
+TEST_F(NewConfig, DISABLED_benchRebalanceStep)
+{
+    const unsigned nkeys = 50000;
+    std::set<int> vbs;
+    for (int ii = 0; ii < 8; ii++) {
+        vbs.insert(ii * 4);
+    }
+    schedule(nkeys);
+
+    apply(moveVbuckets(vbs));
+    lcb_CONFIGSTATS stats = getStats();
+    printf("%u queued, %u vBuckets moved: %lu relocated, %lu checked, "
+           "%lu not checked in %lu us\n", nkeys, (unsigned)vbs.size(),
+           (unsigned long)stats.nrelocated, (unsigned long)stats.nexamined,
+           (unsigned long)stats.nskipped, (unsigned long)(stats.ns_last / 1000));
+    ASSERT_EQ(nkeys, checkPlacement());
+}
@@ -0,0 +1,153 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "config.h"
+#include <gtest/gtest.h>
+#include <libcouchbase/couchbase.h>
+#include "http/qnodes.h"
+#include <vector>
+
+#define MS 1000000
+
+class QNodes : public ::testing::Test
+{
+protected:
+    virtual void SetUp() {
+        qn = lcb_qnodes_new();
+        now = 1;
+    }
+    virtual void TearDown() {
+        lcb_qnodes_destroy(qn);
+    }
+
+    // Picks a node and completes the query right away with the given latency
+    int query(const hrtime_t *latencies) {
+        int ix = lcb_qnodes_pick(qn);
+        now += latencies[ix];
+        lcb_qnodes_sample(qn, ix, qn->generation, latencies[ix], now);
+        lcb_qnodes_release(qn, ix, qn->generation);
+        return ix;
+    }
+
+    lcb_QNODES *qn;
+    hrtime_t now;
+};
+
+TEST_F(QNodes, testParse)
+{
+    ASSERT_EQ(-1, lcb_qnodes_pick(qn));
+    ASSERT_EQ(LCB_SUCCESS, lcb_qnodes_set(qn, "n1:9000;n2"));
+    ASSERT_EQ(2, qn->nnodes);
+    ASSERT_STREQ("n1:9000", qn->nodes[0].hoststr);
+    ASSERT_STREQ("n2:8093", qn->nodes[1].hoststr);
+
+    // A bad list leaves the current one in place
+    ASSERT_NE(LCB_SUCCESS, lcb_qnodes_set(qn, "n3:bad:port"));
+    ASSERT_EQ(2, qn->nnodes);
+
+    ASSERT_EQ(LCB_SUCCESS, lcb_qnodes_set(qn, ""));
+    ASSERT_EQ(0, qn->nnodes);
+    ASSERT_EQ(-1, lcb_qnodes_pick(qn));
+}
+
+TEST_F(QNodes, testPrefersFaster)
+{
+    hrtime_t latencies[] = { 10 * MS, 2 * MS, 30 * MS };
+    std::vector<unsigned> counts(3);
+    ASSERT_EQ(LCB_SUCCESS, lcb_qnodes_set(qn, "n1;n2;n3"));
+
+    for (unsigned ii = 0; ii < 160; ii++) {
+        counts[query(latencies)]++;
+    }
+    // Everything but the probes goes to the fastest node
+    ASSERT_GE(counts[1], 140);
+    ASSERT_GT(counts[0], 0);
+    ASSERT_GT(counts[2], 0);
+}
+
+TEST_F(QNodes, testSpreadsByInflight)
+{
+    ASSERT_EQ(LCB_SUCCESS, lcb_qnodes_set(qn, "n1;n2"));
+    lcb_qnodes_sample(qn, 0, qn->generation, 1 * MS, now);
+    lcb_qnodes_sample(qn, 1, qn->generation, 3 * MS, now);
+
+    // While queries are outstanding, the faster node takes three times as many
+    for (unsigned ii = 0; ii < 8; ii++) {
+        lcb_qnodes_pick(qn);
+    }
+    ASSERT_EQ(6, qn->nodes[0].inflight);
+    ASSERT_EQ(2, qn->nodes[1].inflight);
+}
+
+TEST_F(QNodes, testUnmeasuredFirst)
+{
+    ASSERT_EQ(LCB_SUCCESS, lcb_qnodes_set(qn, "n1;n2;n3"));
+    lcb_qnodes_sample(qn, 0, qn->generation, 1 * MS, now);
+
+    int a = lcb_qnodes_pick(qn);
+    int b = lcb_qnodes_pick(qn);
+    ASSERT_NE(0, a);
+    ASSERT_NE(0, b);
+    ASSERT_NE(a, b);
+}
+
+TEST_F(QNodes, testFailureAndRecovery)
+{
+    hrtime_t latencies[] = { 2 * MS, 5 * MS };
+    ASSERT_EQ(LCB_SUCCESS, lcb_qnodes_set(qn, "n1;n2"));
+    lcb_qnodes_sample(qn, 0, qn->generation, latencies[0], now);
+    lcb_qnodes_sample(qn, 1, qn->generation, latencies[1], now);
+
+    // The first node fails quickly; it still gets a penalty
+    int ix = lcb_qnodes_pick(qn);
+    ASSERT_EQ(0, ix);
+    lcb_qnodes_fail(qn, ix, qn->generation, 1000, ++now);
+    lcb_qnodes_release(qn, ix, qn->generation);
+    ASSERT_EQ(LCB_QNODES_FAIL_PENALTY, qn->nodes[0].latency);
+    ASSERT_NE(0, qn->nodes[0].failed);
+
+    // Nothing is sent to it until it is probed
+    unsigned npicks = 1;
+    while (query(latencies) != 0) {
+        npicks++;
+        ASSERT_LT(npicks, LCB_QNODES_PROBE_INTERVAL);
+    }
+    ASSERT_EQ(LCB_QNODES_PROBE_INTERVAL, npicks + 1);
+
+    // And its recovery is taken as is
+    ASSERT_EQ(latencies[0], qn->nodes[0].latency);
+    ASSERT_EQ(0, qn->nodes[0].failed);
+    ASSERT_EQ(0, query(latencies));
+}
+
+TEST_F(QNodes, testReplaceList)
+{
+    ASSERT_EQ(LCB_SUCCESS, lcb_qnodes_set(qn, "n1;n2"));
+    lcb_qnodes_sample(qn, 1, qn->generation, 4 * MS, now);
+    int ix = lcb_qnodes_pick(qn);
+    unsigned oldgen = qn->generation;
+
+    ASSERT_EQ(LCB_SUCCESS, lcb_qnodes_set(qn, "n2;n3"));
+    ASSERT_EQ(4 * MS, qn->nodes[0].latency);
+    ASSERT_EQ(0, qn->nodes[1].latency);
+
+    // Queries sent before the change are not counted against the new list
+    lcb_qnodes_fail(qn, ix, oldgen, 1, now);
+    lcb_qnodes_release(qn, ix, oldgen);
+    ASSERT_EQ(4 * MS, qn->nodes[0].latency);
+    ASSERT_EQ(0, qn->nodes[0].inflight);
+    ASSERT_EQ(0, qn->nodes[1].inflight);
+}
@@ -0,0 +1,241 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "config.h"
+#include <gtest/gtest.h>
+#include <libcouchbase/couchbase.h>
+#include "timewheel.h"
+#include <vector>
+#include <cstdio>
+#include <ctime>
+
+#define RES 1000000 /* 1ms */
+
+struct TestEntry {
+    lcb_TWENTRY tw;
+    lcb_TIMEWHEEL *wheel;
+    hrtime_t firedAt;
+    unsigned nfired;
+    TestEntry *cancelOther;
+    hrtime_t rescheduleTo;
+};
+
+static hrtime_t curNow;
+
+static void
+entryCallback(void *arg)
+{
+    TestEntry *ent = (TestEntry *)arg;
+    ent->firedAt = curNow;
+    ent->nfired++;
+    if (ent->cancelOther) {
+        lcb_timewheel_cancel(ent->wheel, &ent->cancelOther->tw);
+    }
+    if (ent->rescheduleTo) {
+        hrtime_t when = ent->rescheduleTo;
+        ent->rescheduleTo = 0;
+        lcb_timewheel_schedule(ent->wheel, &ent->tw, when);
+    }
+}
+
+class TimeWheel : public ::testing::Test
+{
+protected:
+    virtual void SetUp() {
+        wheel = lcb_timewheel_new(NULL, 16, RES);
+        // Align to the resolution so expiries fall exactly on slots
+        base = (gethrtime() / RES + 1) * RES;
+    }
+    virtual void TearDown() {
+        lcb_timewheel_destroy(wheel);
+    }
+    void initEntry(TestEntry *ent) {
+        memset(ent, 0, sizeof(*ent));
+        ent->wheel = wheel;
+        lcb_twentry_init(&ent->tw, entryCallback, ent);
+    }
+    unsigned runAt(hrtime_t now) {
+        curNow = now;
+        return lcb_timewheel_run(wheel, now);
+    }
+
+    lcb_TIMEWHEEL *wheel;
+    hrtime_t base;
+};
+
+TEST_F(TimeWheel, testBasic)
+{
+    TestEntry e1, e2, e3;
+    initEntry(&e1);
+    initEntry(&e2);
+    initEntry(&e3);
+
+    lcb_timewheel_schedule(wheel, &e1.tw, base + 5 * RES);
+    lcb_timewheel_schedule(wheel, &e2.tw, base + 1 * RES);
+    lcb_timewheel_schedule(wheel, &e3.tw, base + 3 * RES + RES / 2);
+    ASSERT_TRUE(lcb_twentry_armed(&e1.tw));
+    ASSERT_EQ(3, wheel->nentries);
+
+    ASSERT_EQ(1, runAt(base + 2 * RES));
+    ASSERT_EQ(1, e2.nfired);
+    ASSERT_FALSE(lcb_twentry_armed(&e2.tw));
+
+    // Never invoked before the expiry
+    ASSERT_EQ(0, runAt(base + 3 * RES + RES / 4));
+    ASSERT_EQ(1, runAt(base + 4 * RES));
+    ASSERT_EQ(1, e3.nfired);
+
+    lcb_timewheel_cancel(wheel, &e1.tw);
+    ASSERT_FALSE(lcb_twentry_armed(&e1.tw));
+    ASSERT_EQ(0, runAt(base + 10 * RES));
+    ASSERT_EQ(0, e1.nfired);
+    ASSERT_EQ(0, wheel->nentries);
+}
+
+TEST_F(TimeWheel, testMultipleRotations)
+{
+    // The wheel has 16 slots; this is several rotations away
+    TestEntry e1;
+    initEntry(&e1);
+    lcb_timewheel_schedule(wheel, &e1.tw, base + 100 * RES);
+
+    for (unsigned ii = 1; ii < 100; ii++) {
+        ASSERT_EQ(0, runAt(base + ii * RES));
+    }
+    ASSERT_EQ(1, runAt(base + 100 * RES));
+    ASSERT_EQ(1, e1.nfired);
+
+    // Running far behind
+    lcb_timewheel_schedule(wheel, &e1.tw, base + 110 * RES);
+    ASSERT_EQ(1, runAt(base + 500 * RES));
+    ASSERT_EQ(2, e1.nfired);
+}
+
+TEST_F(TimeWheel, testCallbackModifications)
+{
+    TestEntry e1, e2, e3;
+    initEntry(&e1);
+    initEntry(&e2);
+    initEntry(&e3);
+
+    // All in the same slot. e1 cancels e2 and reschedules itself
+    lcb_timewheel_schedule(wheel, &e1.tw, base + 2 * RES);
+    lcb_timewheel_schedule(wheel, &e2.tw, base + 2 * RES);
+    lcb_timewheel_schedule(wheel, &e3.tw, base + 2 * RES);
+    e1.cancelOther = &e2;
+    e1.rescheduleTo = base + 4 * RES;
+
+    ASSERT_EQ(2, runAt(base + 2 * RES));
+    ASSERT_EQ(1, e1.nfired);
+    ASSERT_EQ(0, e2.nfired);
+    ASSERT_EQ(1, e3.nfired);
+    ASSERT_TRUE(lcb_twentry_armed(&e1.tw));
+
+    // Rescheduling to a time which has already passed fires on the next run
+    e1.cancelOther = NULL;
+    e1.rescheduleTo = base;
+    ASSERT_EQ(2, runAt(base + 5 * RES));
+    ASSERT_EQ(3, e1.nfired);
+    ASSERT_EQ(0, wheel->nentries);
+}
+
+TEST_F(TimeWheel, testManyEntries)
+{
+    const unsigned nentries = 10000;
+    std::vector<TestEntry> entries(nentries);
+    unsigned seed = 1, ii;
+
+    for (ii = 0; ii < nentries; ii++) {
+        initEntry(&entries[ii]);
+        seed = seed * 1103515245 + 12345;
+        lcb_timewheel_schedule(wheel, &entries[ii].tw,
+            base + (seed >> 8) % (200 * RES));
+    }
+
+    hrtime_t now = base, prev = base - RES;
+    unsigned total = 0;
+    while (total < nentries) {
+        seed = seed * 1103515245 + 12345;
+        now += (seed >> 8) % (3 * RES);
+        total += runAt(now);
+
+        for (ii = 0; ii < nentries; ii++) {
+            TestEntry *ent = &entries[ii];
+            if (ent->nfired && ent->firedAt == now) {
+                // Not early, and not later than the first eligible run
+                ASSERT_GE(now, ent->tw.expires);
+                ASSERT_LT(prev / RES, ent->tw.tick);
+            }
+        }
+        prev = now;
+    }
+
+    for (ii = 0; ii < nentries; ii++) {
+        ASSERT_EQ(1, entries[ii].nfired);
+    }
+}
+
+struct SortedEntry {
+    lcb_list_t ll;
+    hrtime_t expires;
+};
+
+static int
+cmpSorted(lcb_list_t *a, lcb_list_t *b)
+{
+    hrtime_t ea = LCB_LIST_ITEM(a, SortedEntry, ll)->expires;
+    hrtime_t eb = LCB_LIST_ITEM(b, SortedEntry, ll)->expires;
+    return ea == eb ? 0 : ea > eb ? 1 : -1;
+}
+
+// Enqueues 100k retries with increasing retry times, as happens during
+// a rebalance. Run with --gtest_also_run_disabled_tests
+TEST_F(TimeWheel, DISABLED_bench100kRetries)
+{
+    const unsigned nentries = 100000;
+    std::vector<TestEntry> entries(nentries);
+    std::vector<SortedEntry> sorted(nentries);
+    lcb_TIMEWHEEL *big = lcb_timewheel_new(NULL, 4096, RES);
+    unsigned ii;
+
+    clock_t begin = clock();
+    for (ii = 0; ii < nentries; ii++) {
+        initEntry(&entries[ii]);
+        entries[ii].wheel = big;
+        lcb_timewheel_schedule(big, &entries[ii].tw, base + ii * 1000);
+    }
+    double tSched = (double)(clock() - begin) / CLOCKS_PER_SEC;
+
+    begin = clock();
+    for (hrtime_t now = base; big->nentries; now += RES) {
+        curNow = now;
+        lcb_timewheel_run(big, now);
+    }
+    double tRun = (double)(clock() - begin) / CLOCKS_PER_SEC;
+    lcb_timewheel_destroy(big);
+
+    lcb_list_t head;
+    lcb_list_init(&head);
+    begin = clock();
+    for (ii = 0; ii < nentries; ii++) {
+        sorted[ii].expires = base + ii * 1000;
+        lcb_list_add_sorted(&head, &sorted[ii].ll, cmpSorted);
+    }
+    double tSorted = (double)(clock() - begin) / CLOCKS_PER_SEC;
+
+    printf("100k entries: wheel schedule %.3fs, wheel expire %.3fs, "
+        "sorted list insert %.3fs\n", tSched, tRun, tSorted);
+}
@@ -153,3 +153,35 @@ TEST_F(HtparseTest, testParseExtended)
     lcbht_free(parser);
     lcb_settings_unref(settings);
 }
+
+TEST_F(HtparseTest, testKeepalive)
+{
+    lcb_settings *settings = lcb_settings_new();
+    lcbht_pPARSER parser = lcbht_new(settings);
+    string hdrs = "HTTP/1.1 200 OK\r\n"
+            "Content-Length: 2\r\n";
+
+    // HTTP/1.1 keeps the connection open, once the body has been read
+    string buf = hdrs + "\r\n{";
+    lcbht_parse(parser, buf.c_str(), buf.size());
+    ASSERT_FALSE(lcbht_can_keepalive(parser));
+    lcbht_parse(parser, "}", 1);
+    ASSERT_TRUE(lcbht_can_keepalive(parser));
+
+    // Unless the server asks for it to be closed
+    lcbht_reset(parser);
+    buf = hdrs + "Connection: close\r\n\r\n{}";
+    lcbht_parse(parser, buf.c_str(), buf.size());
+    ASSERT_NE(0, lcbht_get_response(parser)->state & LCBHT_S_DONE);
+    ASSERT_FALSE(lcbht_can_keepalive(parser));
+
+    // HTTP/1.0 closes it by default
+    lcbht_reset(parser);
+    buf = "HTTP/1.0 200 OK\r\nContent-Length: 0\r\n\r\n";
+    lcbht_parse(parser, buf.c_str(), buf.size());
+    ASSERT_NE(0, lcbht_get_response(parser)->state & LCBHT_S_DONE);
+    ASSERT_FALSE(lcbht_can_keepalive(parser));
+
+    lcbht_free(parser);
+    lcb_settings_unref(settings);
+}
@@ -88,6 +88,42 @@ TEST_F(McAlloc, testKeyAlloc)
     mcreq_release_packet(pipeline, packet);
 }
 
+TEST_F(McAlloc, testPrecomputedVbid)
+{
+    CQWrap q;
+    mc_PACKET *packet;
+    mc_PIPELINE *pipeline;
+    lcb_CMDBASE cmd;
+    protocol_binary_request_header hdr;
+
+    memset(&cmd, 0, sizeof(cmd));
+    memset(&hdr, 0, sizeof(hdr));
+    cmd.key.contig.bytes = const_cast<char *>("Hello");
+    cmd.key.contig.nbytes = 5;
+
+    // Use a vBucket other than the one the key hashes to, so that we can
+    // tell the key was not hashed
+    int vb = vbucket_get_vbucket_by_key(q.config, "Hello", 5);
+    int other = (vb + 1) % q.config->nvb;
+    cmd.cmdflags = LCB_CMD_F_VBID | other;
+
+    lcb_error_t ret = mcreq_basic_packet(&q, &cmd, &hdr, 0, &packet, &pipeline);
+    ASSERT_EQ(LCB_SUCCESS, ret);
+    ASSERT_EQ(other, ntohs(hdr.request.vbucket));
+    ASSERT_EQ(q.pipelines[lcbvb_vbmaster(q.config, other)], pipeline);
+    mcreq_wipe_packet(pipeline, packet);
+    mcreq_release_packet(pipeline, packet);
+
+    // Out of range IDs are ignored
+    memset(&hdr, 0, sizeof(hdr));
+    cmd.cmdflags = LCB_CMD_F_VBID | q.config->nvb;
+    ret = mcreq_basic_packet(&q, &cmd, &hdr, 0, &packet, &pipeline);
+    ASSERT_EQ(LCB_SUCCESS, ret);
+    ASSERT_EQ(vb, ntohs(hdr.request.vbucket));
+    mcreq_wipe_packet(pipeline, packet);
+    mcreq_release_packet(pipeline, packet);
+}
+
 // Check that our value allocation stuff works. This only tests copied values
 TEST_F(McAlloc, testValueAlloc)
 {
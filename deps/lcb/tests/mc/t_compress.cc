@@ -0,0 +1,179 @@
+#include "mctest.h"
+#include "mc/compress.h"
+#include <string>
+
+using std::string;
+
+class McCompress : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        mcreq_compress_init(&ctx);
+    }
+
+    // Returns the result of mcreq_compress_value for a fresh packet
+    int compress(CQWrap& q, const char *key, const string& value) {
+        PacketWrap pw;
+        lcb_CONTIGBUF vbuf;
+        int rv;
+
+        pw.setCopyKey(key);
+        EXPECT_TRUE(pw.reservePacket(&q));
+        vbuf.bytes = value.c_str();
+        vbuf.nbytes = value.size();
+        rv = mcreq_compress_value(pw.pipeline, pw.pkt, &vbuf, &ctx,
+            key, strlen(key));
+        if (rv == 0) {
+            EXPECT_NE(0, pw.pkt->flags & MCREQ_F_HASVALUE);
+            EXPECT_LT(pw.pkt->u_value.single.size, value.size());
+        } else {
+            EXPECT_EQ(0, pw.pkt->flags & MCREQ_F_HASVALUE);
+        }
+        mcreq_wipe_packet(pw.pipeline, pw.pkt);
+        mcreq_release_packet(pw.pipeline, pw.pkt);
+        return rv;
+    }
+
+    mc_COMPRESSCTX ctx;
+};
+
+static string
+randomValue(size_t len, unsigned seed)
+{
+    string s;
+    for (size_t ii = 0; ii < len; ii++) {
+        seed = seed * 1103515245 + 12345;
+        s += (char)(seed >> 16);
+    }
+    return s;
+}
+
+TEST_F(McCompress, testPolicy)
+{
+    if (!mcreq_compression_supported()) {
+        return;
+    }
+    CQWrap q;
+    string compressible(4096, 'x');
+
+    ASSERT_EQ(0, compress(q, "doc:1", compressible));
+    ASSERT_EQ(1, ctx.stats.ncompressed);
+    ASSERT_EQ(compressible.size(), ctx.stats.bytes_raw);
+    ASSERT_GT(ctx.stats.bytes_raw, ctx.stats.bytes_compressed);
+
+    // Below the minimum size
+    ASSERT_EQ(1, compress(q, "doc:2", "xxxxxxxx"));
+    ASSERT_EQ(1, ctx.stats.nsmall);
+
+    // Incompressible
+    ASSERT_EQ(1, compress(q, "doc:3", randomValue(4096, 1)));
+    ASSERT_EQ(1, ctx.stats.nrejected);
+
+    // Ratio which can't be met
+    ctx.policy.min_ratio = 10000;
+    ASSERT_EQ(1, compress(q, "other:1", compressible));
+    ASSERT_EQ(2, ctx.stats.nrejected);
+    ASSERT_EQ(4, ctx.stats.nvalues);
+}
+
+TEST_F(McCompress, testPrefixBackoff)
+{
+    if (!mcreq_compression_supported()) {
+        return;
+    }
+    CQWrap q;
+    string compressible(4096, 'x');
+    string incompressible = randomValue(4096, 2);
+    ctx.policy.max_sample_interval = 8;
+
+    // Failures are tried until the sampling interval backs off
+    unsigned ntried = 0;
+    for (unsigned ii = 0; ii < 100; ii++) {
+        lcb_U64 before = ctx.stats.nbackoff;
+        ASSERT_EQ(1, compress(q, "img:1", incompressible));
+        if (ctx.stats.nbackoff == before) {
+            ntried++;
+        }
+    }
+    // 1, 1, 2, 4, then every 8th
+    ASSERT_GE(ntried, 100 / 8);
+    ASSERT_LE(ntried, 100 / 8 + 4);
+
+    // Other prefixes are unaffected
+    ASSERT_EQ(0, compress(q, "doc:1", compressible));
+
+    // A compressible sample resets the prefix
+    unsigned ii;
+    for (ii = 0; ii < 8; ii++) {
+        if (compress(q, "img:2", compressible) == 0) {
+            break;
+        }
+    }
+    ASSERT_LT(ii, 8);
+    ASSERT_EQ(0, compress(q, "img:3", compressible));
+
+    // Disabled backoff
+    ctx.policy.max_sample_interval = 1;
+    lcb_U64 before = ctx.stats.nbackoff;
+    for (ii = 0; ii < 10; ii++) {
+        compress(q, "img:1", incompressible);
+    }
+    ASSERT_EQ(before, ctx.stats.nbackoff);
+}
+
+TEST_F(McCompress, testInflate)
+{
+    if (!mcreq_compression_supported()) {
+        return;
+    }
+    CQWrap q;
+    PacketWrap pw;
+    lcb_CONTIGBUF vbuf;
+    string value;
+    for (unsigned ii = 0; ii < 10000; ii++) {
+        value += "0123456789"[ii % 7];
+    }
+
+    pw.setCopyKey("doc:1");
+    ASSERT_TRUE(pw.reservePacket(&q));
+    vbuf.bytes = value.c_str();
+    vbuf.nbytes = value.size();
+    ASSERT_EQ(0, mcreq_compress_value(pw.pipeline, pw.pkt, &vbuf, NULL, NULL, 0));
+    const char *comp = SPAN_BUFFER(&pw.pkt->u_value.single);
+    lcb_SIZE ncomp = pw.pkt->u_value.single.size;
+
+    lcb_SIZE n_inflated = 0;
+    ASSERT_EQ(0, mcreq_inflate_size(comp, ncomp, &n_inflated));
+    ASSERT_EQ(value.size(), n_inflated);
+
+    const void *bytes;
+    void *freeptr = NULL;
+    ASSERT_EQ(0, mcreq_inflate_value(comp, ncomp, &bytes, &n_inflated, &freeptr));
+    ASSERT_EQ(value, string((const char *)bytes, n_inflated));
+    free(freeptr);
+
+    // The context's buffer is reused once released
+    void *freeptr2 = NULL;
+    ASSERT_EQ(0, mcreq_inflate_pooled(&ctx, comp, ncomp, &bytes, &n_inflated, &freeptr));
+    ASSERT_EQ(value, string((const char *)bytes, n_inflated));
+    ASSERT_EQ(ctx.inflatebuf, freeptr);
+
+    // But not while it's still in use
+    ASSERT_EQ(0, mcreq_inflate_pooled(&ctx, comp, ncomp, &bytes, &n_inflated, &freeptr2));
+    ASSERT_NE(freeptr, freeptr2);
+    ASSERT_EQ(value, string((const char *)bytes, n_inflated));
+    mcreq_inflate_release(&ctx, freeptr2);
+    mcreq_inflate_release(&ctx, freeptr);
+
+    ASSERT_EQ(0, mcreq_inflate_pooled(&ctx, comp, ncomp, &bytes, &n_inflated, &freeptr));
+    ASSERT_EQ(ctx.inflatebuf, freeptr);
+    mcreq_inflate_release(&ctx, freeptr);
+
+    // Corrupt input
+    ASSERT_NE(0, mcreq_inflate_pooled(&ctx, comp, ncomp / 2, &bytes, &n_inflated, &freeptr));
+    ASSERT_TRUE(freeptr == NULL);
+    ASSERT_EQ(0, ctx.inflatebuf_used);
+
+    mcreq_wipe_packet(pw.pipeline, pw.pkt);
+    mcreq_release_packet(pw.pipeline, pw.pkt);
+    mcreq_compress_cleanup(&ctx);
+}
@@ -38,7 +38,7 @@ TEST_F(McContext, testBasicContext)
         pw.setCookie(&cookie);
 
         mcreq_sched_add(pw.pipeline, pw.pkt);
-        ASSERT_FALSE(SLLIST_IS_EMPTY(&pw.pipeline->requests) == 0);
+        ASSERT_FALSE(LCB_LIST_IS_EMPTY(&pw.pipeline->requests) == 0);
         ASSERT_TRUE(SLLIST_IS_EMPTY(&pw.pipeline->ctxqueued) == 0);
     }
 
@@ -91,7 +91,7 @@ TEST_F(McContext, testFailedContext)
         }
 
 
-        ASSERT_TRUE(SLLIST_IS_EMPTY(&pl->requests));
+        ASSERT_TRUE(LCB_LIST_IS_EMPTY(&pl->requests));
         ASSERT_TRUE(SLLIST_IS_EMPTY(&pl->ctxqueued));
 
         nb_IOV iov[1];
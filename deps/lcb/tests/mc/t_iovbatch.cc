@@ -0,0 +1,210 @@
+#include "mctest.h"
+#include <vector>
+#include <string>
+#include <cstdio>
+
+class McIovBatch : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        memset(&pipeline, 0, sizeof(pipeline));
+        memset(&batch, 0, sizeof(batch));
+        mcreq_pipeline_init(&pipeline);
+        expected.clear();
+        written.clear();
+        storage.assign(1 << 25, '\0');
+        nstorage = 0;
+    }
+
+    virtual void TearDown() {
+        mcreq_iovbatch_cleanup(&batch);
+        mcreq_pipeline_cleanup(&pipeline);
+    }
+
+    // Enqueues a span of `n` bytes which is not contiguous with the
+    // previous one, so that it takes an IOV of its own
+    void enqueue(size_t n) {
+        nb_IOV iov;
+        char *buf = &storage[nstorage];
+        ASSERT_LE(nstorage + n + 1, storage.size());
+        for (size_t ii = 0; ii < n; ii++) {
+            buf[ii] = (char)('a' + (expected.size() + ii) % 26);
+        }
+        expected.append(buf, n);
+        nstorage += n + 1;
+        iov.iov_base = buf;
+        iov.iov_len = n;
+        netbuf_enqueue(&pipeline.nbmgr, &iov);
+    }
+
+    // Fills a batch and "writes" up to `limit` bytes of it
+    unsigned writeBatch(int coalesce, unsigned limit = (unsigned)-1) {
+        unsigned nb = mcreq_iovbatch_fill(&pipeline, &batch, coalesce);
+        unsigned nw = 0;
+        for (unsigned ii = 0; ii < batch.nused && nw < limit; ii++) {
+            size_t n = batch.iov[ii].iov_len;
+            if (nw + n > limit) {
+                n = limit - nw;
+            }
+            written.append((const char *)batch.iov[ii].iov_base, n);
+            nw += n;
+        }
+        EXPECT_LE(nw, nb);
+        if (nw) {
+            netbuf_end_flush(&pipeline.nbmgr, nw);
+        }
+        if (nw < nb) {
+            netbuf_reset_flush(&pipeline.nbmgr);
+        }
+        return nb;
+    }
+
+    void writeAll(int coalesce) {
+        while (writeBatch(coalesce)) {
+        }
+        ASSERT_EQ(expected, written);
+        ASSERT_NE(0, netbuf_is_clean(&pipeline.nbmgr));
+    }
+
+    mc_PIPELINE pipeline;
+    mc_IOVBATCH batch;
+    std::vector<char> storage;
+    size_t nstorage;
+    std::string expected;
+    std::string written;
+};
+
+TEST_F(McIovBatch, testCoalesce)
+{
+    for (unsigned ii = 0; ii < 10; ii++) {
+        enqueue(50);
+    }
+    enqueue(4096);
+    enqueue(50); // Alone between two large spans
+    enqueue(4096);
+
+    ASSERT_EQ(8742, mcreq_iovbatch_fill(&pipeline, &batch, 1));
+    ASSERT_EQ(4, batch.nused);
+    ASSERT_EQ(500, batch.iov[0].iov_len);
+    ASSERT_EQ(batch.scratch, batch.iov[0].iov_base);
+    ASSERT_EQ(0, memcmp(batch.scratch, expected.c_str(), 500));
+    ASSERT_EQ(4096, batch.iov[1].iov_len);
+    ASSERT_EQ(50, batch.iov[2].iov_len);
+    ASSERT_NE(batch.scratch, batch.iov[2].iov_base);
+    ASSERT_EQ(500, batch.ncoalesced);
+    ASSERT_EQ(1, batch.nwrites);
+    ASSERT_EQ(4, batch.nbufs);
+    ASSERT_EQ(8742, batch.nbytes);
+    netbuf_end_flush(&pipeline.nbmgr, 8742);
+
+    // Without coalescing, each span is its own IOV
+    for (unsigned ii = 0; ii < 10; ii++) {
+        enqueue(50);
+    }
+    ASSERT_EQ(500, mcreq_iovbatch_fill(&pipeline, &batch, 0));
+    ASSERT_EQ(10, batch.nused);
+    ASSERT_EQ(500, batch.ncoalesced);
+    netbuf_end_flush(&pipeline.nbmgr, 500);
+    ASSERT_EQ(0, mcreq_iovbatch_fill(&pipeline, &batch, 1));
+    ASSERT_EQ(2, batch.nwrites);
+}
+
+TEST_F(McIovBatch, testPartialWrites)
+{
+    for (unsigned ii = 0; ii < 1000; ii++) {
+        enqueue(ii % 3 ? 20 : 1000);
+    }
+    // Write a prime number of bytes at a time, so that writes end in the
+    // middle of both the scratch buffer and of large spans
+    while (writeBatch(1, 997)) {
+    }
+    ASSERT_EQ(expected, written);
+    ASSERT_NE(0, netbuf_is_clean(&pipeline.nbmgr));
+}
+
+TEST_F(McIovBatch, testScratchFull)
+{
+    // More small data than fits in the scratch buffer
+    for (unsigned ii = 0; ii < 1000; ii++) {
+        enqueue(100);
+    }
+    const unsigned ncopied = MCREQ_IOVBATCH_SCRATCH / 100;
+    ASSERT_EQ((ncopied + MCREQ_IOVBATCH_MIN - 1) * 100, writeBatch(1));
+    ASSERT_EQ(MCREQ_IOVBATCH_MIN, batch.nused);
+    ASSERT_EQ(ncopied * 100, batch.ncoalesced);
+    ASSERT_EQ(ncopied * 100, batch.iov[0].iov_len);
+    writeAll(1);
+}
+
+TEST_F(McIovBatch, testAdaptiveSize)
+{
+    // The array grows while batches fill it
+    for (unsigned ii = 0; ii < 5000; ii++) {
+        enqueue(1000);
+    }
+    writeAll(1);
+    ASSERT_EQ(MCREQ_IOVBATCH_MAX, batch.nalloc);
+    ASSERT_EQ(5000, batch.nbufs);
+    ASSERT_LT(batch.nwrites, 5000 / MCREQ_IOVBATCH_MIN);
+
+    // And shrinks after a run of small batches
+    unsigned nwrites = 0;
+    while (batch.nalloc > MCREQ_IOVBATCH_MIN) {
+        enqueue(1000);
+        ASSERT_EQ(1000, writeBatch(1));
+        ASSERT_LT(++nwrites, 1000u);
+    }
+
+    // A full batch grows it again
+    unsigned nalloc = batch.nalloc;
+    for (unsigned ii = 0; ii < nalloc; ii++) {
+        enqueue(1000);
+    }
+    writeBatch(1);
+    ASSERT_EQ(nalloc, batch.nused);
+    enqueue(1000);
+    writeBatch(1);
+    ASSERT_EQ(nalloc * 2, batch.nalloc);
+    ASSERT_EQ(expected, written);
+}
+
+// Flushes 20k packets, each made of a 30 byte header span and a separate
+// value span, and reports the number of writes needed with a fixed array of
+// 32 IOVs and with adaptive batches. Run with --gtest_also_run_disabled_tests
+TEST_F(McIovBatch, DISABLED_benchSmallSpans)
+{
+    const unsigned npackets = 20000;
+    const unsigned vsizes[] = { 100, 1000 };
+
+    for (unsigned vv = 0; vv < 2; vv++) {
+        for (unsigned mode = 0; mode < 3; mode++) {
+            SetUp();
+            for (unsigned ii = 0; ii < npackets; ii++) {
+                enqueue(30);
+                enqueue(vsizes[vv]);
+            }
+
+            lcb_U64 nwrites = 0, nbytes = 0;
+            if (mode == 0) {
+                nb_IOV iov[32];
+                unsigned nb;
+                int niov;
+                while ((nb = netbuf_start_flush(&pipeline.nbmgr, iov, 32, &niov))) {
+                    netbuf_end_flush(&pipeline.nbmgr, nb);
+                    nwrites++;
+                    nbytes += nb;
+                }
+            } else {
+                writeAll(mode == 2);
+                nwrites = batch.nwrites;
+                nbytes = batch.nbytes;
+            }
+            printf("%u byte values, %s: %lu writes, %lu bytes per write\n",
+                vsizes[vv],
+                mode == 0 ? "32 IOVs" :
+                        mode == 1 ? "adaptive" : "adaptive+coalesce",
+                (unsigned long)nwrites, (unsigned long)(nbytes / nwrites));
+            TearDown();
+        }
+    }
+    SetUp();
+}
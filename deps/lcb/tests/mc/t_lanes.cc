@@ -0,0 +1,258 @@
+#include "mctest.h"
+#include "mc/mcreq-flush-inl.h"
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+
+class McLanes : public ::testing::Test {
+protected:
+    // Gives each pipeline of the queue `nlanes` additional lanes
+    void addLanes(CQWrap& cq, unsigned nlanes) {
+        for (unsigned ii = 0; ii < cq.npipelines; ii++) {
+            mc_PIPELINE *pl = cq.pipelines[ii];
+            pl->lanes = (mc_PIPELINE **)calloc(nlanes, sizeof(*pl->lanes));
+            for (unsigned jj = 0; jj < nlanes; jj++) {
+                mc_PIPELINE *lane = (mc_PIPELINE *)calloc(1, sizeof(*lane));
+                mcreq_pipeline_init(lane);
+                lane->primary = pl;
+                pl->lanes[jj] = lane;
+            }
+            pl->nlanes = nlanes;
+        }
+        // Sets the parent and index of the lanes
+        unsigned npipelines;
+        mc_PIPELINE **pipelines = mcreq_queue_take_pipelines(&cq, &npipelines);
+        mcreq_queue_add_pipelines(&cq, pipelines, npipelines, cq.config);
+    }
+
+    void removeLanes(CQWrap& cq) {
+        for (unsigned ii = 0; ii < cq.npipelines; ii++) {
+            mc_PIPELINE *pl = cq.pipelines[ii];
+            for (unsigned jj = 0; jj < pl->nlanes; jj++) {
+                EXPECT_NE(0, netbuf_is_clean(&pl->lanes[jj]->nbmgr));
+                mcreq_pipeline_cleanup(pl->lanes[jj]);
+                free(pl->lanes[jj]);
+            }
+            free(pl->lanes);
+            pl->lanes = NULL;
+            pl->nlanes = 0;
+        }
+    }
+
+    // Schedules a packet with a value of `nvalue` bytes
+    mc_PACKET *schedPacket(CQWrap& cq, const char *key, size_t nvalue,
+        mc_PIPELINE **pl) {
+        PacketWrap pw;
+        pw.setCopyKey(key);
+        EXPECT_EQ(LCB_SUCCESS, mcreq_basic_packet2(&cq, &pw.cmd, &pw.hdr, 0,
+            nvalue, &pw.pkt, &pw.pipeline));
+        if (nvalue) {
+            mcreq_reserve_value2(pw.pipeline, pw.pkt, nvalue);
+        }
+        pw.hdr.request.bodylen = htonl((lcb_uint32_t)(strlen(key) + nvalue));
+        pw.copyHeader();
+        MCREQ_PKT_RDATA(pw.pkt)->start = 0;
+        mcreq_sched_add(pw.pipeline, pw.pkt);
+        *pl = pw.pipeline;
+        return pw.pkt;
+    }
+
+    // Flushes and removes all the packets of a pipeline
+    void drain(mc_PIPELINE *pl) {
+        mcreq_pipeline_fail(pl, LCB_ERROR, noopFail, NULL);
+        flushAll(pl);
+        ASSERT_EQ(0, pl->nbytes_pending);
+    }
+
+    static void flushAll(mc_PIPELINE *pl) {
+        nb_IOV iov;
+        unsigned toFlush;
+        while ((toFlush = mcreq_flush_iov_fill(pl, &iov, 1, NULL))) {
+            mcreq_flush_done(pl, toFlush, toFlush);
+        }
+    }
+
+    static void noopFail(mc_PIPELINE *, mc_PACKET *, lcb_error_t, void *) {
+    }
+};
+
+TEST_F(McLanes, testNoLanes)
+{
+    CQWrap cq;
+    mc_PIPELINE *pl;
+    mcreq_sched_enter(&cq);
+    mc_PACKET *pkt = schedPacket(cq, "key", 100, &pl);
+    ASSERT_EQ(pl, cq.pipelines[pl->index]);
+    ASSERT_EQ(mcreq_get_size(pkt), pl->nbytes_pending);
+    mcreq_sched_leave(&cq, 0);
+    ASSERT_EQ(mcreq_get_size(pkt), pl->nbytes_pending);
+    drain(pl);
+}
+
+TEST_F(McLanes, testLeastPending)
+{
+    CQWrap cq;
+    addLanes(cq, 2);
+    mc_PIPELINE *pl, *primary;
+    mc_PACKET *pkt;
+    std::vector<mc_PIPELINE *> used;
+
+    // Packets of equal size go to each of the connections in turn
+    mcreq_sched_enter(&cq);
+    for (unsigned ii = 0; ii < 3; ii++) {
+        pkt = schedPacket(cq, "key", 100, &pl);
+        used.push_back(pl);
+    }
+    primary = cq.pipelines[pl->index];
+    ASSERT_EQ(primary, used[0]);
+    ASSERT_EQ(primary->lanes[0], used[1]);
+    ASSERT_EQ(primary->lanes[1], used[2]);
+    ASSERT_EQ(primary, used[2]->primary);
+    ASSERT_EQ(primary->index, used[2]->index);
+    ASSERT_EQ(primary->parent, used[2]->parent);
+
+    // A large packet on the primary sends the following ones elsewhere
+    pkt = schedPacket(cq, "key", 100000, &pl);
+    ASSERT_EQ(primary, pl);
+    for (unsigned ii = 0; ii < 10; ii++) {
+        pkt = schedPacket(cq, "key", 100, &pl);
+        ASSERT_NE(primary, pl);
+    }
+    mcreq_sched_leave(&cq, 0);
+
+    // Responses lower the pending count
+    lcb_SIZE before = primary->nbytes_pending;
+    pkt = mcreq_first_packet(primary);
+    lcb_SIZE pktsize = mcreq_get_size(pkt);
+    ASSERT_EQ(pkt, mcreq_pipeline_remove(primary, pkt->opaque));
+    ASSERT_EQ(before - pktsize, primary->nbytes_pending);
+    flushAll(primary);
+    mcreq_packet_handled(primary, pkt);
+
+    drain(primary);
+    drain(primary->lanes[0]);
+    drain(primary->lanes[1]);
+    removeLanes(cq);
+}
+
+TEST_F(McLanes, testLargeValueLane)
+{
+    CQWrap cq;
+    addLanes(cq, 2);
+    cq.lane_threshold = 4096;
+    mc_PIPELINE *pl, *primary;
+
+    mcreq_sched_enter(&cq);
+    schedPacket(cq, "key", 4096, &pl);
+    primary = cq.pipelines[pl->index];
+    ASSERT_EQ(primary->lanes[1], pl);
+
+    // Small values never use the large value lane, even if it is idle
+    for (unsigned ii = 0; ii < 10; ii++) {
+        schedPacket(cq, "key", 100, &pl);
+        ASSERT_NE(primary->lanes[1], pl);
+    }
+    schedPacket(cq, "key", 10000, &pl);
+    ASSERT_EQ(primary->lanes[1], pl);
+
+    // Failing the context releases the pending counts
+    mcreq_sched_fail(&cq);
+    ASSERT_EQ(0, primary->nbytes_pending);
+    ASSERT_EQ(0, primary->lanes[0]->nbytes_pending);
+    ASSERT_EQ(0, primary->lanes[1]->nbytes_pending);
+    removeLanes(cq);
+}
+
+struct SimPacket {
+    uint32_t opaque;
+    unsigned start;
+    bool large;
+};
+
+static bool
+simCompare(const SimPacket& a, const SimPacket& b)
+{
+    return a.opaque < b.opaque;
+}
+
+// Models each connection as a link which transfers a fixed number of bytes
+// per tick, in order, and reports the latency (in ticks) of 100 byte values
+// sent alongside 1MB values. Run with --gtest_also_run_disabled_tests
+TEST_F(McLanes, DISABLED_benchMixedSizes)
+{
+    const unsigned bandwidth = 256 * 1024, nticks = 2000, perTick = 20;
+    const struct { unsigned nlanes; lcb_SIZE threshold; } configs[] = {
+        { 0, 0 }, { 3, 0 }, { 3, 65536 }
+    };
+
+    for (unsigned cc = 0; cc < sizeof(configs) / sizeof(configs[0]); cc++) {
+        CQWrap cq;
+        addLanes(cq, configs[cc].nlanes);
+        cq.lane_threshold = configs[cc].threshold;
+
+        std::vector<mc_PIPELINE *> all;
+        for (unsigned ii = 0; ii < cq.npipelines; ii++) {
+            all.push_back(cq.pipelines[ii]);
+            for (unsigned jj = 0; jj < cq.pipelines[ii]->nlanes; jj++) {
+                all.push_back(cq.pipelines[ii]->lanes[jj]);
+            }
+        }
+
+        std::vector<SimPacket> sent;
+        std::vector<unsigned> latencies;
+        std::vector<lcb_SIZE> progress(all.size());
+        unsigned seed = 1, nlarge = 0, tick;
+
+        for (tick = 0; tick < nticks || latencies.size() + nlarge < sent.size(); tick++) {
+            if (tick < nticks) {
+                mcreq_sched_enter(&cq);
+                for (unsigned ii = 0; ii < perTick; ii++) {
+                    char key[32];
+                    mc_PIPELINE *pl;
+                    SimPacket sp;
+                    seed = seed * 1103515245 + 12345;
+                    sprintf(key, "key_%u", seed >> 8);
+                    sp.large = (seed >> 16) % 100 == 0;
+                    sp.start = tick;
+                    sp.opaque = schedPacket(cq, key,
+                        sp.large ? 1024 * 1024 : 100, &pl)->opaque;
+                    sent.push_back(sp);
+                }
+                mcreq_sched_leave(&cq, 0);
+            }
+
+            for (unsigned ii = 0; ii < all.size(); ii++) {
+                mc_PIPELINE *pl = all[ii];
+                mc_PACKET *pkt;
+                progress[ii] += bandwidth;
+                flushAll(pl);
+                while ((pkt = mcreq_first_packet(pl)) &&
+                        progress[ii] >= mcreq_get_size(pkt)) {
+                    SimPacket key;
+                    progress[ii] -= mcreq_get_size(pkt);
+                    key.opaque = pkt->opaque;
+                    const SimPacket& sp = *std::lower_bound(
+                        sent.begin(), sent.end(), key, simCompare);
+                    if (sp.large) {
+                        nlarge++;
+                    } else {
+                        latencies.push_back(tick - sp.start);
+                    }
+                    mcreq_pipeline_remove(pl, pkt->opaque);
+                    mcreq_packet_handled(pl, pkt);
+                }
+                if (!pkt) {
+                    progress[ii] = 0;
+                }
+            }
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        printf("%u connection(s) per node, large value lane %s: "
+            "small value latency p50=%u p99=%u max=%u ticks, done at tick %u\n",
+            configs[cc].nlanes + 1, configs[cc].threshold ? "on" : "off",
+            latencies[latencies.size() / 2],
+            latencies[latencies.size() * 99 / 100], latencies.back(), tick);
+        removeLanes(cq);
+    }
+}
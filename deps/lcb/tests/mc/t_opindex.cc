@@ -0,0 +1,208 @@
+#include "mctest.h"
+#include "mc/mcreq-flush-inl.h"
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+
+class McOpIndex : public ::testing::Test {
+protected:
+    // Creates a header-only packet and enqueues it on the pipeline
+    static mc_PACKET *addPacket(mc_PIPELINE *pl, bool enqueue = true) {
+        protocol_binary_request_header hdr;
+        mc_PACKET *pkt = mcreq_allocate_packet(pl);
+        EXPECT_EQ(LCB_SUCCESS, mcreq_reserve_header(pl, pkt, sizeof(hdr.bytes)));
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.request.opaque = pkt->opaque;
+        mcreq_write_hdr(pkt, &hdr);
+        if (enqueue) {
+            mcreq_enqueue_packet(pl, pkt);
+        }
+        return pkt;
+    }
+
+    static void flushAll(mc_PIPELINE *pl) {
+        nb_IOV iov;
+        unsigned toFlush;
+        while ((toFlush = mcreq_flush_iov_fill(pl, &iov, 1, NULL))) {
+            mcreq_flush_done(pl, toFlush, toFlush);
+        }
+    }
+
+    // Removes the packet as if its response had been received
+    static void respond(mc_PIPELINE *pl, mc_PACKET *pkt) {
+        ASSERT_EQ(pkt, mcreq_pipeline_remove(pl, pkt->opaque));
+        mcreq_packet_handled(pl, pkt);
+    }
+
+    static std::vector<mc_PACKET *> listPackets(mc_PIPELINE *pl) {
+        std::vector<mc_PACKET *> ret;
+        lcb_list_t *ll;
+        LCB_LIST_FOR(ll, &pl->requests) {
+            ret.push_back(LCB_LIST_ITEM(ll, mc_PACKET, llnode));
+        }
+        return ret;
+    }
+
+    static void noopFail(mc_PIPELINE *, mc_PACKET *, lcb_error_t, void *) {
+    }
+};
+
+TEST_F(McOpIndex, testFindRemove)
+{
+    CQWrap cq;
+    mc_PIPELINE *pl = cq.pipelines[0];
+    std::vector<mc_PACKET *> pkts;
+
+    for (unsigned ii = 0; ii < 1000; ii++) {
+        pkts.push_back(addPacket(pl));
+    }
+    flushAll(pl);
+    ASSERT_EQ(1000, pl->opindex_count);
+    ASSERT_TRUE(mcreq_pipeline_find(pl, pkts.back()->opaque + 1) == NULL);
+
+    // Remove every other packet, out of order
+    for (unsigned ii = 999; ii < 1000; ii -= 2) {
+        ASSERT_EQ(pkts[ii], mcreq_pipeline_find(pl, pkts[ii]->opaque));
+        respond(pl, pkts[ii]);
+        ASSERT_TRUE(mcreq_pipeline_find(pl, pkts[ii]->opaque) == NULL);
+    }
+
+    // The remaining packets are still found, and listed in their order
+    std::vector<mc_PACKET *> remaining = listPackets(pl);
+    ASSERT_EQ(500, remaining.size());
+    for (unsigned ii = 0; ii < 500; ii++) {
+        ASSERT_EQ(pkts[ii * 2], remaining[ii]);
+        ASSERT_EQ(pkts[ii * 2], mcreq_pipeline_find(pl, pkts[ii * 2]->opaque));
+    }
+
+    ASSERT_EQ(500, mcreq_pipeline_fail(pl, LCB_ERROR, noopFail, NULL));
+    ASSERT_EQ(0, pl->opindex_count);
+    ASSERT_TRUE(LCB_LIST_IS_EMPTY(&pl->requests));
+}
+
+TEST_F(McOpIndex, testCollisions)
+{
+    CQWrap cq;
+    mc_PIPELINE *pl = cq.pipelines[0];
+    std::vector<mc_PACKET *> pkts;
+    unsigned seed = 1;
+
+    // Opaques spaced so that they all start probing from the same slot
+    for (unsigned ii = 0; ii < 40; ii++) {
+        cq.seq = ii * 4096;
+        pkts.push_back(addPacket(pl));
+    }
+    // Along with others which fall within the probe sequence
+    for (unsigned ii = 0; ii < 20; ii++) {
+        cq.seq = ii + 1;
+        pkts.push_back(addPacket(pl));
+    }
+    flushAll(pl);
+
+    while (!pkts.empty()) {
+        seed = seed * 1103515245 + 12345;
+        unsigned ix = (seed >> 8) % pkts.size();
+        respond(pl, pkts[ix]);
+        pkts.erase(pkts.begin() + ix);
+        for (unsigned ii = 0; ii < pkts.size(); ii++) {
+            ASSERT_EQ(pkts[ii], mcreq_pipeline_find(pl, pkts[ii]->opaque));
+        }
+    }
+    ASSERT_EQ(0, pl->opindex_count);
+}
+
+TEST_F(McOpIndex, testTimeoutOrder)
+{
+    CQWrap cq;
+    mc_PIPELINE *pl = cq.pipelines[0];
+    mc_PACKET *pkts[5];
+    hrtime_t oldest = 0;
+
+    for (unsigned ii = 0; ii < 5; ii++) {
+        pkts[ii] = addPacket(pl);
+        MCREQ_PKT_RDATA(pkts[ii])->start = (ii + 1) * 100;
+    }
+    flushAll(pl);
+
+    // A retried packet is placed according to its start time
+    respond(pl, pkts[1]);
+    pkts[1] = addPacket(pl, false);
+    MCREQ_PKT_RDATA(pkts[1])->start = 150;
+    mcreq_reenqueue_packet(pl, pkts[1]);
+    flushAll(pl);
+
+    std::vector<mc_PACKET *> order = listPackets(pl);
+    ASSERT_EQ(5, order.size());
+    ASSERT_EQ(pkts[0], order[0]);
+    ASSERT_EQ(pkts[1], order[1]);
+    ASSERT_EQ(pkts[2], order[2]);
+
+    // Only the packets older than the threshold time out
+    ASSERT_EQ(2, mcreq_pipeline_timeout(pl, LCB_ETIMEDOUT, noopFail, NULL,
+        250, &oldest));
+    ASSERT_EQ(300, oldest);
+    ASSERT_TRUE(mcreq_pipeline_find(pl, pkts[1]->opaque) == NULL);
+    ASSERT_EQ(pkts[3], mcreq_pipeline_find(pl, pkts[3]->opaque));
+    ASSERT_EQ(3, mcreq_pipeline_fail(pl, LCB_ERROR, noopFail, NULL));
+}
+
+// Measures the time to match responses to their requests, received in random
+// order, as the number of requests in flight grows. The linear scan is how
+// requests were matched before the index was added.
+// Run with --gtest_also_run_disabled_tests
+TEST_F(McOpIndex, DISABLED_benchResponseDispatch)
+{
+    const unsigned depths[] = { 10, 100, 1000, 10000, 100000 };
+    const unsigned total = 200000;
+
+    for (unsigned dd = 0; dd < sizeof(depths) / sizeof(depths[0]); dd++) {
+        double elapsed[2];
+        for (unsigned linear = 0; linear < 2; linear++) {
+            CQWrap cq;
+            mc_PIPELINE *pl = cq.pipelines[0];
+            std::vector<mc_PACKET *> pkts;
+            unsigned seed = 1, nresponses = 0;
+            unsigned nresp = linear && depths[dd] > 1000 ? total / 100 : total;
+            clock_t spent = 0;
+
+            while (nresponses < nresp) {
+                while (pkts.size() < depths[dd]) {
+                    pkts.push_back(addPacket(pl));
+                }
+                flushAll(pl);
+                // Respond to half of the pending requests, in random order
+                for (unsigned ii = pkts.size() - 1; ii > 0; ii--) {
+                    seed = seed * 1103515245 + 12345;
+                    std::swap(pkts[ii], pkts[(seed >> 8) % (ii + 1)]);
+                }
+                unsigned nbatch = (depths[dd] + 1) / 2;
+                clock_t begin = clock();
+                for (unsigned ii = 0; ii < nbatch; ii++) {
+                    mc_PACKET *pkt = pkts[pkts.size() - 1 - ii], *found = NULL;
+                    if (linear) {
+                        lcb_list_t *ll;
+                        LCB_LIST_FOR(ll, &pl->requests) {
+                            found = LCB_LIST_ITEM(ll, mc_PACKET, llnode);
+                            if (found->opaque == pkt->opaque) {
+                                break;
+                            }
+                        }
+                    } else {
+                        found = mcreq_pipeline_find(pl, pkt->opaque);
+                    }
+                    ASSERT_EQ(pkt, found);
+                    mcreq_pipeline_remove(pl, pkt->opaque);
+                    mcreq_packet_handled(pl, pkt);
+                }
+                spent += clock() - begin;
+                pkts.resize(pkts.size() - nbatch);
+                nresponses += nbatch;
+            }
+            elapsed[linear] = (double)spent / CLOCKS_PER_SEC * 1e9 / nresponses;
+            mcreq_pipeline_fail(pl, LCB_ERROR, noopFail, NULL);
+        }
+        printf("%6u requests in flight: %7.1f ns per response indexed, "
+            "%9.1f ns with a linear scan\n", depths[dd], elapsed[0], elapsed[1]);
+    }
+}
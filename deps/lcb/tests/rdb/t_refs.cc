@@ -110,3 +110,34 @@ TEST_F(RefTest, testRefConsolidate)
     rp3.unrefSegment(0);
     delete ior;
 }
+
+// Consolidating ahead of a large packet should let the rest of it be read
+// into the same segment, which can then be handed out without copying.
+TEST_F(RefTest, testLargeReadAhead)
+{
+    IORope *ior = new IORope(rdb_bigalloc_new());
+    std::string payload(4096, 'x');
+    payload[0] = 'A';
+    payload[4095] = 'Z';
+
+    // Only part of the packet has arrived
+    ior->feed(payload.substr(0, 100));
+    rdb_consolidate(ior, payload.size());
+    ASSERT_EQ(100, ior->usedSize());
+    rdb_ROPESEG *first = RDB_SEG_FIRST(&ior->recvd);
+    ASSERT_GE(RDB_SEG_SPACE(first), payload.size() - 100);
+
+    ior->feed(payload.substr(100));
+    ASSERT_EQ(payload.size(), ior->usedSize());
+    ASSERT_EQ(first, RDB_SEG_FIRST(&ior->recvd));
+    ASSERT_EQ(payload.size(), rdb_get_contigsize(ior));
+
+    ReadPacket rp(ior, payload.size());
+    ASSERT_EQ(1, rp.segments.size());
+    rp.refSegment(0);
+    rdb_consumed(ior, payload.size());
+    delete ior;
+
+    ASSERT_EQ(payload, rp.asString());
+    rp.unrefSegment(0);
+}
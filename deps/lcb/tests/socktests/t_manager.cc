@@ -39,3 +39,126 @@ TEST_F(SockMgrTest, testCancellation)
     loop->sockpool->tmoidle = LCB_MS2US(2);
     loop->start();
 }
+
+extern "C" {
+static void
+statsCallback(const lcb_POOLHOSTSTATS *stats, void *arg)
+{
+    *(lcb_POOLHOSTSTATS *)arg = *stats;
+}
+
+static void
+pooledConnCb(lcbio_SOCKET *sock, void *arg, lcb_error_t err, lcbio_OSERR)
+{
+    ESocket *s = (ESocket *)arg;
+    s->assign(sock, err);
+    s->parent->stop();
+}
+}
+
+static lcb_POOLHOSTSTATS
+getStats(lcbio_MGR *mgr)
+{
+    lcb_POOLHOSTSTATS stats;
+    memset(&stats, 0, sizeof(stats));
+    lcbio_mgr_stats(mgr, statsCallback, &stats);
+    stats.host = NULL;
+    return stats;
+}
+
+// Breaks after being polled a number of times
+class CountBreakCondition : public BreakCondition {
+public:
+    CountBreakCondition(unsigned n) : remaining(n) {}
+protected:
+    bool shouldBreakImpl() { return --remaining == 0; }
+    unsigned remaining;
+};
+
+class IdleBreakCondition : public BreakCondition {
+public:
+    IdleBreakCondition(lcbio_MGR *m, unsigned n) : mgr(m), nidle(n) {}
+protected:
+    bool shouldBreakImpl() { return getStats(mgr).idle >= nidle; }
+    lcbio_MGR *mgr;
+    unsigned nidle;
+};
+
+TEST_F(SockMgrTest, testMinIdle)
+{
+    lcb_host_t host;
+    loop->populateHost(&host);
+    loop->sockpool->minidle = 2;
+    lcbio_mgr_warmup(loop->sockpool, &host);
+
+    lcb_POOLHOSTSTATS stats = getStats(loop->sockpool);
+    ASSERT_EQ(2, stats.pending);
+
+    IdleBreakCondition bc(loop->sockpool, 2);
+    loop->setBreakCondition(&bc);
+    loop->start();
+    stats = getStats(loop->sockpool);
+    ASSERT_EQ(2, stats.idle);
+    ASSERT_EQ(2, stats.connects);
+    ASSERT_EQ(0, stats.connect_errors);
+    ASSERT_GE(stats.connect_time, stats.connect_time_max);
+
+    // Leasing one starts another in the background
+    ESocket *sock1 = new ESocket();
+    loop->connectPooled(sock1);
+    ASSERT_FALSE(sock1->sock == NULL);
+    IdleBreakCondition bc2(loop->sockpool, 2);
+    loop->setBreakCondition(&bc2);
+    loop->start();
+    stats = getStats(loop->sockpool);
+    ASSERT_EQ(1, stats.leased);
+    ASSERT_EQ(2, stats.idle);
+    ASSERT_EQ(3, stats.total);
+
+    // Releasing it closes it, as the pool is at its idle limit
+    loop->sockpool->maxidle = 2;
+    delete sock1;
+    stats = getStats(loop->sockpool);
+    ASSERT_EQ(0, stats.leased);
+    ASSERT_EQ(2, stats.total);
+
+    // Idle connections at or below the minimum are not timed out
+    loop->sockpool->tmoidle = LCB_MS2US(1);
+    CountBreakCondition cbc(20);
+    loop->setBreakCondition(&cbc);
+    loop->start();
+    stats = getStats(loop->sockpool);
+    ASSERT_EQ(2, stats.idle);
+    ASSERT_EQ(3, stats.connects);
+}
+
+TEST_F(SockMgrTest, testMaxTotal)
+{
+    loop->sockpool->maxtotal = 1;
+
+    ESocket *sock1 = new ESocket();
+    loop->connectPooled(sock1);
+    ASSERT_FALSE(sock1->sock == NULL);
+
+    // The second request waits for the first connection to be released
+    lcb_host_t host;
+    loop->populateHost(&host);
+    ESocket *sock2 = new ESocket();
+    sock2->parent = loop;
+    sock2->creq.type = LCBIO_CONNREQ_POOLED;
+    sock2->creq.u.preq = lcbio_mgr_get(loop->sockpool, &host,
+        LCB_MS2US(1000), pooledConnCb, sock2);
+    lcb_POOLHOSTSTATS stats = getStats(loop->sockpool);
+    ASSERT_EQ(1, stats.waiters);
+    ASSERT_EQ(1, stats.total);
+
+    lcbio_SOCKET *rawsock = sock1->sock;
+    delete sock1;
+    loop->start();
+    ASSERT_EQ(rawsock, sock2->sock);
+    stats = getStats(loop->sockpool);
+    ASSERT_EQ(0, stats.waiters);
+    ASSERT_EQ(1, stats.leased);
+    ASSERT_EQ(1, stats.total);
+    delete sock2;
+}
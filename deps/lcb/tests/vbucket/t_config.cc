@@ -7,6 +7,8 @@
 
 using std::string;
 
+extern "C" uint32_t vb__hash_ketama(const char *key, size_t key_length);
+
 static string getConfigFile(const char *fname)
 {
     // Determine where the file is located?
@@ -124,3 +126,139 @@ TEST_F(ConfigTest, testGeneration)
     lcbvb_destroy(cfg);
     free(js);
 }
+
+// Generated configs only have node addresses once loaded from JSON
+static lcbvb_CONFIG *
+reload(lcbvb_CONFIG *cfg)
+{
+    char *js = lcbvb_save_json(cfg);
+    lcbvb_destroy(cfg);
+    cfg = lcbvb_create();
+    EXPECT_EQ(0, lcbvb_load_json(cfg, js));
+    free(js);
+    return cfg;
+}
+
+static lcbvb_CONFIG *
+genReordered(const lcbvb_CONFIG *orig)
+{
+    // The same nodes and vBucket masters, listed in the reverse order
+    unsigned nsrv = orig->nsrv;
+    lcbvb_SERVER *servers = (lcbvb_SERVER *)calloc(nsrv, sizeof(*servers));
+    for (unsigned ii = 0; ii < nsrv; ii++) {
+        servers[ii].svc.data = 1000 + (nsrv - 1 - ii);
+        servers[ii].svc.views = 2000 + (nsrv - 1 - ii);
+        servers[ii].svc.mgmt = 3000 + (nsrv - 1 - ii);
+        servers[ii].hostname = (char *)"localhost";
+        servers[ii].svc.views_base_ = (char *)"/default";
+    }
+    lcbvb_CONFIG *cfg = lcbvb_create();
+    EXPECT_EQ(0, lcbvb_genconfig_ex(cfg, "default", NULL, servers, nsrv,
+                                    orig->nrepl, orig->nvb));
+    free(servers);
+    for (unsigned ii = 0; ii < cfg->nvb; ii++) {
+        for (unsigned jj = 0; jj < cfg->nrepl + 1; jj++) {
+            cfg->vbuckets[ii].servers[jj] =
+                nsrv - 1 - orig->vbuckets[ii].servers[jj];
+        }
+    }
+    return reload(cfg);
+}
+
+TEST_F(ConfigTest, testCompareMoved)
+{
+    lcbvb_CONFIG *cfg = lcbvb_create();
+    lcbvb_genconfig(cfg, 4, 1, 1024);
+    cfg = reload(cfg);
+    char *js = lcbvb_save_json(cfg);
+
+    // Move a few vBuckets to the next node
+    lcbvb_CONFIG *moved = lcbvb_create();
+    ASSERT_EQ(0, lcbvb_load_json(moved, js));
+    free(js);
+    for (unsigned ii = 0; ii < 1024; ii += 100) {
+        lcbvb_VBUCKET *vb = moved->vbuckets + ii;
+        vb->servers[1] = vb->servers[0];
+        vb->servers[0] = (vb->servers[0] + 1) % moved->nsrv;
+    }
+
+    lcbvb_CONFIGDIFF *diff = lcbvb_compare(cfg, moved);
+    ASSERT_TRUE(diff->vbs_moved != NULL);
+    ASSERT_EQ(11, diff->n_vb_changes);
+    ASSERT_EQ(0, diff->sequence_changed);
+    for (unsigned ii = 0; ii < 1024; ii++) {
+        ASSERT_EQ(ii % 100 == 0, diff->vbs_moved[ii] != 0) << ii;
+    }
+    lcbvb_free_diff(diff);
+
+    // Reordering the nodes alone does not move any vBucket
+    lcbvb_CONFIG *reordered = genReordered(cfg);
+    diff = lcbvb_compare(cfg, reordered);
+    ASSERT_NE(0, diff->sequence_changed);
+    ASSERT_GT(diff->n_vb_changes, 0);
+    for (unsigned ii = 0; ii < 1024; ii++) {
+        ASSERT_EQ(0, diff->vbs_moved[ii]) << ii;
+    }
+    lcbvb_free_diff(diff);
+
+    lcbvb_destroy(reordered);
+    lcbvb_destroy(moved);
+    lcbvb_destroy(cfg);
+}
+
+// The original binary search over the continuum
+static int
+searchContinuum(lcbvb_CONFIG *cfg, uint32_t digest)
+{
+    lcbvb_CONTINUUM *beginp, *endp, *midp, *highp, *lowp;
+    beginp = lowp = cfg->continuum;
+    endp = highp = cfg->continuum + cfg->ncontinuum;
+
+    while (1) {
+        midp = lowp + (highp - lowp) / 2;
+        if (midp == endp) {
+            return beginp->index;
+        }
+        uint32_t mid = midp->point;
+        uint32_t prev = (midp == beginp) ? 0 : (midp-1)->point;
+        if (digest <= mid && digest > prev) {
+            return midp->index;
+        }
+        if (mid < digest) {
+            lowp = midp + 1;
+        } else {
+            highp = midp - 1;
+        }
+        if (lowp > highp) {
+            return beginp->index;
+        }
+    }
+}
+
+TEST_F(ConfigTest, testKetamaLookup)
+{
+    const char *fnames[] = { "full_25.json", "terse_25.json", "memd_25.json",
+        "terse_30.json", "memd_30.json" };
+    unsigned nketama = 0;
+
+    for (size_t ii = 0; ii < sizeof(fnames)/sizeof(fnames[0]); ii++) {
+        string testData = getConfigFile(fnames[ii]);
+        lcbvb_CONFIG *vbc = lcbvb_create();
+        ASSERT_EQ(0, lcbvb_load_json(vbc, testData.c_str()));
+        if (vbc->dtype != LCBVB_DIST_KETAMA) {
+            lcbvb_destroy(vbc);
+            continue;
+        }
+        nketama++;
+
+        for (unsigned jj = 0; jj < 100000; jj++) {
+            char buf[64];
+            size_t nbuf = sprintf(buf, "Key_%u", jj);
+            int vbid, srvix;
+            lcbvb_map_key(vbc, buf, nbuf, &vbid, &srvix);
+            ASSERT_EQ(searchContinuum(vbc, vb__hash_ketama(buf, nbuf)), srvix);
+        }
+        lcbvb_destroy(vbc);
+    }
+    ASSERT_GT(nketama, 0);
+}
@@ -0,0 +1,126 @@
+#include <libcouchbase/couchbase.h>
+#include <libcouchbase/vbucket.h>
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <ctime>
+#include "vbucket/crc32.h"
+
+using std::string;
+using std::vector;
+
+class Crc32Test : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        // Using the full 15 bit hash space exposes the entire digest
+        cfg = lcbvb_create();
+        lcbvb_genconfig(cfg, 4, 1, 32768);
+    }
+    virtual void TearDown() {
+        lcbvb_destroy(cfg);
+    }
+    lcbvb_CONFIG *cfg;
+};
+
+// Byte-at-a-time reference implementation
+static int
+referenceHash(const string& s)
+{
+    uint32_t crc = 0xffffffff;
+    for (size_t ii = 0; ii < s.size(); ii++) {
+        crc ^= (unsigned char)s[ii];
+        for (int jj = 0; jj < 8; jj++) {
+            crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+        }
+    }
+    return ((~crc) >> 16) & 0x7fff;
+}
+
+// The original byte-at-a-time table implementation, for comparison
+static int
+tableHash(const string& s)
+{
+    uint32_t crc = UINT32_MAX;
+    for (size_t ii = 0; ii < s.size(); ii++) {
+        crc = (crc >> 8) ^ crc32tab[(crc ^ (unsigned char)s[ii]) & 0xff];
+    }
+    return ((~crc) >> 16) & 0x7fff;
+}
+
+static string
+makeKey(size_t len, unsigned seed)
+{
+    string s;
+    for (size_t ii = 0; ii < len; ii++) {
+        seed = seed * 1103515245 + 12345;
+        s += (char)(seed >> 16);
+    }
+    return s;
+}
+
+TEST_F(Crc32Test, testMatchesReference)
+{
+    // Known value from the original implementation
+    ASSERT_EQ(0x77d1, lcbvb_k2vb(cfg, "Hello", 5));
+    ASSERT_EQ(referenceHash(""), lcbvb_k2vb(cfg, "", 0));
+
+    for (size_t len = 1; len < 300; len++) {
+        string s = makeKey(len, (unsigned)len);
+        ASSERT_EQ(referenceHash(s), lcbvb_k2vb(cfg, s.c_str(), s.size()));
+        ASSERT_EQ(referenceHash(s), (int)hash_crc32(s.c_str(), s.size()));
+
+        // Unaligned input
+        string shifted = "x" + s;
+        ASSERT_EQ(referenceHash(s),
+            lcbvb_k2vb(cfg, shifted.c_str() + 1, s.size()));
+    }
+}
+
+TEST_F(Crc32Test, testMany)
+{
+    vector<string> keys;
+    vector<const void *> ptrs;
+    vector<lcb_SIZE> sizes;
+    for (unsigned ii = 0; ii < 100; ii++) {
+        keys.push_back(makeKey(ii * 3, ii));
+    }
+    for (unsigned ii = 0; ii < keys.size(); ii++) {
+        ptrs.push_back(keys[ii].c_str());
+        sizes.push_back(keys[ii].size());
+    }
+
+    vector<int> vbids(keys.size(), -1);
+    lcbvb_k2vb_many(cfg, &ptrs[0], &sizes[0], keys.size(), &vbids[0]);
+    for (unsigned ii = 0; ii < keys.size(); ii++) {
+        ASSERT_EQ(lcbvb_k2vb(cfg, keys[ii].c_str(), keys[ii].size()), vbids[ii]);
+    }
+}
+
+// Micro-benchmark. Run with --gtest_also_run_disabled_tests
+TEST_F(Crc32Test, DISABLED_benchK2vb)
+{
+    static const size_t lengths[] = { 8, 16, 32, 64, 128, 250 };
+    const unsigned niter = 2000000;
+
+    for (size_t ii = 0; ii < sizeof(lengths)/sizeof(lengths[0]); ii++) {
+        string s = makeKey(lengths[ii], 42);
+        volatile int sink = 0;
+
+        clock_t begin = clock();
+        for (unsigned jj = 0; jj < niter; jj++) {
+            sink += lcbvb_k2vb(cfg, s.c_str(), s.size());
+        }
+        double fast = (double)(clock() - begin) / CLOCKS_PER_SEC;
+
+        begin = clock();
+        for (unsigned jj = 0; jj < niter; jj++) {
+            sink += tableHash(s);
+        }
+        double ref = (double)(clock() - begin) / CLOCKS_PER_SEC;
+
+        printf("len=%3lu: k2vb %6.1f ns/key, byte table %6.1f ns/key\n",
+            (unsigned long)lengths[ii], fast * 1e9 / niter, ref * 1e9 / niter);
+        (void)sink;
+    }
+}
@@ -8,7 +8,6 @@ var ViewQuery = require('./viewQuery');
 var qstring = require('./qstring');
 var dsn = require('./dsn');
 var qs = require('querystring');
-var request = require('request');
 var dns = require('dns');
 
 var CONST = binding.Constants;
@@ -114,9 +113,14 @@ var CBpp = binding.CouchbaseImpl;
  *  value may be ignored, but its absence is indicative that each
  *  response in the <code>results</code> parameter is ok. If it
  *  is set, then at least one of the result objects failed
- * @param {Object.<string,Result>} results
+ * @param {Object.<string,Result>|Result[]} results
  *  The results of the operation as a dictionary of keys mapped to Result
- *  objects.
+ *  objects. If the <code>indexed</code> option was set, this is instead an
+ *  array holding each Result at the position of its key in the request
+ *  (or in <code>Object.keys()</code> order for a key-value object). The
+ *  dictionary form is then available as <code>results.byKey</code>, and is
+ *  only built when first accessed. This avoids per-key property insertion
+ *  for large requests.
  */
 
 /**
@@ -218,6 +222,17 @@ function Bucket(options, callback) {
   // Internal Callbacks
   this._cb._handleRestResponse = this._handleRestResponse;
 
+  if (this.queryhosts) {
+    try {
+      this._ctl(CONST.LCB_CNTL_N1QL_HOSTS, this.queryhosts);
+    } catch (e) {
+      lclcallback(e);
+    }
+  }
+
+  // Id of the last streaming view request
+  this._lastStreamId = 0;
+
   this.connected = false;
   this._cb.on('connect', function() {
     this.connected = true;
@@ -287,54 +302,137 @@ Bucket.prototype.shutdown = function() {
 };
 
 /**
- * Executes a raw N1QL query
+ * Executes a raw N1QL query, and collects all of its results.
  *
  * @param {string} query
+ * @param {Object|Array} [values]
+ *  Values for the placeholders in the query.
  * @param {Function} callback
  */
 Bucket.prototype.query = function(query, values, callback) {
-  if (this.queryhosts === null) {
-    return callback(new Error('no available query nodes'));
-  }
-
   if (arguments.length < 3) {
     callback = values;
     values = null;
   }
 
-  query = qstring.format(query, values);
+  var rows = [];
+  var error = null;
+  var stream = this.queryStream(query, values);
+  stream.on('row', function(row) {
+    rows.push(row);
+  });
+  stream.on('error', function(err) {
+    error = err;
+  });
+  stream.on('end', function() {
+    callback(error, error && !rows.length ? null : rows);
+  });
+};
+
+/**
+ * Executes a raw N1QL query, emitting its results as they are received.
+ *
+ * The query is sent to the node among the `queryhosts` passed to the
+ * constructor which has been responding the quickest, over a connection
+ * which is kept open for later queries.
+ *
+ * @param {string} query
+ * @param {Object|Array} [values]
+ *  Values for the placeholders in the query.
+ * @returns {ViewStream}
+ *  Emits each result as a `row` event, and the rest of the response as a
+ *  `meta` event.
+ */
+Bucket.prototype.queryStream = function(query, values) {
+  var stream = new ViewQuery.ViewStream();
+
+  if (!this.queryhosts) {
+    process.nextTick(function() {
+      stream._end(new Error('no available query nodes'), null);
+    });
+    return stream;
+  }
+
+  this._query(qstring.format(query, values), stream);
+  return stream;
+};
+
+/**
+ * Creates the error for the errors reported in a N1QL response.
+ *
+ * @param {Object} res
+ * @returns {Error}
+ *
+ * @private
+ * @ignore
+ */
+function _queryError(res) {
+  var inner = res.error;
+  var msg;
+  if (inner) {
+    msg = inner.cause;
+  } else if (res.errors && res.errors.length) {
+    inner = res.errors;
+    msg = inner[0].msg;
+  } else {
+    return null;
+  }
+
+  var errObj = new Error('Query error: ' + msg);
+  // TODO: CONST['ErrorCode::QUERY'];
+  errObj.code = 999;
+  errObj.inner = inner;
+  return errObj;
+}
 
-  var qhosts = this.queryhosts;
-  var host = qhosts[Math.floor(Math.random()*qhosts.length)];
-  var uri = 'http://' + host + '/query';
+/**
+ * Executes a N1QL http request, delivering its results to a ViewStream as
+ * they are received.
+ *
+ * @param {string} query
+ * @param {ViewStream} stream
+ *
+ * @private
+ * @ignore
+ */
+Bucket.prototype._query = function(query, stream) {
+  var self = this;
+  var id = ++this._lastStreamId;
+  stream._setControl({
+    pause: function() { self._cb.httpPause(id); },
+    resume: function() { self._cb.httpResume(id); }
+  });
 
-  request.post({uri: uri, body: query}, function (err, resp, body) {
-    if (err) {
-      return callback(err);
+  this._cb.httpRequest.call(this._cb, null, {
+    path: '/query',
+    data: query,
+    content_type: 'text/plain',
+    lcb_http_type: CONST.LCB_HTTP_TYPE_N1QL,
+    method: CONST.LCB_HTTP_METHOD_POST,
+    stream: id
+  }, function(error, response) {
+    if (response && response.rows) {
+      return stream._addRows(response.rows);
+    }
+    if (!response || response.data === undefined) {
+      return stream._end(error, null);
     }
 
     var res = null;
     try {
-      res = JSON.parse(body);
+      res = JSON.parse(response.data);
     } catch (e) {
-      return callback(new Error('failed to parse query response as json'));
+      return stream._end(
+        error || new Error('failed to parse query response as json'), null);
     }
 
-    var errObj = null;
-    if (res.error) {
-      errObj = new Error('Query error: ' + res.error.cause);
-      // TODO: CONST['ErrorCode::QUERY'];
-      errObj.code = 999;
-      if (body.inner) {
-        errObj.inner = res.error;
-      }
-    }
-
-    if (res.resultset) {
-      return callback(errObj, res.resultset);
-    } else {
-      return callback(errObj, null);
+    var errObj = _queryError(res);
+    if (errObj) {
+      error = errObj;
+    } else if (!error && (response.status < 200 || response.status > 299)) {
+      error = new Error('HTTP error ' + response.status);
     }
+    stream._end(error, res);
   });
 };
 
@@ -363,6 +461,50 @@ Bucket.prototype._view = function(ddoc, name, q, callback) {
   }, callback);
 };
 
+/**
+ * Executes a view http request, delivering its rows to a ViewStream as they
+ * are received rather than once the whole response has been read.
+ *
+ * @param {string} ddoc
+ * @param {string} name
+ * @param {Object} q
+ * @param {ViewStream} stream
+ *
+ * @private
+ * @ignore
+ */
+Bucket.prototype._viewStream = function(ddoc, name, q, stream) {
+  var self = this;
+  var viewtype = '_view';
+  if (q.spatial) {
+    viewtype = '_spatial';
+  }
+
+  var id = ++this._lastStreamId;
+  stream._setControl({
+    pause: function() { self._cb.httpPause(id); },
+    resume: function() { self._cb.httpResume(id); }
+  });
+
+  this._cb.httpRequest.call(this._cb, null, {
+    path: '_design/' + ddoc + '/' + viewtype + '/' + name + '?' +
+      qs.stringify(q),
+    lcb_http_type: CONST.LCB_HTTP_TYPE_VIEW,
+    method: CONST.LCB_HTTP_METHOD_GET,
+    stream: id
+  }, function(error, response) {
+    if (response && response.rows) {
+      return stream._addRows(response.rows);
+    }
+    if (!response || response.data === undefined) {
+      return stream._end(error, null);
+    }
+    self._handleRestResponse(error, response, function(err, rows, misc) {
+      stream._end(err, misc);
+    });
+  });
+};
+
 /**
  * Handles the parsing of HTTP raw response data into an end-user operable
  * format.  Handlers parsing of errors within the body as well as invalid
@@ -544,10 +686,14 @@ Bucket.prototype._interceptEndure =
     var _this = this;
     return function(err, results) {
       var endure_kv = {};
+      var spooled_results = results;
 
       if(globalOptions.spooled) {
         // returns object of results
         var endure_count = 0;
+        if (globalOptions.indexed) {
+          results = results.byKey;
+        }
         for(var result_key in results) {
           if (results.hasOwnProperty(result_key)) {
             if (!results[result_key].error) {
@@ -560,7 +706,7 @@ Bucket.prototype._interceptEndure =
         }
 
         if (endure_count < 0) {
-          callback(err, results);
+          callback(err, spooled_results);
           return;
         }
 
@@ -573,7 +719,7 @@ Bucket.prototype._interceptEndure =
                 }
               }
             }
-            callback(err||endure_err, results);
+            callback(err||endure_err, spooled_results);
           });
 
       } else {
@@ -692,6 +838,69 @@ Bucket.prototype._arithHelper = function(dfl, argList) {
     this._interceptEndure(key, kdict, {}, false, callback));
 };
 
+/**
+ * Invokes a batch of single-key callbacks delivered by the native layer
+ * in one call.  An exception thrown by one callback does not prevent the
+ * remaining callbacks from running; the first one is rethrown afterwards.
+ *
+ * @param {Array} items
+ *  A flat list of [callback, error, result, ...] entries.
+ *
+ * @private
+ * @ignore
+ */
+function _dispatchCallbacks(items) {
+  var thrown = false, exc;
+  for (var i = 0; i < items.length; i += 3) {
+    try {
+      if (items[i + 2] === undefined) {
+        items[i](items[i + 1]);
+      } else {
+        items[i](items[i + 1], items[i + 2]);
+      }
+    } catch (e) {
+      if (!thrown) {
+        thrown = true;
+        exc = e;
+      }
+    }
+  }
+  if (thrown) {
+    throw exc;
+  }
+}
+
+/**
+ * Adds a lazily built key to result mapping to an indexed result array.
+ *
+ * @param {string[]|Object} kv
+ *  The keys (or key-value object) of the original request.
+ * @param {Object[]} results
+ *  The results, at the same positions as the keys in the request.
+ *
+ * @private
+ * @ignore
+ */
+function _addKeyView(kv, results) {
+  var view = null;
+  Object.defineProperty(results, 'byKey', {
+    get: function() {
+      if (!view) {
+        var keys = Array.isArray(kv) ? kv : Object.keys(kv);
+        view = {};
+        for (var i = 0; i < keys.length; ++i) {
+          if (results[i] !== undefined) {
+            view[keys[i]] = results[i];
+          }
+        }
+      }
+      return view;
+    },
+    enumerable: false
+  });
+  return results;
+}
+
 /**
  * Performs a *Multi operation, while wrapping the user callback in
  * an endure intercept at the same time.  It additionally will ensure the
@@ -712,8 +921,19 @@ Bucket.prototype._multiHelper = function(target, argList) {
       }
     }
   }
-  target.call(this._cb, argList[0], options,
-    this._interceptEndure(null, argList[0], options, false, argList[2]));
+  var callback =
+    this._interceptEndure(null, argList[0], options, false, argList[2]);
+  if (options.indexed && options.spooled) {
+    var kv = argList[0];
+    var userCallback = callback;
+    callback = function(err, results) {
+      if (Array.isArray(results)) {
+        _addKeyView(kv, results);
+      }
+      userCallback(err, results);
+    };
+  }
+  target.call(this._cb, argList[0], options, callback);
 };
 
 /**
@@ -1207,6 +1427,7 @@ Bucket.prototype.observe = function(key, options, callback) {
  *  @param {format} [kv.format]
  * @param {Object.<string,Object>} options
  *  @param {boolean} [options.spooled]
+ *  @param {boolean} [options.indexed]
  *  @param {integer} [options.expiry]
  *  @param {integer} [options.flags]
  *  @param {format} [options.format]
@@ -1260,6 +1481,7 @@ Bucket.prototype.setMulti = function(kv, options, callback) {
  *  @param {format} [kv.format]
  * @param {Object.<string,Object>} options
  *  @param {boolean} [options.spooled]
+ *  @param {boolean} [options.indexed]
  *  @param {integer} [options.expiry]
  *  @param {integer} [options.flags]
  *  @param {format} [options.format]
@@ -1291,6 +1513,7 @@ Bucket.prototype.addMulti = function(kv, options, callback) {
  *  @param {format} [kv.format]
  * @param {Object.<string,Object>} options
  *  @param {boolean} [options.spooled]
+ *  @param {boolean} [options.indexed]
  *  @param {integer} [options.expiry]
  *  @param {integer} [options.flags]
  *  @param {format} [options.format]
@@ -1313,6 +1536,7 @@ Bucket.prototype.replaceMulti = function(kv, options, callback) {
  *  @param {integer} [kv.expiry]
  * @param {Object.<string,Object>} options
  *  @param {boolean} [options.spooled]
+ *  @param {boolean} [options.indexed]
  *  @param {integer} [options.expiry]
  *  @param {integer} [options.persist_to]
  *  @param {integer} [options.replicate_to]
@@ -1333,6 +1557,7 @@ Bucket.prototype.appendMulti = function(kv, options, callback) {
  *  @param {integer} [kv.expiry]
  * @param {Object.<string,Object>} options
  *  @param {boolean} [options.spooled]
+ *  @param {boolean} [options.indexed]
  *  @param {integer} [options.expiry]
  *  @param {integer} [options.persist_to]
  *  @param {integer} [options.replicate_to]
@@ -1350,6 +1575,7 @@ Bucket.prototype.prependMulti = function(kv, options, callback) {
  * @param {string[]} kv
  * @param {Object.<string,Object>} options
  *  @param {boolean} [options.spooled]
+ *  @param {boolean} [options.indexed]
  *  @param {format} [options.format]
  * @param {MultiCallback|KeyCallback} callback
  *
@@ -1365,6 +1591,7 @@ Bucket.prototype.getMulti = function(kv, options, callback) {
  * @param {string[]} kv
  * @param {Object.<string,Object>} options
  *  @param {boolean} [options.spooled]
+ *  @param {boolean} [options.indexed]
  *  @param {format} [options.format]
  * @param {MultiCallback|KeyCallback} callback
  *
@@ -1382,6 +1609,7 @@ Bucket.prototype.getReplicaMulti = function(kv, options, callback) {
  *  @param {integer} [kv.expiry]
  * @param {Object.<string,Object>} options
  *  @param {boolean} [options.spooled]
+ *  @param {boolean} [options.indexed]
  *  @param {integer} [options.expiry]
  *  @param {integer} [options.persist_to]
  *  @param {integer} [options.replicate_to]
@@ -1399,6 +1627,7 @@ Bucket.prototype.touchMulti = function(kv, options, callback) {
  * @param {string[]} kv
  * @param {Object.<string,Object>} options
  *  @param {boolean} [options.spooled]
+ *  @param {boolean} [options.indexed]
  *  @param {format} [options.format]
  * @param {MultiCallback|KeyCallback} callback
  *
@@ -1415,6 +1644,7 @@ Bucket.prototype.lockMulti = function(kv, options, callback) {
  *  @param {CAS} kv.cas
  * @param {Object.<string,Object>} options
  *  @param {boolean} [options.spooled]
+ *  @param {boolean} [options.indexed]
  * @param {MultiCallback|KeyCallback} callback
  *
  * @see Bucket#unlock
@@ -1430,6 +1660,7 @@ Bucket.prototype.unlockMulti = function(kv, options, callback) {
  *  @param {CAS} [kv.cas]
  * @param {Object.<string,Object>} options
  *  @param {boolean} [options.spooled]
+ *  @param {boolean} [options.indexed]
  *  @param {integer} [options.persist_to]
  *  @param {integer} [options.replicate_to]
  * @param {MultiCallback|KeyCallback} callback
@@ -1451,6 +1682,7 @@ Bucket.prototype.removeMulti = function(kv, options, callback) {
  *  @param {integer} [kv.expiry]
  * @param {Object.<string,Object>} options
  *  @param {boolean} [options.spooled]
+ *  @param {boolean} [options.indexed]
  *  @param {integer} [kv.offset]
  *  @param {integer} [kv.initial]
  *  @param {integer} [options.expiry]
@@ -1472,6 +1704,7 @@ Bucket.prototype.arithmeticMulti = function(kv, options, callback) {
  *  @param {CAS} kv.cas
  * @param {Object.<string,Object>} options
  *  @param {boolean} [options.spooled]
+ *  @param {boolean} [options.indexed]
  * @param {MultiCallback|KeyCallback} callback
  *
  * @see Bucket#observe
@@ -1560,6 +1793,331 @@ Object.defineProperty(Bucket.prototype, 'connectionTimeout', {
   }
 });
 
+/**
+ * Gets or sets the size in bytes at which raw (Buffer) values are passed
+ * between JavaScript and the network without being copied.
+ *
+ * A Buffer returned by a get operation then references the received network
+ * data directly, and keeps the underlying network buffer alive until it is
+ * garbage collected. A Buffer passed to a storage operation is sent as-is,
+ * and must not be modified until the operation's callback has been invoked.
+ * This is best reserved for large values. A value of 0 disables this.
+ *
+ * @member {integer} Bucket#zeroCopyThreshold
+ * @default 0
+ */
+Object.defineProperty(Bucket.prototype, 'zeroCopyThreshold', {
+  get: function() {
+    return this._ctl(CONST.CNTL_ZEROCOPY_THRESHOLD);
+  },
+  set: function(val) {
+    this._ctl(CONST.CNTL_ZEROCOPY_THRESHOLD, val);
+  }
+});
+
+/**
+ * Gets or sets whether per-key callbacks are delivered in batches.
+ *
+ * When enabled, responses received during one iteration of the event loop
+ * are handed to JavaScript together, and their callbacks are then invoked
+ * in order. This greatly reduces the cost of many small operations, at the
+ * price of delaying each callback until the end of the current I/O pass.
+ *
+ * @member {boolean} Bucket#batchCallbacks
+ * @default false
+ */
+Object.defineProperty(Bucket.prototype, 'batchCallbacks', {
+  get: function() {
+    return this._ctl(CONST.CNTL_CALLBACK_BATCHING);
+  },
+  set: function(val) {
+    this._ctl(CONST.CNTL_CALLBACK_BATCHING, val ? _dispatchCallbacks : false);
+  }
+});
+
+/**
+ * Gets or sets the maximum number of bytes of idle command buffers kept for
+ * reuse by this bucket. Setting it to 0 disables pooling.
+ *
+ * @member {integer} Bucket#bufferPoolSize
+ * @default 16777216
+ */
+Object.defineProperty(Bucket.prototype, 'bufferPoolSize', {
+  get: function() {
+    return this._ctl(CONST.CNTL_BUFFERPOOL_SIZE);
+  },
+  set: function(val) {
+    this._ctl(CONST.CNTL_BUFFERPOOL_SIZE, val);
+  }
+});
+
+/**
+ * Get usage counters for the pool of buffers used to encode keys and values,
+ * as an object with `hits` and `misses` (allocations which did or did not
+ * reuse a pooled buffer), `discarded` (buffers freed rather than pooled) and
+ * `cachedBytes` (the number of bytes currently idle in the pool).
+ *
+ * @member {Object} Bucket#bufferPoolStats
+ */
+Object.defineProperty(Bucket.prototype, 'bufferPoolStats', {
+  get: function() {
+    return this._ctl(CONST.CNTL_BUFFERPOOL_STATS);
+  },
+  writeable: false
+});
+
+/**
+ * Gets or sets the number of recently used keys whose encoded form (and
+ * vBucket) is cached by this bucket, which speeds up workloads repeatedly
+ * accessing the same keys. Setting it to 0 disables and clears the cache.
+ *
+ * @member {integer} Bucket#keyCacheSize
+ * @default 0
+ */
+Object.defineProperty(Bucket.prototype, 'keyCacheSize', {
+  get: function() {
+    return this._ctl(CONST.CNTL_KEYCACHE_SIZE);
+  },
+  set: function(val) {
+    this._ctl(CONST.CNTL_KEYCACHE_SIZE, val);
+  }
+});
+
+/**
+ * Get usage counters for the key cache, as an object with `hits`, `misses`,
+ * `evictions` and `size` (the number of keys currently cached).
+ *
+ * @member {Object} Bucket#keyCacheStats
+ */
+Object.defineProperty(Bucket.prototype, 'keyCacheStats', {
+  get: function() {
+    return this._ctl(CONST.CNTL_KEYCACHE_STATS);
+  },
+  writeable: false
+});
+
+/**
+ * Enables or disables per-server, per-operation latency tracking. When
+ * enabled, the latency of every operation is recorded into a histogram
+ * which can be read using {@link Bucket#latencySnapshot}.
+ *
+ * @member {boolean} Bucket#latencyTracking
+ * @default false
+ */
+Object.defineProperty(Bucket.prototype, 'latencyTracking', {
+  get: function() {
+    return this._ctl(CONST.CNTL_LATENCY_TRACKING);
+  },
+  set: function(val) {
+    this._ctl(CONST.CNTL_LATENCY_TRACKING, val);
+  }
+});
+
+/**
+ * Returns the latencies recorded since tracking was enabled, or since the
+ * last reset. The result is keyed by server (as `host:port`) and then by
+ * operation, and each entry holds the `count` of operations along with their
+ * `min`, `max`, `mean`, `p50`, `p99` and `p999` latencies in microseconds.
+ * Percentiles are accurate to within about 3%.
+ *
+ * @param {boolean} [reset=false]
+ * Whether to reset the histograms once they have been read.
+ * @returns {Object}
+ *
+ * @see Bucket#latencyTracking
+ */
+Bucket.prototype.latencySnapshot = function(reset) {
+  if (reset) {
+    return this._ctl(CONST.CNTL_LATENCY_SNAPSHOT, true);
+  } else {
+    return this._ctl(CONST.CNTL_LATENCY_SNAPSHOT);
+  }
+};
+
+/**
+ * Gets or sets how values are compressed. Setting this merges the given
+ * fields into the current policy.
+ *
+ * `mode` is one of `'off'`, `'inflate_only'` (only inflate compressed values
+ * received from the server), `'on'` (also compress outgoing values) or
+ * `'force'` (compress even before the server has announced support).
+ * Outgoing values smaller than `minSize` bytes, or which shrink by less than
+ * a factor of `minRatio`, are sent uncompressed. When values sharing a key
+ * prefix repeatedly fail to compress, only one in up to `maxSampleInterval`
+ * of them is tried.
+ *
+ * @member {Object} Bucket#compression
+ * @default {mode: 'off', minSize: 32, minRatio: 1.1, maxSampleInterval: 64}
+ */
+Object.defineProperty(Bucket.prototype, 'compression', {
+  get: function() {
+    return this._ctl(CONST.CNTL_COMPRESSION_POLICY);
+  },
+  set: function(val) {
+    this._ctl(CONST.CNTL_COMPRESSION_POLICY, val);
+  }
+});
+
+/**
+ * Returns the counters for outgoing value compression: the number of
+ * `values` considered, how many were `compressed`, how many were skipped
+ * as `tooSmall`, `backedOff` because of their key prefix or `rejected` for
+ * not compressing well enough, along with the `bytesSaved` and the
+ * `cpuTime` spent compressing, in milliseconds.
+ *
+ * @member {Object} Bucket#compressionStats
+ */
+Object.defineProperty(Bucket.prototype, 'compressionStats', {
+  get: function() {
+    return this._ctl(CONST.CNTL_COMPRESSION_STATS);
+  },
+  writeable: false
+});
+
+/**
+ * Gets or sets the sizing of the pool of connections to the data nodes.
+ * Setting this merges the given fields into the current options.
+ *
+ * `minIdle` connections per node are opened in the background and kept open
+ * while idle, so that a failed connection can be replaced without waiting
+ * for a connect. At most `maxIdle` idle connections are kept per node, for
+ * at most `idleTimeout` milliseconds, and no more than `maxTotal` are opened
+ * (0 for no limit).
+ *
+ * @member {Object} Bucket#connectionPool
+ * @default {minIdle: 0, maxIdle: 1, maxTotal: 0, idleTimeout: 10000}
+ */
+Object.defineProperty(Bucket.prototype, 'connectionPool', {
+  get: function() {
+    return this._ctl(CONST.CNTL_CONNPOOL_OPTS);
+  },
+  set: function(val) {
+    this._ctl(CONST.CNTL_CONNPOOL_OPTS, val);
+  }
+});
+
+/**
+ * Returns the state of the connection pool, keyed by node (as `host:port`).
+ * Each entry holds the number of requests `waiters` for a connection, and
+ * of connections `idle`, `pending`, `leased` and in `total`, along with the
+ * count of `connects` and `connectErrors` and the average and maximum
+ * connect latency (`connectTimeAvg`, `connectTimeMax`) in milliseconds.
+ *
+ * @member {Object} Bucket#connectionPoolStats
+ */
+Object.defineProperty(Bucket.prototype, 'connectionPoolStats', {
+  get: function() {
+    return this._ctl(CONST.CNTL_CONNPOOL_STATS);
+  },
+  writeable: false
+});
+
+/**
+ * Gets or sets the connections used for key-value operations. Setting this
+ * merges the given fields into the current options.
+ *
+ * `count` connections are opened to each data node, and each operation is
+ * sent on the one with the fewest bytes awaiting a response. If
+ * `largeValueSize` is non-zero (and `count` is more than 1), values of at
+ * least that many bytes are sent on a connection of their own, so that they
+ * do not hold up smaller operations.
+ *
+ * @member {Object} Bucket#kvConnections
+ * @default {count: 1, largeValueSize: 0}
+ */
+Object.defineProperty(Bucket.prototype, 'kvConnections', {
+  get: function() {
+    return this._ctl(CONST.CNTL_KV_CONNECTIONS);
+  },
+  set: function(val) {
+    this._ctl(CONST.CNTL_KV_CONNECTIONS, val);
+  }
+});
+
+/**
+ * Returns the totals of the writes made to the data nodes since the bucket
+ * was opened: the number of `writes`, and the `bytes` and `buffers` passed
+ * to them. `bytes / writes` is the average size of a write. Small buffers
+ * may be copied together so that they are written as one; `coalescedBytes`
+ * counts the bytes copied in this way.
+ *
+ * @member {Object} Bucket#writeStats
+ */
+Object.defineProperty(Bucket.prototype, 'writeStats', {
+  get: function() {
+    return this._ctl(CONST.CNTL_WRITE_STATS);
+  },
+  writeable: false
+});
+
+/**
+ * Returns the totals of the work done to apply new cluster maps since the
+ * bucket was opened: the number of maps `applied`, the number of queued
+ * operations `checked` for a change in their vBucket's node and the number
+ * `relocated` to another node. Operations queued for nodes which kept all of
+ * their vBuckets are not checked; `skipped` counts them. `totalTime` and
+ * `lastTime` are the time spent applying all the maps and the last one, in
+ * milliseconds.
+ *
+ * @member {Object} Bucket#configStats
+ */
+Object.defineProperty(Bucket.prototype, 'configStats', {
+  get: function() {
+    return this._ctl(CONST.CNTL_CONFIG_STATS);
+  },
+  writeable: false
+});
+
+/**
+ * Get the latency of each of the N1QL query nodes, as an object keyed by
+ * `host:port`. Each entry has the moving average of the time taken for a
+ * response to start arriving (`latency`, in milliseconds, 0 until the node
+ * has been queried), the number of queries awaiting a response (`inflight`)
+ * and whether the last query sent to the node failed (`failed`).
+ *
+ * Queries are sent to the node with the lowest latency, taking the queries
+ * already in flight to each node into account.
+ *
+ * @member {Object} Bucket#queryHostStats
+ */
+Object.defineProperty(Bucket.prototype, 'queryHostStats', {
+  get: function() {
+    return this._ctl(CONST.LCB_CNTL_N1QL_HOSTS);
+  },
+  writeable: false
+});
+
+/**
+ * Gets or sets the maximum number of idle per-operation state objects kept
+ * for reuse by this bucket. Setting it to 0 disables pooling.
+ *
+ * @member {integer} Bucket#cookiePoolSize
+ * @default 1024
+ */
+Object.defineProperty(Bucket.prototype, 'cookiePoolSize', {
+  get: function() {
+    return this._ctl(CONST.CNTL_COOKIEPOOL_SIZE);
+  },
+  set: function(val) {
+    this._ctl(CONST.CNTL_COOKIEPOOL_SIZE, val);
+  }
+});
+
+/**
+ * Get usage counters for the pool of per-operation state objects, as an
+ * object with `hits` and `misses` (operations which did or did not reuse a
+ * pooled object), `inUse`, `highWater` (the most ever in use at once) and
+ * `free` (the number currently idle in the pool).
+ *
+ * @member {Object} Bucket#cookiePoolStats
+ */
+Object.defineProperty(Bucket.prototype, 'cookiePoolStats', {
+  get: function() {
+    return this._ctl(CONST.CNTL_COOKIEPOOL_STATS);
+  },
+  writeable: false
+});
+
 /**
  * Get information about the libcouchbase version being used as an array of
  * [versionNumber, versionString], where versionNumber is a hexadecimal number
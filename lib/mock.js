@@ -1191,6 +1191,18 @@ BucketMock.prototype._view = function(ddoc, name, options, callback) {
   });
 };
 
+BucketMock.prototype._viewStream = function(ddoc, name, options, stream) {
+  var self = this;
+  process.nextTick(function() {
+    self._view(ddoc, name, options, function(err, results, meta) {
+      if (results) {
+        stream._addRows(results);
+      }
+      stream._end(err, meta);
+    });
+  });
+};
+
 BucketMock.prototype.view = function(ddoc, name, query) {
   var vq = query === undefined ? {} : query;
   return new ViewQuery(this, ddoc, name, vq);
@@ -1,5 +1,8 @@
 'use strict';
 
+var util = require('util');
+var EventEmitter = require('events').EventEmitter;
+
 var DEFAULT_LIMIT = 10;
 
 function extend(dest, src) {
@@ -154,6 +157,167 @@ Paginator.prototype.prev = function(callback) {
   return this;
 };
 
+/**
+ * @class ViewStream
+ * @classdesc
+ * Emits the rows of a view query, or the results of a N1QL query, as they
+ * are received from the server.
+ * This class is instantiated by using the {@link ViewQuery#stream} and
+ * {@link Bucket#queryStream} methods.
+ *
+ * @private
+ */
+
+/**
+ * Emitted for each row of the result set.
+ *
+ * @event ViewStream#row
+ * @param {object} row
+ */
+
+/**
+ * Emitted once all of the rows have been emitted.
+ *
+ * @event ViewStream#meta
+ * @param {object} meta
+ *  @param {integer} meta.total_rows
+ *  The total number of rows available in the view.
+ */
+
+/**
+ * Emitted if the query failed, or if some of the nodes reported errors.
+ *
+ * @event ViewStream#error
+ * @param {Error|Error[]} error
+ */
+
+/**
+ * Emitted last, whether or not the query succeeded.
+ *
+ * @event ViewStream#end
+ */
+
+/**
+ * @constructor
+ *
+ * @private
+ * @ignore
+ */
+function ViewStream() {
+  EventEmitter.call(this);
+  this._paused = false;
+  this._pending = [];
+  this._result = null;
+  this._control = null;
+}
+util.inherits(ViewStream, EventEmitter);
+
+/**
+ * Sets the object used to pause and resume the underlying request.
+ *
+ * @private
+ * @ignore
+ */
+ViewStream.prototype._setControl = function(control) {
+  this._control = control;
+};
+
+/**
+ * Emits a batch of rows, or holds on to them while paused.
+ *
+ * @private
+ * @ignore
+ */
+ViewStream.prototype._addRows = function(rows) {
+  for (var i = 0; i < rows.length; ++i) {
+    var row = rows[i];
+    if (typeof row === 'string') {
+      // Rows which could not be decoded natively
+      try {
+        row = JSON.parse(row);
+      } catch (e) {
+        this.emit('error', new Error('Invalid JSON in row'));
+        continue;
+      }
+    }
+    if (this._paused) {
+      this._pending.push(row);
+    } else {
+      this.emit('row', row);
+    }
+  }
+};
+
+/**
+ * Finishes the stream, once all of the rows have been emitted.
+ *
+ * @private
+ * @ignore
+ */
+ViewStream.prototype._end = function(err, meta) {
+  this._result = { error: err, meta: meta };
+  if (!this._paused) {
+    this._finish();
+  }
+};
+
+/**
+ * Emits the outcome of the query.
+ *
+ * @private
+ * @ignore
+ */
+ViewStream.prototype._finish = function() {
+  var res = this._result;
+  this._result = null;
+  this._control = null;
+
+  if (res.error) {
+    this.emit('error', res.error);
+  }
+  if (res.meta) {
+    this.emit('meta', res.meta);
+  }
+  this.emit('end');
+};
+
+/**
+ * Stops the emission of rows. Reading of the response from the network is
+ * also paused, so that rows do not pile up in memory.
+ */
+ViewStream.prototype.pause = function() {
+  if (this._paused) {
+    return;
+  }
+  this._paused = true;
+  if (this._control) {
+    this._control.pause();
+  }
+};
+
+/**
+ * Resumes the emission of rows after {@link ViewStream#pause}.
+ */
+ViewStream.prototype.resume = function() {
+  if (!this._paused) {
+    return;
+  }
+  this._paused = false;
+
+  while (this._pending.length && !this._paused) {
+    this.emit('row', this._pending.shift());
+  }
+  if (this._paused) {
+    return;
+  }
+
+  if (this._result) {
+    this._finish();
+  } else if (this._control) {
+    this._control.resume();
+  }
+};
+
 /**
  * @class ViewQuery
  * @classdesc
@@ -235,6 +399,22 @@ ViewQuery.prototype.query = function(q, callback) {
   return this;
 };
 
+/**
+ * Query for result set, emitting the rows as they are received from the
+ * server instead of collecting them all before invoking a callback. This is
+ * preferable for large result sets.
+ *
+ * @param {object} q key,value pairs supplying additional set of query
+ *    parameters to be used for this queries.
+ * @returns {ViewStream}
+ */
+ViewQuery.prototype.stream = function(q) {
+  var qe = extend( extend({}, this.q), normalizeQuery(q || {}) );
+  var stream = new ViewStream();
+  this._cb._viewStream(this.ddoc, this.name, qe, stream);
+  return stream;
+};
+
 /**
  * Clone this query instance, with a new set of initial parameters overriding
  * current set.
@@ -309,3 +489,4 @@ ViewQuery.prototype._request = function(q, callback) {
 };
 
 module.exports = ViewQuery;
+module.exports.ViewStream = ViewStream;
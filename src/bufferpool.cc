@@ -0,0 +1,136 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "couchbase_impl.h"
+
+using namespace Couchnode;
+
+BufferPool::~BufferPool()
+{
+    for (unsigned int ii = 0; ii < NUM_CLASSES; ii++) {
+        for (size_t jj = 0; jj < freeLists[ii].size(); jj++) {
+            delete[] freeLists[ii][jj];
+        }
+    }
+}
+
+int BufferPool::classOf(size_t n)
+{
+    // Only exact powers of two within range belong to a class
+    if (n & (n - 1)) {
+        return -1;
+    }
+    for (unsigned int ii = 0; ii < NUM_CLASSES; ii++) {
+        if (n == ((size_t)1 << (ii + MIN_SHIFT))) {
+            return ii;
+        }
+    }
+    return -1;
+}
+
+char *BufferPool::acquire(size_t *n)
+{
+    size_t size = (size_t)1 << MIN_SHIFT;
+    unsigned int ix = 0;
+    while (size < *n && ix < NUM_CLASSES - 1) {
+        size <<= 1;
+        ix++;
+    }
+
+    if (size < *n) {
+        // Larger than any class
+        misses++;
+        return new (std::nothrow) char[*n];
+    }
+
+    *n = size;
+    if (!freeLists[ix].empty()) {
+        char *ret = freeLists[ix].back();
+        freeLists[ix].pop_back();
+        cached -= size;
+        hits++;
+        return ret;
+    }
+
+    misses++;
+    return new (std::nothrow) char[size];
+}
+
+void BufferPool::release(char *buf, size_t capacity)
+{
+    if (!buf) {
+        return;
+    }
+
+    int ix = classOf(capacity);
+    if (ix < 0 || cached + capacity > maxCached) {
+        delete[] buf;
+        discarded++;
+        return;
+    }
+
+    freeLists[ix].push_back(buf);
+    cached += capacity;
+}
+
+void BufferPool::takeChunkList(std::vector<BufferChunk> &chunks)
+{
+    if (!spareChunkLists.empty()) {
+        chunks.swap(spareChunkLists.back());
+        spareChunkLists.pop_back();
+    }
+}
+
+void BufferPool::returnChunkList(std::vector<BufferChunk> &chunks)
+{
+    if (chunks.capacity() == 0 || spareChunkLists.size() >= 8) {
+        return;
+    }
+    chunks.clear();
+    spareChunkLists.push_back(std::vector<BufferChunk>());
+    spareChunkLists.back().swap(chunks);
+}
+
+void BufferPool::setMaxCached(size_t n)
+{
+    maxCached = n;
+    trim();
+}
+
+void BufferPool::trim()
+{
+    // Drop the largest buffers first
+    for (int ii = NUM_CLASSES - 1; ii >= 0 && cached > maxCached; ii--) {
+        size_t size = (size_t)1 << (ii + MIN_SHIFT);
+        while (!freeLists[ii].empty() && cached > maxCached) {
+            delete[] freeLists[ii].back();
+            freeLists[ii].pop_back();
+            cached -= size;
+            discarded++;
+        }
+    }
+}
+
+Handle<Object> BufferPool::getStats() const
+{
+    Handle<Object> ret = NanNew<Object>();
+    ret->Set(NanNew<String>("hits"), NanNew<Number>((double)hits));
+    ret->Set(NanNew<String>("misses"), NanNew<Number>((double)misses));
+    ret->Set(NanNew<String>("discarded"), NanNew<Number>((double)discarded));
+    ret->Set(NanNew<String>("cachedBytes"), NanNew<Number>((double)cached));
+    return ret;
+}
@@ -0,0 +1,111 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef COUCHNODE_BUFFERPOOL_H
+#define COUCHNODE_BUFFERPOOL_H 1
+
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+namespace Couchnode
+{
+
+struct BufferChunk {
+    char *data;
+    size_t capacity;
+};
+
+/**
+ * Per-instance cache of command buffers in power-of-two size classes.
+ *
+ * BufferLists borrow their chunks from here and hand them back when the
+ * command is destroyed, so repeated commands of a similar shape stop
+ * allocating once the pool has warmed up. Requests larger than the largest
+ * class are allocated and freed directly. All buffers are allocated with
+ * new[], so any buffer may safely be handed to release().
+ */
+class BufferPool
+{
+public:
+    static const unsigned int MIN_SHIFT = 10; // 1KB
+    static const unsigned int MAX_SHIFT = 20; // 1MB
+    static const unsigned int NUM_CLASSES = MAX_SHIFT - MIN_SHIFT + 1;
+    static const size_t DEFAULT_MAX_CACHED = 16 * 1024 * 1024;
+
+    BufferPool() : maxCached(DEFAULT_MAX_CACHED), cached(0),
+        hits(0), misses(0), discarded(0) {}
+    ~BufferPool();
+
+    /**
+     * Returns a buffer of at least *n bytes. On return, *n holds the
+     * actual capacity, which must be passed back to release().
+     */
+    char *acquire(size_t *n);
+    void release(char *buf, size_t capacity);
+
+    // Lends out (and takes back) the chunk list of a BufferList, so that
+    // its storage is reused as well
+    void takeChunkList(std::vector<BufferChunk> &chunks);
+    void returnChunkList(std::vector<BufferChunk> &chunks);
+
+    // Maximum number of bytes kept idle across all size classes. Shrinking
+    // the limit frees any excess right away.
+    size_t getMaxCached() const { return maxCached; }
+    void setMaxCached(size_t n);
+
+    v8::Handle<v8::Object> getStats() const;
+
+private:
+    // Returns the class holding buffers of exactly n bytes, or -1
+    static int classOf(size_t n);
+
+    std::vector<char *> freeLists[NUM_CLASSES];
+    std::vector<std::vector<BufferChunk> > spareChunkLists;
+    size_t maxCached;
+    size_t cached;
+
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t discarded;
+
+    void trim();
+
+    // No copying
+    BufferPool(BufferPool&);
+};
+
+// These fall back to plain new[] and delete[] when there is no pool
+inline char *poolAcquire(BufferPool *pool, size_t *n)
+{
+    if (pool) {
+        return pool->acquire(n);
+    }
+    return new (std::nothrow) char[*n];
+}
+
+inline void poolRelease(BufferPool *pool, char *buf, size_t capacity)
+{
+    if (pool) {
+        pool->release(buf, capacity);
+    } else {
+        delete[] buf;
+    }
+}
+
+} // namespace Couchnode
+#endif // COUCHNODE_BUFFERPOOL_H
@@ -18,6 +18,7 @@
 #ifndef COUCHNODE_BUFLIST_H
 #define COUCHNODE_BUFLIST_H
 #include <cstdlib>
+#include "bufferpool.h"
 namespace Couchnode
 {
 
@@ -30,8 +31,17 @@ public:
      *
      * For now, it serves as a convenient place to allocate all our string
      * pointers without each command worrying about freeing them.
+     *
+     * Chunks are borrowed from the instance's BufferPool, if any, and
+     * returned to it when the list is destroyed. Each new chunk is twice
+     * the size of the previous one, up to maxChunkSize.
      */
-    BufferList() : curBuf(NULL), bytesUsed(0), bytesAllocated(defaultSize) { }
+    BufferList(BufferPool *p = NULL)
+        : pool(p), curBuf(NULL), bytesUsed(0), bytesAllocated(defaultSize) {
+        if (pool) {
+            pool->takeChunkList(chunks);
+        }
+    }
 
     char *getBuffer(size_t len) {
         char *ret;
@@ -40,17 +50,15 @@ public:
         }
 
         if (len >= bytesAllocated) {
-            ret = new char[len];
-            bufList.push_back(ret);
-            return ret;
+            return allocate(len);
         }
 
         if (!curBuf) {
-            if (!(curBuf = new char[bytesAllocated])) {
+            size_t n = bytesAllocated;
+            if (!(curBuf = allocate(n, &n))) {
                 return NULL;
             }
-
-            bufList.push_back(curBuf);
+            bytesAllocated = n;
         }
 
         if (bytesAvailable() > len) {
@@ -61,17 +69,35 @@ public:
         } else {
             curBuf = NULL;
             bytesUsed = 0;
+            if (bytesAllocated < maxChunkSize) {
+                bytesAllocated *= 2;
+            }
             return getBuffer(len);
         }
 
         return ret;
     }
 
-    bool empty() { return bufList.empty(); }
+    /**
+     * Takes ownership of a buffer allocated with new[] (or from the pool)
+     * elsewhere, so that it is freed along with the rest of the list.
+     * @param capacity the allocated size of the buffer
+     */
+    void adopt(char *buf, size_t capacity) {
+        BufferChunk chunk = { buf, capacity };
+        chunks.push_back(chunk);
+    }
+
+    BufferPool *getPool() const { return pool; }
+
+    bool empty() { return chunks.empty(); }
 
     ~BufferList() {
-        for (unsigned int ii = 0; ii < bufList.size(); ii++) {
-            delete[] bufList[ii];
+        for (unsigned int ii = 0; ii < chunks.size(); ii++) {
+            poolRelease(pool, chunks[ii].data, chunks[ii].capacity);
+        }
+        if (pool) {
+            pool->returnChunkList(chunks);
         }
     }
 
@@ -80,21 +106,34 @@ private:
         return bytesAllocated - bytesUsed;
     }
 
+    char *allocate(size_t len, size_t *capacity = NULL) {
+        size_t n = len;
+        char *ret = poolAcquire(pool, &n);
+        if (ret) {
+            adopt(ret, n);
+        }
+        if (capacity) {
+            *capacity = n;
+        }
+        return ret;
+    }
 
     BufferList(BufferList& other) {
-        bufList = other.bufList;
+        pool = other.pool;
+        chunks.swap(other.chunks);
         bytesUsed = other.bytesUsed;
         bytesAllocated = other.bytesAllocated;
         curBuf = other.curBuf;
 
-        other.bufList.clear();
         other.bytesUsed = 0;
         other.bytesAllocated = 0;
         other.curBuf = 0;
     }
 
     static const unsigned int defaultSize = 1024;
-    std::vector<char *> bufList;
+    static const unsigned int maxChunkSize = 64 * 1024;
+    BufferPool *pool;
+    std::vector<BufferChunk> chunks;
     char *curBuf;
     size_t bytesUsed;
     size_t bytesAllocated;
@@ -0,0 +1,112 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "couchbase_impl.h"
+
+using namespace Couchnode;
+
+#if UV_VERSION_MINOR >= 11
+#define UVC_CHECK_CALLBACK(func) void func(uv_check_t *check)
+#else
+#define UVC_CHECK_CALLBACK(func) void func(uv_check_t *check, int)
+#endif
+
+extern "C" {
+    static UVC_CHECK_CALLBACK(batch_check_cb) {
+        reinterpret_cast<CallbackBatch *>(check->data)->flush();
+    }
+
+    static void batch_close_cb(uv_handle_t *handle) {
+        delete (uv_check_t *)handle;
+    }
+}
+
+CallbackBatch::~CallbackBatch()
+{
+    if (check) {
+        uv_check_stop(check);
+        uv_close((uv_handle_t *)check, batch_close_cb);
+        check = NULL;
+    }
+
+    if (!dispatcher.IsEmpty()) {
+        NanDisposePersistent(dispatcher);
+    }
+
+    if (!pending.IsEmpty()) {
+        NanDisposePersistent(pending);
+    }
+
+    if (!self.IsEmpty()) {
+        NanDisposePersistent(self);
+    }
+}
+
+void CallbackBatch::enable(Handle<Function> fn)
+{
+    if (!dispatcher.IsEmpty()) {
+        NanDisposePersistent(dispatcher);
+    }
+    NanAssignPersistent(dispatcher, fn);
+
+    if (!check) {
+        check = new uv_check_t;
+        memset(check, 0, sizeof(*check));
+        uv_check_init(uv_default_loop(), check);
+        check->data = this;
+    }
+    enabled = true;
+}
+
+void CallbackBatch::add(Handle<Function> callback, Handle<Value> err,
+                        Handle<Value> result)
+{
+    if (count == 0) {
+        NanAssignPersistent(pending, NanNew<Array>());
+        NanAssignPersistent(self, NanObjectWrapHandle(owner));
+        uv_check_start(check, batch_check_cb);
+    }
+
+    Local<Array> items = NanNew(pending);
+    unsigned int base = count * 3;
+    items->Set(base, callback);
+    items->Set(base + 1, err);
+    items->Set(base + 2, result.IsEmpty() ?
+               Handle<Value>(NanUndefined()) : result);
+    count++;
+}
+
+void CallbackBatch::flush()
+{
+    if (count == 0) {
+        return;
+    }
+
+    NanScope();
+    Local<Array> items = NanNew(pending);
+    Local<Object> receiver = NanNew(self);
+    Local<Function> fn = NanNew(dispatcher);
+
+    // Reset first, as the callbacks may schedule (and complete) more work
+    NanDisposePersistent(pending);
+    NanDisposePersistent(self);
+    count = 0;
+    uv_check_stop(check);
+
+    Handle<Value> argv[] = { items };
+    NanMakeCallback(receiver, fn, 1, argv);
+}
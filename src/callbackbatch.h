@@ -0,0 +1,73 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef COUCHNODE_CALLBACKBATCH_H
+#define COUCHNODE_CALLBACKBATCH_H 1
+
+#ifndef COUCHBASE_H
+#error "include couchbase_impl.h first"
+#endif
+
+namespace Couchnode
+{
+
+/**
+ * Collects single-key callbacks so that they reach JavaScript in one call.
+ *
+ * Rather than calling into JavaScript for every response, each callback
+ * and its arguments are appended to an array. Once per event loop
+ * iteration, after all pending I/O has been processed, the array is passed
+ * to a dispatcher function which invokes the callbacks in order.
+ */
+class CallbackBatch
+{
+public:
+    CallbackBatch(node::ObjectWrap *owner)
+        : owner(owner), check(NULL), enabled(false), count(0) {}
+    ~CallbackBatch();
+
+    bool isEnabled() const { return enabled; }
+
+    // The dispatcher receives a flat array of [callback, error, result, ...]
+    void enable(Handle<Function> dispatcher);
+
+    // Callbacks already queued are still delivered
+    void disable() { enabled = false; }
+
+    void add(Handle<Function> callback, Handle<Value> err,
+             Handle<Value> result);
+
+    void flush();
+
+private:
+    node::ObjectWrap *owner;
+    uv_check_t *check;
+    bool enabled;
+    unsigned int count;
+
+    Persistent<Function> dispatcher;
+    Persistent<Array> pending;
+
+    // Keeps the owner alive until the pending callbacks are delivered
+    Persistent<Object> self;
+
+    // No copying
+    CallbackBatch(CallbackBatch&);
+};
+
+} // namespace Couchnode
+#endif // COUCHNODE_CALLBACKBATCH_H
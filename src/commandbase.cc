@@ -152,6 +152,10 @@ bool Command::initialize()
         return false;
     }
 
+    if (wantsIndexedResults()) {
+        keyIndex.reserve(keys.size());
+    }
+
     return true;
 }
 
@@ -180,12 +184,21 @@ bool Command::processSingle(Handle<Value> single,
         }
     }
 
-    if (!getBufBackedString(single, &k, &n)) {
-        return false;
+    int vbid = -1;
+    if (keyCache == NULL || hashkey != NULL || !single->IsString() ||
+            !keyCache->encode(single.As<String>(), vbConfig, bufs,
+                              &k, &n, &vbid)) {
+        if (!getBufBackedString(single, &k, &n)) {
+            return false;
+        }
+    }
+
+    if (wantsIndexedResults()) {
+        keyIndex.add(k, n, ix);
     }
 
     CommandKey ck;
-    ck.setKeys(single, k, n, hashkey, nhashkey);
+    ck.setKeys(single, k, n, hashkey, nhashkey, vbid);
 
     return getHandler()(this, ck, options, ix);
 }
@@ -251,9 +264,9 @@ bool Command::parseCommonOptions(const Handle<Object> obj)
         return false;
     }
 
-    ParamSlot *spec[] = { &isSpooled, &globalHashkey };
+    ParamSlot *spec[] = { &isSpooled, &isIndexed, &globalHashkey };
 
-    if (!ParamSlot::parseAll(obj, spec, 2, err)) {
+    if (!ParamSlot::parseAll(obj, spec, 3, err)) {
         return false;
     }
 
@@ -271,7 +284,14 @@ Cookie* Command::createCookie()
         return cookie;
     }
 
-    cookie = new Cookie(keys.size());
+    CouchbaseImpl *me = ObjectWrap::Unwrap<CouchbaseImpl>(apiArgs.This());
+    cookie = me->getCookiePool().acquire(keys.size());
+    if (wantsIndexedResults()) {
+        cookie->setIndexed(keyIndex, keys.size());
+    }
+    if (me->getCallbackBatch().isEnabled()) {
+        cookie->setBatch(&me->getCallbackBatch());
+    }
     initCookie();
     return cookie;
 }
@@ -284,6 +304,14 @@ void Command::setCookieKeyOption(Handle<Value> key, Handle<Value> option)
     cookieKeyOptions->ForceSet(key, option);
 }
 
+void Command::pinValue(Handle<Value> v)
+{
+    if (pinnedValues.IsEmpty()) {
+        pinnedValues = NanNew<Array>();
+    }
+    pinnedValues->Set(pinnedValues->Length(), v);
+}
+
 void Command::initCookie()
 {
     CallbackMode cbMode;
@@ -297,6 +325,10 @@ void Command::initCookie()
         cookie->setOptions(cookieKeyOptions);
     }
 
+    if (!pinnedValues.IsEmpty()) {
+        cookie->setPinnedValues(pinnedValues);
+    }
+
     cookie->setCallback(callback.v, cbMode);
 }
 
@@ -308,7 +340,28 @@ Command* Command::makePersistent()
     return ret;
 }
 
+Command::Command(_NAN_METHOD_ARGS, int cmdMode)
+    : apiArgs(args),
+      bufs(&ObjectWrap::Unwrap<CouchbaseImpl>(args.This())->getBufferPool()),
+      keyCache(NULL), vbConfig(NULL)
+{
+    CouchbaseImpl *me = ObjectWrap::Unwrap<CouchbaseImpl>(args.This());
+    mode = cmdMode;
+    cookie = NULL;
+
+    if (me->getKeyCache().isEnabled()) {
+        keyCache = &me->getKeyCache();
+        // Commands deferred until connection may run against a different
+        // configuration, so they do not get precomputed vBuckets.
+        if (me->isConnected()) {
+            lcb_cntl(me->getLibcouchbaseHandle(), LCB_CNTL_GET,
+                     LCB_CNTL_VBCONFIG, &vbConfig);
+        }
+    }
+}
+
 Command::Command(Command &other)
-    : apiArgs(other.apiArgs), cookie(other.cookie), bufs(other.bufs) {}
+    : apiArgs(other.apiArgs), cookie(other.cookie), bufs(other.bufs),
+      keyCache(NULL), vbConfig(NULL) {}
 
 };
@@ -43,13 +43,10 @@ public:
             memset(&single_cmd, 0, sizeof(single_cmd));
 
         } else if (ncmds > 1) {
-            cmds = NULL;
             cmdlist = NULL;
-
             cmds = new T[ncmds];
-            cmdlist = new T*[ncmds];
 
-            if (cmds == NULL || cmdlist == NULL) {
+            if (cmds == NULL) {
                 return false;
             }
 
@@ -67,22 +64,46 @@ public:
             return NULL;
         }
 
-        T *ret;
         if (ncmds == 1) {
-            ret = (T *)&single_cmd;
-
-        } else {
-            ret = ((T*)cmds) + ix;
-            cmdlist[ix] = ret;
+            return &single_cmd;
         }
-
-        return ret;
+        return cmds + ix;
     }
 
+    /**
+     * Returns the pointer array expected by the v2 multi-command functions.
+     * It is only built on demand, as commands scheduled through schedule()
+     * do not need it.
+     */
     const T * const * getList() {
+        if (cmdlist == NULL && ncmds > 1) {
+            cmdlist = new T*[ncmds];
+            for (unsigned int ii = 0; ii < ncmds; ii++) {
+                cmdlist[ii] = cmds + ii;
+            }
+        }
         return cmdlist;
     }
 
+    /**
+     * Schedules each command with a v3 function (e.g. lcb_get3) inside a
+     * single scheduling context. If any command fails, none of the commands
+     * are sent.
+     */
+    template <typename F>
+    lcb_error_t schedule(lcb_t instance, const void *cookie, F fn) {
+        lcb_sched_enter(instance);
+        for (unsigned int ii = 0; ii < ncmds; ii++) {
+            lcb_error_t err = fn(instance, cookie, getAt(ii));
+            if (err != LCB_SUCCESS) {
+                lcb_sched_fail(instance);
+                return err;
+            }
+        }
+        lcb_sched_leave(instance);
+        return LCB_SUCCESS;
+    }
+
     unsigned int size() const {
         return ncmds;
     }
@@ -130,12 +130,20 @@ struct HttpOptions : Parameters
     NAMED_OPTION(ContentTypeOption, StringOption, HTTP_CONTENT_TYPE);
     NAMED_OPTION(MethodOption, Int32Option, HTTP_METHOD);
     NAMED_OPTION(HttpTypeOption, Int32Option, HTTP_TYPE);
+    NAMED_OPTION(StreamOption, UInt32Option, HTTP_STREAM);
 
     PathOption path;
     DataOption content;
     ContentTypeOption contentType;
     MethodOption httpMethod;
     HttpTypeOption httpType;
+    // Non-zero to stream the rows of a view or N1QL response. This is the id
+    // by which the stream can be paused and resumed.
+    StreamOption stream;
+
+    bool isStreaming() const {
+        return stream.isFound() && stream.v != 0;
+    }
     bool parseObject(const Handle<Object>, CBExc&);
 };
 
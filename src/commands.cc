@@ -17,6 +17,7 @@
 
 
 #include "couchbase_impl.h"
+#include "node_buffer.h"
 namespace Couchnode
 {
 
@@ -54,15 +55,15 @@ bool GetCommand::handleSingle(Command *p,
 
     kOptions.merge(ctx->globalOptions);
 
-    lcb_get_cmd_st *cmd = ctx->commands.getAt(ix);
-    ki.setKeyV0(cmd);
+    lcb_CMDGET *cmd = ctx->commands.getAt(ix);
+    ki.setKeyV3(cmd);
 
     if (kOptions.lockTime.isFound()) {
-        cmd->v.v0.exptime = kOptions.lockTime.v;
-        cmd->v.v0.lock = 1;
+        cmd->options.exptime = kOptions.lockTime.v;
+        cmd->lock = 1;
 
     } else {
-        cmd->v.v0.exptime = kOptions.expTime.v;
+        cmd->options.exptime = kOptions.expTime.v;
     }
 
     if (kOptions.format.isFound()) {
@@ -78,7 +79,7 @@ bool GetCommand::handleSingle(Command *p,
 
 lcb_error_t GetCommand::execute(lcb_t instance)
 {
-    return lcb_get(instance, cookie, commands.size(), commands.getList());
+    return commands.schedule(instance, cookie, lcb_get3);
 }
 
 bool GetOptions::parseObject(const Handle<Object> options, CBExc &ex)
@@ -117,15 +118,15 @@ bool GetReplicaCommand::handleSingle(Command *p,
 
     kOptions.merge(ctx->globalOptions);
 
-    lcb_get_replica_cmd_t *cmd = ctx->commands.getAt(ix);
-    ki.setKeyV1(cmd);
+    lcb_CMDGETREPLICA *cmd = ctx->commands.getAt(ix);
+    ki.setKeyV3(cmd);
 
     if (kOptions.index.isFound()) {
       if (kOptions.index.v >= 0) {
-        cmd->v.v1.strategy = LCB_REPLICA_SELECT;
-        cmd->v.v1.index = kOptions.index.v;
+        cmd->strategy = LCB_REPLICA_SELECT;
+        cmd->index = kOptions.index.v;
       } else {
-        cmd->v.v1.strategy = LCB_REPLICA_FIRST;
+        cmd->strategy = LCB_REPLICA_FIRST;
       }
     }
 
@@ -142,7 +143,7 @@ bool GetReplicaCommand::handleSingle(Command *p,
 
 lcb_error_t GetReplicaCommand::execute(lcb_t instance)
 {
-    return lcb_get_replica(instance, cookie, commands.size(), commands.getList());
+    return commands.schedule(instance, cookie, lcb_rget3);
 }
 
 bool GetReplicaOptions::parseObject(const Handle<Object> options, CBExc &ex)
@@ -157,11 +158,18 @@ bool GetReplicaOptions::parseObject(const Handle<Object> options, CBExc &ex)
 /// Set                                                                      ///
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
+StoreCommand::StoreCommand(_NAN_METHOD_ARGS, lcb_storage_t sop, int mode)
+    : Command(args, mode), op(sop), numNoCopy(0)
+{
+    CouchbaseImpl *me = ObjectWrap::Unwrap<CouchbaseImpl>(args.This());
+    zeroCopyThreshold = me->getZeroCopyThreshold();
+}
+
 bool StoreCommand::handleSingle(Command *p, CommandKey &ki,
                                 Handle<Value> params, unsigned int ix)
 {
     StoreCommand *ctx = static_cast<StoreCommand *>(p);
-    lcb_store_cmd_t *cmd = ctx->commands.getAt(ix);
+    lcb_CMDSTORE *cmd = ctx->commands.getAt(ix);
     StoreOptions kOptions;
 
     if (!params.IsEmpty()) {
@@ -179,7 +187,7 @@ bool StoreCommand::handleSingle(Command *p, CommandKey &ki,
     char *vbuf;
     size_t nvbuf;
     Handle<Value> s = kOptions.value.v;
-    ki.setKeyV0(cmd);
+    ki.setKeyV3(cmd);
 
     ValueFormat::Spec spec;
     Handle<Value> specObj;
@@ -194,35 +202,57 @@ bool StoreCommand::handleSingle(Command *p, CommandKey &ki,
         return false;
     }
 
-    if (!ValueFormat::encode(s, spec, ctx->bufs, &cmd->v.v0.flags,
-                             &cmd->v.v0.datatype, &vbuf, &nvbuf, ctx->err)) {
+    if (ctx->zeroCopyThreshold &&
+            (spec == ValueFormat::RAW || spec == ValueFormat::AUTO) &&
+            node::Buffer::HasInstance(s) &&
+            node::Buffer::Length(s.As<Object>()) >= ctx->zeroCopyThreshold) {
+        // Send the Buffer's own memory rather than a copy of it
+        vbuf = node::Buffer::Data(s.As<Object>());
+        nvbuf = node::Buffer::Length(s.As<Object>());
+        cmd->flags = ValueFormat::RAW;
+        cmd->datatype = LCB_VALUE_RAW;
+        cmd->value.vtype = LCB_KV_CONTIG;
+        ctx->pinValue(s);
+        ctx->numNoCopy++;
+
+    } else if (!ValueFormat::encode(s, spec, ctx->bufs, &cmd->flags,
+                                    &cmd->datatype, &vbuf, &nvbuf,
+                                    ctx->err)) {
         return false;
     }
 
-    cmd->v.v0.bytes = vbuf;
-    cmd->v.v0.nbytes = nvbuf;
-    cmd->v.v0.cas = kOptions.cas.v;
+    cmd->value.u_buf.contig.bytes = vbuf;
+    cmd->value.u_buf.contig.nbytes = nvbuf;
+    cmd->options.cas = kOptions.cas.v;
 
     // exptime
     if (kOptions.exp.isFound()) {
-        cmd->v.v0.exptime = kOptions.exp.v;
+        cmd->options.exptime = kOptions.exp.v;
     } else {
-        cmd->v.v0.exptime = ctx->globalOptions.exp.v;
+        cmd->options.exptime = ctx->globalOptions.exp.v;
     }
 
     // flags override
     if (kOptions.flags.isFound()) {
-        cmd->v.v0.flags = kOptions.flags.v;
+        cmd->flags = kOptions.flags.v;
     }
 
-    cmd->v.v0.operation = ctx->op;
+    cmd->operation = ctx->op;
 
     return true;
 }
 
 lcb_error_t StoreCommand::execute(lcb_t instance)
 {
-    return lcb_store(instance, cookie, commands.size(), commands.getList());
+    // Each pinned packet reports back through the pktflushed callback once
+    // libcouchbase no longer needs the Buffer. Account for them up front so
+    // the cookie cannot be released before the packets are flushed.
+    cookie->addPinnedPackets(numNoCopy);
+    lcb_error_t err = commands.schedule(instance, cookie, lcb_store3);
+    if (err != LCB_SUCCESS) {
+        cookie->cancelPinnedPackets(numNoCopy);
+    }
+    return err;
 }
 
 bool StoreOptions::parseObject(const Handle<Object> options, CBExc &ex)
@@ -266,7 +296,7 @@ bool ArithmeticCommand::handleSingle(Command *p, CommandKey &ki,
 {
     ArithmeticOptions kOptions;
     ArithmeticCommand *ctx = static_cast<ArithmeticCommand *>(p);
-    lcb_arithmetic_cmd_t *cmd = ctx->commands.getAt(ix);
+    lcb_CMDINCRDECR *cmd = ctx->commands.getAt(ix);
 
 
     if (!params.IsEmpty()) {
@@ -278,20 +308,20 @@ bool ArithmeticCommand::handleSingle(Command *p, CommandKey &ki,
 
 
     kOptions.merge(ctx->globalOptions);
-    ki.setKeyV0(cmd);
-    cmd->v.v0.delta = kOptions.delta.v;
-    cmd->v.v0.initial = kOptions.initial.v;
+    ki.setKeyV3(cmd);
+    cmd->delta = kOptions.delta.v;
+    cmd->initial = kOptions.initial.v;
     if (kOptions.initial.isFound()) {
-        cmd->v.v0.create = 1;
+        cmd->create = 1;
     }
-    cmd->v.v0.exptime = kOptions.exp.v;
+    cmd->options.exptime = kOptions.exp.v;
 
     return true;
 }
 
 lcb_error_t ArithmeticCommand::execute(lcb_t instance)
 {
-    return lcb_arithmetic(instance, cookie, commands.size(), commands.getList());
+    return commands.schedule(instance, cookie, lcb_arithmetic3);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -315,15 +345,15 @@ bool DeleteCommand::handleSingle(Command *p, CommandKey &ki,
         effectiveOptions = &ctx->globalOptions;
     }
 
-    lcb_remove_cmd_t *cmd = ctx->commands.getAt(ix);
-    ki.setKeyV0(cmd);
-    cmd->v.v0.cas = effectiveOptions->cas.v;
+    lcb_CMDREMOVE *cmd = ctx->commands.getAt(ix);
+    ki.setKeyV3(cmd);
+    cmd->options.cas = effectiveOptions->cas.v;
     return true;
 }
 
 lcb_error_t DeleteCommand::execute(lcb_t instance)
 {
-    return lcb_remove(instance, cookie, commands.size(), commands.getList());
+    return commands.schedule(instance, cookie, lcb_remove3);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -356,15 +386,15 @@ bool UnlockCommand::handleSingle(Command *p, CommandKey& ki,
         return false;
     }
 
-    lcb_unlock_cmd_t *cmd = ctx->commands.getAt(ix);
-    ki.setKeyV0(cmd);
-    cmd->v.v0.cas = kOptions.cas.v;
+    lcb_CMDUNLOCK *cmd = ctx->commands.getAt(ix);
+    ki.setKeyV3(cmd);
+    cmd->options.cas = kOptions.cas.v;
     return true;
 }
 
 lcb_error_t UnlockCommand::execute(lcb_t instance)
 {
-    return lcb_unlock(instance, cookie, commands.size(), commands.getList());
+    return commands.schedule(instance, cookie, lcb_unlock3);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -391,15 +421,15 @@ bool TouchCommand::handleSingle(Command *p, CommandKey &ki,
         kOptions.exp = ctx->globalOptions.exp;
     }
 
-    lcb_touch_cmd_t *cmd = ctx->commands.getAt(ix);
-    ki.setKeyV0(cmd);
-    cmd->v.v0.exptime = kOptions.exp.v;
+    lcb_CMDTOUCH *cmd = ctx->commands.getAt(ix);
+    ki.setKeyV3(cmd);
+    cmd->options.exptime = kOptions.exp.v;
     return true;
 }
 
 lcb_error_t TouchCommand::execute(lcb_t instance)
 {
-    return lcb_touch(instance, cookie, commands.size(), commands.getList());
+    return commands.schedule(instance, cookie, lcb_touch3);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -529,10 +559,10 @@ lcb_error_t StatsCommand::execute(lcb_t instance)
 bool HttpOptions::parseObject(const Handle<Object> obj, CBExc &ex)
 {
     ParamSlot *spec[] = {
-            &path, &content, &contentType, &httpMethod, &httpType
+            &path, &content, &contentType, &httpMethod, &httpType, &stream
     };
 
-    return ParamSlot::parseAll(obj, spec, 5, ex);
+    return ParamSlot::parseAll(obj, spec, 6, ex);
 }
 
 bool HttpCommand::handleSingle(Command *p, CommandKey &ki,
@@ -610,16 +640,25 @@ bool HttpCommand::handleSingle(Command *p, CommandKey &ki,
         cmd->v.v0.body = kMisc;
         cmd->v.v0.nbody = nMisc;
     }
+
+    cmd->v.v0.chunked = options->isStreaming();
     return true;
 }
 
 lcb_error_t HttpCommand::execute(lcb_t instance)
 {
     lcb_http_request_t req;
-    return lcb_make_http_request(instance, cookie,
-                                 htType,
-                                 commands.getAt(0),
-                                 &req);
+    lcb_error_t err = lcb_make_http_request(instance, cookie,
+                                            htType,
+                                            commands.getAt(0),
+                                            &req);
+
+    if (err == LCB_SUCCESS && globalOptions.isStreaming()) {
+        CouchbaseImpl *me = reinterpret_cast<CouchbaseImpl *>(
+                const_cast<void *>(lcb_get_cookie(instance)));
+        static_cast<HttpStreamCookie *>(cookie)->start(me, req);
+    }
+    return err;
 }
 
 Cookie *HttpCommand::createCookie()
@@ -627,7 +666,13 @@ Cookie *HttpCommand::createCookie()
     if (cookie) {
         return cookie;
     }
-    cookie = new HttpCookie();
+    if (globalOptions.isStreaming()) {
+        bool isQuery = globalOptions.httpType.v == LCB_HTTP_TYPE_N1QL;
+        cookie = new HttpStreamCookie(globalOptions.stream.v, isQuery ?
+                ViewRowSplitter::queryKeys : ViewRowSplitter::viewKeys);
+    } else {
+        cookie = new HttpCookie();
+    }
     cookie->setCallback(callback.v, CBMODE_SINGLE);
     return cookie;
 }
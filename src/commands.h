@@ -27,6 +27,8 @@
 namespace Couchnode {
 using namespace v8;
 
+class KeyCache;
+
 
 enum ArgMode {
     ARGMODE_SIMPLE = 0x0,
@@ -76,12 +78,13 @@ class CommandKey
 {
 public:
     void setKeys(Handle<Value> o, const char *k, size_t nk,
-                 const char *hk = NULL, size_t nhk = 0) {
+                 const char *hk = NULL, size_t nhk = 0, int vb = -1) {
         object = o;
         key = k;
         nkey = nk;
         hashkey = hk;
         nhashkey = nhk;
+        vbid = vb;
     }
 
     template <typename T>
@@ -93,11 +96,14 @@ public:
     }
 
     template <typename T>
-    void setKeyV1(T *cmd) {
-        cmd->v.v1.key = key;
-        cmd->v.v1.nkey = nkey;
-        cmd->v.v1.hashkey = hashkey;
-        cmd->v.v1.nhashkey = nhashkey;
+    void setKeyV3(T *cmd) {
+        cmd->key.contig.bytes = key;
+        cmd->key.contig.nbytes = nkey;
+        cmd->hashkey.contig.bytes = hashkey;
+        cmd->hashkey.contig.nbytes = nhashkey;
+        if (vbid >= 0) {
+            cmd->cmdflags |= LCB_CMD_F_VBID | vbid;
+        }
     }
 
     const char *getKey() const { return key; }
@@ -111,6 +117,8 @@ private:
     size_t nkey;
     const char *hashkey;
     size_t nhashkey;
+    // Precomputed vBucket for the key, or -1
+    int vbid;
 };
 
 class Command
@@ -133,10 +141,7 @@ public:
                                 unsigned int ix);
 
 
-    Command(_NAN_METHOD_ARGS, int cmdMode) : apiArgs(args) {
-        mode = cmdMode;
-        cookie = NULL;
-    }
+    Command(_NAN_METHOD_ARGS, int cmdMode);
 
     virtual ~Command() {
 
@@ -182,11 +187,13 @@ protected:
     _NAN_METHOD_ARGS_TYPE apiArgs;
 
     NAMED_OPTION(SpooledOption, BooleanOption, SPOOLED);
+    NAMED_OPTION(IndexedOption, BooleanOption, INDEXED);
     NAMED_OPTION(HashkeyOption, StringOption, HASHKEY);
 
 
     // Callback parameters..
     SpooledOption isSpooled;
+    IndexedOption isIndexed;
     CallableOption callback;
     HashkeyOption globalHashkey;
 
@@ -196,10 +203,29 @@ protected:
     KeysInfo keys;
     BufferList bufs;
 
+    // Set if keys should be looked up in the instance's key cache. The
+    // configuration is only set if vBuckets may be precomputed as well.
+    KeyCache *keyCache;
+    lcbvb_CONFIG *vbConfig;
+
     // Per-key options
     // these are transferred over to the the cookie when needed
     Handle<Object> cookieKeyOptions;
 
+    // Buffers whose memory is handed to libcouchbase as-is. These are
+    // transferred over to the cookie, which keeps them alive until
+    // libcouchbase is done with them.
+    Handle<Array> pinnedValues;
+    void pinValue(Handle<Value> v);
+
+    // Positions of each key in the request, for spooled results which are
+    // returned as an array. This is transferred over to the cookie.
+    KeyIndex keyIndex;
+    bool wantsIndexedResults() const {
+        return isSpooled.isFound() && isSpooled.v &&
+                isIndexed.isFound() && isIndexed.v;
+    }
+
 
     // Set by subclasses:
     int mode; // MODE_* | MODE_* ...
@@ -226,7 +252,7 @@ public:
 protected:
     Parameters* getParams() { return &globalOptions; }
     GetOptions globalOptions;
-    CommandList<lcb_get_cmd_t> commands;
+    CommandList<lcb_CMDGET> commands;
     ItemHandler getHandler() const { return handleSingle; }
     virtual bool initCommandList() {
         return commands.initialize(keys.size());
@@ -247,7 +273,7 @@ public:
 protected:
     Parameters* getParams() { return &globalOptions; }
     GetReplicaOptions globalOptions;
-    CommandList<lcb_get_replica_cmd_t> commands;
+    CommandList<lcb_CMDGETREPLICA> commands;
     ItemHandler getHandler() const { return handleSingle; }
     virtual bool initCommandList() {
         return commands.initialize(keys.size());
@@ -274,8 +300,7 @@ public:
 class StoreCommand : public Command
 {
 public:
-    StoreCommand(_NAN_METHOD_ARGS, lcb_storage_t sop, int mode)
-        : Command(args, mode), op(sop) { }
+    StoreCommand(_NAN_METHOD_ARGS, lcb_storage_t sop, int mode);
 
     static bool handleSingle(Command*, CommandKey&,
                              Handle<Value>, unsigned int);
@@ -285,13 +310,17 @@ public:
 
 protected:
     lcb_storage_t op;
-    CommandList<lcb_store_cmd_t> commands;
+    CommandList<lcb_CMDSTORE> commands;
     StoreOptions globalOptions;
     ItemHandler getHandler() const { return handleSingle; }
     Parameters* getParams() { return &globalOptions; }
     virtual bool initCommandList() {
         return commands.initialize(keys.size());
     }
+
+    // Buffers at least this large are sent without being copied
+    size_t zeroCopyThreshold;
+    unsigned int numNoCopy;
 };
 
 class UnlockCommand : public Command
@@ -304,7 +333,7 @@ public:
 protected:
     static bool handleSingle(Command *, CommandKey&,
                              Handle<Value>, unsigned int);
-    CommandList<lcb_unlock_cmd_t> commands;
+    CommandList<lcb_CMDUNLOCK> commands;
     UnlockOptions globalOptions;
     ItemHandler getHandler() const { return handleSingle; }
     Parameters * getParams() { return &globalOptions; }
@@ -324,7 +353,7 @@ public:
     virtual Command *copy() { return new TouchCommand(*this); }
 
 protected:
-    CommandList<lcb_touch_cmd_t> commands;
+    CommandList<lcb_CMDTOUCH> commands;
     TouchOptions globalOptions;
     ItemHandler getHandler() const { return handleSingle; }
     Parameters* getParams() { return &globalOptions; }
@@ -343,7 +372,7 @@ public:
 protected:
     static bool handleSingle(Command *, CommandKey&,
                              Handle<Value>, unsigned int);
-    CommandList<lcb_arithmetic_cmd_t> commands;
+    CommandList<lcb_CMDINCRDECR> commands;
     ArithmeticOptions globalOptions;
     ItemHandler getHandler() const { return handleSingle; }
     Parameters* getParams() { return &globalOptions; }
@@ -363,7 +392,7 @@ public:
 protected:
     static bool handleSingle(Command *, CommandKey&,
                              Handle<Value>, unsigned int);
-    CommandList<lcb_remove_cmd_t> commands;
+    CommandList<lcb_CMDREMOVE> commands;
     DeleteOptions globalOptions;
     ItemHandler getHandler() const { return handleSingle; }
     Parameters * getParams() { return &globalOptions; }
@@ -42,10 +42,28 @@ Handle<Object> CouchbaseImpl::createConstants()
     X(LCB_CNTL_CONLOGGER_LEVEL) \
     X(LCB_CNTL_DETAILED_ERRCODES) \
     X(LCB_CNTL_REINIT_DSN) \
+    X(LCB_CNTL_N1QL_HOSTS) \
     X(CNTL_COUCHNODE_VERSION) \
     X(CNTL_LIBCOUCHBASE_VERSION) \
     X(CNTL_CLNODES) \
     X(CNTL_RESTURI) \
+    X(CNTL_ZEROCOPY_THRESHOLD) \
+    X(CNTL_COOKIEPOOL_STATS) \
+    X(CNTL_COOKIEPOOL_SIZE) \
+    X(CNTL_CALLBACK_BATCHING) \
+    X(CNTL_BUFFERPOOL_STATS) \
+    X(CNTL_BUFFERPOOL_SIZE) \
+    X(CNTL_KEYCACHE_STATS) \
+    X(CNTL_KEYCACHE_SIZE) \
+    X(CNTL_LATENCY_TRACKING) \
+    X(CNTL_LATENCY_SNAPSHOT) \
+    X(CNTL_COMPRESSION_POLICY) \
+    X(CNTL_COMPRESSION_STATS) \
+    X(CNTL_CONNPOOL_OPTS) \
+    X(CNTL_CONNPOOL_STATS) \
+    X(CNTL_KV_CONNECTIONS) \
+    X(CNTL_WRITE_STATS) \
+    X(CNTL_CONFIG_STATS) \
     X(ErrorCode::MEMORY) \
     X(ErrorCode::ARGUMENTS) \
     X(ErrorCode::SCHEDULING) \
@@ -104,6 +122,7 @@ Handle<Object> CouchbaseImpl::createConstants()
     \
     X(LCB_HTTP_TYPE_VIEW) \
     X(LCB_HTTP_TYPE_MANAGEMENT) \
+    X(LCB_HTTP_TYPE_N1QL) \
     X(LCB_HTTP_METHOD_GET) \
     X(LCB_HTTP_METHOD_POST) \
     X(LCB_HTTP_METHOD_PUT) \
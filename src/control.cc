@@ -17,6 +17,7 @@
 
 
 #include "couchbase_impl.h"
+#include <cstdio>
 
 // Thanks mauke
 #define STRINGIFY_(X) #X
@@ -25,6 +26,315 @@
 namespace Couchnode
 {
 
+static const char *
+opcodeName(lcb_U8 opcode, char *buf)
+{
+    switch (opcode) {
+    case 0x00: return "get";
+    case 0x01: return "set";
+    case 0x02: return "add";
+    case 0x03: return "replace";
+    case 0x04: return "remove";
+    case 0x05: return "increment";
+    case 0x06: return "decrement";
+    case 0x0e: return "append";
+    case 0x0f: return "prepend";
+    case 0x1c: return "touch";
+    case 0x1d: return "getAndTouch";
+    case 0x83: return "getReplica";
+    case 0x92: return "observe";
+    case 0x94: return "getAndLock";
+    case 0x95: return "unlock";
+    default:
+        sprintf(buf, "0x%02x", opcode);
+        return buf;
+    }
+}
+
+static void
+latency_callback(lcb_t, const void *cookie, const char *server,
+                 lcb_U8 opcode, const lcb_LATENCYHIST *hist)
+{
+    Handle<Object> snapshot = *(Handle<Object> *)cookie;
+    Handle<String> serverKey = NanNew<String>(server);
+    Handle<Object> byServer;
+    char buf[8];
+
+    if (snapshot->Has(serverKey)) {
+        byServer = snapshot->Get(serverKey).As<Object>();
+    } else {
+        byServer = NanNew<Object>();
+        snapshot->Set(serverKey, byServer);
+    }
+
+    Handle<Object> stats = NanNew<Object>();
+    stats->Set(NanNew<String>("count"),
+               NanNew<Number>((double)lcb_lathist_count(hist)));
+    stats->Set(NanNew<String>("min"), NanNew<Number>(lcb_lathist_min(hist)));
+    stats->Set(NanNew<String>("max"), NanNew<Number>(lcb_lathist_max(hist)));
+    stats->Set(NanNew<String>("mean"), NanNew<Number>(lcb_lathist_mean(hist)));
+    stats->Set(NanNew<String>("p50"),
+               NanNew<Number>(lcb_lathist_percentile(hist, 50)));
+    stats->Set(NanNew<String>("p99"),
+               NanNew<Number>(lcb_lathist_percentile(hist, 99)));
+    stats->Set(NanNew<String>("p999"),
+               NanNew<Number>(lcb_lathist_percentile(hist, 99.9)));
+    byServer->Set(NanNew<String>(opcodeName(opcode, buf)), stats);
+}
+
+static const char *
+compressionModeName(int opts)
+{
+    if (opts & LCB_COMPRESS_FORCE) {
+        return "force";
+    } else if ((opts & LCB_COMPRESS_INOUT) == LCB_COMPRESS_INOUT) {
+        return "on";
+    } else if (opts & LCB_COMPRESS_IN) {
+        return "inflate_only";
+    } else {
+        return "off";
+    }
+}
+
+static Handle<Value>
+getCompressionPolicy(lcb_t instance)
+{
+    lcb_COMPRESSPOLICY policy;
+    int opts = 0;
+    lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_COMPRESSION_OPTS, &opts);
+    lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_COMPRESSION_POLICY, &policy);
+
+    Handle<Object> ret = NanNew<Object>();
+    ret->Set(NanNew<String>("mode"), NanNew<String>(compressionModeName(opts)));
+    ret->Set(NanNew<String>("minSize"), NanNew<Number>(policy.min_size));
+    ret->Set(NanNew<String>("minRatio"), NanNew<Number>(policy.min_ratio));
+    ret->Set(NanNew<String>("maxSampleInterval"),
+             NanNew<Number>(policy.max_sample_interval));
+    return ret;
+}
+
+static lcb_error_t
+setCompressionPolicy(lcb_t instance, Handle<Object> obj)
+{
+    lcb_COMPRESSPOLICY policy;
+    lcb_error_t err;
+    Handle<String> modeKey = NanNew<String>("mode");
+    Handle<String> minSizeKey = NanNew<String>("minSize");
+    Handle<String> minRatioKey = NanNew<String>("minRatio");
+    Handle<String> sampleKey = NanNew<String>("maxSampleInterval");
+
+    if (obj->Has(modeKey)) {
+        String::Utf8Value mode(obj->Get(modeKey)->ToString());
+        err = lcb_cntl_string(instance, "compression", *mode);
+        if (err != LCB_SUCCESS) {
+            return err;
+        }
+    }
+
+    lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_COMPRESSION_POLICY, &policy);
+    if (obj->Has(minSizeKey)) {
+        policy.min_size = obj->Get(minSizeKey)->Uint32Value();
+    }
+    if (obj->Has(minRatioKey)) {
+        policy.min_ratio = (float)obj->Get(minRatioKey)->NumberValue();
+    }
+    if (obj->Has(sampleKey)) {
+        policy.max_sample_interval = obj->Get(sampleKey)->Uint32Value();
+    }
+    return lcb_cntl(instance, LCB_CNTL_SET, LCB_CNTL_COMPRESSION_POLICY, &policy);
+}
+
+static Handle<Value>
+getCompressionStats(lcb_t instance)
+{
+    lcb_COMPRESSSTATS stats;
+    lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_COMPRESSION_STATS, &stats);
+
+    Handle<Object> ret = NanNew<Object>();
+    ret->Set(NanNew<String>("values"), NanNew<Number>((double)stats.nvalues));
+    ret->Set(NanNew<String>("compressed"),
+             NanNew<Number>((double)stats.ncompressed));
+    ret->Set(NanNew<String>("tooSmall"), NanNew<Number>((double)stats.nsmall));
+    ret->Set(NanNew<String>("backedOff"),
+             NanNew<Number>((double)stats.nbackoff));
+    ret->Set(NanNew<String>("rejected"),
+             NanNew<Number>((double)stats.nrejected));
+    ret->Set(NanNew<String>("bytesSaved"),
+             NanNew<Number>((double)(stats.bytes_raw - stats.bytes_compressed)));
+    ret->Set(NanNew<String>("cpuTime"),
+             NanNew<Number>((double)stats.compress_ns / 1e6));
+    return ret;
+}
+
+static Handle<Value>
+getPoolOptions(lcb_t instance)
+{
+    lcb_POOLOPTS opts;
+    lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_MEMDPOOL_OPTS, &opts);
+
+    Handle<Object> ret = NanNew<Object>();
+    ret->Set(NanNew<String>("minIdle"), NanNew<Number>(opts.min_idle));
+    ret->Set(NanNew<String>("maxIdle"), NanNew<Number>(opts.max_idle));
+    ret->Set(NanNew<String>("maxTotal"), NanNew<Number>(opts.max_total));
+    ret->Set(NanNew<String>("idleTimeout"),
+             NanNew<Number>(opts.idle_timeout / 1000.0));
+    return ret;
+}
+
+static lcb_error_t
+setPoolOptions(lcb_t instance, Handle<Object> obj)
+{
+    lcb_POOLOPTS opts;
+    Handle<String> minIdleKey = NanNew<String>("minIdle");
+    Handle<String> maxIdleKey = NanNew<String>("maxIdle");
+    Handle<String> maxTotalKey = NanNew<String>("maxTotal");
+    Handle<String> idleTimeoutKey = NanNew<String>("idleTimeout");
+
+    lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_MEMDPOOL_OPTS, &opts);
+    if (obj->Has(minIdleKey)) {
+        opts.min_idle = obj->Get(minIdleKey)->Uint32Value();
+    }
+    if (obj->Has(maxIdleKey)) {
+        opts.max_idle = obj->Get(maxIdleKey)->Uint32Value();
+    }
+    if (obj->Has(maxTotalKey)) {
+        opts.max_total = obj->Get(maxTotalKey)->Uint32Value();
+    }
+    if (obj->Has(idleTimeoutKey)) {
+        opts.idle_timeout =
+                (lcb_U32)(obj->Get(idleTimeoutKey)->NumberValue() * 1000);
+    }
+    return lcb_cntl(instance, LCB_CNTL_SET, LCB_CNTL_MEMDPOOL_OPTS, &opts);
+}
+
+static void
+pool_stats_callback(lcb_t, const void *cookie, const lcb_POOLHOSTSTATS *stats)
+{
+    Handle<Object> ret = *(Handle<Object> *)cookie;
+    Handle<Object> host = NanNew<Object>();
+    host->Set(NanNew<String>("waiters"), NanNew<Number>(stats->waiters));
+    host->Set(NanNew<String>("idle"), NanNew<Number>(stats->idle));
+    host->Set(NanNew<String>("pending"), NanNew<Number>(stats->pending));
+    host->Set(NanNew<String>("leased"), NanNew<Number>(stats->leased));
+    host->Set(NanNew<String>("total"), NanNew<Number>(stats->total));
+    host->Set(NanNew<String>("connects"),
+              NanNew<Number>((double)stats->connects));
+    host->Set(NanNew<String>("connectErrors"),
+              NanNew<Number>((double)stats->connect_errors));
+    host->Set(NanNew<String>("connectTimeAvg"), NanNew<Number>(
+            stats->connects ?
+                    (double)stats->connect_time / stats->connects / 1000.0 : 0));
+    host->Set(NanNew<String>("connectTimeMax"),
+              NanNew<Number>(stats->connect_time_max / 1000.0));
+    ret->Set(NanNew<String>(stats->host), host);
+}
+
+static Handle<Value>
+getKvConnections(lcb_t instance)
+{
+    lcb_KVCONNOPTS opts;
+    lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_KVCONNS, &opts);
+
+    Handle<Object> ret = NanNew<Object>();
+    ret->Set(NanNew<String>("count"), NanNew<Number>(opts.nconns));
+    ret->Set(NanNew<String>("largeValueSize"),
+             NanNew<Number>(opts.large_value));
+    return ret;
+}
+
+static lcb_error_t
+setKvConnections(lcb_t instance, Handle<Object> obj)
+{
+    lcb_KVCONNOPTS opts;
+    Handle<String> countKey = NanNew<String>("count");
+    Handle<String> largeValueKey = NanNew<String>("largeValueSize");
+
+    lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_KVCONNS, &opts);
+    if (obj->Has(countKey)) {
+        opts.nconns = obj->Get(countKey)->Uint32Value();
+    }
+    if (obj->Has(largeValueKey)) {
+        opts.large_value = obj->Get(largeValueKey)->Uint32Value();
+    }
+    return lcb_cntl(instance, LCB_CNTL_SET, LCB_CNTL_KVCONNS, &opts);
+}
+
+static Handle<Object>
+getWriteStats(lcb_t instance)
+{
+    lcb_FLUSHSTATS stats;
+    lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_FLUSHSTATS, &stats);
+
+    Handle<Object> ret = NanNew<Object>();
+    ret->Set(NanNew<String>("writes"), NanNew<Number>((double)stats.nwrites));
+    ret->Set(NanNew<String>("bytes"), NanNew<Number>((double)stats.nbytes));
+    ret->Set(NanNew<String>("buffers"), NanNew<Number>((double)stats.nbufs));
+    ret->Set(NanNew<String>("coalescedBytes"),
+             NanNew<Number>((double)stats.ncoalesced));
+    return ret;
+}
+
+static Handle<Object>
+getConfigStats(lcb_t instance)
+{
+    lcb_CONFIGSTATS stats;
+    lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_CONFIGSTATS, &stats);
+
+    Handle<Object> ret = NanNew<Object>();
+    ret->Set(NanNew<String>("applied"), NanNew<Number>((double)stats.napplied));
+    ret->Set(NanNew<String>("checked"), NanNew<Number>((double)stats.nexamined));
+    ret->Set(NanNew<String>("relocated"),
+             NanNew<Number>((double)stats.nrelocated));
+    ret->Set(NanNew<String>("skipped"), NanNew<Number>((double)stats.nskipped));
+    ret->Set(NanNew<String>("totalTime"),
+             NanNew<Number>(stats.ns_total / 1000000.0));
+    ret->Set(NanNew<String>("lastTime"),
+             NanNew<Number>(stats.ns_last / 1000000.0));
+    return ret;
+}
+
+static void
+queryhost_stats_callback(lcb_t, const void *cookie,
+                         const lcb_N1QLHOSTSTATS *stats)
+{
+    Handle<Object> ret = *(Handle<Object> *)cookie;
+    Handle<Object> host = NanNew<Object>();
+    host->Set(NanNew<String>("latency"), NanNew<Number>(stats->latency / 1000.0));
+    host->Set(NanNew<String>("inflight"), NanNew<Number>(stats->inflight));
+    host->Set(NanNew<String>("failed"), stats->failed ? NanTrue() : NanFalse());
+    ret->Set(NanNew<String>(stats->host), host);
+}
+
+static Handle<Object>
+getQueryHosts(lcb_t instance)
+{
+    Handle<Object> ret = NanNew<Object>();
+    lcb_N1QLSTATSREQ req;
+    req.callback = queryhost_stats_callback;
+    req.cookie = &ret;
+    lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_N1QL_HOSTS, &req);
+    return ret;
+}
+
+static lcb_error_t
+setQueryHosts(lcb_t instance, Handle<Value> hosts)
+{
+    std::string spec;
+    if (hosts->IsArray()) {
+        Handle<Array> arr = hosts.As<Array>();
+        for (unsigned int ii = 0; ii < arr->Length(); ii++) {
+            String::Utf8Value s(arr->Get(ii)->ToString());
+            spec.append(*s, s.length());
+            spec += ';';
+        }
+    } else {
+        String::Utf8Value s(hosts->ToString());
+        spec.assign(*s, s.length());
+    }
+    return lcb_cntl(instance, LCB_CNTL_SET, LCB_CNTL_N1QL_HOSTS,
+                    (void *)spec.c_str());
+}
+
 NAN_METHOD(CouchbaseImpl::_Control)
 {
     NanScope();
@@ -123,6 +433,14 @@ NAN_METHOD(CouchbaseImpl::_Control)
         break;
      }
 
+    case LCB_CNTL_N1QL_HOSTS: {
+        if (option == LCB_CNTL_GET) {
+            NanReturnValue(getQueryHosts(instance));
+        }
+        err = setQueryHosts(instance, optVal);
+        break;
+    }
+
     case CNTL_LIBCOUCHBASE_VERSION: {
         const char *vstr;
         lcb_uint32_t vnum;
@@ -161,6 +479,170 @@ NAN_METHOD(CouchbaseImpl::_Control)
         NanReturnValue(NanNew<String>(s));
     }
 
+    case CNTL_ZEROCOPY_THRESHOLD: {
+        if (option == LCB_CNTL_GET) {
+            NanReturnValue(NanNew<Number>(me->zeroCopyThreshold));
+        }
+        me->zeroCopyThreshold = optVal->Uint32Value();
+        err = LCB_SUCCESS;
+        break;
+    }
+
+    case CNTL_COOKIEPOOL_STATS: {
+        if (option != LCB_CNTL_GET) {
+            NanReturnValue(exc.eArguments("Pool statistics are read-only").throwV8());
+        }
+        NanReturnValue(me->cookiePool.getStats());
+    }
+
+    case CNTL_CALLBACK_BATCHING: {
+        if (option == LCB_CNTL_GET) {
+            NanReturnValue(me->callbackBatch.isEnabled() ? NanTrue() : NanFalse());
+        }
+        if (optVal->IsFunction()) {
+            me->callbackBatch.enable(optVal.As<Function>());
+        } else if (!optVal->BooleanValue()) {
+            me->callbackBatch.disable();
+        } else {
+            NanReturnValue(exc.eArguments("Expected a dispatch function").throwV8());
+        }
+        err = LCB_SUCCESS;
+        break;
+    }
+
+    case CNTL_BUFFERPOOL_STATS: {
+        if (option != LCB_CNTL_GET) {
+            NanReturnValue(exc.eArguments("Pool statistics are read-only").throwV8());
+        }
+        NanReturnValue(me->bufferPool.getStats());
+    }
+
+    case CNTL_BUFFERPOOL_SIZE: {
+        if (option == LCB_CNTL_GET) {
+            NanReturnValue(NanNew<Number>((double)me->bufferPool.getMaxCached()));
+        }
+        me->bufferPool.setMaxCached(optVal->Uint32Value());
+        err = LCB_SUCCESS;
+        break;
+    }
+
+    case CNTL_KEYCACHE_STATS: {
+        if (option != LCB_CNTL_GET) {
+            NanReturnValue(exc.eArguments("Cache statistics are read-only").throwV8());
+        }
+        NanReturnValue(me->keyCache.getStats());
+    }
+
+    case CNTL_KEYCACHE_SIZE: {
+        if (option == LCB_CNTL_GET) {
+            NanReturnValue(NanNew<Number>((double)me->keyCache.getCapacity()));
+        }
+        me->keyCache.setCapacity(optVal->Uint32Value());
+        err = LCB_SUCCESS;
+        break;
+    }
+
+    case CNTL_LATENCY_TRACKING: {
+        int enabled = 0;
+        if (option == LCB_CNTL_SET) {
+            enabled = optVal->BooleanValue() ? 1 : 0;
+        }
+        err = lcb_cntl(instance, option, LCB_CNTL_OPLATENCY, &enabled);
+        if (err == LCB_SUCCESS && option == LCB_CNTL_GET) {
+            NanReturnValue(enabled ? NanTrue() : NanFalse());
+        }
+        break;
+    }
+
+    case CNTL_LATENCY_SNAPSHOT: {
+        // Setting a true value returns the snapshot and resets the histograms
+        int reset = option == LCB_CNTL_SET && optVal->BooleanValue();
+        Handle<Object> snapshot = NanNew<Object>();
+        err = lcb_get_latencies(instance, &snapshot, latency_callback, reset);
+        if (err == LCB_SUCCESS) {
+            NanReturnValue(snapshot);
+        }
+        break;
+    }
+
+    case CNTL_COMPRESSION_POLICY: {
+        if (option == LCB_CNTL_GET) {
+            NanReturnValue(getCompressionPolicy(instance));
+        }
+        if (!optVal->IsObject()) {
+            NanReturnValue(exc.eArguments("Expected a policy object").throwV8());
+        }
+        err = setCompressionPolicy(instance, optVal.As<Object>());
+        break;
+    }
+
+    case CNTL_COMPRESSION_STATS: {
+        if (option != LCB_CNTL_GET) {
+            NanReturnValue(exc.eArguments("Compression statistics are read-only").throwV8());
+        }
+        NanReturnValue(getCompressionStats(instance));
+    }
+
+    case CNTL_CONNPOOL_OPTS: {
+        if (option == LCB_CNTL_GET) {
+            NanReturnValue(getPoolOptions(instance));
+        }
+        if (!optVal->IsObject()) {
+            NanReturnValue(exc.eArguments("Expected an options object").throwV8());
+        }
+        err = setPoolOptions(instance, optVal.As<Object>());
+        break;
+    }
+
+    case CNTL_CONNPOOL_STATS: {
+        if (option != LCB_CNTL_GET) {
+            NanReturnValue(exc.eArguments("Pool statistics are read-only").throwV8());
+        }
+        Handle<Object> stats = NanNew<Object>();
+        lcb_POOLSTATSREQ req;
+        req.callback = pool_stats_callback;
+        req.cookie = &stats;
+        err = lcb_cntl(instance, LCB_CNTL_GET, LCB_CNTL_MEMDPOOL_STATS, &req);
+        if (err == LCB_SUCCESS) {
+            NanReturnValue(stats);
+        }
+        break;
+    }
+
+    case CNTL_KV_CONNECTIONS: {
+        if (option == LCB_CNTL_GET) {
+            NanReturnValue(getKvConnections(instance));
+        }
+        if (!optVal->IsObject()) {
+            NanReturnValue(exc.eArguments("Expected an options object").throwV8());
+        }
+        err = setKvConnections(instance, optVal.As<Object>());
+        break;
+    }
+
+    case CNTL_WRITE_STATS: {
+        if (option != LCB_CNTL_GET) {
+            NanReturnValue(exc.eArguments("Write statistics are read-only").throwV8());
+        }
+        NanReturnValue(getWriteStats(instance));
+    }
+
+    case CNTL_CONFIG_STATS: {
+        if (option != LCB_CNTL_GET) {
+            NanReturnValue(exc.eArguments("Config statistics are read-only").throwV8());
+        }
+        NanReturnValue(getConfigStats(instance));
+    }
+
+    case CNTL_COOKIEPOOL_SIZE: {
+        if (option == LCB_CNTL_GET) {
+            NanReturnValue(NanNew<Number>((double)me->cookiePool.getMaxFree()));
+        }
+        me->cookiePool.setMaxFree(optVal->Uint32Value());
+        err = LCB_SUCCESS;
+        break;
+    }
+
 
     default:
         NanReturnValue(exc.eArguments("Not supported yet").throwV8());
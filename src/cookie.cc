@@ -23,14 +23,19 @@ using namespace Couchnode;
 
 Cookie::~Cookie()
 {
-    if (!parent.IsEmpty()) {
-        NanDisposePersistent(parent);
-    }
+    disposeHandles();
 
     if (callback) {
         delete callback;
         callback = NULL;
     }
+}
+
+void Cookie::disposeHandles()
+{
+    if (!parent.IsEmpty()) {
+        NanDisposePersistent(parent);
+    }
 
     if (!spooledInfo.IsEmpty()) {
         NanDisposePersistent(spooledInfo);
@@ -39,6 +44,10 @@ Cookie::~Cookie()
     if (!keyOptions.IsEmpty()) {
         NanDisposePersistent(keyOptions);
     }
+
+    if (!pinnedValues.IsEmpty()) {
+        NanDisposePersistent(pinnedValues);
+    }
 }
 
 void Cookie::addSpooledInfo(Handle<Value>& ec, ResponseInfo& info)
@@ -52,11 +61,27 @@ void Cookie::addSpooledInfo(Handle<Value>& ec, ResponseInfo& info)
         info.setField(NameMap::ERRORED, ec);
     }
 
+    if (isIndexed) {
+        int ix = info.index;
+        if (ix < 0) {
+            ix = keyIndex.claim(info.key, info.nkey);
+        }
+        if (ix >= 0) {
+            NanNew(spooledInfo)->Set(ix, payload);
+            return;
+        }
+    }
+
     NanNew(spooledInfo)->ForceSet(info.getKey(), payload);
 }
 
 void Cookie::invokeSingleCallback(Handle<Value>& errObj, ResponseInfo& info)
 {
+    if (batch && batch->isEnabled()) {
+        batch->add(callback->GetFunction(), errObj, info.payload);
+        return;
+    }
+
     Handle<Value> args[2] = { errObj, info.payload };
     int argc = 2;
     if (args[1].IsEmpty()) {
@@ -87,6 +112,27 @@ bool Cookie::hasRemaining() {
     return remaining > 0;
 }
 
+void Cookie::release()
+{
+    if (pool) {
+        pool->release(this);
+    } else {
+        delete this;
+    }
+}
+
+void Cookie::reset(unsigned int numRemaining)
+{
+    hasError = false;
+    cbType = CBMODE_SINGLE;
+    remaining = numRemaining;
+    pinnedPackets = 0;
+    isCancelled = false;
+    isIndexed = false;
+    keyIndex.clear();
+    batch = NULL;
+}
+
 
 void Cookie::markProgress(ResponseInfo &info) {
     remaining--;
@@ -96,7 +142,8 @@ void Cookie::markProgress(ResponseInfo &info) {
         // Termination via 'NULL'
         if (cbType == CBMODE_SPOOLED) {
             invokeSpooledCallback();
-            delete this;
+            release();
+            return;
         }
     }
 
@@ -121,8 +168,16 @@ void Cookie::markProgress(ResponseInfo &info) {
         invokeSpooledCallback();
     }
 
-    if (!hasRemaining()) {
-        delete this;
+    if (!hasRemaining() && pinnedPackets == 0) {
+        release();
+    }
+}
+
+void Cookie::packetFlushed()
+{
+    assert(pinnedPackets > 0);
+    if (--pinnedPackets == 0 && !hasRemaining()) {
+        release();
     }
 }
 
@@ -131,7 +186,7 @@ void Cookie::cancel(lcb_error_t err, Handle<Array> keys)
     isCancelled = 1;
     for (unsigned int ii = 0; ii < keys->Length(); ii++) {
         Handle<Value> key = keys->Get(ii);
-        ResponseInfo ri(err, key);
+        ResponseInfo ri(err, key, ii);
         markProgress(ri);
     }
 }
@@ -153,7 +208,7 @@ void StatsCookie::invoke(lcb_error_t err)
         argv[1] = NanNew<Object>();
     }
     callback->Call(2, argv);
-    delete this;
+    release();
 }
 
 void StatsCookie::update(lcb_error_t err,
@@ -208,7 +263,7 @@ void HttpCookie::update(lcb_error_t err, const lcb_http_resp_t *resp)
         // Cancellation
         Handle<Value> args[] = { errObj };
         callback->Call(1, args);
-        delete this;
+        release();
         return;
     }
 
@@ -239,7 +294,104 @@ void HttpCookie::update(lcb_error_t err, const lcb_http_resp_t *resp)
     Handle<Value> args[] = { errObj, payload, callback->GetFunction() };
     NanMakeCallback(NanGetCurrentContext()->Global(),
                        getGlobalRestHandler(), 3, args);
-    delete this;
+    release();
+}
+
+void HttpStreamCookie::start(CouchbaseImpl *parent, lcb_http_request_t req)
+{
+    impl = parent;
+    request = req;
+    impl->addStream(streamId, this);
+}
+
+void HttpStreamCookie::finish()
+{
+    if (impl) {
+        impl->removeStream(streamId);
+        impl = NULL;
+    }
+    request = NULL;
+}
+
+void HttpStreamCookie::pause()
+{
+    if (request) {
+        lcb_pause_http_request(impl->getLibcouchbaseHandle(), request);
+    }
+}
+
+void HttpStreamCookie::resume()
+{
+    if (request) {
+        lcb_resume_http_request(impl->getLibcouchbaseHandle(), request);
+    }
+}
+
+void HttpStreamCookie::onData(const lcb_http_resp_t *resp)
+{
+    NanScope();
+    splitter.feed((const char *)resp->v.v0.bytes, resp->v.v0.nbytes);
+
+    size_t nrows = splitter.rowCount();
+    if (!nrows) {
+        return;
+    }
+
+    Handle<Array> rows = NanNew<Array>(nrows);
+    for (size_t ii = 0; ii < nrows; ii++) {
+        size_t n;
+        const char *row = splitter.rowAt(ii, &n);
+        Handle<Value> value;
+        if (JsonDecoder::decode(row, n, value) != JsonDecoder::OK) {
+            // Left for JSON.parse, which also reports any error
+            value = NanNew<String>(row, n);
+        }
+        rows->Set(ii, value);
+    }
+    splitter.clearRows();
+
+    Handle<Object> payload = NanNew<Object>();
+    payload->ForceSet(NameMap::get(NameMap::HTTP_ROWS), rows);
+    Handle<Value> args[] = { NanUndefined(), payload };
+    callback->Call(2, args);
+}
+
+void HttpStreamCookie::update(lcb_error_t err, const lcb_http_resp_t *resp)
+{
+    NanScope();
+    Handle<Value> errObj;
+
+    finish();
+    if (err) {
+        errObj = CBExc().eLcb(err).asValue();
+    } else {
+        errObj = NanUndefined();
+    }
+
+    if (!resp) {
+        Handle<Value> args[] = { errObj };
+        callback->Call(1, args);
+        release();
+        return;
+    }
+
+    Handle<Object> payload = NanNew<Object>();
+    payload->ForceSet(NameMap::get(NameMap::HTTP_STATUS),
+                      NanNew<Number>(resp->v.v0.status));
+
+    if (err != LCB_SUCCESS) {
+        payload->ForceSet(NameMap::get(NameMap::ERRORED), errObj);
+    }
+
+    const std::string &meta = splitter.getMeta();
+    if (!meta.empty()) {
+        payload->ForceSet(NameMap::get(NameMap::HTTP_CONTENT),
+                          NanNew<String>(meta.data(), meta.size()));
+    }
+
+    Handle<Value> args[] = { errObj, payload };
+    callback->Call(2, args);
+    release();
 }
 
 void ObserveCookie::update(lcb_error_t err, const lcb_observe_resp_t *resp)
@@ -248,7 +400,7 @@ void ObserveCookie::update(lcb_error_t err, const lcb_observe_resp_t *resp)
 
     if (!ri.hasKey()) {
         invokeSpooledCallback();
-        delete this;
+        release();
         return;
     }
 
@@ -274,12 +426,13 @@ void initCommonInfo_v0(ResponseInfo *tp, lcb_error_t err, const T* resp)
 {
     tp->key = resp->v.v0.key;
     tp->nkey = resp->v.v0.nkey;
+    tp->index = -1;
     tp->status = err;
     tp->payload = NanNew<Object>();
 }
 
 ResponseInfo::ResponseInfo(lcb_error_t err, const lcb_get_resp_t *resp,
-                           const Cookie *cookie)
+                           const Cookie *cookie, void *backbuf)
 {
     initCommonInfo_v0(this, err, resp);
     if (err != LCB_SUCCESS) {
@@ -299,7 +452,7 @@ ResponseInfo::ResponseInfo(lcb_error_t err, const lcb_get_resp_t *resp,
 
     Handle<Value> s = ValueFormat::decode((const char *)resp->v.v0.bytes,
                                           resp->v.v0.nbytes,
-                                          effectiveFlags);
+                                          effectiveFlags, backbuf);
     setValue(s);
 }
 
@@ -354,6 +507,7 @@ ResponseInfo::ResponseInfo(lcb_error_t err, const lcb_observe_resp_t *resp)
     if (resp->v.v0.key == NULL && resp->v.v0.nkey == 0) {
         key = NULL;
         nkey = 0;
+        index = -1;
         return;
     }
 
@@ -392,8 +546,8 @@ ResponseInfo::ResponseInfo(lcb_error_t err, const lcb_durability_resp_t *resp)
     setCas(resp->v.v0.cas);
 }
 
-ResponseInfo::ResponseInfo(lcb_error_t err, Handle<Value> kObj) :
-        key(NULL), nkey(0), keyObj(kObj)
+ResponseInfo::ResponseInfo(lcb_error_t err, Handle<Value> kObj, int ix) :
+        key(NULL), nkey(0), index(ix), keyObj(kObj)
 {
     status = err;
     payload = NanNew<Object>();
@@ -422,7 +576,7 @@ static void error_callback(lcb_t instance,
 
 
 
-static void get_callback(lcb_t,
+static void get_callback(lcb_t instance,
                          const void *cookie,
                          lcb_error_t error,
                          const lcb_get_resp_t *resp)
@@ -432,9 +586,18 @@ static void get_callback(lcb_t,
     }
 
     Cookie *cc = getInstance(cookie);
+    CouchbaseImpl *me = reinterpret_cast<CouchbaseImpl *>(
+            const_cast<void *>(lcb_get_cookie(instance)));
+
+    // Only worth pinning the network buffer for large values
+    void *backbuf = NULL;
+    size_t threshold = me->getZeroCopyThreshold();
+    if (threshold && resp->v.v0.nbytes >= threshold) {
+        backbuf = resp->v.v0.bufh;
+    }
 
     NanScope();
-    ResponseInfo ri(error, resp, cc);
+    ResponseInfo ri(error, resp, cc, backbuf);
     cc->markProgress(ri);
 }
 
@@ -550,6 +713,24 @@ static void stats_callback(lcb_t,
     sc->update(error, resp);
 }
 
+static void pktflushed_callback(lcb_t, const void *cookie)
+{
+    getInstance(cookie)->packetFlushed();
+}
+
+static void http_data_callback(lcb_http_request_t,
+                               lcb_t,
+                               const void *cookie,
+                               lcb_error_t,
+                               const lcb_http_resp_t *resp)
+{
+    // Only streaming requests are chunked
+    HttpStreamCookie *hc =
+            reinterpret_cast<HttpStreamCookie *>(
+                    const_cast<void *>(cookie));
+    hc->onData(resp);
+}
+
 static void http_complete_callback(lcb_http_request_t,
                                    lcb_t,
                                    const void *cookie,
@@ -575,8 +756,10 @@ void CouchbaseImpl::setupLibcouchbaseCallbacks(void)
     lcb_set_touch_callback(instance, touch_callback);
     lcb_set_configuration_callback(instance, configuration_callback);
     lcb_set_http_complete_callback(instance, http_complete_callback);
+    lcb_set_http_data_callback(instance, http_data_callback);
     lcb_set_unlock_callback(instance, unlock_callback);
     lcb_set_durability_callback(instance, durability_callback);
     lcb_set_observe_callback(instance, observe_callback);
     lcb_set_stat_callback(instance, stats_callback);
+    lcb_set_pktflushed_callback(instance, pktflushed_callback);
 }
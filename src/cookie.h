@@ -32,6 +32,9 @@ typedef enum {
 } CallbackMode;
 
 class Cookie;
+class CookiePool;
+class CallbackBatch;
+class CouchbaseImpl;
 
 class ResponseInfo {
 public:
@@ -58,7 +61,8 @@ public:
     ~ResponseInfo() {
     }
 
-    ResponseInfo(lcb_error_t, const lcb_get_resp_t*, const Cookie *);
+    ResponseInfo(lcb_error_t, const lcb_get_resp_t*, const Cookie *,
+                 void *backbuf);
     ResponseInfo(lcb_error_t, const lcb_store_resp_t *);
     ResponseInfo(lcb_error_t, const lcb_arithmetic_resp_t*);
     ResponseInfo(lcb_error_t, const lcb_touch_resp_t*);
@@ -66,10 +70,12 @@ public:
     ResponseInfo(lcb_error_t, const lcb_remove_resp_t *);
     ResponseInfo(lcb_error_t, const lcb_observe_resp_t *);
     ResponseInfo(lcb_error_t, const lcb_durability_resp_t *);
-    ResponseInfo(lcb_error_t, Handle<Value> kObj);
+    ResponseInfo(lcb_error_t, Handle<Value> kObj, int ix = -1);
 
     const void *key;
     size_t nkey;
+    // Position of the key in the request, if already known
+    int index;
     //HandleScope scope;
     Handle<Value> keyObj;
 
@@ -91,12 +97,16 @@ class Cookie
 public:
     Cookie(unsigned int numRemaining)
         : callback(NULL), hasError(false), cbType(CBMODE_SINGLE),
-          remaining(numRemaining), isCancelled(false) {}
+          remaining(numRemaining), pinnedPackets(0), isCancelled(false),
+          isIndexed(false), batch(NULL), pool(NULL) {}
 
     void setCallback(Handle<Function> cb, CallbackMode mode) {
-        assert(callback == NULL);
-
-        callback = new NanCallback(cb);
+        if (callback == NULL) {
+            callback = new NanCallback(cb);
+        } else {
+            // Recycled from the pool
+            callback->SetFunction(cb);
+        }
         cbType = mode;
 
         if (cbType == CBMODE_SPOOLED) {
@@ -114,6 +124,39 @@ public:
         NanAssignPersistent(keyOptions, options);
     }
 
+    // Spooled results are placed in an array at the position of each key in
+    // the request, rather than in an object keyed by the key
+    void setIndexed(KeyIndex &index, unsigned int nkeys) {
+        assert(spooledInfo.IsEmpty());
+        keyIndex.swap(index);
+        keyIndex.seal();
+        isIndexed = true;
+        NanAssignPersistent(spooledInfo, NanNew<Array>(nkeys));
+    }
+
+    // Single-key callbacks are queued on the batch instead of being invoked
+    // directly
+    void setBatch(CallbackBatch *b) {
+        batch = b;
+    }
+
+    void setPinnedValues(Handle<Array> values) {
+        assert(pinnedValues.IsEmpty());
+        NanAssignPersistent(pinnedValues, values);
+    }
+
+    // The cookie outlives its callbacks until each scheduled packet which
+    // references a pinned value has been released by libcouchbase
+    void addPinnedPackets(unsigned int n) {
+        pinnedPackets += n;
+    }
+    // Undoes addPinnedPackets() when the packets were never scheduled
+    void cancelPinnedPackets(unsigned int n) {
+        assert(pinnedPackets >= n);
+        pinnedPackets -= n;
+    }
+    void packetFlushed();
+
     virtual ~Cookie();
     void markProgress(ResponseInfo&);
     virtual void cancel(lcb_error_t err, Handle<Array> keys);
@@ -136,6 +179,10 @@ protected:
 
     // Processed a single command
     bool hasRemaining();
+
+    // Called once the cookie is no longer needed. This either hands it
+    // back to its pool or deletes it.
+    void release();
     NanCallback *callback;
 
     void initSpooledInfo() {
@@ -154,14 +201,29 @@ protected:
     // Per-key options
     Persistent<Object> keyOptions;
 
+    // Values sent without being copied
+    Persistent<Array> pinnedValues;
+
     // Pointer to parent
     Persistent<Value> parent;
 
 private:
     unsigned int remaining;
+    unsigned int pinnedPackets;
 
     bool isCancelled;
 
+    bool isIndexed;
+    KeyIndex keyIndex;
+
+    CallbackBatch *batch;
+
+    // Owning pool, if any
+    CookiePool *pool;
+    friend class CookiePool;
+    void disposeHandles();
+    void reset(unsigned int numRemaining);
+
     // No copying
     Cookie(Cookie&);
 };
@@ -181,7 +243,7 @@ class HttpCookie : public Cookie
 {
 public:
     HttpCookie() : Cookie(-1) {}
-    void update(lcb_error_t, const lcb_http_resp_t *);
+    virtual void update(lcb_error_t, const lcb_http_resp_t *);
     virtual void cancel(lcb_error_t err, Handle<Array>) {
         update(err, NULL);
     }
@@ -195,6 +257,34 @@ private:
 
 };
 
+// Hands the rows of a view response to the callback in batches as they are
+// received, as { rows: [...] }. Once the response is complete, the callback
+// gets the status and the rest of the body (total_rows, errors) as `data`.
+class HttpStreamCookie : public HttpCookie
+{
+public:
+    HttpStreamCookie(unsigned int id, const char * const *rowKeys)
+        : streamId(id), impl(NULL), request(NULL), splitter(rowKeys) {}
+
+    // Called once the request is scheduled, so that it can be paused
+    void start(CouchbaseImpl *parent, lcb_http_request_t req);
+    void onData(const lcb_http_resp_t *);
+    virtual void update(lcb_error_t, const lcb_http_resp_t *);
+
+    // Stops or restarts reading the response from the network, for when
+    // JavaScript cannot keep up with the rows
+    void pause();
+    void resume();
+
+private:
+    void finish();
+
+    unsigned int streamId;
+    CouchbaseImpl *impl;
+    lcb_http_request_t request;
+    ViewRowSplitter splitter;
+};
+
 class ObserveCookie : public Cookie {
 public:
     ObserveCookie(unsigned int ncmds) : Cookie(ncmds) {
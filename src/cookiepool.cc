@@ -0,0 +1,95 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "couchbase_impl.h"
+
+using namespace Couchnode;
+
+CookiePool::~CookiePool()
+{
+    for (size_t ii = 0; ii < freeList.size(); ii++) {
+        delete freeList[ii];
+    }
+    freeList.clear();
+
+    if (!idleFunction.IsEmpty()) {
+        NanDisposePersistent(idleFunction);
+    }
+}
+
+Cookie *CookiePool::acquire(unsigned int numRemaining)
+{
+    Cookie *cookie;
+
+    if (freeList.empty()) {
+        cookie = new Cookie(numRemaining);
+        cookie->pool = this;
+        misses++;
+    } else {
+        cookie = freeList.back();
+        freeList.pop_back();
+        cookie->reset(numRemaining);
+        hits++;
+    }
+
+    if (++inUse > highWater) {
+        highWater = inUse;
+    }
+    return cookie;
+}
+
+void CookiePool::release(Cookie *cookie)
+{
+    assert(cookie->pool == this);
+    assert(inUse > 0);
+    inUse--;
+
+    if (freeList.size() >= maxFree) {
+        delete cookie;
+        return;
+    }
+
+    cookie->disposeHandles();
+    if (cookie->callback) {
+        if (idleFunction.IsEmpty()) {
+            NanAssignPersistent(idleFunction,
+                                NanNew<FunctionTemplate>()->GetFunction());
+        }
+        cookie->callback->SetFunction(NanNew(idleFunction));
+    }
+    freeList.push_back(cookie);
+}
+
+void CookiePool::setMaxFree(size_t n)
+{
+    maxFree = n;
+    while (freeList.size() > maxFree) {
+        delete freeList.back();
+        freeList.pop_back();
+    }
+}
+
+Handle<Object> CookiePool::getStats() const
+{
+    Handle<Object> ret = NanNew<Object>();
+    ret->Set(NanNew<String>("hits"), NanNew<Number>((double)hits));
+    ret->Set(NanNew<String>("misses"), NanNew<Number>((double)misses));
+    ret->Set(NanNew<String>("inUse"), NanNew<Number>((double)inUse));
+    ret->Set(NanNew<String>("highWater"), NanNew<Number>((double)highWater));
+    ret->Set(NanNew<String>("free"), NanNew<Number>((double)freeList.size()));
+    return ret;
+}
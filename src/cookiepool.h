@@ -0,0 +1,72 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef COUCHNODE_COOKIEPOOL_H
+#define COUCHNODE_COOKIEPOOL_H 1
+
+#ifndef COUCHBASE_H
+#error "include couchbase_impl.h first"
+#endif
+
+namespace Couchnode
+{
+
+/**
+ * Per-instance free list of Cookie objects.
+ *
+ * A cookie returned here keeps its NanCallback, so an operation which hits
+ * the pool performs no heap allocation for either. Only plain Cookie objects
+ * are pooled; the stats, HTTP and observe cookies are rare and are still
+ * allocated and deleted directly.
+ */
+class CookiePool
+{
+public:
+    CookiePool() : maxFree(DEFAULT_MAX_FREE), hits(0), misses(0),
+        inUse(0), highWater(0) {}
+    ~CookiePool();
+
+    Cookie *acquire(unsigned int numRemaining);
+
+    // Called by the cookie once it is no longer referenced by libcouchbase
+    void release(Cookie *cookie);
+
+    // Maximum number of idle cookies kept around. Shrinking the limit
+    // frees any excess right away.
+    size_t getMaxFree() const { return maxFree; }
+    void setMaxFree(size_t n);
+
+    Handle<Object> getStats() const;
+
+    static const size_t DEFAULT_MAX_FREE = 1024;
+
+private:
+    std::vector<Cookie *> freeList;
+    size_t maxFree;
+
+    // Function assigned to idle callbacks so they do not keep the user's
+    // closure alive while sitting in the pool.
+    Persistent<Function> idleFunction;
+
+    uint64_t hits;
+    uint64_t misses;
+    size_t inUse;
+    size_t highWater;
+};
+
+} // namespace Couchnode
+#endif // COUCHNODE_COOKIEPOOL_H
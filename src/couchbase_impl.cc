@@ -50,7 +50,8 @@ unsigned int CouchbaseImpl::objectCount;
 
 CouchbaseImpl::CouchbaseImpl(lcb_t inst) :
     ObjectWrap(), connected(false), useHashtableParams(false),
-    instance(inst), lastError(LCB_SUCCESS), isShutdown(false)
+    instance(inst), lastError(LCB_SUCCESS), zeroCopyThreshold(0),
+    callbackBatch(this), isShutdown(false)
 
 {
     lcb_set_cookie(instance, reinterpret_cast<void *>(this));
@@ -109,6 +110,8 @@ void CouchbaseImpl::Init(Handle<Object> target)
     NODE_SET_PROTOTYPE_METHOD(t, "endureMulti", EndureMulti);
     NODE_SET_PROTOTYPE_METHOD(t, "stats", Stats);
     NODE_SET_PROTOTYPE_METHOD(t, "httpRequest", HttpRequest);
+    NODE_SET_PROTOTYPE_METHOD(t, "httpPause", HttpPause);
+    NODE_SET_PROTOTYPE_METHOD(t, "httpResume", HttpResume);
     NODE_SET_PROTOTYPE_METHOD(t, "_control", _Control);
     NODE_SET_PROTOTYPE_METHOD(t, "_connect", Connect);
     target->Set(NanNew<String>("CouchbaseImpl"), t->GetFunction());
@@ -213,9 +216,6 @@ NAN_METHOD(CouchbaseImpl::New)
         NanReturnValue(exc.eLcb(err).throwV8());
     }
 
-    lcb_int32_t compOpts = LCB_COMPRESS_NONE;
-    lcb_cntl(instance, LCB_CNTL_SET, LCB_CNTL_COMPRESSION_OPTS, &compOpts);
-
     CouchbaseImpl *hw = new CouchbaseImpl(instance);
     hw->Wrap(args.This());
     NanReturnValue(args.This());
@@ -495,6 +495,30 @@ NAN_METHOD(CouchbaseImpl::HttpRequest)
     NanReturnValue(makeOperation(args, op));
 }
 
+NAN_METHOD(CouchbaseImpl::HttpPause)
+{
+    NanScope();
+    CouchbaseImpl *me = ObjectWrap::Unwrap<CouchbaseImpl>(args.This());
+    StreamMap::iterator iter = me->streams.find(args[0]->Uint32Value());
+    if (iter == me->streams.end()) {
+        NanReturnValue(NanFalse());
+    }
+    iter->second->pause();
+    NanReturnValue(NanTrue());
+}
+
+NAN_METHOD(CouchbaseImpl::HttpResume)
+{
+    NanScope();
+    CouchbaseImpl *me = ObjectWrap::Unwrap<CouchbaseImpl>(args.This());
+    StreamMap::iterator iter = me->streams.find(args[0]->Uint32Value());
+    if (iter == me->streams.end()) {
+        NanReturnValue(NanFalse());
+    }
+    iter->second->resume();
+    NanReturnValue(NanTrue());
+}
+
 NAN_METHOD(CouchbaseImpl::Shutdown)
 {
     NanScope();
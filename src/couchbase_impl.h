@@ -63,6 +63,8 @@ using v8::Object;
 #include <queue>
 #include <libcouchbase/couchbase.h>
 #include <libcouchbase/configuration.h>
+#include <libcouchbase/pktfwd.h>
+#include <libcouchbase/vbucket.h>
 #if LCB_VERSION < 0x020100
 #error "Couchnode requires libcouchbase >= 2.1.0"
 #endif
@@ -70,11 +72,18 @@ using v8::Object;
 #include "cas.h"
 #include "namemap.h"
 #include "exception.h"
+#include "keyindex.h"
+#include "viewrows.h"
 #include "cookie.h"
+#include "cookiepool.h"
+#include "callbackbatch.h"
 #include "options.h"
 #include "commandlist.h"
 #include "commands.h"
+#include "keycache.h"
 #include "valueformat.h"
+#include "jsonencoder.h"
+#include "jsondecoder.h"
 
 namespace Couchnode
 {
@@ -95,7 +104,24 @@ enum ControlCode {
     CNTL_COUCHNODE_VERSION = 0x1001,
     CNTL_LIBCOUCHBASE_VERSION = 0x1002,
     CNTL_CLNODES = 0x1003,
-    CNTL_RESTURI = 0x1004
+    CNTL_RESTURI = 0x1004,
+    CNTL_ZEROCOPY_THRESHOLD = 0x1005,
+    CNTL_COOKIEPOOL_STATS = 0x1006,
+    CNTL_COOKIEPOOL_SIZE = 0x1007,
+    CNTL_CALLBACK_BATCHING = 0x1008,
+    CNTL_BUFFERPOOL_STATS = 0x1009,
+    CNTL_BUFFERPOOL_SIZE = 0x100A,
+    CNTL_KEYCACHE_STATS = 0x100B,
+    CNTL_KEYCACHE_SIZE = 0x100C,
+    CNTL_LATENCY_TRACKING = 0x100D,
+    CNTL_LATENCY_SNAPSHOT = 0x100E,
+    CNTL_COMPRESSION_POLICY = 0x100F,
+    CNTL_COMPRESSION_STATS = 0x1010,
+    CNTL_CONNPOOL_OPTS = 0x1011,
+    CNTL_CONNPOOL_STATS = 0x1012,
+    CNTL_KV_CONNECTIONS = 0x1013,
+    CNTL_WRITE_STATS = 0x1014,
+    CNTL_CONFIG_STATS = 0x1015
 };
 
 class CouchbaseImpl: public node::ObjectWrap
@@ -130,6 +156,8 @@ public:
     static NAN_METHOD(View);
     static NAN_METHOD(Shutdown);
     static NAN_METHOD(HttpRequest);
+    static NAN_METHOD(HttpPause);
+    static NAN_METHOD(HttpResume);
     static NAN_METHOD(_Control);
     static NAN_METHOD(Connect);
 
@@ -163,6 +191,38 @@ public:
         return connected;
     }
 
+    // Minimum size of a RAW value for it to be returned as a Buffer which
+    // references the network buffer directly. 0 disables this.
+    size_t getZeroCopyThreshold(void) const {
+        return zeroCopyThreshold;
+    }
+
+    CookiePool &getCookiePool(void) {
+        return cookiePool;
+    }
+
+    CallbackBatch &getCallbackBatch(void) {
+        return callbackBatch;
+    }
+
+    BufferPool &getBufferPool(void) {
+        return bufferPool;
+    }
+
+    KeyCache &getKeyCache(void) {
+        return keyCache;
+    }
+
+    // Streaming HTTP requests in progress, by the id they were given by
+    // JavaScript
+    void addStream(unsigned int id, HttpStreamCookie *cookie) {
+        streams[id] = cookie;
+    }
+
+    void removeStream(unsigned int id) {
+        streams.erase(id);
+    }
+
     static void dumpMemoryInfo(const std::string&);
 
 protected:
@@ -170,9 +230,16 @@ protected:
     bool useHashtableParams;
     lcb_t instance;
     lcb_error_t lastError;
+    size_t zeroCopyThreshold;
+    CookiePool cookiePool;
+    CallbackBatch callbackBatch;
+    BufferPool bufferPool;
+    KeyCache keyCache;
 
     typedef std::map<std::string, NanCallback* > EventMap;
     EventMap events;
+    typedef std::map<unsigned int, HttpStreamCookie *> StreamMap;
+    StreamMap streams;
     Persistent<Function> connectHandler;
     std::queue<Command *> pendingCommands;
     void setupLibcouchbaseCallbacks(void);
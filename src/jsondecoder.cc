@@ -0,0 +1,482 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "couchbase_impl.h"
+#include <cstdlib>
+
+namespace Couchnode
+{
+
+using v8::Array;
+
+#define RETURN_IF_NOT_OK(expr) do { \
+    Status rv__ = expr; \
+    if (rv__ != OK) { \
+        return rv__; \
+    } \
+} while (0)
+
+JsonDecoder::Status JsonDecoder::decode(const char *bytes, size_t n,
+                                        Handle<Value> &out)
+{
+    JsonDecoder decoder(bytes, n);
+
+    if (n <= maxFlatSize && decoder.parseFlatObject(out) == OK) {
+        return OK;
+    }
+
+    // Not a small flat object, start over with the general parser
+    decoder.cur = bytes;
+    RETURN_IF_NOT_OK(decoder.parseValue(out, 0));
+
+    decoder.skipWhitespace();
+    if (decoder.cur != decoder.end) {
+        return INVALID;
+    }
+    return OK;
+}
+
+/**
+ * Parses an object whose members are all strings without escapes, numbers,
+ * booleans or null. Anything else (including malformed input) returns
+ * UNSUPPORTED so that the general parser can have a go, and report errors.
+ */
+JsonDecoder::Status JsonDecoder::parseFlatObject(Handle<Value> &out)
+{
+    if (!consume('{')) {
+        return UNSUPPORTED;
+    }
+
+    Handle<Object> obj = NanNew<Object>();
+    if (!consume('}')) {
+        do {
+            Handle<String> key;
+            Handle<Value> value;
+
+            skipWhitespace();
+            if (cur == end || *cur != '"') {
+                return UNSUPPORTED;
+            }
+            if (parseString(key, true) != OK || !consume(':')) {
+                return UNSUPPORTED;
+            }
+
+            skipWhitespace();
+            if (cur == end) {
+                return UNSUPPORTED;
+            }
+
+            switch (*cur) {
+            case '"': {
+                Handle<String> s;
+                if (parseString(s, false) != OK) {
+                    return UNSUPPORTED;
+                }
+                value = s;
+                break;
+            }
+            case 't':
+                if (parseLiteral("true", 4) != OK) {
+                    return UNSUPPORTED;
+                }
+                value = NanTrue();
+                break;
+            case 'f':
+                if (parseLiteral("false", 5) != OK) {
+                    return UNSUPPORTED;
+                }
+                value = NanFalse();
+                break;
+            case 'n':
+                if (parseLiteral("null", 4) != OK) {
+                    return UNSUPPORTED;
+                }
+                value = NanNull();
+                break;
+            default:
+                if (*cur != '-' && (*cur < '0' || *cur > '9')) {
+                    return UNSUPPORTED;
+                }
+                if (parseNumber(value) != OK) {
+                    return UNSUPPORTED;
+                }
+                break;
+            }
+
+            obj->ForceSet(key, value);
+        } while (consume(','));
+
+        if (!consume('}')) {
+            return UNSUPPORTED;
+        }
+    }
+
+    skipWhitespace();
+    if (cur != end) {
+        return UNSUPPORTED;
+    }
+    out = obj;
+    return OK;
+}
+
+JsonDecoder::Status JsonDecoder::parseValue(Handle<Value> &out,
+                                            unsigned int depth)
+{
+    skipWhitespace();
+    if (cur == end) {
+        return INVALID;
+    }
+
+    switch (*cur) {
+    case '{':
+        if (depth >= maxDepth) {
+            return UNSUPPORTED;
+        }
+        return parseObject(out, depth + 1);
+
+    case '[':
+        if (depth >= maxDepth) {
+            return UNSUPPORTED;
+        }
+        return parseArray(out, depth + 1);
+
+    case '"': {
+        Handle<String> s;
+        RETURN_IF_NOT_OK(parseString(s, false));
+        out = s;
+        return OK;
+    }
+
+    case 't':
+        RETURN_IF_NOT_OK(parseLiteral("true", 4));
+        out = NanTrue();
+        return OK;
+
+    case 'f':
+        RETURN_IF_NOT_OK(parseLiteral("false", 5));
+        out = NanFalse();
+        return OK;
+
+    case 'n':
+        RETURN_IF_NOT_OK(parseLiteral("null", 4));
+        out = NanNull();
+        return OK;
+
+    default:
+        return parseNumber(out);
+    }
+}
+
+JsonDecoder::Status JsonDecoder::parseObject(Handle<Value> &out,
+                                             unsigned int depth)
+{
+    // Skip the '{'
+    ++cur;
+    Handle<Object> obj = NanNew<Object>();
+    out = obj;
+
+    if (consume('}')) {
+        return OK;
+    }
+
+    do {
+        Handle<String> key;
+        Handle<Value> value;
+
+        skipWhitespace();
+        if (cur == end || *cur != '"') {
+            return INVALID;
+        }
+        RETURN_IF_NOT_OK(parseString(key, true));
+        if (!consume(':')) {
+            return INVALID;
+        }
+        RETURN_IF_NOT_OK(parseValue(value, depth));
+
+        // ForceSet so that e.g. "__proto__" becomes an own property, as it
+        // does with JSON.parse
+        obj->ForceSet(key, value);
+    } while (consume(','));
+
+    return consume('}') ? OK : INVALID;
+}
+
+JsonDecoder::Status JsonDecoder::parseArray(Handle<Value> &out,
+                                            unsigned int depth)
+{
+    // Skip the '['
+    ++cur;
+    Handle<Array> arr = NanNew<Array>();
+    out = arr;
+
+    if (consume(']')) {
+        return OK;
+    }
+
+    uint32_t ix = 0;
+    do {
+        Handle<Value> value;
+        RETURN_IF_NOT_OK(parseValue(value, depth));
+        arr->Set(ix++, value);
+    } while (consume(','));
+
+    return consume(']') ? OK : INVALID;
+}
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static bool readHex4(const char *p, const char *end, unsigned int *out)
+{
+    if (end - p < 4) {
+        return false;
+    }
+
+    *out = 0;
+    for (int ii = 0; ii < 4; ii++) {
+        int v = hexValue(p[ii]);
+        if (v < 0) {
+            return false;
+        }
+        *out = (*out << 4) | v;
+    }
+    return true;
+}
+
+static void appendUtf8(std::string &s, unsigned int cp)
+{
+    if (cp < 0x80) {
+        s += (char)cp;
+    } else if (cp < 0x800) {
+        s += (char)(0xC0 | (cp >> 6));
+        s += (char)(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        s += (char)(0xE0 | (cp >> 12));
+        s += (char)(0x80 | ((cp >> 6) & 0x3F));
+        s += (char)(0x80 | (cp & 0x3F));
+    } else {
+        s += (char)(0xF0 | (cp >> 18));
+        s += (char)(0x80 | ((cp >> 12) & 0x3F));
+        s += (char)(0x80 | ((cp >> 6) & 0x3F));
+        s += (char)(0x80 | (cp & 0x3F));
+    }
+}
+
+JsonDecoder::Status JsonDecoder::parseString(Handle<String> &out, bool isKey)
+{
+    // Skip the opening quote
+    const char *begin = ++cur;
+
+    // Fast path: no escapes, create the string straight from the input
+    while (cur != end) {
+        unsigned char c = *cur;
+        if (c == '"' || c == '\\' || c < 0x20) {
+            break;
+        }
+        ++cur;
+    }
+
+    if (cur == end || (unsigned char)*cur < 0x20) {
+        return INVALID;
+    }
+
+    if (*cur == '"') {
+        int len = cur - begin;
+        ++cur;
+        if (isKey) {
+            out = NanSymbol(begin, len);
+        } else {
+            out = NanNew<String>(begin, len);
+        }
+        return OK;
+    }
+
+    std::string decoded(begin, cur - begin);
+    while (cur != end) {
+        unsigned char c = *cur;
+
+        if (c == '"') {
+            ++cur;
+            out = NanNew<String>(decoded.c_str(), (int)decoded.size());
+            return OK;
+
+        } else if (c < 0x20) {
+            return INVALID;
+
+        } else if (c != '\\') {
+            decoded += (char)c;
+            ++cur;
+            continue;
+        }
+
+        if (++cur == end) {
+            return INVALID;
+        }
+
+        switch (*cur++) {
+        case '"':
+            decoded += '"';
+            break;
+        case '\\':
+            decoded += '\\';
+            break;
+        case '/':
+            decoded += '/';
+            break;
+        case 'b':
+            decoded += '\b';
+            break;
+        case 'f':
+            decoded += '\f';
+            break;
+        case 'n':
+            decoded += '\n';
+            break;
+        case 'r':
+            decoded += '\r';
+            break;
+        case 't':
+            decoded += '\t';
+            break;
+        case 'u': {
+            unsigned int cp;
+            if (!readHex4(cur, end, &cp)) {
+                return INVALID;
+            }
+            cur += 4;
+
+            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                unsigned int lo;
+                if (end - cur < 6 || cur[0] != '\\' || cur[1] != 'u' ||
+                        !readHex4(cur + 2, end, &lo)) {
+                    // JSON.parse allows a lone surrogate here, which has no
+                    // UTF-8 representation.
+                    return UNSUPPORTED;
+                }
+                if (lo < 0xDC00 || lo > 0xDFFF) {
+                    return UNSUPPORTED;
+                }
+                cur += 6;
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+
+            } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                return UNSUPPORTED;
+            }
+
+            appendUtf8(decoded, cp);
+            break;
+        }
+        default:
+            return INVALID;
+        }
+    }
+
+    return INVALID;
+}
+
+JsonDecoder::Status JsonDecoder::parseNumber(Handle<Value> &out)
+{
+    const char *begin = cur;
+    bool negative = false;
+    bool isInteger = true;
+
+    if (cur != end && *cur == '-') {
+        negative = true;
+        ++cur;
+    }
+
+    if (cur == end) {
+        return INVALID;
+    }
+
+    // Leading zeros are not permitted
+    if (*cur == '0') {
+        ++cur;
+    } else if (*cur >= '1' && *cur <= '9') {
+        while (cur != end && *cur >= '0' && *cur <= '9') {
+            ++cur;
+        }
+    } else {
+        return INVALID;
+    }
+
+    const char *intEnd = cur;
+
+    if (cur != end && *cur == '.') {
+        isInteger = false;
+        ++cur;
+        if (cur == end || *cur < '0' || *cur > '9') {
+            return INVALID;
+        }
+        while (cur != end && *cur >= '0' && *cur <= '9') {
+            ++cur;
+        }
+    }
+
+    if (cur != end && (*cur == 'e' || *cur == 'E')) {
+        isInteger = false;
+        ++cur;
+        if (cur != end && (*cur == '+' || *cur == '-')) {
+            ++cur;
+        }
+        if (cur == end || *cur < '0' || *cur > '9') {
+            return INVALID;
+        }
+        while (cur != end && *cur >= '0' && *cur <= '9') {
+            ++cur;
+        }
+    }
+
+    const char *digits = begin + (negative ? 1 : 0);
+    if (isInteger && intEnd - digits <= 15) {
+        // Exactly representable; no need for strtod
+        int64_t v = 0;
+        for (const char *p = digits; p != intEnd; ++p) {
+            v = v * 10 + (*p - '0');
+        }
+        double d = (double)v;
+        out = NanNew<Number>(negative ? -d : d);
+        return OK;
+    }
+
+    // strtod needs a NUL-terminated buffer
+    std::string tmp(begin, cur - begin);
+    out = NanNew<Number>(strtod(tmp.c_str(), NULL));
+    return OK;
+}
+
+JsonDecoder::Status JsonDecoder::parseLiteral(const char *lit, size_t n)
+{
+    if ((size_t)(end - cur) < n || memcmp(cur, lit, n) != 0) {
+        return INVALID;
+    }
+    cur += n;
+    return OK;
+}
+
+#undef RETURN_IF_NOT_OK
+
+}
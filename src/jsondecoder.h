@@ -0,0 +1,86 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#ifndef COUCHNODE_JSONDECODER_H
+#define COUCHNODE_JSONDECODER_H 1
+#ifndef COUCHBASE_H
+#error "include couchbase_impl.h first"
+#endif
+
+namespace Couchnode
+{
+
+/**
+ * Builds V8 values directly from a UTF-8 JSON document, without first
+ * materializing the document as a V8 string.
+ *
+ * The grammar accepted is the same as JSON.parse. A document which is not
+ * valid JSON yields INVALID, in which case the caller can hand the original
+ * bytes out as a Buffer. A few constructs which are valid but awkward to
+ * reproduce exactly (unpaired surrogate escapes, very deep nesting) yield
+ * UNSUPPORTED, meaning the caller should defer to JSON.parse.
+ */
+class JsonDecoder
+{
+public:
+    enum Status {
+        OK,
+        INVALID,
+        UNSUPPORTED
+    };
+
+    static Status decode(const char *bytes, size_t n, Handle<Value> &out);
+
+private:
+    JsonDecoder(const char *bytes, size_t n)
+        : cur(bytes), end(bytes + n) { }
+
+    Status parseValue(Handle<Value> &out, unsigned int depth);
+    Status parseFlatObject(Handle<Value> &out);
+    Status parseObject(Handle<Value> &out, unsigned int depth);
+    Status parseArray(Handle<Value> &out, unsigned int depth);
+    Status parseString(Handle<String> &out, bool isKey);
+    Status parseNumber(Handle<Value> &out);
+    Status parseLiteral(const char *lit, size_t n);
+
+    void skipWhitespace() {
+        while (cur != end &&
+                (*cur == ' ' || *cur == '\n' || *cur == '\r' || *cur == '\t')) {
+            ++cur;
+        }
+    }
+
+    bool consume(char c) {
+        skipWhitespace();
+        if (cur != end && *cur == c) {
+            ++cur;
+            return true;
+        }
+        return false;
+    }
+
+    // Documents at most this size which are a single object of scalars are
+    // parsed without recursion and with internalized keys.
+    static const size_t maxFlatSize = 512;
+    static const unsigned int maxDepth = 128;
+
+    const char *cur;
+    const char *end;
+};
+
+}
+
+#endif
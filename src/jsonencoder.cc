@@ -0,0 +1,390 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "couchbase_impl.h"
+#include "node_buffer.h"
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace Couchnode
+{
+
+using v8::Array;
+
+#define RETURN_IF_NOT_OK(expr) do { \
+    Status rv__ = expr; \
+    if (rv__ != OK) { \
+        return rv__; \
+    } \
+} while (0)
+
+#define APPEND_OR_NOMEM(...) do { \
+    if (!append(__VA_ARGS__)) { \
+        return NOMEM; \
+    } \
+} while (0)
+
+bool JsonEncoder::reserve(size_t n)
+{
+    if (used + n <= capacity) {
+        return true;
+    }
+
+    size_t newcap = capacity ? capacity : initialSize;
+    while (newcap < used + n) {
+        newcap *= 2;
+    }
+
+    char *tmp = poolAcquire(pool, &newcap);
+    if (!tmp) {
+        return false;
+    }
+
+    if (used) {
+        memcpy(tmp, data, used);
+    }
+    if (data) {
+        poolRelease(pool, data, capacity);
+    }
+    data = tmp;
+    capacity = newcap;
+    return true;
+}
+
+char *JsonEncoder::release(BufferList &buf, size_t *n)
+{
+    char *ret = data;
+    *n = used;
+    buf.adopt(ret, capacity);
+
+    data = NULL;
+    used = 0;
+    capacity = 0;
+    return ret;
+}
+
+JsonEncoder::Status JsonEncoder::encode(Handle<Value> input)
+{
+    // JSON.stringify returns undefined rather than a string for these; let
+    // the caller produce the same error it always has.
+    if (input.IsEmpty() || isSkipped(input)) {
+        return FALLBACK;
+    }
+    return writeValue(input, 0);
+}
+
+JsonEncoder::Status JsonEncoder::writeValue(Handle<Value> v,
+                                            unsigned int depth)
+{
+    if (v->IsString()) {
+        return writeString(v.As<String>());
+
+    } else if (v->IsInt32()) {
+        char tmp[16];
+        int nw = sprintf(tmp, "%d", v->Int32Value());
+        APPEND_OR_NOMEM(tmp, nw);
+        return OK;
+
+    } else if (v->IsNumber()) {
+        return writeNumber(v->NumberValue());
+
+    } else if (v->IsTrue()) {
+        APPEND_OR_NOMEM("true", 4);
+        return OK;
+
+    } else if (v->IsFalse()) {
+        APPEND_OR_NOMEM("false", 5);
+        return OK;
+
+    } else if (v->IsNull()) {
+        APPEND_OR_NOMEM("null", 4);
+        return OK;
+
+    } else if (depth >= maxDepth) {
+        // Either a cycle or something pathological. JSON.stringify knows
+        // how to report this properly.
+        return FALLBACK;
+
+    } else if (v->IsArray()) {
+        return writeArray(v.As<Array>(), depth + 1);
+
+    } else if (v->IsObject()) {
+        return writeObject(v.As<Object>(), depth + 1);
+    }
+
+    return FALLBACK;
+}
+
+/**
+ * Format a finite, non-zero number as ECMAScript's Number::toString does:
+ * the shortest digits which round-trip, in plain notation for magnitudes
+ * in [1e-6, 1e21) and as `d.ddde+n` / `d.ddde-n` otherwise.
+ */
+static int formatNumber(double d, char *out)
+{
+    char tmp[32], digits[20];
+    char *p = out;
+    int ndigits = 0, exp10, point, ii;
+
+    // Any decimal of up to 15 digits survives a round trip through a normal
+    // double, so if the 15-digit form round-trips, dropping its trailing
+    // zeros gives the shortest digits. Subnormals have less precision, and
+    // are tried from a single digit up
+    for (int prec = std::fabs(d) < DBL_MIN ? 1 : 15; prec <= 17; prec++) {
+        sprintf(tmp, "%.*e", prec - 1, d);
+        if (prec == 17 || strtod(tmp, NULL) == d) {
+            break;
+        }
+    }
+
+    const char *src = tmp;
+    if (*src == '-') {
+        *p++ = *src++;
+    }
+    for (; *src != 'e'; src++) {
+        if (*src != '.') {
+            digits[ndigits++] = *src;
+        }
+    }
+    exp10 = atoi(src + 1);
+    while (ndigits > 1 && digits[ndigits - 1] == '0') {
+        ndigits--;
+    }
+
+    // The decimal point goes after this many digits
+    point = exp10 + 1;
+
+    if (ndigits <= point && point <= 21) {
+        memcpy(p, digits, ndigits);
+        p += ndigits;
+        for (ii = ndigits; ii < point; ii++) {
+            *p++ = '0';
+        }
+    } else if (0 < point && point <= 21) {
+        memcpy(p, digits, point);
+        p += point;
+        *p++ = '.';
+        memcpy(p, digits + point, ndigits - point);
+        p += ndigits - point;
+    } else if (-6 < point && point <= 0) {
+        *p++ = '0';
+        *p++ = '.';
+        for (ii = point; ii < 0; ii++) {
+            *p++ = '0';
+        }
+        memcpy(p, digits, ndigits);
+        p += ndigits;
+    } else {
+        *p++ = digits[0];
+        if (ndigits > 1) {
+            *p++ = '.';
+            memcpy(p, digits + 1, ndigits - 1);
+            p += ndigits - 1;
+        }
+        p += sprintf(p, "e%c%d", exp10 < 0 ? '-' : '+', exp10 < 0 ? -exp10 : exp10);
+    }
+    *p = '\0';
+    return (int)(p - out);
+}
+
+JsonEncoder::Status JsonEncoder::writeNumber(double d)
+{
+    char tmp[32];
+    int nw;
+
+    if (std::isnan(d) || std::isinf(d)) {
+        APPEND_OR_NOMEM("null", 4);
+        return OK;
+    }
+
+    if (d == 0) {
+        // Also catches -0, which JSON.stringify emits as "0"
+        APPEND_OR_NOMEM('0');
+        return OK;
+    }
+
+    if (std::floor(d) == d && std::fabs(d) < 9007199254740992.0) {
+        nw = sprintf(tmp, "%.0f", d);
+        APPEND_OR_NOMEM(tmp, nw);
+        return OK;
+    }
+
+    nw = formatNumber(d, tmp);
+    APPEND_OR_NOMEM(tmp, nw);
+    return OK;
+}
+
+static inline bool needsEscape(unsigned char c)
+{
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+JsonEncoder::Status JsonEncoder::writeString(Handle<String> s)
+{
+    // Each UTF-16 code unit takes at most 3 bytes in UTF-8, plus quotes
+    size_t maxlen = s->Length() * 3;
+    if (!reserve(maxlen + 2)) {
+        return NOMEM;
+    }
+
+    data[used++] = '"';
+    char *begin = data + used;
+    size_t nw = s->WriteUtf8(begin, (int)maxlen, NULL,
+                             String::NO_NULL_TERMINATION);
+
+    size_t ii;
+    for (ii = 0; ii < nw; ii++) {
+        if (needsEscape(begin[ii])) {
+            break;
+        }
+    }
+
+    if (ii == nw) {
+        used += nw;
+        data[used++] = '"';
+        return OK;
+    }
+
+    // Slow path: the string contains characters which must be escaped.
+    // Move the remainder aside and re-emit it.
+    used += ii;
+    std::string tail(begin + ii, nw - ii);
+
+    static const char hexchars[] = "0123456789abcdef";
+    for (ii = 0; ii < tail.size(); ii++) {
+        unsigned char c = tail[ii];
+        if (!needsEscape(c)) {
+            APPEND_OR_NOMEM((char)c);
+            continue;
+        }
+
+        switch (c) {
+        case '"':
+            APPEND_OR_NOMEM("\\\"", 2);
+            break;
+        case '\\':
+            APPEND_OR_NOMEM("\\\\", 2);
+            break;
+        case '\b':
+            APPEND_OR_NOMEM("\\b", 2);
+            break;
+        case '\f':
+            APPEND_OR_NOMEM("\\f", 2);
+            break;
+        case '\n':
+            APPEND_OR_NOMEM("\\n", 2);
+            break;
+        case '\r':
+            APPEND_OR_NOMEM("\\r", 2);
+            break;
+        case '\t':
+            APPEND_OR_NOMEM("\\t", 2);
+            break;
+        default: {
+            char esc[6] = { '\\', 'u', '0', '0',
+                            hexchars[c >> 4], hexchars[c & 0xf] };
+            APPEND_OR_NOMEM(esc, sizeof(esc));
+            break;
+        }
+        }
+    }
+
+    APPEND_OR_NOMEM('"');
+    return OK;
+}
+
+JsonEncoder::Status JsonEncoder::writeArray(Handle<Array> arr,
+                                            unsigned int depth)
+{
+    APPEND_OR_NOMEM('[');
+
+    unsigned int len = arr->Length();
+    for (unsigned int ii = 0; ii < len; ii++) {
+        if (ii) {
+            APPEND_OR_NOMEM(',');
+        }
+
+        Handle<Value> cur = arr->Get(ii);
+        if (cur.IsEmpty()) {
+            // Exception thrown by a getter
+            return FALLBACK;
+        }
+
+        if (isSkipped(cur)) {
+            APPEND_OR_NOMEM("null", 4);
+        } else {
+            RETURN_IF_NOT_OK(writeValue(cur, depth));
+        }
+    }
+
+    APPEND_OR_NOMEM(']');
+    return OK;
+}
+
+JsonEncoder::Status JsonEncoder::writeObject(Handle<Object> obj,
+                                             unsigned int depth)
+{
+    // These all have a JSON representation which differs from their
+    // enumerable properties.
+    if (obj->IsDate() || obj->IsBooleanObject() || obj->IsNumberObject() ||
+            obj->IsStringObject() || node::Buffer::HasInstance(obj)) {
+        return FALLBACK;
+    }
+
+    Handle<Value> toJSON = obj->Get(NameMap::get(NameMap::TOJSON));
+    if (toJSON.IsEmpty() || toJSON->IsFunction()) {
+        return FALLBACK;
+    }
+
+    APPEND_OR_NOMEM('{');
+
+    Local<Array> names = obj->GetOwnPropertyNames();
+    unsigned int len = names->Length();
+    bool first = true;
+
+    for (unsigned int ii = 0; ii < len; ii++) {
+        Handle<Value> name = names->Get(ii);
+        Handle<Value> cur = obj->Get(name);
+        if (cur.IsEmpty()) {
+            return FALLBACK;
+        }
+
+        if (isSkipped(cur)) {
+            continue;
+        }
+
+        if (!first) {
+            APPEND_OR_NOMEM(',');
+        }
+        first = false;
+
+        RETURN_IF_NOT_OK(writeString(name->ToString()));
+        APPEND_OR_NOMEM(':');
+        RETURN_IF_NOT_OK(writeValue(cur, depth));
+    }
+
+    APPEND_OR_NOMEM('}');
+    return OK;
+}
+
+#undef RETURN_IF_NOT_OK
+#undef APPEND_OR_NOMEM
+
+}
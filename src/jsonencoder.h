@@ -0,0 +1,107 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#ifndef COUCHNODE_JSONENCODER_H
+#define COUCHNODE_JSONENCODER_H 1
+#ifndef COUCHBASE_H
+#error "include couchbase_impl.h first"
+#endif
+
+namespace Couchnode
+{
+
+/**
+ * Serializes a V8 value graph directly into UTF-8 JSON.
+ *
+ * This handles the common case of plain objects, arrays, strings, numbers,
+ * booleans and null. Anything whose JSON form depends on user code (objects
+ * with a toJSON method, Dates, boxed primitives, Buffers) or which nests
+ * too deeply makes the encoder return FALLBACK, in which case the caller
+ * should defer to JSON.stringify so the output is unchanged.
+ *
+ * The output is written into a single growing buffer which is handed over
+ * to a BufferList once complete, so the document is never copied again.
+ */
+class JsonEncoder
+{
+public:
+    enum Status {
+        OK,
+        FALLBACK,
+        NOMEM
+    };
+
+    JsonEncoder(BufferPool *p = NULL)
+        : pool(p), data(NULL), used(0), capacity(0) { }
+    ~JsonEncoder() {
+        if (data) {
+            poolRelease(pool, data, capacity);
+        }
+    }
+
+    Status encode(Handle<Value> input);
+
+    /**
+     * Transfers ownership of the encoded buffer to the BufferList
+     * @param buf the list which will own (and free) the buffer
+     * @param n set to the length of the encoded data
+     * @return the encoded data
+     */
+    char *release(BufferList &buf, size_t *n);
+
+private:
+    Status writeValue(Handle<Value> v, unsigned int depth);
+    Status writeString(Handle<String> s);
+    Status writeNumber(double d);
+    Status writeArray(Handle<v8::Array> arr, unsigned int depth);
+    Status writeObject(Handle<Object> obj, unsigned int depth);
+
+    bool reserve(size_t n);
+    bool append(const char *s, size_t n) {
+        if (!reserve(n)) {
+            return false;
+        }
+        memcpy(data + used, s, n);
+        used += n;
+        return true;
+    }
+    bool append(char c) {
+        if (!reserve(1)) {
+            return false;
+        }
+        data[used++] = c;
+        return true;
+    }
+
+    static bool isSkipped(Handle<Value> v) {
+        return v->IsUndefined() || v->IsFunction();
+    }
+
+    static const unsigned int maxDepth = 128;
+    static const size_t initialSize = 256;
+
+    BufferPool *pool;
+    char *data;
+    size_t used;
+    size_t capacity;
+
+    // No copying
+    JsonEncoder(JsonEncoder&);
+};
+
+}
+
+#endif
@@ -0,0 +1,172 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "couchbase_impl.h"
+
+using namespace Couchnode;
+
+void KeyCache::setCapacity(size_t n)
+{
+    entries.clear();
+    entries.resize(n);
+    nused = 0;
+    head = tail = -1;
+
+    size_t nbuckets = 1;
+    while (nbuckets < n * 2) {
+        nbuckets <<= 1;
+    }
+    buckets.assign(n ? nbuckets : 0, -1);
+    mask = nbuckets - 1;
+}
+
+// FNV-1a over the UTF-16 code units
+uint32_t KeyCache::hashChars(const uint16_t *chars, unsigned int n)
+{
+    uint32_t h = 2166136261U;
+    for (unsigned int ii = 0; ii < n; ii++) {
+        h = (h ^ chars[ii]) * 16777619U;
+    }
+    return h;
+}
+
+int KeyCache::find(uint32_t hash, const uint16_t *chars, unsigned int n) const
+{
+    for (int ix = buckets[hash & mask]; ix != -1; ix = entries[ix].chain) {
+        const Entry &ent = entries[ix];
+        if (ent.hash == hash && ent.nchars == n &&
+                memcmp(&ent.data[0], chars, n * 2) == 0) {
+            return ix;
+        }
+    }
+    return -1;
+}
+
+void KeyCache::unlink(int ix)
+{
+    Entry &ent = entries[ix];
+    if (ent.prev != -1) {
+        entries[ent.prev].next = ent.next;
+    } else {
+        head = ent.next;
+    }
+    if (ent.next != -1) {
+        entries[ent.next].prev = ent.prev;
+    } else {
+        tail = ent.prev;
+    }
+}
+
+void KeyCache::pushFront(int ix)
+{
+    Entry &ent = entries[ix];
+    ent.prev = -1;
+    ent.next = head;
+    if (head != -1) {
+        entries[head].prev = ix;
+    }
+    head = ix;
+    if (tail == -1) {
+        tail = ix;
+    }
+}
+
+// Returns an unused entry, evicting the least recently used one if needed
+int KeyCache::allocate()
+{
+    if (nused < entries.size()) {
+        return nused++;
+    }
+
+    int ix = tail;
+    unlink(ix);
+
+    int *link = &buckets[entries[ix].hash & mask];
+    while (*link != ix) {
+        link = &entries[*link].chain;
+    }
+    *link = entries[ix].chain;
+    evictions++;
+    return ix;
+}
+
+bool KeyCache::encode(Handle<String> s, lcbvb_CONFIG *cfg, BufferList &bufs,
+                      char **k, size_t *n, int *vbid)
+{
+    int nchars = s->Length();
+    if (nchars == 0 || nchars > (int)MAX_KEY_LENGTH) {
+        return false;
+    }
+
+    uint16_t chars[MAX_KEY_LENGTH];
+    s->Write(chars, 0, nchars, String::NO_NULL_TERMINATION);
+    uint32_t hash = hashChars(chars, nchars);
+
+    int ix = find(hash, chars, nchars);
+    if (ix != -1) {
+        hits++;
+        unlink(ix);
+        pushFront(ix);
+
+    } else {
+        misses++;
+        size_t nutf8 = s->Utf8Length();
+        ix = allocate();
+
+        Entry &ent = entries[ix];
+        ent.hash = hash;
+        ent.nchars = nchars;
+        ent.nutf8 = nutf8;
+        ent.vbid = -1;
+        ent.nvb = 0;
+        ent.data.resize(nchars * 2 + nutf8);
+        memcpy(&ent.data[0], chars, nchars * 2);
+        s->WriteUtf8(&ent.data[0] + nchars * 2, nutf8, NULL,
+                     String::NO_NULL_TERMINATION);
+
+        ent.chain = buckets[hash & mask];
+        buckets[hash & mask] = ix;
+        pushFront(ix);
+    }
+
+    Entry &ent = entries[ix];
+    *n = ent.nutf8;
+    if (!(*k = bufs.getBuffer(*n))) {
+        return false;
+    }
+    memcpy(*k, ent.utf8(), *n);
+
+    *vbid = -1;
+    if (cfg && LCBVB_DISTTYPE(cfg) == LCBVB_DIST_VBUCKET && cfg->nvb) {
+        if (ent.nvb != cfg->nvb) {
+            ent.vbid = lcbvb_k2vb(cfg, ent.utf8(), ent.nutf8);
+            ent.nvb = cfg->nvb;
+        }
+        *vbid = ent.vbid;
+    }
+    return true;
+}
+
+Handle<Object> KeyCache::getStats() const
+{
+    Handle<Object> ret = NanNew<Object>();
+    ret->Set(NanNew<String>("hits"), NanNew<Number>((double)hits));
+    ret->Set(NanNew<String>("misses"), NanNew<Number>((double)misses));
+    ret->Set(NanNew<String>("evictions"), NanNew<Number>((double)evictions));
+    ret->Set(NanNew<String>("size"), NanNew<Number>((double)nused));
+    return ret;
+}
@@ -0,0 +1,100 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef COUCHNODE_KEYCACHE_H
+#define COUCHNODE_KEYCACHE_H 1
+
+#ifndef COUCHBASE_H
+#error "include couchbase_impl.h first"
+#endif
+
+namespace Couchnode
+{
+
+/**
+ * Bounded LRU cache of encoded keys.
+ *
+ * Each entry maps the UTF-16 contents of a key string to its UTF-8
+ * encoding and to the vBucket it hashes to. A hit skips the UTF-8
+ * conversion as well as the CRC32 hashing of the key inside libcouchbase.
+ * The vBucket is recomputed whenever the number of vBuckets changes.
+ */
+class KeyCache
+{
+public:
+    // Longer strings can never be valid keys, and are not cached
+    static const unsigned int MAX_KEY_LENGTH = 250;
+
+    KeyCache() : mask(0), head(-1), tail(-1), nused(0),
+        hits(0), misses(0), evictions(0) {}
+
+    bool isEnabled() const { return !entries.empty(); }
+
+    // Resizing the cache empties it. A size of 0 disables it.
+    size_t getCapacity() const { return entries.size(); }
+    void setCapacity(size_t n);
+
+    /**
+     * Writes the UTF-8 encoding of the key into a buffer from the list.
+     * @param cfg the current configuration, or NULL if the vBucket should
+     *  not be computed
+     * @param vbid set to the vBucket of the key, or -1 if not known
+     * @return false if the key cannot be cached. The caller should encode
+     *  the key itself.
+     */
+    bool encode(Handle<String> s, lcbvb_CONFIG *cfg, BufferList &bufs,
+                char **k, size_t *n, int *vbid);
+
+    Handle<Object> getStats() const;
+
+private:
+    struct Entry {
+        uint32_t hash;
+        unsigned int nchars;
+        size_t nutf8;
+        int vbid;
+        unsigned int nvb;
+        // LRU list, and collision chain
+        int prev;
+        int next;
+        int chain;
+        // UTF-16 contents followed by the UTF-8 encoding
+        std::vector<char> data;
+
+        const char *utf8() const { return &data[0] + nchars * 2; }
+    };
+
+    static uint32_t hashChars(const uint16_t *chars, unsigned int n);
+    int find(uint32_t hash, const uint16_t *chars, unsigned int n) const;
+    int allocate();
+    void unlink(int ix);
+    void pushFront(int ix);
+
+    std::vector<Entry> entries;
+    std::vector<int> buckets;
+    uint32_t mask;
+    int head;
+    int tail;
+    size_t nused;
+
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+};
+
+} // namespace Couchnode
+#endif // COUCHNODE_KEYCACHE_H
@@ -0,0 +1,149 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef COUCHNODE_KEYINDEX_H
+#define COUCHNODE_KEYINDEX_H 1
+
+#ifndef COUCHBASE_H
+#error "include couchbase_impl.h first"
+#endif
+
+#include <algorithm>
+
+namespace Couchnode
+{
+
+/**
+ * Maps the raw key of a response back to the position of its request.
+ *
+ * Keys are copied into a single buffer and sorted once, so a lookup is a
+ * binary search over memcmp() rather than a V8 property access. A key
+ * requested more than once resolves to each of its positions in turn.
+ */
+class KeyIndex
+{
+public:
+    KeyIndex() {}
+
+    void reserve(size_t nkeys) {
+        entries.reserve(nkeys);
+    }
+
+    void add(const char *key, size_t nkey, unsigned int ix) {
+        Entry ent;
+        ent.offset = keys.size();
+        ent.nkey = nkey;
+        ent.ix = ix;
+        ent.claimed = false;
+        keys.insert(keys.end(), key, key + nkey);
+        entries.push_back(ent);
+    }
+
+    // Must be called once all keys have been added
+    void seal() {
+        std::sort(entries.begin(), entries.end(), EntryLess(this));
+    }
+
+    /**
+     * Returns the request position of the key, marking it as used, or -1
+     * if the key was not requested (or all its positions are used).
+     */
+    int claim(const void *key, size_t nkey) {
+        Entry probe;
+        probe.offset = 0;
+        probe.nkey = nkey;
+        probe.ix = 0;
+        probe.claimed = false;
+
+        std::vector<Entry>::iterator it = std::lower_bound(
+                entries.begin(), entries.end(), probe,
+                ProbeLess(this, (const char *)key));
+
+        for (; it != entries.end() && it->nkey == nkey &&
+                memcmp(getKey(*it), key, nkey) == 0; ++it) {
+            if (!it->claimed) {
+                it->claimed = true;
+                return it->ix;
+            }
+        }
+        return -1;
+    }
+
+    bool empty() const { return entries.empty(); }
+
+    void swap(KeyIndex &other) {
+        keys.swap(other.keys);
+        entries.swap(other.entries);
+    }
+
+    // Empties the index while keeping its storage for reuse
+    void clear() {
+        keys.clear();
+        entries.clear();
+    }
+
+private:
+    struct Entry {
+        size_t offset;
+        size_t nkey;
+        unsigned int ix;
+        bool claimed;
+    };
+
+    const char *getKey(const Entry &ent) const {
+        return &keys[0] + ent.offset;
+    }
+
+    // Orders by length first, so most mismatches skip the memcmp()
+    static int compare(const char *a, size_t na, const char *b, size_t nb) {
+        if (na != nb) {
+            return na < nb ? -1 : 1;
+        }
+        return memcmp(a, b, na);
+    }
+
+    struct EntryLess {
+        EntryLess(const KeyIndex *p) : parent(p) {}
+        bool operator()(const Entry &a, const Entry &b) const {
+            int rv = compare(parent->getKey(a), a.nkey,
+                             parent->getKey(b), b.nkey);
+            if (rv != 0) {
+                return rv < 0;
+            }
+            return a.ix < b.ix;
+        }
+        const KeyIndex *parent;
+    };
+
+    struct ProbeLess {
+        ProbeLess(const KeyIndex *p, const char *k) : parent(p), key(k) {}
+        bool operator()(const Entry &a, const Entry &probe) const {
+            return compare(parent->getKey(a), a.nkey, key, probe.nkey) < 0;
+        }
+        const KeyIndex *parent;
+        const char *key;
+    };
+
+    std::vector<char> keys;
+    std::vector<Entry> entries;
+
+    // No copying
+    KeyIndex(KeyIndex&);
+};
+
+} // namespace Couchnode
+#endif // COUCHNODE_KEYINDEX_H
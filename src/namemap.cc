@@ -41,6 +41,7 @@ void NameMap::initialize()
     install("replicate_to", REPLICATE_TO);
     install("timeout", TIMEOUT);
     install("spooled", SPOOLED);
+    install("indexed", INDEXED);
     install("error", ERRORED);
     install("is_delete", IS_DELETE);
 
@@ -62,6 +63,8 @@ void NameMap::initialize()
     install("method", HTTP_METHOD);
     install("lcb_http_type", HTTP_TYPE);
     install("status", HTTP_STATUS);
+    install("stream", HTTP_STREAM);
+    install("rows", HTTP_ROWS);
 
     install("json", FMT_JSON);
     install("raw", FMT_RAW);
@@ -73,6 +76,8 @@ void NameMap::initialize()
     install("hashkey", HASHKEY);
 
     install("_handleRestResponse", RESTHANDLER);
+
+    install("toJSON", TOJSON);
 }
 
 void NameMap::install(const char *name, dict_t val)
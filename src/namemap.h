@@ -48,6 +48,7 @@ namespace Couchnode
             REPLICATE_TO,
             TIMEOUT,
             SPOOLED,
+            INDEXED,
             IS_DELETE,
             ERRORED,
             OBS_TTP,
@@ -67,6 +68,8 @@ namespace Couchnode
             HTTP_METHOD,
             HTTP_TYPE,
             HTTP_STATUS,
+            HTTP_STREAM,
+            HTTP_ROWS,
 
             FMT_RAW,
             FMT_UTF8,
@@ -79,6 +82,8 @@ namespace Couchnode
 
             RESTHANDLER,
 
+            TOJSON,
+
             MAX
         } dict_t;
         static v8::Persistent<v8::String> names[MAX];
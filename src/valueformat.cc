@@ -37,31 +37,54 @@ void ValueFormat::initialize()
     assert(!jsonStringify.IsEmpty());
 }
 
+extern "C" {
+static void releaseBackbuf(char *, void *hint)
+{
+    lcb_backbuf_unref(reinterpret_cast<lcb_BACKBUF>(hint));
+}
+}
+
 Handle<Value> ValueFormat::decode(const char *bytes, size_t n,
-                                  uint32_t flags)
+                                  uint32_t flags, void *backbuf)
 {
     uint32_t dtype = flags & MASK;
     if (dtype == UTF8) {
         return NanNew<String>(bytes, n);
 
     } else if (dtype == RAW) {
+        if (backbuf) {
+            // Hand out the network buffer itself; it stays pinned until the
+            // Buffer is garbage collected.
+            lcb_backbuf_ref(reinterpret_cast<lcb_BACKBUF>(backbuf));
+            return NanNewBufferHandle(const_cast<char*>(bytes), n,
+                                      releaseBackbuf, backbuf);
+        }
+
         // 0.8 defines this as char*, hence the cast
         return NanNewBufferHandle(const_cast<char*>(bytes), n);
 
     } else if (dtype == JSON) {
+        Handle<Value> ret;
+        JsonDecoder::Status status = JsonDecoder::decode(bytes, n, ret);
+        if (status == JsonDecoder::OK) {
+            return ret;
+        } else if (status == JsonDecoder::INVALID) {
+            return decode(bytes, n, RAW, backbuf);
+        }
+
+        // Valid, but needs JSON.parse to be reproduced exactly
         Handle<Value> s = decode(bytes, n, UTF8);
         v8::TryCatch try_catch;
         Local<Function> jsonParseLcl = NanNew(jsonParse);
-        Handle<Value> ret = jsonParseLcl->Call(
-                NanGetCurrentContext()->Global(), 1, &s);
+        ret = jsonParseLcl->Call(NanGetCurrentContext()->Global(), 1, &s);
         if (try_catch.HasCaught()) {
-            return decode(bytes, n, RAW);
+            return decode(bytes, n, RAW, backbuf);
         }
 
         return ret;
     } else {
         // unrecognized format
-        return decode(bytes, n, RAW);
+        return decode(bytes, n, RAW, backbuf);
     }
 
     return Handle<Value>();
@@ -182,6 +205,26 @@ bool ValueFormat::encode(Handle<Value> input,
 
     } else if (spec == JSON) {
         v8::TryCatch try_catch;
+        JsonEncoder encoder(buf.getPool());
+        JsonEncoder::Status status = encoder.encode(input);
+
+        if (try_catch.HasCaught()) {
+            ex.eArguments("Couldn't convert to JSON", try_catch.Exception());
+            return false;
+        }
+
+        if (status == JsonEncoder::NOMEM) {
+            ex.eMemory();
+            return false;
+
+        } else if (status == JsonEncoder::OK) {
+            *k = encoder.release(buf, n);
+            *flags = JSON;
+            *datatype = LCB_VALUE_F_JSON;
+            return true;
+        }
+
+        // Something the native encoder doesn't handle; defer to JS
         Local<Function> jsonStringifyLcl = NanNew(jsonStringify);
         Handle<Value> ret = jsonStringifyLcl->Call(
                 NanGetCurrentContext()->Global(), 1, &input);
@@ -87,8 +87,12 @@ public:
      * @param bytes the input buffer to decode
      * @param n the size of the input buffer
      * @param flags format specifier
+     * @param backbuf if not NULL, the lcb_BACKBUF holding `bytes`. A RAW
+     *        value is then returned as a Buffer referencing it, rather than
+     *        as a copy.
      */
-    static Handle<Value> decode(const char *bytes, size_t n, uint32_t flags);
+    static Handle<Value> decode(const char *bytes, size_t n, uint32_t flags,
+                                void *backbuf = NULL);
 
     /**
      * Encodes a value
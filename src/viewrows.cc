@@ -0,0 +1,162 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "couchbase_impl.h"
+#include <cstring>
+
+namespace Couchnode
+{
+
+static inline bool isJsonSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+const char * const ViewRowSplitter::viewKeys[] = { "rows", NULL };
+
+// "resultset" is used by the developer previews of the query service
+const char * const ViewRowSplitter::queryKeys[] = {
+    "results", "resultset", NULL
+};
+
+bool ViewRowSplitter::isRowKey() const
+{
+    if (nkey == sizeof(key)) {
+        return false;
+    }
+    for (const char * const *cur = rowKeys; *cur; cur++) {
+        if (strlen(*cur) == nkey && memcmp(key, *cur, nkey) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ViewRowSplitter::feed(const char *buf, size_t n)
+{
+    const char *end = buf + n;
+    // Start of the bytes not yet copied to the meta document or to a row
+    const char *run = buf;
+
+    for (const char *cur = buf; cur != end; cur++) {
+        char c = *cur;
+
+        if (inString) {
+            if (escaped) {
+                escaped = false;
+                // None of rowKeys contain escapes
+                nkey = sizeof(key);
+            } else if (c == '\\') {
+                escaped = true;
+            } else if (c == '"') {
+                inString = false;
+                if (phase == META) {
+                    keyState = depth == 1 && isRowKey() ? KEY_ROWS : KEY_NONE;
+                }
+            } else if (nkey < sizeof(key)) {
+                key[nkey++] = c;
+            }
+            continue;
+        }
+
+        switch (phase) {
+        case META:
+            if (c == '"') {
+                inString = true;
+                nkey = 0;
+            } else if (c == '{' || c == '[') {
+                depth++;
+                if (c == '[' && depth == ROWS_DEPTH && keyState == KEY_COLON) {
+                    meta.append(run, cur + 1 - run);
+                    run = cur + 1;
+                    phase = ROWS;
+                }
+                keyState = KEY_NONE;
+            } else if (c == '}' || c == ']') {
+                if (depth) {
+                    depth--;
+                }
+                keyState = KEY_NONE;
+            } else if (c == ':') {
+                keyState = keyState == KEY_ROWS ? KEY_COLON : KEY_NONE;
+            } else if (!isJsonSpace(c)) {
+                keyState = KEY_NONE;
+            }
+            break;
+
+        case ROWS:
+            if (c == ']') {
+                depth--;
+                phase = META;
+                run = cur;
+            } else if (c == ',' || isJsonSpace(c)) {
+                run = cur + 1;
+            } else {
+                phase = ROW;
+                run = cur;
+                if (c == '"') {
+                    inString = true;
+                } else if (c == '{' || c == '[') {
+                    depth++;
+                }
+            }
+            break;
+
+        case ROW:
+            if (c == '"') {
+                inString = true;
+            } else if (c == '{' || c == '[') {
+                depth++;
+            } else if (depth > ROWS_DEPTH) {
+                if ((c == '}' || c == ']') && --depth == ROWS_DEPTH) {
+                    endRow(run, cur + 1);
+                    run = cur + 1;
+                    phase = ROWS;
+                }
+            } else if (c == ',' || c == ']' || isJsonSpace(c)) {
+                // The end of a row which is a string or a number
+                endRow(run, cur);
+                if (c == ']') {
+                    depth--;
+                    phase = META;
+                    run = cur;
+                } else {
+                    phase = ROWS;
+                    run = cur + 1;
+                }
+            }
+            break;
+        }
+    }
+
+    if (phase == META) {
+        meta.append(run, end - run);
+    } else if (phase == ROW) {
+        rows.append(run, end - run);
+    }
+}
+
+void ViewRowSplitter::clearRows()
+{
+    if (rowEnds.empty()) {
+        return;
+    }
+    rows.erase(0, rowEnds.back());
+    rowEnds.clear();
+}
+
+} // namespace Couchnode
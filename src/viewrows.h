@@ -0,0 +1,113 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2014 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#ifndef COUCHNODE_VIEWROWS_H
+#define COUCHNODE_VIEWROWS_H 1
+
+#ifndef COUCHBASE_H
+#error "include couchbase_impl.h first"
+#endif
+
+namespace Couchnode
+{
+
+/**
+ * Splits the body of a view or N1QL response into its rows while it is
+ * being received, so that rows can be handed out without waiting for (or
+ * holding) the whole body.
+ *
+ * The elements of the top-level rows array ("rows" for views) are returned
+ * as the JSON text of each row. Everything else in the body (total_rows,
+ * errors, ...) is kept as the meta document, in which the rows array is left
+ * empty. A body without a rows array, such as an error page, ends up
+ * entirely in the meta document.
+ */
+class ViewRowSplitter
+{
+public:
+    // Keys of the rows array in view and N1QL responses
+    static const char * const viewKeys[];
+    static const char * const queryKeys[];
+
+    // rowKeys is a NULL-terminated list of the keys which may hold the rows
+    explicit ViewRowSplitter(const char * const *rowKeys = viewKeys)
+        : rowKeys(rowKeys), phase(META), depth(0), inString(false),
+        escaped(false), nkey(0), keyState(KEY_NONE) {}
+
+    // Consumes the next fragment of the body
+    void feed(const char *buf, size_t n);
+
+    // Number of complete rows received since the last clearRows()
+    size_t rowCount() const { return rowEnds.size(); }
+
+    const char *rowAt(size_t ix, size_t *n) const {
+        size_t begin = ix ? rowEnds[ix - 1] : 0;
+        *n = rowEnds[ix] - begin;
+        return rows.data() + begin;
+    }
+
+    // Drops the complete rows, keeping any partially received one
+    void clearRows();
+
+    const std::string& getMeta() const { return meta; }
+
+private:
+    enum Phase {
+        // Outside of the rows array
+        META,
+        // Between two elements of the rows array
+        ROWS,
+        // Within an element of the rows array
+        ROW
+    };
+
+    // Progress towards a top-level "rows": [ (or another of rowKeys)
+    enum KeyState {
+        KEY_NONE,
+        KEY_ROWS,
+        KEY_COLON
+    };
+
+    // Depth of the elements of the rows array
+    static const unsigned int ROWS_DEPTH = 2;
+
+    void endRow(const char *begin, const char *end) {
+        rows.append(begin, end - begin);
+        rowEnds.push_back(rows.size());
+    }
+
+    bool isRowKey() const;
+
+    const char * const *rowKeys;
+    Phase phase;
+    unsigned int depth;
+    bool inString;
+    bool escaped;
+
+    // The top-level key being read. Only rowKeys are of interest, so longer
+    // keys are truncated.
+    char key[16];
+    size_t nkey;
+    KeyState keyState;
+
+    std::string meta;
+    std::string rows;
+    std::vector<size_t> rowEnds;
+};
+
+} // namespace Couchnode
+
+#endif
@@ -25,4 +25,159 @@ describe('#ctl', function() {
     done();
   });
 
+  it('should reuse operation state between operations', function(done) {
+    var cb = H.client;
+    var key = H.genKey("ctlCookiePool");
+    cb.set(key, "blah", H.okCallback(function(){
+      // The set's state is released once this callback returns
+      setImmediate(function() {
+        cb.get(key, H.okCallback(function(){
+          var stats = cb.cookiePoolStats;
+          assert.equal(typeof stats, 'object');
+          assert(stats.hits > 0);
+          assert(stats.highWater >= stats.inUse);
+          assert(cb.cookiePoolSize > 0);
+          done();
+        }));
+      });
+    }));
+  });
+
+  it('should reuse command buffers between batches', function(done) {
+    var cb = H.client;
+    var kv = {};
+    for (var i = 0; i < 50; i++) {
+      kv[H.genKey("ctlBufferPool" + i)] = { value: new Array(200).join('x') };
+    }
+
+    cb.setMulti(kv, {spooled: true}, H.okCallback(function(){
+      var before = cb.bufferPoolStats;
+      assert(before.cachedBytes > 0);
+      cb.setMulti(kv, {spooled: true}, H.okCallback(function(){
+        var after = cb.bufferPoolStats;
+        assert.equal(after.misses, before.misses);
+        assert(after.hits > before.hits);
+        done();
+      }));
+    }));
+  });
+
+  it('should cache encoded keys', function(done) {
+    var cb = H.client;
+    var key = H.genKey("ctlKeyCache");
+    cb.keyCacheSize = 128;
+    assert.equal(cb.keyCacheSize, 128);
+    cb.set(key, "blah", H.okCallback(function(){
+      cb.get(key, H.okCallback(function(res){
+        assert.equal(res.value, "blah");
+        var stats = cb.keyCacheStats;
+        assert(stats.hits > 0);
+        assert(stats.size > 0);
+        cb.keyCacheSize = 0;
+        assert.equal(cb.keyCacheStats.size, 0);
+        done();
+      }));
+    }));
+  });
+
+  it('should track latencies', function(done) {
+    var cb = H.client;
+    var key = H.genKey("ctlLatency");
+    cb.latencyTracking = true;
+    assert.equal(cb.latencyTracking, true);
+    cb.latencySnapshot(true);
+    cb.set(key, "blah", H.okCallback(function(){
+      cb.get(key, H.okCallback(function(){
+        var snap = cb.latencySnapshot(true);
+        var servers = Object.keys(snap);
+        assert(servers.length > 0);
+        var ops = {};
+        servers.forEach(function(server) {
+          Object.keys(snap[server]).forEach(function(op) {
+            var st = snap[server][op];
+            assert(st.min <= st.p50 && st.p50 <= st.p99 && st.p99 <= st.p999);
+            assert(st.p999 <= st.max);
+            ops[op] = (ops[op] || 0) + st.count;
+          });
+        });
+        assert.equal(ops.set, 1);
+        assert.equal(ops.get, 1);
+        assert.deepEqual(cb.latencySnapshot(), {});
+        cb.latencyTracking = false;
+        done();
+      }));
+    }));
+  });
+
+  it('should configure compression', function() {
+    var cb = H.client;
+    var orig = cb.compression;
+    assert.equal(orig.mode, 'off');
+    cb.compression = { minSize: 1024, maxSampleInterval: 16 };
+    var policy = cb.compression;
+    assert.equal(policy.minSize, 1024);
+    assert.equal(policy.maxSampleInterval, 16);
+    assert.equal(policy.minRatio, orig.minRatio);
+    assert.throws(function() {
+      cb.compression = { mode: 'bogus' };
+    });
+    assert.equal(typeof cb.compressionStats.bytesSaved, 'number');
+    cb.compression = orig;
+  });
+
+  it('should configure the connection pool', function() {
+    var cb = H.client;
+    var orig = cb.connectionPool;
+    cb.connectionPool = { minIdle: 1, maxIdle: 2 };
+    var opts = cb.connectionPool;
+    assert.equal(opts.minIdle, 1);
+    assert.equal(opts.maxIdle, 2);
+    assert.equal(opts.idleTimeout, orig.idleTimeout);
+
+    var stats = cb.connectionPoolStats;
+    var hosts = Object.keys(stats);
+    assert(hosts.length > 0);
+    hosts.forEach(function(host) {
+      assert(stats[host].connects >= stats[host].total - stats[host].pending);
+    });
+    cb.connectionPool = orig;
+  });
+
+  it('should spread operations over several connections', function(done) {
+    var cb = H.client;
+    var orig = cb.kvConnections;
+    cb.kvConnections = { count: 3, largeValueSize: 65536 };
+    var opts = cb.kvConnections;
+    assert.equal(opts.count, 3);
+    assert.equal(opts.largeValueSize, 65536);
+
+    var key = H.genKey("ctlKvConns");
+    cb.upsert(key, new Buffer(100000), H.okCallback(function() {
+      cb.get(key, H.okCallback(function() {
+        cb.kvConnections = orig;
+        done();
+      }));
+    }));
+  });
+
+  it('should get cluster map statistics', function() {
+    var stats = H.client.configStats;
+    assert(typeof stats.applied === 'number');
+    assert(stats.relocated <= stats.checked);
+    assert(stats.lastTime <= stats.totalTime);
+  });
+
+  it('should count writes to the data nodes', function(done) {
+    var cb = H.client;
+    var before = cb.writeStats;
+    var key = H.genKey("ctlWriteStats");
+    cb.upsert(key, "value", H.okCallback(function() {
+      var after = cb.writeStats;
+      assert(after.writes > before.writes);
+      assert(after.bytes > before.bytes);
+      assert(after.buffers >= after.writes);
+      done();
+    }));
+  });
+
 });
@@ -153,6 +153,101 @@ describe('#design documents', function() {
     ]);
   });
 
+  it('should stream view rows', function(done) {
+    var cb = H.client;
+    this.timeout(60000);
+
+    var docname = H.genKey("streamtest");
+    var ddoc = {
+      "views": {
+        "simple": {
+          "map": "function(doc,meta){if(doc.x=='"+docname+"'){emit(meta.id);}}"
+        }
+      }
+    };
+
+    var keys = [];
+
+    function TestPopulate(callback) {
+      var multikv = {};
+      for (var i = 0; i < 12; ++i) {
+        var kn = docname+"-"+i;
+        keys.push(kn);
+        multikv[kn] = {value:{x:docname}};
+      }
+
+      cb.setMulti(multikv, {}, function(){
+        callback(null, 1);
+      });
+    }
+
+    function TestDD(callback) {
+      cb.setDesignDoc(docname, ddoc, function() {
+        function checkView(){
+          var q = cb.view(docname, "simple", {limit:1});
+          q.query(function(err, results) {
+            if (err) {
+              checkView();
+            } else {
+              setTimeout(function(){
+                callback(null, 2);
+              }, 1000);
+            }
+          });
+        }
+        checkView();
+      });
+    }
+
+    function TestStream(callback) {
+      var q = cb.view(docname, "simple", {stale: false});
+      var stream = q.stream();
+      var rows = [];
+      var gotMeta = false;
+
+      stream.on('row', function(row) {
+        rows.push(row);
+        // No rows are emitted while paused
+        if (rows.length === 1) {
+          stream.pause();
+          setTimeout(function() {
+            assert.equal(rows.length, 1, "row emitted while paused");
+            stream.resume();
+          }, 100);
+        }
+      });
+      stream.on('meta', function(meta) {
+        assert.equal(meta.total_rows, 12, "wrong total_rows");
+        gotMeta = true;
+      });
+      stream.on('error', function(err) {
+        assert(!err, "stream failed");
+      });
+      stream.on('end', function() {
+        assert(gotMeta, "no meta emitted");
+        assert.equal(rows.length, 12, "wrong row count");
+        assert(keys.indexOf(rows[0].id) >= 0, "unknown row id");
+        callback(null, 3);
+      });
+    }
+
+    function Shutdown(callback) {
+      cb.removeDesignDoc(docname, function(err, result) {
+        cb.removeMulti(keys, {}, function(err, results) {
+          done();
+          callback(null, 4);
+        });
+      });
+    }
+
+    async.series([
+      TestPopulate,
+      TestDD,
+      TestStream,
+      Shutdown
+    ]);
+  });
+
   it('should work with queries', function(done) {
     var cb = H.client;
     this.timeout(30000);
@@ -90,6 +90,79 @@ describe('#get/set', function() {
     }));
   });
 
+  it('should encode documents identically to JSON.stringify', function(done) {
+    var cb = H.client;
+    var value = {
+      str: 'quote " backslash \\ newline \n tab \t ctl \u0001 ☆',
+      nums: [0, -0, 1, -1, 3.14, 1e21, 1e-7, 2147483648, NaN, Infinity],
+      nested: { arr: [true, false, null, undefined, function(){}], o: {} },
+      skipped: undefined
+    };
+    var key = H.genKey("set-json-native");
+
+    cb.set(key, value, H.okCallback(function(){
+      cb.get(key, { format: 'raw' }, H.okCallback(function(result){
+        assert.deepEqual(JSON.parse(result.value.toString()),
+          JSON.parse(JSON.stringify(value)));
+        done();
+      }));
+    }));
+  });
+
+  it('should format numbers identically to JSON.stringify', function(done) {
+    var cb = H.client;
+    var value = [1e-7, 1e-6, 1.5e-7, 1e20, 1e21, 1.5e21, 0.1, 1/3, -2.5e-8,
+      123456789012345680000, 1.7976931348623157e308, 5e-324, 0.30000000000000004];
+    var key = H.genKey("set-json-numbers");
+
+    cb.set(key, value, H.okCallback(function(){
+      cb.get(key, { format: 'raw' }, H.okCallback(function(result){
+        assert.equal(result.value.toString(), JSON.stringify(value));
+        done();
+      }));
+    }));
+  });
+
+  it('should decode documents identically to JSON.parse', function(done) {
+    var cb = H.client;
+    var docs = [
+      '{"a":1,"b":-0.5,"c":"str","d":true,"e":null}',
+      ' { "nested" : [1, {"x": [[], {}]}, "esc\\"\\\\\\n\\u00e9\\ud83d\\ude00"] } ',
+      '{"__proto__": 1, "dup": 1, "dup": 2}',
+      '[1e3, -0, 12345678901234567890, 0.1]',
+      '"just a string"'
+    ];
+    var remaining = docs.length;
+
+    docs.forEach(function(doc, ix) {
+      var key = H.genKey("get-json-native-" + ix);
+      cb.set(key, doc, { format: 'utf8', flags: H.format.json },
+          H.okCallback(function() {
+        cb.get(key, H.okCallback(function(result) {
+          assert.deepEqual(result.value, JSON.parse(doc));
+          if (--remaining === 0) {
+            done();
+          }
+        }));
+      }));
+    });
+  });
+
+  it('should return invalid JSON documents as Buffers', function(done) {
+    var cb = H.client;
+    var key = H.genKey("get-json-invalid");
+    var doc = '{"a": 01}';
+
+    cb.set(key, doc, { format: 'utf8', flags: H.format.json },
+        H.okCallback(function() {
+      cb.get(key, H.okCallback(function(result) {
+        assert(Buffer.isBuffer(result.value));
+        assert.equal(result.value.toString(), doc);
+        done();
+      }));
+    }));
+  });
+
   it('should properly handle setting raw strings', function(done) {
     var cb = H.client;
     var value = "hello";
@@ -134,6 +207,27 @@ describe('#get/set', function() {
     }));
   });
 
+  it('should store and return large raw values without copying', function(done) {
+    var cb = H.client;
+    var buf = new Buffer(256 * 1024);
+    for (var ii = 0; ii < buf.length; ii++) {
+      buf[ii] = ii & 0xff;
+    }
+    var key = H.genKey("get-raw-zerocopy");
+
+    cb.zeroCopyThreshold = 1024;
+    assert.equal(cb.zeroCopyThreshold, 1024);
+    cb.set(key, buf, H.okCallback(function(){
+      cb.get(key, function(err, result){
+        cb.zeroCopyThreshold = 0;
+        assert(!err);
+        assert(Buffer.isBuffer(result.value));
+        assert.deepEqual(result.value, buf);
+        done();
+      });
+    }));
+  });
+
   it('should allow overriding of flags', function(done) {
     var cb = H.client;
     var value = {val:"value"};
@@ -193,4 +287,35 @@ describe('#get/set', function() {
     }));
   });
 
+
+  it('should deliver batched callbacks', function(done) {
+    var cb = H.client;
+    var key = H.genKey("batched");
+    var missing = H.genKey("batched-missing");
+    var count = 10;
+    var seen = 0;
+
+    cb.set(key, "bar", H.okCallback(function(){
+      cb.batchCallbacks = true;
+      assert.strictEqual(cb.batchCallbacks, true);
+
+      cb.get(missing, function(err, result) {
+        assert(err, "Key should not exist");
+        seen++;
+      });
+
+      var gotOne = H.okCallback(function(result){
+        assert.equal(result.value, "bar");
+        if (++seen === count + 1) {
+          cb.batchCallbacks = false;
+          assert.strictEqual(cb.batchCallbacks, false);
+          done();
+        }
+      });
+      for (var i = 0; i < count; i++) {
+        cb.get(key, gotOne);
+      }
+    }));
+  });
+
 });
@@ -82,4 +82,30 @@ describe('#getMulti/setMulti', function() {
     });
   });
 
+  it('should return results by position when indexed', function(done) {
+    var cb = H.client;
+    var badKey = H.genKey("test-multiget-indexed-error");
+    var goodKey = H.genKey("test-multiget-indexed");
+    var goodValue = 'foo';
+
+    cb.set(goodKey, goodValue, function(err, result) {
+      assert.ifError(err);
+      var keys = [badKey, goodKey, goodKey];
+
+      cb.getMulti(keys, {indexed: true}, function(err, results) {
+        assert.strictEqual(err.code, H.errors.checkResults);
+        assert(Array.isArray(results));
+        assert.equal(results.length, keys.length);
+        assert.strictEqual(results[0].error.code, H.errors.keyNotFound);
+        assert.equal(results[1].value, goodValue);
+        assert.equal(results[2].value, goodValue);
+
+        assert.deepEqual(Object.keys(results.byKey).sort(),
+                         [badKey, goodKey].sort());
+        assert.equal(results.byKey[goodKey].value, goodValue);
+        done();
+      });
+    });
+  });
+
 });
@@ -29,4 +29,34 @@ var H = require('../test_harness.js');
     });
   });
 
+  it('should stream query results', function(done) {
+    var cb = H.client;
+    var nrows = 0;
+    var meta = null;
+    var stream = cb.queryStream('SELECT * FROM default');
+    stream.on('row', function(row) {
+      assert.equal(typeof row, 'object');
+      nrows++;
+    });
+    stream.on('meta', function(m) {
+      meta = m;
+    });
+    stream.on('error', function(err) {
+      assert(!err, 'Failed to execute query.');
+    });
+    stream.on('end', function() {
+      assert(meta, 'No response metadata.');
+      var results = meta.results || meta.resultset;
+      assert(Array.isArray(results));
+      assert.equal(results.length, 0);
+
+      // The query node was measured
+      var stats = cb.queryHostStats;
+      var hosts = Object.keys(stats);
+      assert(hosts.length > 0);
+      assert(hosts.some(function(host) { return stats[host].latency > 0; }));
+      done();
+    });
+  });
+
 });